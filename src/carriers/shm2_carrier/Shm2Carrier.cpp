@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include "Shm2Carrier.h"
+#include "Shm2Stream.h"
+
+#include <yarp/os/ConnectionState.h>
+#include <yarp/os/Log.h>
+
+#include <atomic>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+
+// Initial size of the rings, they grow to fit larger messages.
+constexpr size_t shm2DefaultCapacity = 1024 * 1024;
+
+std::atomic<int> shm2Counter {0};
+
+std::string segmentBaseName(int pid, int index)
+{
+    return "/yarp-shm2-" + std::to_string(pid) + "-" + std::to_string(index);
+}
+
+} // namespace
+
+
+Shm2Carrier::Shm2Carrier() = default;
+
+Shm2Carrier::~Shm2Carrier() = default;
+
+yarp::os::Carrier* Shm2Carrier::create() const
+{
+    return new Shm2Carrier();
+}
+
+std::string Shm2Carrier::getName() const
+{
+    return "shm2";
+}
+
+int Shm2Carrier::getSpecifierCode() const
+{
+    return 15;
+}
+
+bool Shm2Carrier::requireAck() const
+{
+    return false;
+}
+
+bool Shm2Carrier::isConnectionless() const
+{
+    return false;
+}
+
+bool Shm2Carrier::checkHeader(const yarp::os::Bytes& header)
+{
+    return getSpecifier(header) % 16 == getSpecifierCode();
+}
+
+void Shm2Carrier::getHeader(yarp::os::Bytes& header) const
+{
+    createStandardHeader(getSpecifierCode(), header);
+}
+
+void Shm2Carrier::setParameters(const yarp::os::Bytes& header)
+{
+    YARP_UNUSED(header);
+}
+
+bool Shm2Carrier::respondToHeader(yarp::os::ConnectionState& proto)
+{
+    // i am the receiver: create the segments, and tell the sender
+    // where to find them.
+    int pid = static_cast<int>(getpid());
+    int index = shm2Counter++;
+    auto* stream = new Shm2Stream(proto.getStreams().getLocalAddress(),
+                                  proto.getStreams().getRemoteAddress());
+    if (!stream->open(segmentBaseName(pid, index), false, shm2DefaultCapacity)) {
+        delete stream;
+        writeYarpInt(-1, proto);
+        return false;
+    }
+    writeYarpInt(pid, proto);
+    writeYarpInt(index, proto);
+    proto.os().flush();
+
+    // Wait for the sender to map the segments.
+    if (readYarpInt(proto) != 1) {
+        yError("shm2: the sender could not attach to the shared memory, is it on the same host?");
+        delete stream;
+        return false;
+    }
+    proto.takeStreams(stream);
+    return true;
+}
+
+bool Shm2Carrier::expectReplyToHeader(yarp::os::ConnectionState& proto)
+{
+    // i am the sender
+    int pid = readYarpInt(proto);
+    if (pid <= 0) {
+        return false;
+    }
+    int index = readYarpInt(proto);
+    auto* stream = new Shm2Stream(proto.getStreams().getLocalAddress(),
+                                  proto.getStreams().getRemoteAddress());
+    bool ok = stream->open(segmentBaseName(pid, index), true, 0);
+    writeYarpInt(ok ? 1 : 0, proto);
+    proto.os().flush();
+    if (!ok) {
+        delete stream;
+        return false;
+    }
+    proto.takeStreams(stream);
+    return true;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SHM2_SHM2CARRIER_H
+#define YARP_SHM2_SHM2CARRIER_H
+
+#include <yarp/os/AbstractCarrier.h>
+
+
+/**
+ * Communicating between two ports on the same host via POSIX shared
+ * memory.
+ *
+ * The connection is negotiated over tcp as usual.  Then the receiver
+ * creates two ring buffers with shm_open (one for data and one for
+ * replies), the sender maps them, and the tcp socket is closed.  Each
+ * message is copied once into the ring, and the ends wake each other
+ * up with futexes, without any system call while the rings are busy.
+ * The data ring grows automatically to fit large messages, such as
+ * high resolution images.
+ */
+class Shm2Carrier :
+        public yarp::os::AbstractCarrier
+{
+public:
+    Shm2Carrier();
+    virtual ~Shm2Carrier();
+
+    Carrier* create() const override;
+
+    std::string getName() const override;
+
+    virtual int getSpecifierCode() const;
+    bool requireAck() const override;
+    bool isConnectionless() const override;
+    bool checkHeader(const yarp::os::Bytes& header) override;
+    void getHeader(yarp::os::Bytes& header) const override;
+    void setParameters(const yarp::os::Bytes& header) override;
+    bool respondToHeader(yarp::os::ConnectionState& proto) override;
+    bool expectReplyToHeader(yarp::os::ConnectionState& proto) override;
+};
+
+#endif // YARP_SHM2_SHM2CARRIER_H
@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include "Shm2Ring.h"
+
+#include <yarp/os/Log.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex words must be plain 32 bit integers");
+
+namespace {
+
+constexpr std::uint32_t shm2Magic = 0x324d4853; // "SHM2"
+constexpr std::uint32_t shm2Version = 1;
+constexpr size_t minCapacity = 4096;
+constexpr size_t maxCapacity = size_t{1} << 30;
+constexpr int spinCount = 1000;
+constexpr long waitSliceNs = 100000000; // check the peer every 100 ms
+
+size_t roundCapacity(size_t len)
+{
+    size_t cap = minCapacity;
+    while (cap < len && cap < maxCapacity) {
+        cap <<= 1;
+    }
+    return cap;
+}
+
+void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t seen)
+{
+    struct timespec ts
+    {
+        0, waitSliceNs
+    };
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, seen, &ts, nullptr, 0);
+}
+
+void futexWake(std::atomic<std::uint32_t>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+bool processAlive(std::int32_t pid)
+{
+    if (pid <= 0) {
+        // not attached yet
+        return true;
+    }
+    return (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+// Spin for a while, then sleep on the futex word until ready() holds.
+// Returns false if the ring was closed, or if the other end died.
+template <typename Ready>
+bool waitOn(Shm2RingHeader* header,
+            std::atomic<std::uint32_t>& word,
+            std::atomic<std::uint32_t>& waiting,
+            const std::atomic<std::int32_t>& peerPid,
+            Ready ready)
+{
+    for (int i = 0; i < spinCount; i++) {
+        if (ready()) {
+            return true;
+        }
+    }
+    while (true) {
+        std::uint32_t seen = word.load();
+        if (ready()) {
+            return true;
+        }
+        if (header->closed.load() != 0) {
+            return false;
+        }
+        waiting.store(1);
+        if (ready()) {
+            waiting.store(0);
+            return true;
+        }
+        futexWait(word, seen);
+        waiting.store(0);
+        if (!processAlive(peerPid.load())) {
+            header->closed.store(1);
+        }
+    }
+}
+
+} // namespace
+
+
+Shm2Ring::Shm2Ring() :
+        generation(0),
+        producer(false),
+        owner(false),
+        mem(nullptr),
+        memSize(0),
+        header(nullptr),
+        data(nullptr)
+{
+}
+
+Shm2Ring::~Shm2Ring()
+{
+    close();
+}
+
+std::string Shm2Ring::segmentName(std::uint32_t generation) const
+{
+    if (generation == 0) {
+        return baseName;
+    }
+    return baseName + "." + std::to_string(generation);
+}
+
+bool Shm2Ring::map(const std::string& segment, bool create, size_t capacity)
+{
+    int fd = shm_open(segment.c_str(), O_RDWR | (create ? (O_CREAT | O_EXCL) : 0), 0600);
+    if (fd < 0) {
+        yError("shm2: cannot open shared memory %s: %s", segment.c_str(), strerror(errno));
+        return false;
+    }
+
+    size_t size = sizeof(Shm2RingHeader) + capacity;
+    if (create) {
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            yError("shm2: cannot resize shared memory %s: %s", segment.c_str(), strerror(errno));
+            ::close(fd);
+            shm_unlink(segment.c_str());
+            return false;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) <= sizeof(Shm2RingHeader)) {
+            yError("shm2: invalid shared memory %s", segment.c_str());
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+    }
+
+    void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        yError("shm2: cannot map shared memory %s: %s", segment.c_str(), strerror(errno));
+        if (create) {
+            shm_unlink(segment.c_str());
+        }
+        return false;
+    }
+
+    auto* h = static_cast<Shm2RingHeader*>(m);
+    if (create) {
+        h = new (m) Shm2RingHeader();
+        h->magic = shm2Magic;
+        h->version = shm2Version;
+        h->capacity = capacity;
+    } else if (h->magic != shm2Magic || h->version != shm2Version || h->capacity + sizeof(Shm2RingHeader) != size) {
+        yError("shm2: shared memory %s has an unexpected layout", segment.c_str());
+        munmap(m, size);
+        return false;
+    }
+
+    mem = m;
+    memSize = size;
+    header = h;
+    data = static_cast<char*>(m) + sizeof(Shm2RingHeader);
+    return true;
+}
+
+void Shm2Ring::unmap()
+{
+    if (mem != nullptr) {
+        munmap(mem, memSize);
+    }
+    mem = nullptr;
+    memSize = 0;
+    header = nullptr;
+    data = nullptr;
+}
+
+bool Shm2Ring::create(const std::string& name, size_t capacity, bool producer)
+{
+    close();
+    baseName = name;
+    generation = 0;
+    this->producer = producer;
+    if (!map(segmentName(generation), true, roundCapacity(capacity))) {
+        return false;
+    }
+    owner = true;
+    if (producer) {
+        header->producerPid.store(getpid());
+    } else {
+        header->consumerPid.store(getpid());
+    }
+    return true;
+}
+
+bool Shm2Ring::attach(const std::string& name, bool producer)
+{
+    close();
+    baseName = name;
+    generation = 0;
+    this->producer = producer;
+    if (!map(segmentName(generation), false, 0)) {
+        return false;
+    }
+    // Both ends have the segment mapped, its name is no longer needed.
+    shm_unlink(segmentName(generation).c_str());
+    owner = false;
+    if (producer) {
+        header->producerPid.store(getpid());
+    } else {
+        header->consumerPid.store(getpid());
+    }
+    header->attached.store(1);
+    return true;
+}
+
+bool Shm2Ring::grow(size_t len)
+{
+    size_t cap = roundCapacity(2 * len);
+    if (cap <= header->capacity) {
+        return false;
+    }
+
+    void* oldMem = mem;
+    size_t oldSize = memSize;
+    Shm2RingHeader* oldHeader = header;
+    char* oldData = data;
+    std::uint32_t nextGeneration = generation + 1;
+    if (!map(segmentName(nextGeneration), true, cap)) {
+        mem = oldMem;
+        memSize = oldSize;
+        header = oldHeader;
+        data = oldData;
+        return false;
+    }
+    header->producerPid.store(getpid());
+    header->consumerPid.store(oldHeader->consumerPid.load());
+    generation = nextGeneration;
+    owner = true;
+
+    // Everything written so far stays in the old segment, the consumer
+    // drains it before moving to the new one.
+    oldHeader->next.store(nextGeneration);
+    oldHeader->dataFutex.fetch_add(1);
+    futexWake(oldHeader->dataFutex);
+    munmap(oldMem, oldSize);
+    return true;
+}
+
+bool Shm2Ring::follow()
+{
+    std::uint32_t nextGeneration = header->next.load();
+    std::int32_t producerPid = header->producerPid.load();
+    unmap();
+    std::string segment = segmentName(nextGeneration);
+    if (!map(segment, false, 0)) {
+        return false;
+    }
+    shm_unlink(segment.c_str());
+    generation = nextGeneration;
+    owner = false;
+    header->consumerPid.store(getpid());
+    if (header->producerPid.load() == 0) {
+        header->producerPid.store(producerPid);
+    }
+    header->attached.store(1);
+    return true;
+}
+
+bool Shm2Ring::waitForData(std::uint64_t readSeq)
+{
+    Shm2RingHeader* h = header;
+    return waitOn(h, h->dataFutex, h->consumerWaiting, h->producerPid, [h, readSeq]() {
+        return h->writeSeq.load() != readSeq || h->next.load() != 0;
+    });
+}
+
+bool Shm2Ring::waitForSpace(std::uint64_t writeSeq)
+{
+    Shm2RingHeader* h = header;
+    return waitOn(h, h->spaceFutex, h->producerWaiting, h->consumerPid, [h, writeSeq]() {
+        return writeSeq - h->readSeq.load() < h->capacity;
+    });
+}
+
+bool Shm2Ring::write(const char* src, size_t len)
+{
+    if (header == nullptr || !producer) {
+        return false;
+    }
+    if (len > header->capacity) {
+        // If the ring cannot grow, the data goes through it in chunks.
+        grow(len);
+    }
+
+    const std::uint64_t cap = header->capacity;
+    const std::uint64_t mask = cap - 1;
+    std::uint64_t w = header->writeSeq.load(std::memory_order_relaxed);
+    while (len > 0) {
+        if (header->closed.load() != 0) {
+            return false;
+        }
+        std::uint64_t space = cap - (w - header->readSeq.load(std::memory_order_acquire));
+        if (space == 0) {
+            if (!waitForSpace(w)) {
+                return false;
+            }
+            continue;
+        }
+        size_t n = static_cast<size_t>(std::min<std::uint64_t>(space, len));
+        size_t at = static_cast<size_t>(w & mask);
+        size_t first = std::min(n, static_cast<size_t>(cap) - at);
+        memcpy(data + at, src, first);
+        if (n > first) {
+            memcpy(data, src + first, n - first);
+        }
+        w += n;
+        src += n;
+        len -= n;
+        header->writeSeq.store(w);
+        header->dataFutex.fetch_add(1);
+        if (header->consumerWaiting.load() != 0) {
+            futexWake(header->dataFutex);
+        }
+    }
+    return true;
+}
+
+yarp::conf::ssize_t Shm2Ring::read(char* dest, size_t len)
+{
+    if (header == nullptr || producer) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    while (true) {
+        std::uint64_t r = header->readSeq.load(std::memory_order_relaxed);
+        std::uint64_t avail = header->writeSeq.load(std::memory_order_acquire) - r;
+        if (avail > 0) {
+            const std::uint64_t cap = header->capacity;
+            size_t n = static_cast<size_t>(std::min<std::uint64_t>(avail, len));
+            size_t at = static_cast<size_t>(r & (cap - 1));
+            size_t first = std::min(n, static_cast<size_t>(cap) - at);
+            memcpy(dest, data + at, first);
+            if (n > first) {
+                memcpy(dest + first, data, n - first);
+            }
+            header->readSeq.store(r + n);
+            header->spaceFutex.fetch_add(1);
+            if (header->producerWaiting.load() != 0) {
+                futexWake(header->spaceFutex);
+            }
+            return static_cast<yarp::conf::ssize_t>(n);
+        }
+        if (header->next.load() != 0) {
+            if (!follow()) {
+                return -1;
+            }
+            continue;
+        }
+        if (!waitForData(r)) {
+            // Closed, but there may still be data written before that.
+            if (header->writeSeq.load() == r && header->next.load() == 0) {
+                return -1;
+            }
+        }
+    }
+}
+
+void Shm2Ring::interrupt()
+{
+    if (header != nullptr) {
+        header->closed.store(1);
+        header->dataFutex.fetch_add(1);
+        header->spaceFutex.fetch_add(1);
+        futexWake(header->dataFutex);
+        futexWake(header->spaceFutex);
+    }
+}
+
+void Shm2Ring::close()
+{
+    if (header == nullptr) {
+        return;
+    }
+    if (!producer) {
+        // Let the producer know, even if it already moved to a larger
+        // segment.
+        while (header->next.load() != 0 && follow()) {
+        }
+        if (header == nullptr) {
+            return;
+        }
+    }
+    interrupt();
+    if (owner && header->attached.load() == 0) {
+        // The other end never mapped the segment.  It might still be
+        // on its way, if it is alive and has to drain a previous one.
+        bool pending = (generation > 0) && processAlive(producer ? header->consumerPid.load() : header->producerPid.load());
+        if (!pending) {
+            shm_unlink(segmentName(generation).c_str());
+        }
+    }
+    owner = false;
+    unmap();
+}
+
+bool Shm2Ring::isOk() const
+{
+    if (header == nullptr) {
+        return false;
+    }
+    if (header->closed.load() == 0) {
+        return true;
+    }
+    // A closed ring can still hold data for the consumer.
+    return !producer && (header->writeSeq.load() != header->readSeq.load() || header->next.load() != 0);
+}
+
+size_t Shm2Ring::capacity() const
+{
+    return (header != nullptr) ? static_cast<size_t>(header->capacity) : 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SHM2_SHM2RING_H
+#define YARP_SHM2_SHM2RING_H
+
+#include <yarp/conf/numeric.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * The control block at the beginning of a Shm2Ring segment.
+ *
+ * writeSeq and readSeq are the total number of bytes written and read
+ * since the segment was created, i.e. the data in the ring is the
+ * range [readSeq, writeSeq).  The two futex words are bumped after
+ * every write and read respectively, and are used to sleep while the
+ * ring is empty or full.  The fields written by the producer and the
+ * ones written by the consumer live on different cache lines.
+ */
+struct Shm2RingHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t capacity;                 ///< size of the data area, a power of 2
+    std::atomic<std::uint32_t> closed;      ///< one of the ends went away
+    std::atomic<std::uint32_t> attached;    ///< the other end mapped the segment
+    std::atomic<std::uint32_t> next;        ///< generation of the segment replacing this one
+    std::atomic<std::int32_t> producerPid;
+    std::atomic<std::int32_t> consumerPid;
+
+    alignas(64) std::atomic<std::uint64_t> writeSeq; ///< bytes written by the producer
+    std::atomic<std::uint32_t> dataFutex;            ///< bumped when data is written
+    std::atomic<std::uint32_t> producerWaiting;
+
+    alignas(64) std::atomic<std::uint64_t> readSeq;  ///< bytes consumed by the consumer
+    std::atomic<std::uint32_t> spaceFutex;           ///< bumped when data is consumed
+    std::atomic<std::uint32_t> consumerWaiting;
+};
+
+
+/**
+ * A byte ring in POSIX shared memory, with a single producer and a
+ * single consumer, possibly in different processes.
+ *
+ * Each write is copied once into the ring, and each read copies the
+ * data out of it.  Waiting for data or space is done on a futex, after
+ * a short spin.  When a single write does not fit in the ring, the
+ * producer moves to a larger segment: the consumer drains the old one
+ * and then follows it.
+ */
+class Shm2Ring
+{
+public:
+    Shm2Ring();
+    ~Shm2Ring();
+
+    Shm2Ring(const Shm2Ring&) = delete;
+    Shm2Ring& operator=(const Shm2Ring&) = delete;
+
+    /**
+     * Create a new segment.
+     * @param name the base name of the segment, starting with '/'
+     * @param capacity the initial size of the ring (rounded up to a power of 2)
+     * @param producer true if this end writes to the ring
+     * @return true on success
+     */
+    bool create(const std::string& name, size_t capacity, bool producer);
+
+    /**
+     * Attach to a segment created by the other end, and remove its
+     * name from the system.
+     * @param name the base name of the segment
+     * @param producer true if this end writes to the ring
+     * @return true on success
+     */
+    bool attach(const std::string& name, bool producer);
+
+    /**
+     * Write data to the ring, waiting for space if needed.
+     * @return false if the ring was closed
+     */
+    bool write(const char* data, size_t len);
+
+    /**
+     * Read some data from the ring, waiting for it if needed.
+     * @return the number of bytes read, or -1 if the ring was closed
+     */
+    yarp::conf::ssize_t read(char* data, size_t len);
+
+    /**
+     * Mark the ring as closed, and wake up both ends.
+     */
+    void interrupt();
+
+    /**
+     * Interrupt the ring and release the segment.
+     */
+    void close();
+
+    /**
+     * @return true if the ring is attached and not closed
+     */
+    bool isOk() const;
+
+    /**
+     * @return the current size of the ring
+     */
+    size_t capacity() const;
+
+private:
+    bool map(const std::string& segment, bool create, size_t capacity);
+    void unmap();
+    bool grow(size_t len);
+    bool follow();
+    bool waitForData(std::uint64_t readSeq);
+    bool waitForSpace(std::uint64_t writeSeq);
+    std::string segmentName(std::uint32_t generation) const;
+
+    std::string baseName;
+    std::uint32_t generation;
+    bool producer;
+    bool owner;         ///< the segment name was created by this end
+    void* mem;
+    size_t memSize;
+    Shm2RingHeader* header;
+    char* data;
+};
+
+#endif // YARP_SHM2_SHM2RING_H
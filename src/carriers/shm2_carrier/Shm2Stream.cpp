@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include "Shm2Stream.h"
+
+#include <yarp/os/Bytes.h>
+
+
+Shm2Stream::Shm2Stream(const yarp::os::Contact& local, const yarp::os::Contact& remote) :
+        happy(false),
+        localAddress(local),
+        remoteAddress(remote)
+{
+}
+
+Shm2Stream::~Shm2Stream()
+{
+    close();
+}
+
+bool Shm2Stream::open(const std::string& name, bool sender, size_t capacity)
+{
+    const std::string dataName = name + "_data";
+    const std::string replyName = name + "_reply";
+    if (sender) {
+        happy = out.attach(dataName, true) && in.attach(replyName, false);
+    } else {
+        happy = in.create(dataName, capacity, false) && out.create(replyName, capacity, true);
+    }
+    if (!happy) {
+        close();
+    }
+    return happy;
+}
+
+void Shm2Stream::close()
+{
+    happy = false;
+    in.close();
+    out.close();
+}
+
+void Shm2Stream::interrupt()
+{
+    happy = false;
+    in.interrupt();
+    out.interrupt();
+}
+
+void Shm2Stream::write(const yarp::os::Bytes& b)
+{
+    if (!happy) {
+        return;
+    }
+    if (!out.write(b.get(), b.length())) {
+        happy = false;
+    }
+}
+
+yarp::conf::ssize_t Shm2Stream::read(yarp::os::Bytes& b)
+{
+    if (!happy) {
+        return -1;
+    }
+    yarp::conf::ssize_t result = in.read(b.get(), b.length());
+    if (result < 0) {
+        happy = false;
+    }
+    return result;
+}
+
+yarp::os::InputStream& Shm2Stream::getInputStream()
+{
+    return *this;
+}
+
+yarp::os::OutputStream& Shm2Stream::getOutputStream()
+{
+    return *this;
+}
+
+bool Shm2Stream::isOk() const
+{
+    // Failures of the output ring are reported by write().
+    return happy && in.isOk();
+}
+
+void Shm2Stream::reset()
+{
+}
+
+void Shm2Stream::beginPacket()
+{
+}
+
+void Shm2Stream::endPacket()
+{
+}
+
+const yarp::os::Contact& Shm2Stream::getLocalAddress() const
+{
+    return localAddress;
+}
+
+const yarp::os::Contact& Shm2Stream::getRemoteAddress() const
+{
+    return remoteAddress;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SHM2_SHM2STREAM_H
+#define YARP_SHM2_SHM2STREAM_H
+
+#include <yarp/os/Contact.h>
+#include <yarp/os/InputStream.h>
+#include <yarp/os/OutputStream.h>
+#include <yarp/os/TwoWayStream.h>
+
+#include "Shm2Ring.h"
+
+#include <string>
+
+
+/**
+ * A stream over a pair of Shm2Ring segments, one carrying data from
+ * the sender to the receiver, and the other one carrying replies.
+ */
+class Shm2Stream :
+        public yarp::os::TwoWayStream,
+        public yarp::os::InputStream,
+        public yarp::os::OutputStream
+{
+public:
+    Shm2Stream(const yarp::os::Contact& local, const yarp::os::Contact& remote);
+    virtual ~Shm2Stream();
+
+    /**
+     * Set up the segments.  The receiver creates them, and the sender
+     * attaches to them.
+     * @param name the base name of the segments
+     * @param sender true on the sending end of the connection
+     * @param capacity initial size of the rings, used by the receiver
+     * @return true on success
+     */
+    bool open(const std::string& name, bool sender, size_t capacity);
+
+    void close() override;
+    void interrupt() override;
+
+    using yarp::os::OutputStream::write;
+    void write(const yarp::os::Bytes& b) override;
+
+    using yarp::os::InputStream::read;
+    yarp::conf::ssize_t read(yarp::os::Bytes& b) override;
+
+    yarp::os::InputStream& getInputStream() override;
+    yarp::os::OutputStream& getOutputStream() override;
+    bool isOk() const override;
+
+    void reset() override;
+
+    void beginPacket() override;
+    void endPacket() override;
+
+    const yarp::os::Contact& getLocalAddress() const override;
+    const yarp::os::Contact& getRemoteAddress() const override;
+
+private:
+    Shm2Ring in;
+    Shm2Ring out;
+    bool happy;
+    yarp::os::Contact localAddress;
+    yarp::os::Contact remoteAddress;
+};
+
+#endif // YARP_SHM2_SHM2STREAM_H
@@ -1088,33 +1088,14 @@ bool ServerGrabber::threadInit()
     {
         if(param.cap==COLOR)
         {
+            // in splitter mode, the whole image, whose halves are sent
             img= new ImageOf<PixelRgb>;
-            if(param.splitterMode)
-            {
-                img->resize(fgImage->width()/2,fgImage->height());
-
-                img2= new ImageOf<PixelRgb>;
-                img2->resize(fgImage->width()/2,fgImage->height());
-            }
-            else
-            {
-                img->resize(fgImage->width(),fgImage->height());
-            }
+            img->resize(fgImage->width(),fgImage->height());
         }
         else
         {
             img_Raw= new ImageOf<PixelMono>;
-            if(param.splitterMode)
-            {
-                img_Raw->resize(fgImageRaw->width()/2,fgImageRaw->height());
-
-                img2_Raw= new ImageOf<PixelMono>;
-                img2_Raw->resize(fgImageRaw->width()/2,fgImageRaw->height());
-            }
-            else
-            {
-                img_Raw->resize(fgImageRaw->width(), fgImageRaw->height());
-            }
+            img_Raw->resize(fgImageRaw->width(), fgImageRaw->height());
         }
     }
     return true;
@@ -1233,18 +1214,16 @@ void ServerGrabber::run()
             {
                 if(fgImage!=nullptr)
                 {
-                    yarp::sig::ImageOf<yarp::sig::PixelRgb> inputImage;
-                    fgImage->getImage(inputImage);
+                    fgImage->getImage(*img);
 
-                    bool ok = utils::vertSplit(inputImage,*img,*img2);
+                    // the two halves are sent without being copied
+                    bool ok = flex_i.setView(*img, 0, 0, img->width()/2, img->height()) &&
+                              flex_i2.setView(*img, img->width()/2, 0, img->width()/2, img->height());
                     if (!ok)
                     {
                         yError()<<"ServerGrabber: failed to split the image";
                         return;
                     }
-
-                    setupFlexImage(*img,flex_i);
-                    setupFlexImage(*img2,flex_i2);
                 }
                 else
                     yError()<<"ServerGrabber: Image not captured.. check hardware configuration";
@@ -1253,19 +1232,15 @@ void ServerGrabber::run()
             {
                 if(fgImageRaw!=nullptr)
                 {
-                    yarp::sig::ImageOf<yarp::sig::PixelMono> inputImage;
-                    fgImageRaw->getImage(inputImage);
+                    fgImageRaw->getImage(*img_Raw);
 
-                    bool ok = utils::vertSplit(inputImage,*img_Raw,*img2_Raw);
+                    bool ok = flex_i.setView(*img_Raw, 0, 0, img_Raw->width()/2, img_Raw->height()) &&
+                              flex_i2.setView(*img_Raw, img_Raw->width()/2, 0, img_Raw->width()/2, img_Raw->height());
                     if (!ok)
                     {
                         yError()<<"ServerGrabber: failed to split the image";
                         return;
                     }
-
-                    setupFlexImage(*img_Raw,flex_i);
-                    setupFlexImage(*img2_Raw,flex_i2);
-
                 }
                 else
                     yError()<<"ServerGrabber: Image not captured.. check hardware configuration";
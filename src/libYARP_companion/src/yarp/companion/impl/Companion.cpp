@@ -43,12 +43,17 @@
 #include <yarp/os/impl/StreamConnectionReader.h>
 #include <yarp/os/impl/Terminal.h>
 
+#include <yarp/sig/Image.h>
+#include <yarp/sig/Vector.h>
+
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <mutex>
 #include <string>
+#include <vector>
 
 
 using namespace yarp::companion::impl;
@@ -238,6 +243,7 @@ Companion::Companion() :
     adminMode(false),
     waitConnect(false)
 {
+    add("bench",      &Companion::cmdBench,      "measure the throughput and latency of a connection");
     add("check",      &Companion::cmdCheck,      "run a simple sanity check to see if yarp is working");
     add("clean",      &Companion::cmdClean,      "try to remove inactive entries from the name server");
     add("clock",      &Companion::cmdClock,      "creates a server publishing the system time");
@@ -417,12 +423,15 @@ int Companion::cmdTerminate(int argc, char *argv[]) {
 int Companion::cmdPing(int argc, char *argv[]) {
     bool time = false;
     bool rate = false;
+    bool stats = false;
     if (argc>=1) {
         while (argv[0][0]=='-') {
             if (std::string(argv[0])=="--time") {
                 time = true;
             } else if (std::string(argv[0])=="--rate") {
                 rate = true;
+            } else if (std::string(argv[0])=="--stats") {
+                stats = true;
             } else {
                 yError("Unrecognized option");
                 argc = 1;
@@ -431,6 +440,26 @@ int Companion::cmdPing(int argc, char *argv[]) {
             argv++;
         }
     }
+    if (stats && (argc == 1 || argc == 2)) {
+        Bottle cmd;
+        Bottle reply;
+        cmd.addVocab(Vocab::encode("stat"));
+        if (argc == 2) {
+            cmd.addString(argv[1]);
+        }
+        if (!NetworkBase::write(Contact(argv[0]), cmd, reply, true, true)) {
+            yError("Cannot get the statistics of %s", argv[0]);
+            return 1;
+        }
+        if (reply.get(0).isVocab()) {
+            yError("%s", reply.get(1).asString().c_str());
+            return 1;
+        }
+        for (size_t i = 0; i < reply.size(); i++) {
+            printf("%s\n", reply.get(i).toString().c_str());
+        }
+        return 0;
+    }
     if (argc == 1) {
         char *targetName = argv[0];
         if (time) {
@@ -457,6 +486,7 @@ int Companion::cmdPing(int argc, char *argv[]) {
     fprintf(stderr, "  yarp ping /port\n");
     fprintf(stderr, "  yarp ping --time /port\n");
     fprintf(stderr, "  yarp ping --rate /port\n");
+    fprintf(stderr, "  yarp ping --stats /port [/peer]\n");
     return 1;
 }
 
@@ -2441,6 +2471,339 @@ int Companion::cmdSample(int argc, char *argv[]) {
 }
 
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+namespace {
+
+// Payloads of (about) the requested size, in bytes.
+size_t benchPayloadSize(const Bottle& bot)
+{
+    return (bot.size() == 1) ? bot.get(0).asBlobLength() : 0;
+}
+
+size_t benchPayloadSize(const yarp::sig::Vector& vec)
+{
+    return vec.size() * sizeof(double);
+}
+
+size_t benchPayloadSize(const yarp::sig::ImageOf<yarp::sig::PixelRgb>& img)
+{
+    return img.getRawImageSize();
+}
+
+void benchFill(Bottle& bot, size_t size)
+{
+    std::vector<char> data(size, 'x');
+    bot.clear();
+    bot.add(Value(data.data(), static_cast<int>(size)));
+}
+
+void benchFill(yarp::sig::Vector& vec, size_t size)
+{
+    vec.resize(std::max<size_t>(1, size / sizeof(double)), 1.0);
+}
+
+void benchFill(yarp::sig::ImageOf<yarp::sig::PixelRgb>& img, size_t size)
+{
+    // a square image
+    auto side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(size / 3.0)));
+    img.resize(side, side);
+    img.zero();
+}
+
+// The messages are numbered in their envelope.  Carriers that do not
+// transmit the envelope (e.g. local) deliver them in order, so they are
+// numbered as they arrive.
+template <class T>
+class CompanionBenchReader : public TypedReaderCallback<T>
+{
+public:
+    CompanionBenchReader(BufferedPort<T>& port, const std::vector<double>& sendTimes, int warmup) :
+            port(port),
+            sendTimes(sendTimes),
+            warmup(warmup),
+            arrivals(0),
+            seen(sendTimes.size(), false),
+            lastTime(0)
+    {
+        latencies.reserve(sendTimes.size());
+    }
+
+    using TypedReaderCallback<T>::onRead;
+    void onRead(T& datum) override
+    {
+        YARP_UNUSED(datum);
+        double now = SystemClock::nowSystem();
+        Stamp stamp;
+        bool numbered = port.getEnvelope(stamp) && stamp.isValid();
+        std::lock_guard<std::mutex> lock(mutex);
+        int seq = numbered ? stamp.getCount() : arrivals - warmup;
+        arrivals++;
+        if (seq < 0 || seq >= static_cast<int>(seen.size()) || seen[seq]) {
+            // warm up message
+            return;
+        }
+        seen[seq] = true;
+        latencies.push_back(now - sendTimes[seq]);
+        lastTime = now;
+    }
+
+    BufferedPort<T>& port;
+    const std::vector<double>& sendTimes;
+    int warmup;
+    int arrivals;
+    std::mutex mutex;
+    std::vector<bool> seen;
+    std::vector<double> latencies;
+    double lastTime;
+};
+
+double benchPercentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+// A JSON string, with the quotes, the backslashes and the control
+// characters escaped.
+std::string benchJsonString(const std::string& str)
+{
+    std::string result = "\"";
+    for (char ch : str) {
+        switch (ch) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(ch));
+                result += code;
+            } else {
+                result += ch;
+            }
+        }
+    }
+    result += '"';
+    return result;
+}
+
+// A JSON value for a (key value) entry of the report
+std::string benchJsonValue(const Value& value)
+{
+    if (value.isString()) {
+        return benchJsonString(value.asString());
+    }
+    if (value.isFloat64() && !std::isfinite(value.asFloat64())) {
+        return "null";
+    }
+    return value.toString();
+}
+
+template <class T>
+int companionBench(Property& options, const std::string& payload)
+{
+    std::string carrier = options.check("carrier", Value("tcp")).asString();
+    auto size = static_cast<size_t>(options.check("size", Value(1024)).asInt32());
+    int count = options.check("count", Value(1000)).asInt32();
+    int warmup = options.check("warmup", Value(10)).asInt32();
+    double rate = options.check("rate", Value(0.0)).asFloat64();
+    std::string name = options.check("name", Value("...")).asString();
+    bool json = options.check("json");
+    if (count <= 0) {
+        fprintf(stderr, "The number of messages must be positive\n");
+        return 1;
+    }
+
+    BufferedPort<T> out;
+    BufferedPort<T> in;
+    std::vector<double> sendTimes(count, 0.0);
+    CompanionBenchReader<T> reader(in, sendTimes, warmup);
+    in.setStrict();
+    in.useCallback(reader);
+    bool ok = (name == "...") ? (out.open("...") && in.open("...")) :
+                                (out.open(name + "/o") && in.open(name + "/i"));
+    if (!ok) {
+        fprintf(stderr, "Failed to open the ports\n");
+        return 1;
+    }
+    std::string outName = out.getName();
+    std::string inName = in.getName();
+    if (!NetworkBase::connect(out.getName(), in.getName(), carrier, true)) {
+        fprintf(stderr, "Failed to connect %s to %s with carrier %s\n",
+                out.getName().c_str(), in.getName().c_str(), carrier.c_str());
+        return 1;
+    }
+    double start = SystemClock::nowSystem();
+    while (in.getInputCount() < 1 && SystemClock::nowSystem() - start < 5) {
+        SystemClock::delaySystem(0.01);
+    }
+
+    size_t bytes = 0;
+    auto send = [&](int seq) {
+        T& datum = out.prepare();
+        if (bytes == 0 || benchPayloadSize(datum) != bytes) {
+            benchFill(datum, size);
+            bytes = benchPayloadSize(datum);
+        }
+        Stamp stamp(seq, SystemClock::nowSystem());
+        if (seq < count) {
+            sendTimes[seq] = stamp.getTime();
+        }
+        out.setEnvelope(stamp);
+        out.writeStrict();
+    };
+
+    // the sequence numbers of the warm up messages are ignored by the reader
+    for (int i = 0; i < warmup; i++) {
+        send(count + i);
+    }
+    out.waitForWrite();
+    SystemClock::delaySystem(0.1);
+
+    std::clock_t cpuStart = std::clock();
+    start = SystemClock::nowSystem();
+    for (int i = 0; i < count; i++) {
+        if (rate > 0) {
+            double wait = start + i / rate - SystemClock::nowSystem();
+            if (wait > 0) {
+                SystemClock::delaySystem(wait);
+            }
+        }
+        send(i);
+    }
+    out.waitForWrite();
+
+    // wait for the last messages, unless they stopped coming
+    size_t received = 0;
+    double lastProgress = SystemClock::nowSystem();
+    while (SystemClock::nowSystem() - lastProgress < 1.0) {
+        size_t now = 0;
+        {
+            std::lock_guard<std::mutex> lock(reader.mutex);
+            now = reader.latencies.size();
+        }
+        if (now == static_cast<size_t>(count)) {
+            break;
+        }
+        if (now != received) {
+            received = now;
+            lastProgress = SystemClock::nowSystem();
+        }
+        SystemClock::delaySystem(0.01);
+    }
+    double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    out.close();
+    in.close();
+
+    std::vector<double> latencies;
+    double duration = 0;
+    {
+        std::lock_guard<std::mutex> lock(reader.mutex);
+        latencies = reader.latencies;
+        duration = latencies.empty() ? 0 : reader.lastTime - start;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    received = latencies.size();
+    double throughput = (duration > 0) ? received / duration : 0;
+    double usec = 1e6;
+
+    Bottle result;
+    auto report = [&](const char* key, const Value& value) {
+        Bottle& entry = result.addList();
+        entry.addString(key);
+        entry.add(value);
+    };
+    report("carrier", Value(carrier));
+    report("output", Value(outName));
+    report("input", Value(inName));
+    report("payload", Value(payload));
+    report("bytes", Value(static_cast<int>(bytes)));
+    report("sent", Value(count));
+    report("received", Value(static_cast<int>(received)));
+    report("drops", Value(count - static_cast<int>(received)));
+    report("duration_s", Value(duration));
+    report("throughput_msg_s", Value(throughput));
+    report("throughput_mb_s", Value(throughput * bytes / 1e6));
+    report("latency_min_us", Value(latencies.empty() ? 0 : latencies.front() * usec));
+    report("latency_p50_us", Value(benchPercentile(latencies, 0.5) * usec));
+    report("latency_p99_us", Value(benchPercentile(latencies, 0.99) * usec));
+    report("latency_p999_us", Value(benchPercentile(latencies, 0.999) * usec));
+    report("latency_max_us", Value(latencies.empty() ? 0 : latencies.back() * usec));
+    report("cpu_us_per_msg", Value(received > 0 ? cpu / received * usec : 0));
+
+    if (json) {
+        printf("{");
+        for (size_t i = 0; i < result.size(); i++) {
+            Bottle* entry = result.get(i).asList();
+            printf("%s%s: %s",
+                   (i > 0) ? ", " : "",
+                   benchJsonString(entry->get(0).asString()).c_str(),
+                   benchJsonValue(entry->get(1)).c_str());
+        }
+        printf("}\n");
+    } else {
+        printf("%s\n", result.toString().c_str());
+    }
+    return 0;
+}
+
+} // namespace
+
+#endif /*DOXYGEN_SHOULD_SKIP_THIS*/
+
+
+int Companion::cmdBench(int argc, char *argv[]) {
+    Property options;
+    options.fromCommand(argc, argv, false);
+    if (options.check("help")) {
+        printf("This is yarp bench. Syntax:\n");
+        printf("  yarp bench [--carrier tcp] [--payload bottle|vector|image] [--size 1024]\n");
+        printf("             [--count 1000] [--rate 0] [--warmup 10] [--name /prefix] [--json]\n");
+        printf("Messages are sent from a port to another port of this process, through a\n");
+        printf("connection with the given carrier (e.g. tcp, fast_tcp, udp, mcast, shmem,\n");
+        printf("local).  Each message carries a payload of about 'size' bytes, and is sent\n");
+        printf("as soon as the previous one is written, or at 'rate' messages per second.\n");
+        printf("The throughput, the latency percentiles, the CPU time per message and the\n");
+        printf("number of messages lost are printed as a list of (key value) pairs, or as a\n");
+        printf("JSON object with --json.\n");
+        return 0;
+    }
+
+    if (!NetworkBase::exists(NetworkBase::getNameServerName(), true)) {
+        fprintf(stderr, "No name server, switching to local mode\n");
+        NetworkBase::setLocalMode(true);
+    }
+
+    std::string payload = options.check("payload", Value("bottle")).asString();
+    if (payload == "bottle") {
+        return companionBench<Bottle>(options, payload);
+    }
+    if (payload == "vector") {
+        return companionBench<yarp::sig::Vector>(options, payload);
+    }
+    if (payload == "image") {
+        return companionBench<yarp::sig::ImageOf<yarp::sig::PixelRgb>>(options, payload);
+    }
+    fprintf(stderr, "Unknown payload %s, use bottle, vector or image\n", payload.c_str());
+    return 1;
+}
+
+
 void Companion::applyArgs(yarp::os::Contactable& port) {
     if (argType!="") {
         port.promiseType(Type::byNameOnWire(argType.c_str()));
@@ -152,6 +152,8 @@ public:
 
     int cmdSample(int argc, char *argv[]);
 
+    int cmdBench(int argc, char *argv[]);
+
     int subscribe(const char *src,
                   const char *dest,
                   const char *mode = nullptr);
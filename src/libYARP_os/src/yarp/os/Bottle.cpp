@@ -184,6 +184,22 @@ Bottle& Bottle::addList()
     return implementation->addList();
 }
 
+Bottle& Bottle::addList(const std::vector<yarp::conf::float64_t>& values)
+{
+    implementation->edit();
+    Bottle& lst = implementation->addList();
+    lst.implementation->assignFloat64(values.data(), values.size());
+    return lst;
+}
+
+Bottle& Bottle::addList(const std::vector<std::int32_t>& values)
+{
+    implementation->edit();
+    Bottle& lst = implementation->addList();
+    lst.implementation->assignInt32(values.data(), values.size());
+    return lst;
+}
+
 Property& Bottle::addDict()
 {
     implementation->edit();
@@ -247,6 +263,16 @@ Value& Bottle::get(size_t index) const
     return implementation->get(index);
 }
 
+const yarp::conf::float64_t* Bottle::getFloat64Data() const
+{
+    return implementation->getFloat64Data();
+}
+
+const std::int32_t* Bottle::getInt32Data() const
+{
+    return implementation->getInt32Data();
+}
+
 size_t Bottle::size() const
 {
     return static_cast<int>(implementation->size());
@@ -17,6 +17,7 @@
 #include <yarp/os/Value.h>
 
 #include <string>
+#include <vector>
 
 #define BOTTLE_TAG_INT8 32         // 0000 0000 0010 0000
 #define BOTTLE_TAG_INT16 64        // 0000 0000 0100 0000
@@ -264,6 +265,32 @@ public:
      */
     Bottle& addList();
 
+#ifndef SWIG
+    /**
+     * Places a nested list of floating point numbers in the bottle, at
+     * the end of the list.
+     *
+     * The numbers are copied in a single block, and the list is written
+     * to the network the same way.
+     *
+     * @param values the numbers to add.
+     * @return a reference to the newly added list.
+     */
+    Bottle& addList(const std::vector<yarp::conf::float64_t>& values);
+
+    /**
+     * Places a nested list of integers in the bottle, at the end of the
+     * list.
+     *
+     * The numbers are copied in a single block, and the list is written
+     * to the network the same way.
+     *
+     * @param values the numbers to add.
+     * @return a reference to the newly added list.
+     */
+    Bottle& addList(const std::vector<std::int32_t>& values);
+#endif // SWIG
+
     /**
      * Places an empty key/value object in the bottle, at the end of the
      * list.
@@ -288,12 +315,46 @@ public:
      * Methods like v.asInt32() or v.asString() can be used to access the
      * result as a particular type.
      *
+     * The Value is valid until the bottle is modified.  Several
+     * threads can read the same bottle with get(), as long as none of
+     * them modifies it.
+     *
      * @param index the part of the list to read from.
      * @return the Value v; if the index lies outside the range of
      *         elements present, then v.isNull() will be true.
      */
     Value& get(size_type index) const;
 
+    /**
+     * Gets the content of a bottle holding floating point numbers only,
+     * as a contiguous array of size() numbers.
+     *
+     * Lists of floating point numbers read from the network, or added
+     * with addList(const std::vector<yarp::conf::float64_t>&), are
+     * stored this way, and no copy is made.
+     *
+     * The array is valid until the bottle is modified; accessing its
+     * elements with get(), from any thread, does not invalidate it.
+     * A change made to an element through get() is seen by the next
+     * call to this method (which then checks all the elements), not by
+     * an array that was read before.
+     *
+     * @return the numbers, or nullptr if the bottle is empty or holds
+     *         anything else.
+     */
+    const yarp::conf::float64_t* getFloat64Data() const;
+
+    /**
+     * Gets the content of a bottle holding 32 bit integers only, as a
+     * contiguous array of size() numbers.
+     *
+     * @see getFloat64Data()
+     *
+     * @return the numbers, or nullptr if the bottle is empty or holds
+     *         anything else.
+     */
+    const std::int32_t* getInt32Data() const;
+
     /**
      * Gets the number of elements in the bottle.
      *
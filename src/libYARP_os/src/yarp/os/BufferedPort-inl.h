@@ -150,6 +150,34 @@ void yarp::os::BufferedPort<T>::setStrict(bool strict)
     reader.setStrict(strict);
 }
 
+template <typename T>
+void yarp::os::BufferedPort<T>::setCapacity(size_t capacity, BufferOverflowPolicy policy)
+{
+    attachIfNeeded();
+    reader.setCapacity(capacity, policy);
+}
+
+template <typename T>
+void yarp::os::BufferedPort<T>::setFlowControl(size_t credits)
+{
+    attachIfNeeded();
+    reader.setFlowControl(credits);
+}
+
+template <typename T>
+void yarp::os::BufferedPort<T>::setCoalescingKey(std::function<std::string(const T&)> key)
+{
+    attachIfNeeded();
+    reader.setCoalescingKey(key);
+}
+
+template <typename T>
+yarp::os::BufferOverflowStats yarp::os::BufferedPort<T>::getOverflowStats()
+{
+    attachIfNeeded();
+    return reader.getOverflowStats();
+}
+
 template <typename T>
 T* yarp::os::BufferedPort<T>::read(bool shouldWait)
 {
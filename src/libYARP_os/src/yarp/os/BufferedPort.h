@@ -47,7 +47,12 @@ namespace os {
  * In this way all messages will be stored inside the BufferedPort and delivered
  * to the reader.
  * Pay attention that in this case a slow reader may cause increasing latency
- * and memory use.
+ * and memory use, unless BufferedPort::setFlowControl() is used instead, so
+ * that the writers are held back when the reader cannot keep up.
+ * BufferedPort::setCapacity() bounds the number of messages kept, and
+ * chooses what happens when a message arrives to a full buffer: the oldest
+ * or the newest message is dropped, the sender waits, or the message
+ * replaces an older one with the same key.
  *
  * Methods that can be useful to monitor the status of read and write operations
  * are yarp::os::BufferedPort::getPendingReads() and
@@ -184,6 +189,42 @@ public:
     // Documented in TypedReader
     void setStrict(bool strict = true) override;
 
+    /**
+     * Keep at most a given number of messages waiting to be read, in
+     * the order they arrived, and decide what happens to the others.
+     * See PortReaderBuffer::setCapacity().
+     *
+     * @param capacity the number of messages kept, 0 for no bound
+     * @param policy what to do with a message that arrives when the
+     *               buffer is full
+     */
+    void setCapacity(size_t capacity, BufferOverflowPolicy policy = BufferOverflowPolicy::DropOldest);
+
+    /**
+     * Deliver every message, as setStrict() does, but with at most a
+     * given number of messages waiting to be read.  Writers that have
+     * used up these credits are held back, and see it with isWriting():
+     * the reader withholds the acknowledgement of the message that
+     * arrives while the buffer is full (BufferOverflowPolicy::Block).
+     * See PortReaderBuffer::setFlowControl().
+     *
+     * @param credits the number of messages kept, 0 for no bound
+     */
+    void setFlowControl(size_t credits);
+
+    /**
+     * Set the key used to match messages by the
+     * BufferOverflowPolicy::Coalesce policy.
+     * See PortReaderBuffer::setCoalescingKey().
+     */
+    void setCoalescingKey(std::function<std::string(const T&)> key);
+
+    /**
+     * @return the counters of the messages received and dropped by the
+     * reader buffer
+     */
+    BufferOverflowStats getOverflowStats();
+
     // Documented in TypedReader
     T* read(bool shouldWait = true) override;
 
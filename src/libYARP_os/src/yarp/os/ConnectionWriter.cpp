@@ -8,6 +8,7 @@
  */
 
 #include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/Bottle.h>
 #include <yarp/os/OutputStream.h>
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 
@@ -21,6 +22,12 @@ bool ConnectionWriter::isNull() const
     return false;
 }
 
+const Searchable& ConnectionWriter::getConnectionModifiers() const
+{
+    static const Bottle none;
+    return none;
+}
+
 
 ConnectionWriter* ConnectionWriter::createBufferedConnectionWriter()
 {
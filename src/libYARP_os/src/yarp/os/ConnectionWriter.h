@@ -22,6 +22,7 @@ class ConnectionReader;
 class PortReader;
 class PortWriter;
 class Portable;
+class Searchable;
 class SizedWriter;
 class OutputStream;
 } // namespace os
@@ -263,7 +264,6 @@ public:
      */
     virtual bool isNull() const;
 
-
     /**
      *
      * @return a buffer if one is present.
@@ -271,6 +271,21 @@ public:
      */
     virtual SizedWriter* getBuffer() const = 0;
 
+    /**
+     *
+     * Access modifiers associated with the connection, if any, e.g.
+     * `(codec jpeg)` for a connection using the carrier
+     * `tcp+codec.jpeg`.  Objects can use them to choose how they
+     * serialize themselves for this connection.
+     *
+     * Declared after the other virtual methods, so that the writers
+     * built against older versions keep their layout.
+     *
+     * @return connection configuration object (empty by default)
+     *
+     */
+    virtual const Searchable& getConnectionModifiers() const;
+
     /**
      *
      * Create a connection writer implementation that stores
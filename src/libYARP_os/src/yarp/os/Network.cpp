@@ -23,8 +23,10 @@
 #include <yarp/os/Vocab.h>
 #include <yarp/os/YarpPlugin.h>
 #include <yarp/os/impl/BufferedConnectionWriter.h>
+#include <yarp/os/impl/CommandConnection.h>
 #include <yarp/os/impl/LogForwarder.h>
 #include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/NameClient.h>
 #include <yarp/os/impl/NameConfig.h>
 #include <yarp/os/impl/PlatformSignal.h>
 #include <yarp/os/impl/PlatformStdio.h>
@@ -45,6 +47,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -104,6 +107,9 @@ static bool needsLookup(const Contact& contact)
 
 static int noteDud(const Contact& src)
 {
+    // Do not trust what we remember about the port anymore.
+    NameClient::forgetName(src.getName());
+
     NameStore* store = getNameSpace().getQueryBypass();
     if (store != nullptr) {
         return store->announce(src.getName(), 0);
@@ -169,13 +175,30 @@ static int enactConnection(const Contact& src,
         return 0;
     }
 
+    Contact c2 = src;
+    if (c2.getPort() <= 0) {
+        c2 = NetworkBase::queryName(c2.getName());
+    }
+
+    // Both questions go to the source port over the same connection.
+    std::unique_ptr<CommandConnection> connection;
+    if (getNameSpace().serverAllocatesPortNumbers()) {
+        connection.reset(new CommandConnection(c2, rpc));
+    }
+    auto ask = [&](Bottle& cmd, Bottle& reply) {
+        if (connection != nullptr) {
+            return connection->write(cmd, reply);
+        }
+        return NetworkBase::write(c2, cmd, reply, rpc);
+    };
+
     Bottle cmd;
     Bottle reply;
     cmd.addVocab(Vocab::encode("list"));
     cmd.addVocab(Vocab::encode(reversed ? "in" : "out"));
     cmd.addString(dest.getName().c_str());
     YARP_SPRINTF2(Logger::get(), debug, "asking %s: %s", src.toString().c_str(), cmd.toString().c_str());
-    bool ok = NetworkBase::write(src, cmd, reply, rpc);
+    bool ok = ask(cmd, reply);
     if (!ok) {
         noteDud(src);
         return 1;
@@ -230,13 +253,8 @@ static int enactConnection(const Contact& src,
         cmd.addString(c.getName());
     }
 
-    Contact c2 = src;
-    if (c2.getPort() <= 0) {
-        c2 = NetworkBase::queryName(c2.getName());
-    }
-
     YARP_SPRINTF2(Logger::get(), debug, "** asking %s: %s", src.toString().c_str(), cmd.toString().c_str());
-    ok = NetworkBase::write(c2, cmd, reply, rpc);
+    ok = ask(cmd, reply);
     if (!ok) {
         noteDud(src);
         return 1;
@@ -1208,68 +1226,8 @@ bool NetworkBase::write(const Contact& contact,
         return ok;
     }
 
-    const char* connectionName = "admin";
-    std::string name = contact.getName();
-    const char* targetName = name.c_str(); // use carefully!
-    Contact address = contact;
-    if (!address.isValid()) {
-        address = getNameSpace().queryName(targetName);
-    }
-    if (!address.isValid()) {
-        if (!style.quiet) {
-            YARP_SPRINTF1(Logger::get(), error, "cannot find port %s", targetName);
-        }
-        return false;
-    }
-
-    if (style.timeout > 0) {
-        address.setTimeout((float)style.timeout);
-    }
-    OutputProtocol* out = Carriers::connect(address);
-    if (out == nullptr) {
-        if (!style.quiet) {
-            YARP_SPRINTF1(Logger::get(), error, "Cannot connect to port %s", targetName);
-        }
-        return false;
-    }
-    if (style.timeout > 0) {
-        out->setTimeout(style.timeout);
-    }
-
-    Route r(connectionName, targetName, (!style.carrier.empty()) ? style.carrier.c_str() : "text_ack");
-    out->open(r);
-
-    PortCommand pc(0, style.admin ? "a" : "d");
-    BufferedConnectionWriter bw(out->getConnection().isTextMode(),
-                                out->getConnection().isBareMode());
-    bool ok = true;
-    if (out->getConnection().canEscape()) {
-        ok = pc.write(bw);
-    }
-    if (!ok) {
-        if (!style.quiet) {
-            YARP_ERROR(Logger::get(), "could not write to connection");
-        }
-        delete out;
-        return false;
-    }
-    ok = cmd.write(bw);
-    if (!ok) {
-        if (!style.quiet) {
-            YARP_ERROR(Logger::get(), "could not write to connection");
-        }
-        delete out;
-        return false;
-    }
-    if (style.expectReply) {
-        bw.setReplyHandler(reply);
-    }
-    out->write(bw);
-    if (out != nullptr) {
-        delete out;
-        out = nullptr;
-    }
-    return true;
+    CommandConnection connection(contact, style);
+    return connection.write(cmd, reply);
 }
 
 bool NetworkBase::write(const std::string& port_name,
@@ -51,10 +51,44 @@ template <typename T>
 void yarp::os::PortReaderBuffer<T>::setStrict(bool strict)
 {
     autoDiscard = !strict;
+    implementation.setCapacity(0, BufferOverflowPolicy::DropOldest);
     // do discard at earliest time possible
     implementation.setPrune(autoDiscard);
 }
 
+template <typename T>
+void yarp::os::PortReaderBuffer<T>::setCapacity(size_t capacity, BufferOverflowPolicy policy)
+{
+    // all the messages kept are delivered, in order
+    autoDiscard = (capacity == 0);
+    implementation.setPrune(false);
+    implementation.setCapacity(capacity, policy);
+}
+
+template <typename T>
+void yarp::os::PortReaderBuffer<T>::setFlowControl(size_t credits)
+{
+    if (credits == 0) {
+        setStrict(true);
+        return;
+    }
+    setCapacity(credits, BufferOverflowPolicy::Block);
+}
+
+template <typename T>
+void yarp::os::PortReaderBuffer<T>::setCoalescingKey(std::function<std::string(const T&)> key)
+{
+    implementation.setCoalescingKey([key](const PortReader& reader) {
+        return key(static_cast<const T&>(reader));
+    });
+}
+
+template <typename T>
+yarp::os::BufferOverflowStats yarp::os::PortReaderBuffer<T>::getOverflowStats()
+{
+    return implementation.getOverflowStats();
+}
+
 template <typename T>
 bool yarp::os::PortReaderBuffer<T>::check()
 {
@@ -155,6 +189,34 @@ yarp::os::PortReader* yarp::os::PortReaderBuffer<T>::create() const
     return new T;
 }
 
+template <typename T>
+bool yarp::os::PortReaderBuffer<T>::copyLocal(const PortWriter& obj, PortReader& dest) const
+{
+    if (typeid(obj) != typeid(T)) {
+        return false;
+    }
+    const T* src = dynamic_cast<const T*>(&obj);
+    if (src == nullptr) {
+        return false;
+    }
+    return assignLocal(*src, static_cast<T&>(dest), std::is_copy_assignable<T>());
+}
+
+template <typename T>
+bool yarp::os::PortReaderBuffer<T>::assignLocal(const T& src, T& dest, std::true_type)
+{
+    dest = src;
+    return true;
+}
+
+template <typename T>
+bool yarp::os::PortReaderBuffer<T>::assignLocal(const T& src, T& dest, std::false_type)
+{
+    YARP_UNUSED(src);
+    YARP_UNUSED(dest);
+    return false;
+}
+
 template <typename T>
 void yarp::os::PortReaderBuffer<T>::setReplier(PortReader& reader)
 {
@@ -22,7 +22,10 @@
 #include <yarp/os/TypedReaderThread.h>
 
 #include <cstdio>
+#include <functional>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
 
 namespace yarp {
 namespace os {
@@ -59,6 +62,51 @@ public:
     // documented in TypedReader
     void setStrict(bool strict = true) override;
 
+    /**
+     * Keep at most a given number of messages waiting to be read, in
+     * the order they arrived.  The storage for them is allocated once,
+     * here, so that receiving a message does not allocate memory.
+     * Calling setStrict() afterwards removes the bound.
+     *
+     * @param capacity the number of messages kept, 0 for no bound
+     * @param policy what to do with a message that arrives when the
+     *               buffer is full
+     */
+    void setCapacity(size_t capacity, BufferOverflowPolicy policy = BufferOverflowPolicy::DropOldest);
+
+    /**
+     * Deliver every message, in order, as setStrict() does, but with at
+     * most a given number of messages waiting to be read (the credits of
+     * the writers).  Once they are used up, a message that arrives is not
+     * acknowledged until the reader takes one, so the writers see that
+     * they are still writing (isWriting()): a write() is then dropped at
+     * the writer, and a writeStrict() waits.
+     *
+     * This is setCapacity() with the BufferOverflowPolicy::Block policy:
+     * the credits are not advertised to the writers, which only see an
+     * acknowledgement that does not come.  On carriers without
+     * acknowledgements (e.g. fast_tcp), the writers are held back only
+     * once the network buffers are full.
+     *
+     * @param credits the number of messages kept, 0 to deliver all
+     *                messages without a bound, as setStrict()
+     */
+    void setFlowControl(size_t credits);
+
+    /**
+     * Set how messages are matched by the BufferOverflowPolicy::Coalesce
+     * policy: a message replaces the one waiting to be read that has
+     * the same key.
+     *
+     * @param key a function giving the key of a message
+     */
+    void setCoalescingKey(std::function<std::string(const T&)> key);
+
+    /**
+     * @return the counters of the messages received and dropped
+     */
+    BufferOverflowStats getOverflowStats();
+
     /**
      * Check if data is available.
      *
@@ -113,6 +161,12 @@ public:
      */
     PortReader* create() const override;
 
+    /**
+     * Objects written by ports of the same process are copied by
+     * assignment if their type is exactly T.
+     */
+    bool copyLocal(const PortWriter& obj, PortReader& dest) const override;
+
     // documented in TypedReader
     void setReplier(PortReader& reader) override;
 
@@ -145,6 +199,9 @@ private:
     T* last;
     T* default_value;
     TypedReaderThread<T>* reader;
+
+    static bool assignLocal(const T& src, T& dest, std::true_type);
+    static bool assignLocal(const T& src, T& dest, std::false_type);
 };
 
 } // namespace os
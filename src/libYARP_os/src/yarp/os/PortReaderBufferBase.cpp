@@ -9,6 +9,7 @@
 
 #include <yarp/os/PortReaderBufferBase.h>
 
+#include <yarp/os/DummyConnector.h>
 #include <yarp/os/Os.h>
 #include <yarp/os/PortReaderBuffer.h>
 #include <yarp/os/Portable.h>
@@ -20,8 +21,9 @@
 #include <yarp/os/impl/PortCorePacket.h>
 #include <yarp/os/impl/StreamConnectionReader.h>
 
-#include <list>
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -37,6 +39,9 @@ public:
 
     std::string envelope;
 
+    // the key of the content, for the Coalesce policy
+    std::string key;
+
     // if nun-null, refers to an external buffer
     // by convention, overrides reader
     PortReader* external;
@@ -108,16 +113,35 @@ public:
 };
 
 
+// The packets waiting to be read are kept in a ring, and the others in
+// a stack, so that no memory is allocated once there are enough packets.
 class PortReaderPool
 {
 private:
-    std::list<PortReaderPacket*> inactive;
-    std::list<PortReaderPacket*> active;
+    std::vector<PortReaderPacket*> inactive;
+    std::vector<PortReaderPacket*> active;
+    size_t head {0};
+    size_t count {0};
+
+    PortReaderPacket*& at(size_t index)
+    {
+        return active[(head + index) % active.size()];
+    }
+
+    void resize(size_t size)
+    {
+        std::vector<PortReaderPacket*> ring(size, nullptr);
+        for (size_t i = 0; i < count; i++) {
+            ring[i] = at(i);
+        }
+        active.swap(ring);
+        head = 0;
+    }
 
 public:
     size_t getCount()
     {
-        return active.size();
+        return count;
     }
 
     size_t getFree()
@@ -128,32 +152,53 @@ public:
     PortReaderPacket* getInactivePacket()
     {
         if (inactive.empty()) {
-            PortReaderPacket* obj = nullptr;
-            obj = new PortReaderPacket();
-            inactive.push_back(obj);
+            inactive.push_back(new PortReaderPacket());
         }
-        PortReaderPacket* next = inactive.front();
+        PortReaderPacket* next = inactive.back();
         yAssert(next != nullptr);
-        inactive.remove(next);
+        inactive.pop_back();
         return next;
     }
 
     PortReaderPacket* getActivePacket()
     {
         PortReaderPacket* next = nullptr;
-        if (getCount() >= 1) {
-            next = active.front();
+        if (count >= 1) {
+            next = at(0);
             yAssert(next != nullptr);
-            active.remove(next);
+            head = (head + 1) % active.size();
+            count--;
         }
         return next;
     }
 
     void addActivePacket(PortReaderPacket* packet)
     {
-        if (packet != nullptr) {
-            active.push_back(packet);
+        if (packet == nullptr) {
+            return;
         }
+        if (count == active.size()) {
+            resize(std::max<size_t>(8, active.size() * 2));
+        }
+        at(count) = packet;
+        count++;
+    }
+
+    /**
+     * Put a packet in the place of the waiting packet with the same key.
+     * @return the packet replaced, or nullptr if there is none
+     */
+    PortReaderPacket* replaceActivePacket(PortReaderPacket* packet)
+    {
+        for (size_t i = 0; i < count; i++) {
+            PortReaderPacket*& slot = at(i);
+            if (slot->key == packet->key) {
+                PortReaderPacket* old = slot;
+                slot = packet;
+                return old;
+            }
+        }
+        return nullptr;
     }
 
     void addInactivePacket(PortReaderPacket* packet)
@@ -163,11 +208,27 @@ public:
         }
     }
 
+    /**
+     * Make sure there are at least a given number of packets, and room
+     * for all of them in the ring and in the stack.
+     */
+    void reserve(size_t total, const std::function<PortReader*()>& create)
+    {
+        if (active.size() < total) {
+            resize(total);
+        }
+        inactive.reserve(total);
+        while (count + inactive.size() < total) {
+            auto* packet = new PortReaderPacket();
+            packet->setReader(create());
+            inactive.push_back(packet);
+        }
+    }
+
     void reset()
     {
-        while (!active.empty()) {
-            delete active.back();
-            active.pop_back();
+        while (count > 0) {
+            delete getActivePacket();
         }
         while (!inactive.empty()) {
             delete inactive.back();
@@ -192,6 +253,11 @@ public:
     double last_recv;
 
     PortReaderPool pool;
+    size_t capacity;
+    BufferOverflowPolicy policy;
+    std::function<std::string(const PortReader&)> coalescingKey;
+    BufferOverflowStats stats;
+    bool interrupted;
 
     int ct;
     Port* port;
@@ -208,6 +274,9 @@ public:
             replier(nullptr),
             period(-1),
             last_recv(-1),
+            capacity(0),
+            policy(BufferOverflowPolicy::DropOldest),
+            interrupted(false),
             ct(0),
             port(nullptr),
             contentSema(0),
@@ -240,6 +309,7 @@ public:
         }
         pool.reset();
         ct = 0;
+        interrupted = false;
     }
 
 
@@ -251,9 +321,24 @@ public:
         return {};
     }
 
+    // true if the sender should wait for a message to be read
+    // The reader waits for room when the buffer is full
+    bool waitsForRoom()
+    {
+        return capacity > 0 && policy == BufferOverflowPolicy::Block && !interrupted;
+    }
+
+    bool mustBlock()
+    {
+        return waitsForRoom() && pool.getCount() >= capacity;
+    }
+
     PortReaderPacket* get()
     {
         PortReaderPacket* result = nullptr;
+        if (capacity > 0) {
+            return mustBlock() ? nullptr : pool.getInactivePacket();
+        }
         bool grab = true;
         if (pool.getFree() == 0) {
             grab = false;
@@ -319,6 +404,55 @@ public:
         return drop;
     }
 
+    /**
+     * Queue a packet that was just filled, making room for it if needed.
+     * Called with stateMutex locked.
+     * @return true if there is one more message to read
+     */
+    bool push(PortReaderPacket* packet)
+    {
+        stats.received++;
+        if (capacity == 0) {
+            bool pruned = false;
+            if (ct > 0 && prune) {
+                PortReaderPacket* readerPacket = dropContent();
+                pruned = (readerPacket != nullptr);
+            }
+            pool.addActivePacket(packet);
+            ct++;
+            stats.highWater = std::max(stats.highWater, pool.getCount());
+            return !pruned;
+        }
+        if (policy == BufferOverflowPolicy::Coalesce && coalescingKey) {
+            PortReader* content = (packet->getExternal() != nullptr) ? packet->getExternal() : packet->getReader();
+            packet->key = (content != nullptr) ? coalescingKey(*content) : std::string();
+            PortReaderPacket* old = pool.replaceActivePacket(packet);
+            if (old != nullptr) {
+                pool.addInactivePacket(old);
+                stats.coalesced++;
+                return false;
+            }
+        }
+        if (pool.getCount() >= capacity) {
+            if (policy == BufferOverflowPolicy::DropNewest) {
+                pool.addInactivePacket(packet);
+                stats.droppedNewest++;
+                return false;
+            }
+            // With the Block policy, this happens only if the capacity
+            // was reduced while messages were waiting.
+            dropContent();
+            stats.droppedOldest++;
+            pool.addActivePacket(packet);
+            ct++;
+            return false;
+        }
+        pool.addActivePacket(packet);
+        ct++;
+        stats.highWater = std::max(stats.highWater, pool.getCount());
+        return true;
+    }
+
     void attach(Port& port)
     {
         this->port = &port;
@@ -377,6 +511,11 @@ void PortReaderBufferBase::interrupt()
 {
     // give read a chance
     mPriv->contentSema.post();
+    // and do not keep senders waiting for room anymore
+    mPriv->stateMutex.lock();
+    mPriv->interrupted = true;
+    mPriv->stateMutex.unlock();
+    mPriv->consumeSema.post();
 }
 
 PortReader* PortReaderBufferBase::readBase(bool& missed, bool cleanup)
@@ -451,6 +590,7 @@ bool PortReaderBufferBase::read(ConnectionReader& connection)
         }
     }
     PortReaderPacket* reader = nullptr;
+    bool blocked = false;
     while (reader == nullptr) {
         mPriv->stateMutex.lock();
         reader = mPriv->get();
@@ -459,6 +599,11 @@ bool PortReaderBufferBase::read(ConnectionReader& connection)
             yAssert(next != nullptr);
             reader->setReader(next);
         }
+        if (reader == nullptr && !blocked && mPriv->mustBlock()) {
+            // counted once per message, not once per wake-up
+            blocked = true;
+            mPriv->stats.blocked++;
+        }
 
         mPriv->stateMutex.unlock();
         if (reader == nullptr) {
@@ -477,16 +622,9 @@ bool PortReaderBufferBase::read(ConnectionReader& connection)
     }
     if (ok) {
         mPriv->stateMutex.lock();
-        bool pruned = false;
-        if (mPriv->ct > 0 && mPriv->prune) {
-            PortReaderPacket* readerPacket = mPriv->dropContent();
-            pruned = (readerPacket != nullptr);
-        }
-        //mPriv->configure(reader, false, true);
-        mPriv->pool.addActivePacket(reader);
-        mPriv->ct++;
+        bool added = mPriv->push(reader);
         mPriv->stateMutex.unlock();
-        if (!pruned) {
+        if (added) {
             mPriv->contentSema.post();
         }
         //YARP_ERROR(Logger::get(), ">>>>>>>>>>>>>>>>> adding data");
@@ -534,6 +672,38 @@ unsigned int PortReaderBufferBase::getMaxBuffer()
     return mPriv->maxBuffer;
 }
 
+void PortReaderBufferBase::setCapacity(size_t capacity, BufferOverflowPolicy policy)
+{
+    std::lock_guard<std::mutex> lock(mPriv->stateMutex);
+    mPriv->capacity = capacity;
+    mPriv->policy = policy;
+    if (capacity > 0) {
+        // Room for the messages waiting, the one being received and
+        // the one being used by the reader.
+        mPriv->pool.reserve(capacity + 2, [this]() { return create(); });
+    }
+    // a sender may be waiting for room
+    mPriv->consumeSema.post();
+}
+
+size_t PortReaderBufferBase::getCapacity()
+{
+    std::lock_guard<std::mutex> lock(mPriv->stateMutex);
+    return mPriv->capacity;
+}
+
+void PortReaderBufferBase::setCoalescingKey(std::function<std::string(const PortReader&)> key)
+{
+    std::lock_guard<std::mutex> lock(mPriv->stateMutex);
+    mPriv->coalescingKey = std::move(key);
+}
+
+BufferOverflowStats PortReaderBufferBase::getOverflowStats()
+{
+    std::lock_guard<std::mutex> lock(mPriv->stateMutex);
+    return mPriv->stats;
+}
+
 bool PortReaderBufferBase::isClosed()
 {
     return mPriv->port == nullptr;
@@ -558,9 +728,14 @@ bool PortReaderBufferBase::acceptObjectBase(PortReader* obj,
     // the object
 
     PortReaderPacket* reader = nullptr;
+    bool blocked = false;
     while (reader == nullptr) {
         mPriv->stateMutex.lock();
         reader = mPriv->get();
+        if (reader == nullptr && !blocked && mPriv->mustBlock()) {
+            blocked = true;
+            mPriv->stats.blocked++;
+        }
         mPriv->stateMutex.unlock();
         if (reader == nullptr) {
             mPriv->consumeSema.wait();
@@ -570,16 +745,9 @@ bool PortReaderBufferBase::acceptObjectBase(PortReader* obj,
     reader->setExternal(obj, wrapper);
 
     mPriv->stateMutex.lock();
-    bool pruned = false;
-    if (mPriv->ct > 0 && mPriv->prune) {
-        PortReaderPacket* readerPacket = mPriv->dropContent();
-        pruned = (readerPacket != nullptr);
-    }
-    //mPriv->configure(reader, false, true);
-    mPriv->pool.addActivePacket(reader);
-    mPriv->ct++;
+    bool added = mPriv->push(reader);
     mPriv->stateMutex.unlock();
-    if (!pruned) {
+    if (added) {
         mPriv->contentSema.post();
     }
     //YARP_ERROR(Logger::get(), ">>>>>>>>>>>>>>>>> adding data");
@@ -588,6 +756,63 @@ bool PortReaderBufferBase::acceptObjectBase(PortReader* obj,
 }
 
 
+bool PortReaderBufferBase::acceptLocalBase(const yarp::os::PortWriter& obj,
+                                           const std::string& envelope)
+{
+    // Like read(), but the object is copied instead of being read from
+    // a connection.  This never waits for room in the buffer, the
+    // sender may hold locks of the target port: when there is none,
+    // the message is dropped.
+    if (mPriv->creator == nullptr || mPriv->replier != nullptr) {
+        return false;
+    }
+
+    mPriv->stateMutex.lock();
+    if (mPriv->waitsForRoom()) {
+        // A reader that asked to wait for room (Block policy) is served
+        // by the connection, which holds the writer back until there is
+        // room.  This does not depend on the room left: a message taken
+        // here could overtake one waiting on the connection.
+        mPriv->stateMutex.unlock();
+        return false;
+    }
+    PortReaderPacket* reader = mPriv->get();
+    if (reader == nullptr) {
+        mPriv->stats.received++;
+        mPriv->stats.droppedNewest++;
+        mPriv->stateMutex.unlock();
+        return true;
+    }
+    if (reader->getReader() == nullptr) {
+        PortReader* next = create();
+        yAssert(next != nullptr);
+        reader->setReader(next);
+    }
+    mPriv->stateMutex.unlock();
+
+    // The packet is ours until it is pushed, as in read()
+    bool ok = mPriv->creator->copyLocal(obj, *reader->getReader());
+    if (!ok) {
+        DummyConnector con;
+        ok = obj.write(con.getWriter()) && reader->getReader()->read(con.getReader());
+    }
+    reader->envelope = envelope;
+
+    mPriv->stateMutex.lock();
+    bool added = false;
+    if (ok) {
+        added = mPriv->push(reader);
+    } else {
+        mPriv->pool.addInactivePacket(reader);
+    }
+    mPriv->stateMutex.unlock();
+    if (added) {
+        mPriv->contentSema.post();
+    }
+    return true;
+}
+
+
 bool PortReaderBufferBase::forgetObjectBase(PortReader* obj,
                                             yarp::os::PortWriter* wrapper)
 {
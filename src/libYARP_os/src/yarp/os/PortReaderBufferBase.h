@@ -12,6 +12,8 @@
 
 #include <yarp/os/PortReader.h>
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 namespace yarp {
@@ -21,6 +23,33 @@ class Port;
 class PortReaderBufferBaseCreator;
 class PortWriter;
 
+/**
+ * What a reader with a bounded buffer (see BufferedPort::setCapacity())
+ * does with a message that arrives when the buffer is full.
+ */
+enum class BufferOverflowPolicy
+{
+    DropOldest, ///< the oldest message waiting to be read is discarded
+    DropNewest, ///< the message that arrives is discarded
+    Block,      ///< the sender waits until a message is read
+    Coalesce    ///< the message replaces the waiting message with the same key,
+                ///< if any, otherwise the oldest message is discarded
+};
+
+/**
+ * Counters of the messages received by a reader with a buffer, and of
+ * what was done to keep the buffer within its capacity.
+ */
+struct BufferOverflowStats
+{
+    size_t received {0};      ///< messages received
+    size_t droppedOldest {0}; ///< waiting messages discarded to make room
+    size_t droppedNewest {0}; ///< messages discarded when they arrived
+    size_t coalesced {0};     ///< waiting messages replaced by a newer one with the same key
+    size_t blocked {0};       ///< times a sender had to wait for room
+    size_t highWater {0};     ///< maximum number of messages waiting at the same time
+};
+
 class YARP_os_API PortReaderBufferBase :
         public yarp::os::PortReader
 {
@@ -40,6 +69,37 @@ public:
 
     unsigned int getMaxBuffer();
 
+    /**
+     * Keep at most a given number of messages waiting to be read.  The
+     * storage for them is allocated once, here.  While a capacity is
+     * set, setPrune() has no effect.  Once interrupt() is called (e.g.
+     * when the port is closed), senders are not kept waiting anymore,
+     * the oldest messages are dropped instead.
+     *
+     * @param capacity the number of messages, 0 to go back to an
+     *        unbounded buffer
+     * @param policy what to do with the messages that arrive when the
+     *        buffer is full
+     */
+    void setCapacity(size_t capacity, BufferOverflowPolicy policy);
+
+    /**
+     * @return the capacity given to setCapacity(), 0 if there is none
+     */
+    size_t getCapacity();
+
+    /**
+     * Set the function that gives the key of a message, used by the
+     * BufferOverflowPolicy::Coalesce policy.  It is called with the
+     * buffer locked, so it should be quick.
+     */
+    void setCoalescingKey(std::function<std::string(const yarp::os::PortReader&)> key);
+
+    /**
+     * @return the counters of the messages received and dropped
+     */
+    BufferOverflowStats getOverflowStats();
+
     bool isClosed();
 
     void clear();
@@ -61,6 +121,25 @@ public:
     virtual bool acceptObjectBase(yarp::os::PortReader* obj,
                                   yarp::os::PortWriter* wrapper);
 
+    /**
+     * Take a copy of an object written by a port of the same process,
+     * without going through a connection.  The copy is made by
+     * assignment if the type matches the objects of the buffer,
+     * otherwise by serializing the object in memory.  Unlike
+     * acceptObjectBase, this never waits for room in the buffer: the
+     * message is dropped if there is none, unless the buffer waits for
+     * room (BufferOverflowPolicy::Block), in which case the message is
+     * left to the connection.
+     *
+     * @param obj the object written, not used once this returns
+     * @param envelope the envelope of the message
+     * @return true if the message was handled, false if the buffer
+     *         cannot take messages this way (no creator, a replier, or
+     *         the Block policy)
+     */
+    bool acceptLocalBase(const yarp::os::PortWriter& obj,
+                         const std::string& envelope);
+
     virtual bool forgetObjectBase(yarp::os::PortReader* obj,
                                   yarp::os::PortWriter* wrapper);
 
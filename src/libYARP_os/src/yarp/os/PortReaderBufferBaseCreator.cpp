@@ -9,3 +9,10 @@
 #include <yarp/os/PortReaderBufferBaseCreator.h>
 
 yarp::os::PortReaderBufferBaseCreator::~PortReaderBufferBaseCreator() = default;
+
+bool yarp::os::PortReaderBufferBaseCreator::copyLocal(const yarp::os::PortWriter& obj, yarp::os::PortReader& dest) const
+{
+    YARP_UNUSED(obj);
+    YARP_UNUSED(dest);
+    return false;
+}
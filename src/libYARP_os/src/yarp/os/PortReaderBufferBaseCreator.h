@@ -16,6 +16,7 @@ namespace yarp {
 namespace os {
 
 class PortReader;
+class PortWriter;
 
 class YARP_os_API PortReaderBufferBaseCreator
 {
@@ -23,6 +24,17 @@ public:
     virtual ~PortReaderBufferBaseCreator();
 
     virtual yarp::os::PortReader* create() const = 0;
+
+    /**
+     * Copy an object written by a port of the same process into an
+     * object of the buffer, without serializing it.
+     *
+     * @param obj the object written
+     * @param dest an object created by create()
+     * @return true if the object was copied, false if it has to be
+     *         serialized instead (the default)
+     */
+    virtual bool copyLocal(const yarp::os::PortWriter& obj, yarp::os::PortReader& dest) const;
 };
 
 } // namespace os
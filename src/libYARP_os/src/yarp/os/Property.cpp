@@ -24,6 +24,7 @@
 #include <cstring>
 #include <map>
 #include <memory>
+#include <vector>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -102,32 +103,115 @@ public:
     std::map<std::string, PropertyItem> data;
     Property* owner;
 
+    /*
+     * Lookups go through an open addressing hash table of the entries
+     * of data, rather than through the map.  The keys are not copied:
+     * the table points to the key of each map node (nodes never move),
+     * so that each key is stored once.  The map is still used for
+     * storage, and to keep the output of toString() sorted.
+     */
+    struct Slot
+    {
+        size_t hash;
+        const std::string* key; // nullptr if the slot is free
+        PropertyItem* item;
+    };
+    std::vector<Slot> index;
+    size_t indexed{0};
+
     explicit Private(Property* owner) :
             owner(owner)
     {
     }
 
-    PropertyItem* getPropNoCreate(const std::string& key) const
+    static size_t hashKey(const char* key, size_t len)
+    {
+        // FNV-1a
+        size_t h = static_cast<size_t>(14695981039346656037ULL);
+        for (size_t i = 0; i < len; i++) {
+            h ^= static_cast<unsigned char>(key[i]);
+            h *= static_cast<size_t>(1099511628211ULL);
+        }
+        return h;
+    }
+
+    // Add an entry to the table, which must have room for it (see
+    // reserveIndex()).
+    void insertIndex(const std::string* key, PropertyItem* item, size_t hash)
     {
-        auto it = data.find(key);
-        if (it == data.end()) {
+        const size_t mask = index.size() - 1;
+        size_t i = hash & mask;
+        while (index[i].key != nullptr) {
+            i = (i + 1) & mask;
+        }
+        index[i] = Slot{hash, key, item};
+        indexed++;
+    }
+
+    // Grow the table before an entry is added to data, keeping it at most
+    // half full so that probes stay short.  The table is rebuilt from data,
+    // so the new entry must be inserted after this.
+    void reserveIndex()
+    {
+        if ((indexed + 1) * 2 > index.size()) {
+            reindex(std::max<size_t>(16, index.size() * 2));
+        }
+    }
+
+    void reindex(size_t capacity)
+    {
+        index.assign(capacity, Slot{0, nullptr, nullptr});
+        indexed = 0;
+        for (auto& it : data) {
+            insertIndex(&(it.first), &(it.second), hashKey(it.first.c_str(), it.first.length()));
+        }
+    }
+
+    void reindex()
+    {
+        size_t capacity = 16;
+        while (data.size() * 2 > capacity) {
+            capacity *= 2;
+        }
+        reindex(capacity);
+    }
+
+    PropertyItem* getPropNoCreate(const char* key, size_t len, size_t hash) const
+    {
+        if (indexed == 0) {
             return nullptr;
         }
-        return const_cast<PropertyItem*>(&(it->second));
+        const size_t mask = index.size() - 1;
+        for (size_t i = hash & mask; index[i].key != nullptr; i = (i + 1) & mask) {
+            const Slot& slot = index[i];
+            if (slot.hash == hash && slot.key->length() == len && memcmp(slot.key->data(), key, len) == 0) {
+                return slot.item;
+            }
+        }
+        return nullptr;
+    }
+
+    PropertyItem* getPropNoCreate(const char* key, size_t len) const
+    {
+        return getPropNoCreate(key, len, hashKey(key, len));
+    }
+
+    PropertyItem* getPropNoCreate(const std::string& key) const
+    {
+        return getPropNoCreate(key.c_str(), key.length());
     }
 
     PropertyItem* getProp(const std::string& key, bool create = true)
     {
-        auto entry = data.find(key);
-        if (entry == data.end()) {
-            if (!create) {
-                return nullptr;
-            }
-            data[key] = PropertyItem();
-            entry = data.find(key);
+        size_t hash = hashKey(key.c_str(), key.length());
+        PropertyItem* p = getPropNoCreate(key.c_str(), key.length(), hash);
+        if (p == nullptr && create) {
+            reserveIndex();
+            auto entry = data.emplace(key, PropertyItem()).first;
+            p = &(entry->second);
+            insertIndex(&(entry->first), p, hash);
         }
-        yAssert(entry != data.end());
-        return &(entry->second);
+        return p;
     }
 
     void put(const std::string& key, const std::string& val)
@@ -173,29 +257,31 @@ public:
 
     void unput(const std::string& key)
     {
-        data.erase(key);
+        if (data.erase(key) != 0) {
+            reindex();
+        }
     }
 
-    bool check(const std::string& key) const
+    bool check(const char* key, size_t len) const
     {
-        PropertyItem* p = getPropNoCreate(key);
+        PropertyItem* p = getPropNoCreate(key, len);
         if (owner->getMonitor() != nullptr) {
             SearchReport report;
-            report.key = key;
+            report.key = std::string(key, len);
             report.isFound = (p != nullptr);
             owner->reportToMonitor(report);
         }
         return p != nullptr;
     }
 
-    Value& get(const std::string& key) const
+    Value& get(const char* key, size_t len) const
     {
-        PropertyItem* p = getPropNoCreate(key);
+        PropertyItem* p = getPropNoCreate(key, len);
         if (p != nullptr) {
             p->flush();
             if (owner->getMonitor() != nullptr) {
                 SearchReport report;
-                report.key = key;
+                report.key = std::string(key, len);
                 report.isFound = true;
                 report.value = p->bot.get(1).toString();
                 owner->reportToMonitor(report);
@@ -204,7 +290,7 @@ public:
         }
         if (owner->getMonitor() != nullptr) {
             SearchReport report;
-            report.key = key;
+            report.key = std::string(key, len);
             owner->reportToMonitor(report);
         }
         return Value::getNullValue();
@@ -254,6 +340,9 @@ public:
     void clear()
     {
         data.clear();
+        // keep the table
+        std::fill(index.begin(), index.end(), Slot{0, nullptr, nullptr});
+        indexed = 0;
     }
 
     void fromString(const std::string& txt, bool wipe = true)
@@ -978,6 +1067,7 @@ Property& Property::operator=(const Property& rhs)
         Searchable::operator=(static_cast<const Searchable&>(rhs));
         Portable::operator=(static_cast<const Portable&>(rhs));
         mPriv->data = rhs.mPriv->data;
+        mPriv->reindex();
         mPriv->owner = this;
     }
     return *this;
@@ -1021,7 +1111,12 @@ void Property::put(const std::string& key, double value)
 
 bool Property::check(const std::string& key) const
 {
-    return mPriv->check(key);
+    return mPriv->check(key.c_str(), key.length());
+}
+
+bool Property::check(const char* key) const
+{
+    return mPriv->check(key, strlen(key));
 }
 
 void Property::unput(const std::string& key)
@@ -1031,7 +1126,12 @@ void Property::unput(const std::string& key)
 
 Value& Property::find(const std::string& key) const
 {
-    return mPriv->get(key);
+    return mPriv->get(key.c_str(), key.length());
+}
+
+Value& Property::find(const char* key) const
+{
+    return mPriv->get(key, strlen(key));
 }
 
 
@@ -98,6 +98,19 @@ public:
     // documented in Searchable
     bool check(const std::string& key) const override;
 
+#ifndef SWIG
+    /**
+     * \brief Check if there exists a property of the given name.
+     *
+     * Same as check(const std::string&), without building a std::string
+     * for the key, which allocates memory for long keys.
+     *
+     * @param key the name to check for, a null terminated string
+     * @return true iff a property of the given name exists
+     */
+    bool check(const char* key) const;
+#endif // SWIG
+
     /**
      * \brief Associate the given \c key with the given string.
      *
@@ -188,6 +201,19 @@ public:
     // documented in Searchable
     Value& find(const std::string& key) const override;
 
+#ifndef SWIG
+    /**
+     * \brief Gets a value corresponding to a given keyword.
+     *
+     * Same as find(const std::string&), without building a std::string
+     * for the key, which allocates memory for long keys.
+     *
+     * @param key the keyword to look for, a null terminated string
+     * @return the value associated with the keyword, or a null Value
+     */
+    Value& find(const char* key) const;
+#endif // SWIG
+
     // documented in Searchable
     Bottle& findGroup(const std::string& key) const override;
 
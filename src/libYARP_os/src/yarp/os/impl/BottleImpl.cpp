@@ -18,6 +18,12 @@
 #include <yarp/os/impl/MemoryOutputStream.h>
 #include <yarp/os/impl/StreamConnectionReader.h>
 
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
 using yarp::os::Bottle;
 using yarp::os::Bytes;
 using yarp::os::ConnectionReader;
@@ -26,6 +32,7 @@ using yarp::os::Searchable;
 using yarp::os::Value;
 using yarp::os::impl::BottleImpl;
 using yarp::os::impl::Storable;
+using yarp::os::impl::StoreString;
 
 //#define YMSG(x) printf x;
 //#define YTRACE(x) YMSG(("at %s\n", x))
@@ -38,6 +45,8 @@ BottleImpl::BottleImpl() :
         parent(nullptr),
         invalid(false),
         ro(false),
+        packed(0),
+        extraState(nullptr),
         speciality(0),
         nested(false),
         dirty(true)
@@ -48,6 +57,8 @@ BottleImpl::BottleImpl(Searchable* parent) :
         parent(parent),
         invalid(false),
         ro(false),
+        packed(0),
+        extraState(nullptr),
         speciality(0),
         nested(false),
         dirty(true)
@@ -55,240 +66,805 @@ BottleImpl::BottleImpl(Searchable* parent) :
 }
 
 
+struct BottleImpl::Extra
+{
+    Extra() = default;
+    Extra(const Extra&) = delete;
+    Extra& operator=(const Extra&) = delete;
+
+    ~Extra()
+    {
+        for (auto& spare : spares) {
+            for (auto& i : spare) {
+                delete i;
+            }
+        }
+        delete writer;
+    }
+
+    BufferedConnectionWriter* writer{nullptr}; // kept to serialize without allocating
+    std::string unquoted;                      // kept to parse strings without allocating
+
+    std::vector<Storable*> spares[spareKinds];
+    size_t spareCount{0};
+    size_t spareBytes{0};
+
+    // The const methods that create the items, or that copy the items
+    // to the packed arrays (mirrored), hold lazyMutex, so that a bottle
+    // can be read from several threads.  They keep the packed arrays,
+    // which are released by the next modification only.
+    std::int32_t mirrored{0};
+    std::vector<yarp::conf::float64_t> packedFloat64;
+    std::vector<std::int32_t> packedInt32;
+    std::mutex lazyMutex;
+};
+
+
 BottleImpl::~BottleImpl()
 {
-    clear();
+    for (auto& i : content) {
+        delete i;
+    }
+    delete extraState.load(std::memory_order_relaxed);
+}
+
+
+BottleImpl::Extra& BottleImpl::extra() const
+{
+    // Const readers may need it at the same time: the first one wins
+    Extra* e = extraState.load(std::memory_order_acquire);
+    if (e == nullptr) {
+        auto* created = new Extra;
+        if (extraState.compare_exchange_strong(e, created, std::memory_order_acq_rel)) {
+            e = created;
+        } else {
+            delete created;
+        }
+    }
+    return *e;
+}
+
+
+size_t BottleImpl::getSpareCount() const
+{
+    Extra* e = extraState.load(std::memory_order_acquire);
+    return (e != nullptr) ? e->spareCount : 0;
+}
+
+size_t BottleImpl::getSpareBytes() const
+{
+    Extra* e = extraState.load(std::memory_order_acquire);
+    return (e != nullptr) ? e->spareBytes : 0;
 }
 
 
 void BottleImpl::add(Storable* s)
 {
+    unpack();
     content.push_back(s);
     dirty = true;
 }
 
+void BottleImpl::addPacked(std::int32_t x)
+{
+    extra().packedInt32.push_back(x);
+    dirty = true;
+}
+
+void BottleImpl::addPacked(yarp::conf::float64_t x)
+{
+    extra().packedFloat64.push_back(x);
+    dirty = true;
+}
+
 
 void BottleImpl::clear()
 {
     for (auto& i : content) {
-        delete i;
+        recycle(i);
     }
     content.clear();
+    packed = 0;
+    Extra* e = extraState.load(std::memory_order_relaxed);
+    if (e != nullptr) {
+        e->mirrored = 0;
+        e->packedFloat64.clear();
+        e->packedInt32.clear();
+    }
     dirty = true;
 }
 
-void BottleImpl::smartAdd(const std::string& str)
-{
-    if (str.length() > 0) {
-        char ch = str[0];
-        Storable* s = nullptr;
-        StoreString* ss = nullptr;
-        bool numberLike = true;
-        bool preamble = true;
-        bool hexActive = false;
-        size_t hexStart = 0;
-        int periodCount = 0;
-        int signCount = 0;
-        bool hasPeriodOrE = false;
-        for (size_t i = 0; i < str.length(); i++) {
-            char ch2 = str[i];
-            if (ch2 == '.') {
-                hasPeriodOrE = true;
-                periodCount++;
-                if (periodCount > 1) {
-                    numberLike = false;
-                }
-            }
-            if (!hexActive && (ch2 == 'e' || ch2 == 'E')) {
-                hasPeriodOrE = true;
-            }
-            if (preamble) {
-                if (ch2 == 'x' || ch2 == 'X') {
-                    hexActive = true;
-                    hexStart = i;
-                    continue;
-                }
-            }
-            if (preamble) {
-                if (ch2 == '0' || ch2 == '+' || ch2 == '-') {
-                    if (ch2 == '+' || ch2 == '-') {
-                        signCount++;
-                        if (signCount > 1) {
-                            numberLike = false;
-                        }
-                    }
-                    continue;
-                }
-            }
-            preamble = false;
-            if (!((ch2 >= '0' && ch2 <= '9') || ch2 == '.' || ch2 == 'e' ||
-                  ch2 == 'E' || ch2 == '+' || ch2 == '-' ||
-                  (hexActive && ((ch2 >= 'a' && ch2 <= 'f') ||
-                                 (ch2 >= 'A' && ch2 <= 'F'))))) {
-                numberLike = false;
-                break;
-            }
+
+void BottleImpl::unpack() const
+{
+    if (packed.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    // (the packed arrays are in extra(), created before packed was set)
+    Extra& e = extra();
+    std::lock_guard<std::mutex> lock(e.lazyMutex);
+    auto* self = const_cast<BottleImpl*>(this);
+    std::int32_t code = packed.load(std::memory_order_relaxed);
+    if (code != 0) {
+        self->createItems();
+        e.mirrored = code;
+        // the items are complete before they are seen by other threads
+        self->packed.store(0, std::memory_order_release);
+    }
+}
+
+void BottleImpl::unpack()
+{
+    if (packed != 0) {
+        createItems();
+        packed = 0;
+    }
+    Extra* e = extraState.load(std::memory_order_relaxed);
+    if (e != nullptr) {
+        e->mirrored = 0;
+        e->packedFloat64.clear();
+        e->packedInt32.clear();
+    }
+}
+
+void BottleImpl::createItems()
+{
+    Extra& e = extra();
+    if (packed == BOTTLE_TAG_FLOAT64) {
+        content.reserve(e.packedFloat64.size());
+        for (auto x : e.packedFloat64) {
+            content.push_back(create(StoreFloat64(x)));
         }
-        if (hexActive) {
-            if (static_cast<int>(str.length()) - (hexStart + 1) > 8) {
-                // we can only deal with 32bit hexadecimal
-                numberLike = false;
-            }
+    } else if (packed == BOTTLE_TAG_INT32) {
+        content.reserve(e.packedInt32.size());
+        for (auto x : e.packedInt32) {
+            content.push_back(create(StoreInt32(x)));
         }
+    }
+}
 
-        if (numberLike &&
-            ((ch >= '0' && ch <= '9') || ch == '+' || ch == '-' || ch == '.') &&
-            (ch != '.' || str.length() > 1)) {
-            if (!hasPeriodOrE) {
-                s = new StoreInt32(0);
-            } else {
-                s = new StoreFloat64(0);
+
+void BottleImpl::assignFloat64(const yarp::conf::float64_t* values, size_type len)
+{
+    clear();
+    if (len > 0) {
+        extra().packedFloat64.assign(values, values + len);
+        packed = BOTTLE_TAG_FLOAT64;
+    }
+}
+
+void BottleImpl::assignInt32(const std::int32_t* values, size_type len)
+{
+    clear();
+    if (len > 0) {
+        extra().packedInt32.assign(values, values + len);
+        packed = BOTTLE_TAG_INT32;
+    }
+}
+
+
+const yarp::conf::float64_t* BottleImpl::getFloat64Data() const
+{
+    Extra& e = extra();
+    std::lock_guard<std::mutex> lock(e.lazyMutex);
+    if (packed != 0) {
+        return (packed == BOTTLE_TAG_FLOAT64) ? e.packedFloat64.data() : nullptr;
+    }
+    if (content.empty()) {
+        return nullptr;
+    }
+    for (auto s : content) {
+        if (!s->isFloat64()) {
+            return nullptr;
+        }
+    }
+    // The items may have been changed through get() since the last call
+    // (or since they were unpacked): the copy is checked every time.  It
+    // is updated in place, so that the arrays returned before stay valid
+    // until the bottle is modified.
+    if (e.mirrored != BOTTLE_TAG_FLOAT64 || e.packedFloat64.size() != content.size()) {
+        e.packedFloat64.clear();
+        for (auto s : content) {
+            e.packedFloat64.push_back(s->asFloat64());
+        }
+        e.mirrored = BOTTLE_TAG_FLOAT64;
+    } else {
+        for (size_t i = 0; i < content.size(); i++) {
+            yarp::conf::float64_t x = content[i]->asFloat64();
+            if (e.packedFloat64[i] != x) {
+                e.packedFloat64[i] = x;
             }
-        } else if (ch == '(') {
-            s = new StoreList();
-        } else if (ch == '[') {
-            s = new StoreVocab();
-        } else if (ch == '{') {
-            s = new StoreBlob();
-        } else {
-            s = ss = new StoreString("");
-        }
-        if (s != nullptr) {
-            s->fromStringNested(str);
-            if (ss != nullptr) {
-                if (str.length() == 0 || str[0] != '\"') {
-                    std::string val = ss->asString();
-                    if (val == "true") {
-                        delete s;
-                        s = new StoreVocab(static_cast<int>('1'));
-                    } else if (val == "false") {
-                        delete s;
-                        s = new StoreVocab(0);
-                    }
-                }
+        }
+    }
+    return e.packedFloat64.data();
+}
+
+const std::int32_t* BottleImpl::getInt32Data() const
+{
+    Extra& e = extra();
+    std::lock_guard<std::mutex> lock(e.lazyMutex);
+    if (packed != 0) {
+        return (packed == BOTTLE_TAG_INT32) ? e.packedInt32.data() : nullptr;
+    }
+    if (content.empty()) {
+        return nullptr;
+    }
+    for (auto s : content) {
+        if (!s->isInt32()) {
+            return nullptr;
+        }
+    }
+    // The items may have been changed through get() since the last call
+    // (or since they were unpacked): the copy is checked every time.  It
+    // is updated in place, so that the arrays returned before stay valid
+    // until the bottle is modified.
+    if (e.mirrored != BOTTLE_TAG_INT32 || e.packedInt32.size() != content.size()) {
+        e.packedInt32.clear();
+        for (auto s : content) {
+            e.packedInt32.push_back(s->asInt32());
+        }
+        e.mirrored = BOTTLE_TAG_INT32;
+    } else {
+        for (size_t i = 0; i < content.size(); i++) {
+            std::int32_t x = content[i]->asInt32();
+            if (e.packedInt32[i] != x) {
+                e.packedInt32[i] = x;
             }
-            add(s);
         }
-        ss = nullptr;
     }
+    return e.packedInt32.data();
 }
 
-void BottleImpl::fromString(const std::string& line)
+
+bool BottleImpl::canReadPacked(ConnectionReader& reader, std::int32_t len) const
+{
+#ifdef YARP_LITTLE_ENDIAN
+    size_t itemSize = 0;
+    if (speciality == BOTTLE_TAG_FLOAT64) {
+        itemSize = sizeof(yarp::conf::float64_t);
+    } else if (speciality == BOTTLE_TAG_INT32) {
+        itemSize = sizeof(std::int32_t);
+    }
+    // Do not trust the length before checking that the data is there
+    return itemSize != 0 && len > 0 && static_cast<size_t>(len) * itemSize <= reader.getSize();
+#else
+    YARP_UNUSED(reader);
+    YARP_UNUSED(len);
+    return false;
+#endif
+}
+
+bool BottleImpl::readPacked(ConnectionReader& reader, std::int32_t len)
+{
+    // The items are stored in the same byte order on the wire
+    bool ok = false;
+    Extra& e = extra();
+    if (speciality == BOTTLE_TAG_FLOAT64) {
+        e.packedFloat64.resize(len);
+        ok = reader.expectBlock(reinterpret_cast<char*>(e.packedFloat64.data()),
+                                len * sizeof(yarp::conf::float64_t));
+    } else {
+        e.packedInt32.resize(len);
+        ok = reader.expectBlock(reinterpret_cast<char*>(e.packedInt32.data()),
+                                len * sizeof(std::int32_t));
+    }
+    if (!ok) {
+        e.packedFloat64.clear();
+        e.packedInt32.clear();
+        return false;
+    }
+    packed = speciality;
+    return true;
+}
+
+
+size_t BottleImpl::spareIndex(std::int32_t code)
+{
+    switch (code) {
+    case BOTTLE_TAG_INT8:
+        return 0;
+    case BOTTLE_TAG_INT16:
+        return 1;
+    case BOTTLE_TAG_INT32:
+        return 2;
+    case BOTTLE_TAG_INT64:
+        return 3;
+    case BOTTLE_TAG_FLOAT32:
+        return 4;
+    case BOTTLE_TAG_FLOAT64:
+        return 5;
+    case BOTTLE_TAG_VOCAB:
+        return 6;
+    case BOTTLE_TAG_STRING:
+        return 7;
+    case BOTTLE_TAG_BLOB:
+        return 8;
+    default:
+        // Lists, typed or not, but not dictionaries
+        if ((code & GROUP_MASK) == BOTTLE_TAG_LIST) {
+            return 9;
+        }
+        return spareKinds;
+    }
+}
+
+
+size_t BottleImpl::spareSize(const Storable* s)
+{
+    if (s->isString()) {
+        return static_cast<const StoreString*>(s)->capacity();
+    }
+    if (s->isBlob()) {
+        return static_cast<const StoreBlob*>(s)->capacity();
+    }
+    return 0;
+}
+
+
+void BottleImpl::recycle(Storable* s)
+{
+    // (the code of a list depends on its content, no need to compute it)
+    size_t index = s->isList() ? spareIndex(BOTTLE_TAG_LIST) : spareIndex(s->getCode());
+    size_t bytes = spareSize(s);
+    if (index >= spareKinds) {
+        delete s;
+        return;
+    }
+    Extra& e = extra();
+    if (e.spareCount >= maxSpareItems || e.spareBytes + bytes > maxSpareBytes) {
+        delete s;
+        return;
+    }
+    if (s->isList()) {
+        // Its own items go to its spares, within its own limits.
+        s->asList()->implementation->clear();
+    }
+    e.spares[index].push_back(s);
+    e.spareCount++;
+    e.spareBytes += bytes;
+}
+
+
+Storable* BottleImpl::reuse(std::int32_t code)
+{
+    size_t index = spareIndex(code);
+    Extra* e = extraState.load(std::memory_order_relaxed);
+    if (e == nullptr || index >= spareKinds || e->spares[index].empty()) {
+        return nullptr;
+    }
+    Storable* s = e->spares[index].back();
+    e->spares[index].pop_back();
+    e->spareCount--;
+    e->spareBytes -= spareSize(s);
+    if (s->isList()) {
+        // Bring the list back to the state of a new one (it was cleared
+        // by recycle()).
+        BottleImpl* impl = s->asList()->implementation;
+        impl->specialize(0);
+        impl->setNested(false);
+        impl->invalid = false;
+    }
+    return s;
+}
+
+
+Storable* BottleImpl::createByCode(std::int32_t code)
+{
+    Storable* s = reuse(code);
+    if (s == nullptr) {
+        return Storable::createByCode(code);
+    }
+    if (s->isList()) {
+        // as done by Storable::createByCode
+        BottleImpl* impl = s->asList()->implementation;
+        impl->specialize(code & UNIT_MASK);
+        impl->setNested(true);
+    }
+    return s;
+}
+
+namespace {
+
+// Classes of the characters of the text form of a Bottle.  The scanner
+// looks them up in a table, and skips runs of plain characters, rather
+// than using SIMD: items are short and the grammar is branchy, so wide
+// loads would not pay off.
+enum CharClass : unsigned char
+{
+    Plain,
+    Space, // ends an item, and is skipped before items
+    Comma, // ends an item
+    Quote,
+    Escape,
+    OpenList,
+    CloseList,
+    OpenBlob,
+    CloseBlob
+};
+
+struct CharClassTable
+{
+    CharClass table[256];
+
+    constexpr CharClassTable() :
+            table()
+    {
+        table[static_cast<unsigned char>(' ')] = Space;
+        table[static_cast<unsigned char>('\t')] = Space;
+        table[static_cast<unsigned char>('\n')] = Space;
+        table[static_cast<unsigned char>('\r')] = Space;
+        table[static_cast<unsigned char>(',')] = Comma;
+        table[static_cast<unsigned char>('\"')] = Quote;
+        table[static_cast<unsigned char>('\\')] = Escape;
+        table[static_cast<unsigned char>('(')] = OpenList;
+        table[static_cast<unsigned char>(')')] = CloseList;
+        table[static_cast<unsigned char>('{')] = OpenBlob;
+        table[static_cast<unsigned char>('}')] = CloseBlob;
+    }
+
+    CharClass operator[](char ch) const
+    {
+        return table[static_cast<unsigned char>(ch)];
+    }
+};
+
+// (constant initialized, so usable by static constructors)
+constexpr CharClassTable charClasses;
+
+/*
+ * Split the text form of a Bottle in its top level items, and call
+ * onItem(begin, length) for each one of them, without copying.
+ *
+ * Items are separated by spaces or commas outside of quotes, lists and
+ * blobs, and a backslash escapes the following character.  An item that
+ * is still open at the end of the text (e.g. with an unmatched quote) is
+ * dropped.
+ */
+template <typename F>
+void forEachItem(const char* text, size_t len, F onItem)
 {
-    clear();
-    dirty = true;
-    std::string arg;
     bool quoted = false;
     bool back = false;
     bool begun = false;
     int nested = 0;
     int nestedAlt = 0;
-    std::string nline = line + " ";
-
-    for (char ch : nline) {
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
         if (back) {
-            arg += ch;
             back = false;
-        } else {
-            if (!begun) {
-                if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') {
-                    begun = true;
-                }
+            continue;
+        }
+        CharClass cls = charClasses[text[i]];
+        if (!begun) {
+            if (cls == Space) {
+                continue;
+            }
+            begun = true;
+            start = i;
+        }
+        switch (cls) {
+        case Plain:
+            // Skip the whole run of plain characters
+            while (i + 1 < len && charClasses[text[i + 1]] == Plain) {
+                i++;
             }
-            if (begun) {
-                if (ch == '\"') {
-                    quoted = !quoted;
+            break;
+        case Quote:
+            quoted = !quoted;
+            break;
+        case Escape:
+            back = true;
+            break;
+        case OpenList:
+            nested += quoted ? 0 : 1;
+            break;
+        case CloseList:
+            nested -= quoted ? 0 : 1;
+            break;
+        case OpenBlob:
+            nestedAlt += quoted ? 0 : 1;
+            break;
+        case CloseBlob:
+            nestedAlt -= quoted ? 0 : 1;
+            break;
+        case Space:
+        case Comma:
+            if (!quoted && nested == 0 && nestedAlt == 0) {
+                if (i > start) {
+                    onItem(text + start, i - start);
                 }
-                if (!quoted) {
-                    if (ch == '(') {
-                        nested++;
-                    }
-                    if (ch == ')') {
-                        nested--;
-                    }
-                    if (ch == '{') {
-                        nestedAlt++;
-                    }
-                    if (ch == '}') {
-                        nestedAlt--;
+                begun = false;
+            }
+            break;
+        }
+    }
+    // The end of the text ends the last item, as a space would do
+    if (begun && !back && !quoted && nested == 0 && nestedAlt == 0) {
+        onItem(text + start, len - start);
+    }
+}
+
+enum ItemKind
+{
+    IntItem,
+    FloatItem,
+    ListItem,
+    VocabItem,
+    BlobItem,
+    StringItem
+};
+
+// Guess the kind of an item from its text
+ItemKind itemKind(const char* str, size_t len)
+{
+    char ch = str[0];
+    bool numberLike = true;
+    bool preamble = true;
+    bool hexActive = false;
+    size_t hexStart = 0;
+    int periodCount = 0;
+    int signCount = 0;
+    bool hasPeriodOrE = false;
+    for (size_t i = 0; i < len; i++) {
+        char ch2 = str[i];
+        if (ch2 == '.') {
+            hasPeriodOrE = true;
+            periodCount++;
+            if (periodCount > 1) {
+                numberLike = false;
+            }
+        }
+        if (!hexActive && (ch2 == 'e' || ch2 == 'E')) {
+            hasPeriodOrE = true;
+        }
+        if (preamble) {
+            if (ch2 == 'x' || ch2 == 'X') {
+                hexActive = true;
+                hexStart = i;
+                continue;
+            }
+        }
+        if (preamble) {
+            if (ch2 == '0' || ch2 == '+' || ch2 == '-') {
+                if (ch2 == '+' || ch2 == '-') {
+                    signCount++;
+                    if (signCount > 1) {
+                        numberLike = false;
                     }
                 }
-                if (ch == '\\') {
-                    back = true;
-                    arg += ch;
-                } else {
-                    if ((!quoted) && (ch == ',' || ch == ' ' || ch == '\t' ||
-                                      ch == '\n' || ch == '\r') &&
-                        (nestedAlt == 0) && (nested == 0)) {
-                        if (!arg.empty()) {
-                            if (arg == "null") {
-                                add(new StoreVocab(yarp::os::createVocab('n', 'u', 'l', 'l')));
-                            } else {
-                                smartAdd(arg);
-                            }
-                        }
-                        arg = "";
-                        begun = false;
-                    } else {
-                        arg += ch;
-                    }
+                continue;
+            }
+        }
+        preamble = false;
+        if (!((ch2 >= '0' && ch2 <= '9') || ch2 == '.' || ch2 == 'e' ||
+              ch2 == 'E' || ch2 == '+' || ch2 == '-' ||
+              (hexActive && ((ch2 >= 'a' && ch2 <= 'f') ||
+                             (ch2 >= 'A' && ch2 <= 'F'))))) {
+            numberLike = false;
+            break;
+        }
+    }
+    if (hexActive) {
+        if (len - (hexStart + 1) > 8) {
+            // we can only deal with 32bit hexadecimal
+            numberLike = false;
+        }
+    }
+
+    if (numberLike &&
+        ((ch >= '0' && ch <= '9') || ch == '+' || ch == '-' || ch == '.') &&
+        (ch != '.' || len > 1)) {
+        return hasPeriodOrE ? FloatItem : IntItem;
+    }
+    if (ch == '(') {
+        return ListItem;
+    }
+    if (ch == '[') {
+        return VocabItem;
+    }
+    if (ch == '{') {
+        return BlobItem;
+    }
+    return StringItem;
+}
+
+// Length of the text of an item, without its first and last characters
+inline size_t innerLength(size_t len)
+{
+    return (len >= 2) ? len - 2 : 0;
+}
+
+// Copy a number in a null terminated buffer, for strtol and strtod.
+// Numbers are short, the heap is used only for unusually long ones.
+class NumberText
+{
+public:
+    NumberText(const char* str, size_t len)
+    {
+        if (len < sizeof(buf)) {
+            memcpy(buf, str, len);
+            buf[len] = '\0';
+            text = buf;
+        } else {
+            big.assign(str, len);
+            text = &big[0];
+        }
+    }
+
+    char* text;
+
+private:
+    char buf[64];
+    std::string big;
+};
+
+std::int32_t textToInt32(const char* str, size_t len)
+{
+    // as StoreInt32::fromString()
+    NumberText number(str, len);
+    return static_cast<std::int32_t>(strtol(number.text, nullptr, 0));
+}
+
+yarp::conf::float64_t textToFloat64(const char* str, size_t len)
+{
+    // as StoreFloat64::fromString(), dealing with the locale
+    NumberText number(str, len);
+    char* period = static_cast<char*>(memchr(number.text, '.', len));
+    if (period != nullptr) {
+        *period = localeconv()->decimal_point[0];
+    }
+    return static_cast<yarp::conf::float64_t>(strtod(number.text, nullptr));
+}
+
+std::int32_t textToVocab(const char* str, size_t len)
+{
+    // as Vocab::encode()
+    return yarp::os::createVocab((len > 0) ? str[0] : 0,
+                                 (len > 1) ? str[1] : 0,
+                                 (len > 2) ? str[2] : 0,
+                                 (len > 3) ? str[3] : 0);
+}
+
+inline bool textIs(const char* str, size_t len, const char* word)
+{
+    return len == strlen(word) && memcmp(str, word, len) == 0;
+}
+
+// The value of an item in the text of a blob, as Value::asInt32() would
+// return for the item
+std::int32_t blobItemValue(const char* str, size_t len, std::string& unquoted)
+{
+    if (textIs(str, len, "null")) {
+        return yarp::os::createVocab('n', 'u', 'l', 'l');
+    }
+    switch (itemKind(str, len)) {
+    case IntItem:
+        return textToInt32(str, len);
+    case FloatItem:
+        return static_cast<std::int32_t>(textToFloat64(str, len));
+    case VocabItem:
+        return textToVocab(str + 1, innerLength(len));
+    case StringItem:
+        if (str[0] != '\"') {
+            StoreString::unquote(str, len, unquoted);
+            if (unquoted == "true") {
+                return static_cast<int>('1');
+            }
+        }
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+void BottleImpl::smartAdd(const char* str, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    Storable* s = nullptr;
+    switch (itemKind(str, len)) {
+    case IntItem:
+        s = create(StoreInt32(textToInt32(str, len)));
+        break;
+    case FloatItem:
+        s = create(StoreFloat64(textToFloat64(str, len)));
+        break;
+    case ListItem:
+        s = reuse(StoreList::code);
+        if (s == nullptr) {
+            s = new StoreList();
+        }
+        // ignore first ( and last )
+        s->asList()->implementation->fromString(str + 1, innerLength(len));
+        break;
+    case VocabItem:
+        // ignore first [ and last ]
+        s = create(StoreVocab(textToVocab(str + 1, innerLength(len))));
+        break;
+    case BlobItem:
+        // ignore first { and last }, the bytes are given as numbers
+        {
+            std::string bytes;
+            forEachItem(str + 1, innerLength(len), [this, &bytes](const char* item, size_t itemLen) {
+                bytes += static_cast<char>(static_cast<unsigned char>(blobItemValue(item, itemLen, extra().unquoted)));
+            });
+            s = create(StoreBlob(bytes));
+        }
+        break;
+    case StringItem:
+        {
+            std::string& unquoted = extra().unquoted;
+            StoreString::unquote(str, len, unquoted);
+            if (str[0] != '\"' && unquoted == "true") {
+                s = create(StoreVocab(static_cast<int>('1')));
+            } else if (str[0] != '\"' && unquoted == "false") {
+                s = create(StoreVocab(0));
+            } else {
+                s = reuse(StoreString::code);
+                if (s == nullptr) {
+                    s = new StoreString();
                 }
+                s->fromString(unquoted);
             }
         }
+        break;
     }
+    add(s);
+}
+
+void BottleImpl::fromString(const std::string& line)
+{
+    fromString(line.c_str(), line.length());
+}
+
+void BottleImpl::fromString(const char* text, size_t len)
+{
+    clear();
+    dirty = true;
+    forEachItem(text, len, [this](const char* item, size_t itemLen) {
+        if (textIs(item, itemLen, "null")) {
+            add(create(StoreVocab(yarp::os::createVocab('n', 'u', 'l', 'l'))));
+        } else {
+            smartAdd(item, itemLen);
+        }
+    });
 }
 
 bool BottleImpl::isComplete(const char* txt)
 {
     bool quoted = false;
     bool back = false;
-    bool begun = false;
     int nested = 0;
     int nestedAlt = 0;
-    std::string nline = txt;
-    nline += " ";
-
-    for (char ch : nline) {
+    for (const char* cursor = txt; *cursor != '\0'; cursor++) {
         if (back) {
             back = false;
-        } else {
-            if (!begun) {
-                if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') {
-                    begun = true;
-                }
-            }
-            if (begun) {
-                if (ch == '\"') {
-                    quoted = !quoted;
-                }
-                if (!quoted) {
-                    if (ch == '(') {
-                        nested++;
-                    }
-                    if (ch == ')') {
-                        nested--;
-                    }
-                    if (ch == '{') {
-                        nestedAlt++;
-                    }
-                    if (ch == '}') {
-                        nestedAlt--;
-                    }
-                }
-                if (ch == '\\') {
-                    back = true;
-                    // arg += ch;
-                } else {
-                    if ((!quoted) &&
-                        (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') &&
-                        (nestedAlt == 0) && (nested == 0)) {
-                        // smartAdd(arg);
-                        begun = false;
-                    } else {
-                        // arg += ch;
-                    }
-                }
-            }
+            continue;
+        }
+        switch (charClasses[*cursor]) {
+        case Quote:
+            quoted = !quoted;
+            break;
+        case Escape:
+            back = true;
+            break;
+        case OpenList:
+            nested += quoted ? 0 : 1;
+            break;
+        case CloseList:
+            nested -= quoted ? 0 : 1;
+            break;
+        case OpenBlob:
+            nestedAlt += quoted ? 0 : 1;
+            break;
+        case CloseBlob:
+            nestedAlt -= quoted ? 0 : 1;
+            break;
+        default:
+            break;
         }
     }
     return nested == 0 && nestedAlt == 0 && !quoted;
@@ -297,6 +873,7 @@ bool BottleImpl::isComplete(const char* txt)
 
 std::string BottleImpl::toString() const
 {
+    unpack();
     std::string result;
     for (unsigned int i = 0; i < content.size(); i++) {
         if (i > 0) {
@@ -310,6 +887,12 @@ std::string BottleImpl::toString() const
 
 BottleImpl::size_type BottleImpl::size() const
 {
+    if (packed == BOTTLE_TAG_FLOAT64) {
+        return extra().packedFloat64.size();
+    }
+    if (packed == BOTTLE_TAG_INT32) {
+        return extra().packedInt32.size();
+    }
     return content.size();
 }
 
@@ -327,7 +910,7 @@ bool BottleImpl::fromBytes(ConnectionReader& reader)
     } else {
         YMSG(("READ skipped subcode %" PRId32 "\n", speciality));
     }
-    Storable* storable = Storable::createByCode(id);
+    Storable* storable = createByCode(id);
     if (storable == nullptr) {
         YARP_SPRINTF1(Logger::get(), error, "BottleImpl reader failed, unrecognized object code %" PRId32, id);
         return false;
@@ -381,6 +964,9 @@ bool BottleImpl::fromBytes(const Bytes& data)
         return false;
     }
     YMSG(("READ bottle length %d\n", len));
+    if (canReadPacked(reader, len)) {
+        return readPacked(reader, len);
+    }
     for (int i = 0; i < len; i++) {
         bool ok = fromBytes(reader);
         if (!ok) {
@@ -500,6 +1086,9 @@ bool BottleImpl::read(ConnectionReader& reader)
             return false;
         }
         YMSG(("READ got length %d\n", len));
+        if (canReadPacked(reader, len)) {
+            return readPacked(reader, len);
+        }
         for (int i = 0; i < len; i++) {
             bool ok = fromBytes(reader);
             if (!ok) {
@@ -518,22 +1107,51 @@ void BottleImpl::synch() const
 void BottleImpl::synch()
 {
     if (dirty) {
+        if (packed != 0) {
+            speciality = packed;
+        }
         if (!nested) {
             subCode();
             YMSG(("bottle code %" PRId32 "\n", StoreList::code + subCode()));
         }
         data.clear();
-        BufferedConnectionWriter writer;
+        Extra& e = extra();
+        BufferedConnectionWriter*& writer = e.writer;
+        if (writer == nullptr) {
+            writer = new BufferedConnectionWriter;
+        } else {
+            writer->restart();
+        }
         if (!nested) {
-            writer.appendInt32(StoreList::code + speciality);
+            writer->appendInt32(StoreList::code + speciality);
             YMSG(("wrote bottle code %" PRId32 "\n", StoreList::code + speciality));
         }
         YMSG(("bottle length %zd\n", size()));
-        writer.appendInt32(static_cast<std::int32_t>(size()));
+        writer->appendInt32(static_cast<std::int32_t>(size()));
+#ifdef YARP_LITTLE_ENDIAN
+        // Packed items are written as they are
+        if (packed == BOTTLE_TAG_FLOAT64) {
+            writer->appendBlock(reinterpret_cast<const char*>(e.packedFloat64.data()),
+                                e.packedFloat64.size() * sizeof(yarp::conf::float64_t));
+        } else if (packed == BOTTLE_TAG_INT32) {
+            writer->appendBlock(reinterpret_cast<const char*>(e.packedInt32.data()),
+                                e.packedInt32.size() * sizeof(std::int32_t));
+        }
+#else
+        if (packed == BOTTLE_TAG_FLOAT64) {
+            for (auto x : e.packedFloat64) {
+                writer->appendFloat64(x);
+            }
+        } else if (packed == BOTTLE_TAG_INT32) {
+            for (auto x : e.packedInt32) {
+                writer->appendInt32(x);
+            }
+        }
+#endif
         for (auto s : content) {
             if (speciality == 0) {
                 YMSG(("subcode %" PRId32 "\n", s->getCode()));
-                writer.appendInt32(s->getCode());
+                writer->appendInt32(s->getCode());
             } else {
                 YMSG(("skipped subcode %" PRId32 "\n", s->getCode()));
                 yAssert(speciality == s->getCode());
@@ -541,11 +1159,13 @@ void BottleImpl::synch()
             if (s->isList()) {
                 s->asList()->implementation->setNested(true);
             }
-            s->writeRaw(writer);
+            s->writeRaw(*writer);
         }
-        data.resize(writer.dataSize(), ' ');
+        data.resize(writer->dataSize(), ' ');
         MemoryOutputStream m(&data[0]);
-        writer.write(m);
+        writer->write(m);
+        // Do not keep references to the items
+        writer->restart();
         dirty = false;
     }
 }
@@ -570,6 +1190,10 @@ void BottleImpl::setNested(bool nested)
 
 std::int32_t BottleImpl::subCode()
 {
+    if (packed != 0) {
+        speciality = packed;
+        return packed;
+    }
     return subCoder(*this);
 }
 
@@ -580,46 +1204,47 @@ bool BottleImpl::checkIndex(size_type index) const
 
 bool BottleImpl::isInt8(int index)
 {
-    return (checkIndex(index) ? content[index]->isInt8() : false);
+    return get(index).isInt8();
 }
 
 bool BottleImpl::isInt16(int index)
 {
-    return (checkIndex(index) ? content[index]->isInt16() : false);
+    return get(index).isInt16();
 }
 
 bool BottleImpl::isInt32(int index)
 {
-    return (checkIndex(index) ? content[index]->isInt32() : false);
+    return get(index).isInt32();
 }
 
 bool BottleImpl::isInt64(int index)
 {
-    return (checkIndex(index) ? content[index]->isInt64() : false);
+    return get(index).isInt64();
 }
 
 bool BottleImpl::isFloat32(int index)
 {
-    return (checkIndex(index) ? content[index]->isFloat32() : false);
+    return get(index).isFloat32();
 }
 
 bool BottleImpl::isFloat64(int index)
 {
-    return (checkIndex(index) ? content[index]->isFloat64() : false);
+    return get(index).isFloat64();
 }
 
 bool BottleImpl::isString(int index)
 {
-    return (checkIndex(index) ? content[index]->isString() : false);
+    return get(index).isString();
 }
 
 bool BottleImpl::isList(int index)
 {
-    return (checkIndex(index) ? content[index]->isList() : false);
+    return get(index).isList();
 }
 
 Storable* BottleImpl::pop()
 {
+    unpack();
     Storable* stb = nullptr;
     if (size() == 0) {
         stb = new StoreNull();
@@ -634,14 +1259,18 @@ Storable* BottleImpl::pop()
 
 Storable& BottleImpl::get(size_type index) const
 {
+    unpack();
     return (checkIndex(index) ? *(content[index]) : getNull());
 }
 
 yarp::os::Bottle& BottleImpl::addList()
 {
-    auto* lst = new StoreList();
+    Storable* lst = reuse(StoreList::code);
+    if (lst == nullptr) {
+        lst = new StoreList();
+    }
     add(lst);
-    return lst->internal();
+    return *(lst->asList());
 }
 
 yarp::os::Property& BottleImpl::addDict()
@@ -659,6 +1288,19 @@ void BottleImpl::copyRange(const BottleImpl* alt, size_type first, size_type len
         return;
     }
 
+    if (alt != this && alt->packed != 0) {
+        // Copy the packed items, without creating them
+        const size_t total = alt->size();
+        const size_t begin = (first < total) ? first : total;
+        const size_t count = (len < total - begin) ? len : total - begin;
+        if (alt->packed == BOTTLE_TAG_FLOAT64) {
+            assignFloat64(alt->extra().packedFloat64.data() + begin, count);
+        } else {
+            assignInt32(alt->extra().packedInt32.data() + begin, count);
+        }
+        return;
+    }
+
     // Handle copying to the same object just a subset of the bottle
     const BottleImpl* src = alt;
     BottleImpl tmp(nullptr);
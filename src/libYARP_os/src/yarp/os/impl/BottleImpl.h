@@ -14,6 +14,8 @@
 #include <yarp/os/Bytes.h>
 #include <yarp/os/impl/Storable.h>
 
+#include <atomic>
+#include <cstring>
 #include <vector>
 
 namespace yarp {
@@ -26,6 +28,8 @@ class ConnectionWriter;
 
 namespace impl {
 
+class BufferedConnectionWriter;
+
 
 /**
  * A flexible data format for holding a bunch of numbers and strings.
@@ -59,50 +63,76 @@ public:
 
     void addInt8(std::int8_t x)
     {
-        add(new StoreInt8(x));
+        add(create(StoreInt8(x)));
     }
 
     void addInt16(std::int16_t x)
     {
-        add(new StoreInt16(x));
+        add(create(StoreInt16(x)));
     }
 
     void addInt32(std::int32_t x)
     {
-        add(new StoreInt32(x));
+        if (packed == BOTTLE_TAG_INT32) {
+            addPacked(x);
+            return;
+        }
+        add(create(StoreInt32(x)));
     }
 
     void addInt64(std::int64_t x)
     {
-        add(new StoreInt64(x));
+        add(create(StoreInt64(x)));
     }
 
     void addFloat32(yarp::conf::float32_t x)
     {
-        add(new StoreFloat32(x));
+        add(create(StoreFloat32(x)));
     }
 
     void addFloat64(yarp::conf::float64_t x)
     {
-        add(new StoreFloat64(x));
+        if (packed == BOTTLE_TAG_FLOAT64) {
+            addPacked(x);
+            return;
+        }
+        add(create(StoreFloat64(x)));
     }
 
     void addVocab(std::int32_t x)
     {
-        add(new StoreVocab(x));
+        add(create(StoreVocab(x)));
     }
 
     void addString(const std::string& text)
     {
-        add(new StoreString(text));
+        Storable* s = reuse(StoreString::code);
+        if (s == nullptr) {
+            s = new StoreString(text);
+        } else {
+            s->fromString(text);
+        }
+        add(s);
     }
 
     yarp::os::Bottle& addList();
 
     yarp::os::Property& addDict();
 
+    // Replace the content with the given numbers, kept packed
+    void assignFloat64(const yarp::conf::float64_t* values, size_type len);
+    void assignInt32(const std::int32_t* values, size_type len);
+
+    // Contiguous view of the content, if all items are of that type
+    const yarp::conf::float64_t* getFloat64Data() const;
+    const std::int32_t* getInt32Data() const;
+
     void clear();
 
+    // Items kept by clear() for reuse, and the bytes of their strings
+    size_t getSpareCount() const;
+    size_t getSpareBytes() const;
+
     void fromString(const std::string& line);
     std::string toString() const;
     size_type size() const;
@@ -147,8 +177,7 @@ public:
     yarp::os::Value& addBit(const char* str)
     {
         size_type len = size();
-        std::string x(str);
-        smartAdd(x);
+        smartAdd(str, strlen(str));
         if (size() > len) {
             return get((int)size() - 1);
         }
@@ -182,12 +211,76 @@ public:
 private:
     YARP_SUPPRESS_DLL_INTERFACE_WARNING_ARG(std::vector<Storable*>) content;
     YARP_SUPPRESS_DLL_INTERFACE_WARNING_ARG(std::vector<char>) data;
+
+    // Items released by clear(), by kind, reused by the next additions:
+    // once a Bottle has been filled (or read) once, filling it again
+    // with a message of the same shape does not allocate.  At most
+    // maxSpareItems items, and maxSpareBytes bytes of string and blob
+    // storage, are kept; clear() releases the others.
+    static constexpr size_t spareKinds = 10;
+    static constexpr size_t maxSpareItems = 1024;
+    static constexpr size_t maxSpareBytes = 64 * 1024;
+
+    // Lists of float64 or int32 only are kept packed, as they are on
+    // the wire, until an item is accessed or a different item is
+    // added.  While packed, content is empty and packed is the code of
+    // the items.
+    YARP_SUPPRESS_DLL_INTERFACE_WARNING_ARG(std::atomic<std::int32_t>) packed;
+
+    // The spare items, the packed arrays and the buffers kept to write
+    // and parse without allocating live in a separate structure,
+    // created the first time one of them is needed, so that the many
+    // bottles that are only built once (nested lists, values of a
+    // Property...) stay small.
+    struct Extra;
+    mutable YARP_SUPPRESS_DLL_INTERFACE_WARNING_ARG(std::atomic<Extra*>) extraState;
+    Extra& extra() const;
+
     int speciality;
     bool nested;
     bool dirty;
 
     void add(Storable* s);
-    void smartAdd(const std::string& str);
+    void addPacked(std::int32_t x);
+    void addPacked(yarp::conf::float64_t x);
+    void smartAdd(const char* str, size_t len);
+
+    // Parse text directly into the items, without copying the tokens
+    void fromString(const char* text, size_t len);
+
+    // Create the items of a packed list.  The const version keeps the
+    // packed arrays, the other one releases them.
+    void unpack() const;
+    void unpack();
+    void createItems();
+
+    // Read len packed items in a single block, if possible
+    bool canReadPacked(ConnectionReader& reader, std::int32_t len) const;
+    bool readPacked(ConnectionReader& reader, std::int32_t len);
+
+    static size_t spareIndex(std::int32_t code);
+    static size_t spareSize(const Storable* s);
+    void recycle(Storable* s);
+
+    // Get a released item for the given code, ready to be filled, or
+    // nullptr if there is none.
+    Storable* reuse(std::int32_t code);
+
+    // Get an item with the value of x, reusing a released one if possible
+    template <typename T>
+    Storable* create(const T& x)
+    {
+        Storable* s = reuse(T::code);
+        if (s == nullptr) {
+            s = new T();
+        }
+        s->copy(x);
+        return s;
+    }
+
+    // Get an empty item for the given code, reusing a released one if
+    // possible
+    Storable* createByCode(std::int32_t code);
 
     /*
      * Bottle is using a lazy synchronization method. Whenever some operation
@@ -42,7 +42,8 @@ BufferedConnectionWriter::BufferedConnectionWriter(bool textMode,
         lst_used(0),
         header_used(0),
         target_used(&lst_used),
-        initialPoolSize(BUFFERED_CONNECTION_INITIAL_POOL_SIZE)
+        initialPoolSize(BUFFERED_CONNECTION_INITIAL_POOL_SIZE),
+        modifiers(nullptr)
 {
     stopPool();
 }
@@ -327,7 +328,7 @@ size_t BufferedConnectionWriter::length(size_t index) const
         yarp::os::ManagedBytes& b = *(header[index]);
         return b.used();
     }
-    yarp::os::ManagedBytes& b = *(lst[index - header.size()]);
+    yarp::os::ManagedBytes& b = *(lst[index - header_used]);
     return b.used();
 }
 
@@ -337,7 +338,7 @@ const char* BufferedConnectionWriter::data(size_t index) const
         yarp::os::ManagedBytes& b = *(header[index]);
         return (const char*)b.get();
     }
-    yarp::os::ManagedBytes& b = *(lst[index - header.size()]);
+    yarp::os::ManagedBytes& b = *(lst[index - header_used]);
     return (const char*)b.get();
 }
 
@@ -445,6 +446,19 @@ void BufferedConnectionWriter::requestDrop()
     shouldDrop = true;
 }
 
+const Searchable& BufferedConnectionWriter::getConnectionModifiers() const
+{
+    if (modifiers == nullptr) {
+        return ConnectionWriter::getConnectionModifiers();
+    }
+    return *modifiers;
+}
+
+void BufferedConnectionWriter::setConnectionModifiers(const Searchable* modifiers)
+{
+    this->modifiers = modifiers;
+}
+
 bool BufferedConnectionWriter::dropRequested()
 {
     return shouldDrop;
@@ -208,6 +208,15 @@ public:
     bool isActive() const override;
     bool isError() const override;
     void requestDrop() override;
+    const Searchable& getConnectionModifiers() const override;
+
+    /**
+     * Set the modifiers of the connection the message is written for,
+     * returned by getConnectionModifiers().  They are not copied.
+     *
+     * @param modifiers the modifiers, or nullptr for none
+     */
+    void setConnectionModifiers(const Searchable* modifiers);
 
     // defined by yarp::os::SizedWriter
     bool dropRequested() override;
@@ -267,6 +276,7 @@ private:
     size_t header_used;           ///< how many header buffers are in use for the current message
     size_t* target_used;          ///< points to lst_used of header_used
     size_t initialPoolSize;       ///< size of new pool buffers
+    const yarp::os::Searchable* modifiers; ///< modifiers of the connection, if any
 };
 
 
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/os/impl/CommandConnection.h>
+
+#include <yarp/os/Carriers.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Route.h>
+#include <yarp/os/impl/BufferedConnectionWriter.h>
+#include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/PortCommand.h>
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+CommandConnection::CommandConnection(const Contact& contact, const ContactStyle& style) :
+        contact(contact),
+        style(style),
+        out(nullptr)
+{
+}
+
+CommandConnection::~CommandConnection()
+{
+    close();
+}
+
+bool CommandConnection::open()
+{
+    std::string targetName = contact.getName();
+    Contact address = contact;
+    if (!address.isValid()) {
+        address = NetworkBase::queryName(targetName);
+    }
+    if (!address.isValid()) {
+        if (!style.quiet) {
+            YARP_SPRINTF1(Logger::get(), error, "cannot find port %s", targetName.c_str());
+        }
+        return false;
+    }
+
+    if (style.timeout > 0) {
+        address.setTimeout((float)style.timeout);
+    }
+    out = Carriers::connect(address);
+    if (out == nullptr) {
+        if (!style.quiet) {
+            YARP_SPRINTF1(Logger::get(), error, "Cannot connect to port %s", targetName.c_str());
+        }
+        return false;
+    }
+    if (style.timeout > 0) {
+        out->setTimeout(style.timeout);
+    }
+
+    Route r("admin", targetName, (!style.carrier.empty()) ? style.carrier : "text_ack");
+    out->open(r);
+    return true;
+}
+
+void CommandConnection::close()
+{
+    if (out != nullptr) {
+        delete out;
+        out = nullptr;
+    }
+}
+
+bool CommandConnection::write(const PortWriter& cmd, PortReader& reply)
+{
+    if (out == nullptr && !open()) {
+        return false;
+    }
+
+    PortCommand pc(0, style.admin ? "a" : "d");
+    BufferedConnectionWriter bw(out->getConnection().isTextMode(),
+                                out->getConnection().isBareMode());
+    bool ok = true;
+    if (out->getConnection().canEscape()) {
+        ok = pc.write(bw);
+    }
+    if (ok) {
+        ok = cmd.write(bw);
+    }
+    if (!ok) {
+        if (!style.quiet) {
+            YARP_ERROR(Logger::get(), "could not write to connection");
+        }
+        close();
+        return false;
+    }
+    if (style.expectReply) {
+        bw.setReplyHandler(reply);
+    }
+    out->write(bw);
+    if (!out->isOk()) {
+        close();
+    }
+    return true;
+}
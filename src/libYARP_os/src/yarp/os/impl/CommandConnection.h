@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_OS_IMPL_COMMANDCONNECTION_H
+#define YARP_OS_IMPL_COMMANDCONNECTION_H
+
+#include <yarp/os/Contact.h>
+#include <yarp/os/ContactStyle.h>
+#include <yarp/os/OutputProtocol.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/PortWriter.h>
+
+namespace yarp {
+namespace os {
+namespace impl {
+
+/**
+ * A connection for sending commands to a port (or to the name server)
+ * and reading the replies, as NetworkBase::write() does.  The
+ * connection is kept open, so that a sequence of commands costs a
+ * single connection and header exchange rather than one per command.
+ */
+class YARP_os_impl_API CommandConnection
+{
+public:
+    /**
+     * Constructor.  The connection is made by the first write().
+     * @param contact the port to talk to; it is looked up on the name
+     * server if its address is not known
+     * @param style the options for the connection, as for
+     * NetworkBase::write()
+     */
+    CommandConnection(const Contact& contact, const ContactStyle& style);
+
+    /**
+     * Destructor, closes the connection.
+     */
+    ~CommandConnection();
+
+    CommandConnection(const CommandConnection&) = delete;
+    CommandConnection& operator=(const CommandConnection&) = delete;
+
+    /**
+     * Send a command, and read its reply if the style expects one.  A
+     * connection found broken is made again for the next command.
+     * @param cmd the command
+     * @param reply where to put the reply
+     * @return true if the command was sent
+     */
+    bool write(const PortWriter& cmd, PortReader& reply);
+
+private:
+    bool open();
+    void close();
+
+    Contact contact;
+    ContactStyle style;
+    OutputProtocol* out;
+};
+
+} // namespace impl
+} // namespace os
+} // namespace yarp
+
+#endif // YARP_OS_IMPL_COMMANDCONNECTION_H
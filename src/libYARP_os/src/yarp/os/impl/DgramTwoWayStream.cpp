@@ -11,6 +11,7 @@
 
 #include <yarp/conf/system.h>
 
+#include <yarp/os/NetInt16.h>
 #include <yarp/os/NetType.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/impl/Logger.h>
@@ -35,8 +36,12 @@
 #    include <sys/socket.h>
 #    include <sys/types.h>
 #    include <unistd.h>
+#    if defined(__linux__)
+#        define YARP_DGRAM_BATCH_AVAILABLE
+#    endif
 #endif
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 
@@ -45,6 +50,9 @@ using namespace yarp::os;
 
 #define CRC_SIZE 8
 #define UDP_MAX_DATAGRAM_SIZE (65507 - CRC_SIZE)
+#define DGRAM_MAX_BATCH 64
+#define FEC_HEADER_SIZE 8
+#define FEC_PARITY_SIZE (FEC_HEADER_SIZE + 4)
 
 
 static bool checkCrc(char* buf, yarp::conf::ssize_t length, yarp::conf::ssize_t crcLength, int pct, int* store_altPct = nullptr)
@@ -72,6 +80,49 @@ static bool checkCrc(char* buf, yarp::conf::ssize_t length, yarp::conf::ssize_t
 }
 
 
+// Header of the datagrams when forward error correction is enabled:
+// sequence number (first of the group for parity datagrams), kind
+// (0 for data, number of datagrams in the group for parity, -1 for
+// unprotected datagrams) and position in the group.
+static void addFecHeader(char* buf, std::uint32_t seq, int kind, int index)
+{
+    NetInt32 netSeq = static_cast<NetInt32>(seq);
+    NetInt16 netKind = static_cast<NetInt16>(kind);
+    NetInt16 netIndex = static_cast<NetInt16>(index);
+    memcpy(buf, &netSeq, 4);
+    memcpy(buf + 4, &netKind, 2);
+    memcpy(buf + 6, &netIndex, 2);
+}
+
+static void getFecHeader(const char* buf, std::uint32_t& seq, int& kind, int& index)
+{
+    NetInt32 netSeq;
+    NetInt16 netKind;
+    NetInt16 netIndex;
+    memcpy(&netSeq, buf, 4);
+    memcpy(&netKind, buf + 4, 2);
+    memcpy(&netIndex, buf + 6, 2);
+    seq = static_cast<std::uint32_t>(netSeq);
+    kind = netKind;
+    index = static_cast<std::uint16_t>(netIndex);
+}
+
+static void xorBytes(char* dest, const char* src, size_t length)
+{
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t a;
+        std::uint64_t b;
+        memcpy(&a, dest + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dest + i, &a, 8);
+    }
+    for (; i < length; i++) {
+        dest[i] ^= src[i];
+    }
+}
+
 static void addCrc(char* buf, yarp::conf::ssize_t length, yarp::conf::ssize_t crcLength, int pct)
 {
     auto alt = (NetInt32)NetType::getCrc(buf + crcLength,
@@ -237,8 +288,51 @@ void DgramTwoWayStream::allocate(int readSize, int writeSize)
 #endif
     }
 
-    readBuffer.allocate(_read_size);
-    writeBuffer.allocate(_write_size);
+    if (fecGroup != 0) {
+        // make space for the header of the parity datagrams
+        _write_size = std::min(_write_size, UDP_MAX_DATAGRAM_SIZE + CRC_SIZE - FEC_PARITY_SIZE);
+    }
+
+    batchSize = 1;
+#if defined(YARP_DGRAM_BATCH_AVAILABLE)
+    std::string _env_batch = NetworkBase::getEnvironment("YARP_DGRAM_BATCH");
+    if (!_env_batch.empty() && dgram != nullptr && fecGroup == 0) {
+        batchSize = static_cast<size_t>(std::min(std::max(NetType::toInt(_env_batch), 1), DGRAM_MAX_BATCH));
+    }
+#endif
+
+    if (batchSize > 1) {
+        // nothing bigger than a udp datagram can be received
+        _read_size = std::min(_read_size, UDP_MAX_DATAGRAM_SIZE + CRC_SIZE);
+        readBatch.allocate(_read_size * batchSize);
+        writeBatch.allocate(_write_size * batchSize);
+        readBatchLength.assign(batchSize, 0);
+        writeBatchLength.assign(batchSize, 0);
+        readBuffer = ManagedBytes(Bytes(readBatch.get(), _read_size), false);
+        writeBuffer = ManagedBytes(Bytes(writeBatch.get(), _write_size), false);
+    } else {
+        readBatch.clear();
+        writeBatch.clear();
+        readBuffer.allocate(_read_size);
+        if (fecGroup != 0) {
+            fecWrite.allocate(FEC_HEADER_SIZE + _write_size);
+            writeBuffer = ManagedBytes(Bytes(fecWrite.get() + FEC_HEADER_SIZE, _write_size), false);
+            fecParity.allocate(FEC_PARITY_SIZE + _write_size);
+            memset(fecParity.get(), 0, fecParity.length());
+            fecRead.allocate(FEC_PARITY_SIZE + _read_size);
+        } else {
+            writeBuffer.allocate(_write_size);
+        }
+    }
+    fecIndex = 0;
+    fecParityLength = 0;
+    fecLengthXor = 0;
+    fecStarted = false;
+    fecActive = false;
+    fecStashLength = 0;
+    readBatchNext = 0;
+    readBatchCount = 0;
+    writeBatchCount = 0;
     readAt = 0;
     readAvail = 0;
     writeAvail = CRC_SIZE;
@@ -610,6 +704,9 @@ void DgramTwoWayStream::interrupt()
             while (happy && ct > 0) {
                 ct--;
                 DgramTwoWayStream tmp;
+                if (fecGroup != 0) {
+                    tmp.fecGroup = -1;
+                }
                 if (mgram != nullptr) {
                     YARP_DEBUG(Logger::get(),
                                std::string("* mcast interrupt, interface ") + restrictInterfaceIp.toString());
@@ -707,6 +804,9 @@ yarp::conf::ssize_t DgramTwoWayStream::read(Bytes& b)
             //yAssert(dgram != nullptr);
             //YARP_DEBUG(Logger::get(), "DGRAM Waiting for something!");
             yarp::conf::ssize_t result = -1;
+            if (fecGroup != 0) {
+                result = receiveFec();
+            } else
 #if defined(YARP_HAS_ACE)
             if ((dgram != nullptr) && restrictInterfaceIp.isValid()) {
                 /*
@@ -732,7 +832,12 @@ yarp::conf::ssize_t DgramTwoWayStream::read(Bytes& b)
                 //YARP_DEBUG(Logger::get(), "DGRAM Waiting for something!");
                 result = dgram->recv(readBuffer.get(), readBuffer.length(), dummy);
 #else
-                result = recv(dgram_sockfd, readBuffer.get(), readBuffer.length(), 0);
+#    if defined(YARP_DGRAM_BATCH_AVAILABLE)
+                if (batchSize > 1) {
+                    result = receiveBatch();
+                } else
+#    endif
+                    result = recv(dgram_sockfd, readBuffer.get(), readBuffer.length(), 0);
 #endif
                 YARP_DEBUG(Logger::get(),
                            std::string("DGRAM Got ") + NetType::toString((int)result) + " bytes");
@@ -848,7 +953,11 @@ void DgramTwoWayStream::write(const Bytes& b)
         writeAvail += rem;
         local = Bytes(local.get() + rem, local.length() - rem);
         if (shouldFlush) {
-            flush();
+            if (batchSize > 1) {
+                queueDatagram();
+            } else {
+                sendDatagram();
+            }
         }
     }
 }
@@ -860,6 +969,21 @@ void DgramTwoWayStream::flush()
         return;
     }
 
+    if (batchSize > 1) {
+        queueDatagram();
+        sendBatch();
+        return;
+    }
+
+    sendDatagram();
+    if (fecGroup > 0 && fecIndex > 0) {
+        sendParity();
+    }
+}
+
+
+void DgramTwoWayStream::sendDatagram()
+{
     // should set CRC
     if (writeAvail <= CRC_SIZE) {
         return;
@@ -871,29 +995,18 @@ void DgramTwoWayStream::flush()
         //yAssert(dgram != nullptr);
         yarp::conf::ssize_t len = 0;
 
-#if defined(YARP_HAS_ACE)
-        if (mgram != nullptr) {
-            len = mgram->send(writeBuffer.get(), writeAvail);
-            YARP_DEBUG(Logger::get(),
-                       std::string("MCAST - wrote ") + NetType::toString((int)len) + " bytes");
-        } else
-#endif
-            if (dgram != nullptr) {
-#if defined(YARP_HAS_ACE)
-            len = dgram->send(writeBuffer.get(), writeAvail, remoteHandle);
-#else
-            len = send(dgram_sockfd, writeBuffer.get(), writeAvail, 0);
-#endif
-            YARP_DEBUG(Logger::get(),
-                       std::string("DGRAM - wrote ") + NetType::toString((int)len) + " bytes to " + remoteAddress.toString());
+        if (fecGroup != 0) {
+            // the header is in the space reserved before writeBuffer
+            char* header = writeBuffer.get() - FEC_HEADER_SIZE;
+            addFecHeader(header, fecSeq, (fecGroup > 0) ? 0 : -1, fecIndex);
+            len = sendRaw(header, writeAvail + FEC_HEADER_SIZE) - FEC_HEADER_SIZE;
+            if (fecGroup > 0) {
+                addParity(writeBuffer.get(), writeAvail);
+            }
         } else {
-            Bytes b(writeBuffer.get(), writeAvail);
-            monitor = ManagedBytes(b, false);
-            monitor.copy();
-            //printf("Monitored output of %d bytes\n", monitor.length());
-            len = monitor.length();
-            onMonitorOutput();
+            len = sendRaw(writeBuffer.get(), writeAvail);
         }
+
         //if (len>WRITE_SIZE*0.75) {
         if (len > writeBuffer.length() * 0.75) {
             YARP_DEBUG(Logger::get(),
@@ -934,6 +1047,383 @@ void DgramTwoWayStream::flush()
 
     // make space for CRC
     writeAvail = CRC_SIZE;
+
+    if (fecGroup > 0 && fecIndex == fecGroup) {
+        sendParity();
+    }
+}
+
+
+yarp::conf::ssize_t DgramTwoWayStream::sendRaw(const char* data, size_t length)
+{
+    yarp::conf::ssize_t len = 0;
+#if defined(YARP_HAS_ACE)
+    if (mgram != nullptr) {
+        len = mgram->send(data, length);
+        YARP_DEBUG(Logger::get(),
+                   std::string("MCAST - wrote ") + NetType::toString((int)len) + " bytes");
+    } else
+#endif
+        if (dgram != nullptr) {
+#if defined(YARP_HAS_ACE)
+        len = dgram->send(data, length, remoteHandle);
+#else
+        len = send(dgram_sockfd, data, length, 0);
+#endif
+        YARP_DEBUG(Logger::get(),
+                   std::string("DGRAM - wrote ") + NetType::toString((int)len) + " bytes to " + remoteAddress.toString());
+    } else {
+        Bytes b(const_cast<char*>(data), length);
+        monitor = ManagedBytes(b, false);
+        monitor.copy();
+        //printf("Monitored output of %d bytes\n", monitor.length());
+        len = monitor.length();
+        onMonitorOutput();
+    }
+    return len;
+}
+
+
+void DgramTwoWayStream::queueDatagram()
+{
+    if (writeAvail <= CRC_SIZE) {
+        return;
+    }
+    addCrc(writeBuffer.get(), writeAvail, CRC_SIZE, pct);
+    pct++;
+    writeBatchLength[writeBatchCount] = writeAvail;
+    writeBatchCount++;
+    if (writeBatchCount == batchSize) {
+        sendBatch();
+        return;
+    }
+    size_t slot = writeBatch.length() / batchSize;
+    writeBuffer = ManagedBytes(Bytes(writeBatch.get() + writeBatchCount * slot, slot), false);
+    writeAvail = CRC_SIZE;
+}
+
+
+void DgramTwoWayStream::sendBatch()
+{
+    size_t slot = writeBatch.length() / batchSize;
+    size_t count = writeBatchCount;
+    writeBatchCount = 0;
+    writeBuffer = ManagedBytes(Bytes(writeBatch.get(), slot), false);
+    writeAvail = CRC_SIZE;
+    if (count == 0) {
+        return;
+    }
+
+#if defined(YARP_DGRAM_BATCH_AVAILABLE)
+    struct iovec iov[DGRAM_MAX_BATCH];
+    struct mmsghdr msgs[DGRAM_MAX_BATCH];
+    size_t longDgrams = 0;
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = writeBatch.get() + i * slot;
+        iov[i].iov_len = writeBatchLength[i];
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (writeBatchLength[i] > slot * 0.75) {
+            longDgrams++;
+        }
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        int result = sendmmsg(dgram_sockfd, msgs + sent, static_cast<unsigned int>(count - sent), 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            happy = false;
+            YARP_DEBUG(Logger::get(), "DGRAM failed to send message with error: " + std::string(strerror(errno)));
+            return;
+        }
+        for (int i = 0; i < result; i++) {
+            if (msgs[sent + i].msg_len != writeBatchLength[sent + i]) {
+                // checksums will cause dumping
+                YARP_DEBUG(Logger::get(), "dgram/mcast send behaving badly");
+            }
+        }
+        sent += static_cast<size_t>(result);
+    }
+    YARP_DEBUG(Logger::get(),
+               std::string("DGRAM - wrote ") + NetType::toString(static_cast<int>(count)) + " datagrams to " + remoteAddress.toString());
+
+    if (longDgrams > 0) {
+        // Give the receiver the same time per long datagram as when
+        // sending them one by one (see flush()), but sleep rather than
+        // busy waiting.
+        yarp::os::SystemClock::delaySystem(0.001 * longDgrams);
+    }
+#endif
+}
+
+
+yarp::conf::ssize_t DgramTwoWayStream::receiveBatch()
+{
+#if defined(YARP_DGRAM_BATCH_AVAILABLE)
+    size_t slot = readBatch.length() / batchSize;
+    if (readBatchNext >= readBatchCount) {
+        readBatchNext = 0;
+        readBatchCount = 0;
+        struct iovec iov[DGRAM_MAX_BATCH];
+        struct mmsghdr msgs[DGRAM_MAX_BATCH];
+        for (size_t i = 0; i < batchSize; i++) {
+            iov[i].iov_base = readBatch.get() + i * slot;
+            iov[i].iov_len = slot;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        // Wait for the first datagram, then take whatever else is
+        // already there.
+        int result;
+        do {
+            result = recvmmsg(dgram_sockfd, msgs, static_cast<unsigned int>(batchSize), MSG_WAITFORONE, nullptr);
+        } while (result < 0 && errno == EINTR && !closed);
+        if (result <= 0) {
+            return -1;
+        }
+        for (int i = 0; i < result; i++) {
+            readBatchLength[i] = msgs[i].msg_len;
+        }
+        readBatchCount = static_cast<size_t>(result);
+    }
+    readBuffer = ManagedBytes(Bytes(readBatch.get() + readBatchNext * slot, slot), false);
+    return static_cast<yarp::conf::ssize_t>(readBatchLength[readBatchNext++]);
+#else
+    return -1;
+#endif
+}
+
+
+yarp::conf::ssize_t DgramTwoWayStream::receiveRaw(char* data, size_t length)
+{
+    yarp::conf::ssize_t result = -1;
+    if (dgram != nullptr) {
+#if defined(YARP_HAS_ACE)
+        ACE_INET_Addr dummy((u_short)0, (ACE_UINT32)INADDR_ANY);
+        result = dgram->recv(data, length, dummy);
+#else
+        result = recv(dgram_sockfd, data, length, 0);
+#endif
+        YARP_DEBUG(Logger::get(),
+                   std::string("DGRAM Got ") + NetType::toString((int)result) + " bytes");
+    } else {
+        onMonitorInput();
+        size_t len = std::min(monitor.length(), length);
+        memcpy(data, monitor.get(), len);
+        result = len;
+    }
+    return result;
+}
+
+
+void DgramTwoWayStream::setRedundancy(int redundancy)
+{
+    if (redundancy <= 0) {
+        fecGroup = 0;
+        return;
+    }
+    redundancy = std::min(redundancy, 100);
+    // the nearest group size
+    fecGroup = std::max(1, (100 + redundancy / 2) / redundancy);
+}
+
+
+void DgramTwoWayStream::addParity(const char* data, size_t length)
+{
+    xorBytes(fecParity.get() + FEC_PARITY_SIZE, data, length);
+    fecParityLength = std::max(fecParityLength, length);
+    fecLengthXor ^= static_cast<std::uint32_t>(length);
+    fecSeq++;
+    fecIndex++;
+}
+
+
+void DgramTwoWayStream::sendParity()
+{
+    char* parity = fecParity.get();
+    addFecHeader(parity, fecSeq - static_cast<std::uint32_t>(fecIndex), fecIndex, 0);
+    NetInt32 netLength = static_cast<NetInt32>(fecLengthXor);
+    memcpy(parity + FEC_HEADER_SIZE, &netLength, 4);
+    if (sendRaw(parity, FEC_PARITY_SIZE + fecParityLength) < 0) {
+        happy = false;
+        YARP_DEBUG(Logger::get(), "DGRAM failed to send parity with error: " + std::string(strerror(errno)));
+    }
+    memset(parity + FEC_PARITY_SIZE, 0, fecParityLength);
+    fecParityLength = 0;
+    fecLengthXor = 0;
+    fecIndex = 0;
+}
+
+
+yarp::conf::ssize_t DgramTwoWayStream::receiveFec()
+{
+    while (true) {
+        if (fecActive) {
+            // hand over the datagrams of the group in order
+            size_t end = (fecCount > 0) ? fecCount : fecSlotLength.size();
+            if (fecClosed) {
+                // skip the ones that could not be rebuilt
+                while (fecNext < end && fecSlotLength[fecNext] == 0) {
+                    fecNext++;
+                }
+            }
+            if (fecNext < end && fecSlotLength[fecNext] > 0) {
+                size_t len = std::min(fecSlotLength[fecNext], readBuffer.length());
+                memcpy(readBuffer.get(), fecSlots[fecNext].data(), len);
+                fecNext++;
+                return static_cast<yarp::conf::ssize_t>(len);
+            }
+            if (fecClosed) {
+                fecActive = false;
+            }
+        }
+        if (!fecActive && fecStashLength > 0) {
+            size_t len = fecStashLength;
+            fecStashLength = 0;
+            acceptFec(fecStash.data(), len);
+            continue;
+        }
+
+        yarp::conf::ssize_t result = receiveRaw(fecRead.get(), fecRead.length());
+        if (closed || result <= 0) {
+            return result;
+        }
+        if (result < FEC_HEADER_SIZE) {
+            continue;
+        }
+        std::uint32_t seq;
+        int kind;
+        int index;
+        getFecHeader(fecRead.get(), seq, kind, index);
+        if (kind < 0) {
+            // not protected, hand it over right away
+            size_t len = std::min(static_cast<size_t>(result - FEC_HEADER_SIZE), readBuffer.length());
+            memcpy(readBuffer.get(), fecRead.get() + FEC_HEADER_SIZE, len);
+            return static_cast<yarp::conf::ssize_t>(len);
+        }
+        acceptFec(fecRead.get(), static_cast<size_t>(result));
+        reportFec();
+    }
+}
+
+
+void DgramTwoWayStream::acceptFec(const char* data, size_t length)
+{
+    std::uint32_t seq;
+    int kind;
+    int index;
+    getFecHeader(data, seq, kind, index);
+    std::uint32_t first = (kind > 0) ? seq : seq - static_cast<std::uint32_t>(index);
+
+    if (fecActive && first != fecFirst) {
+        // a new group begins before the end of the current one
+        closeFecGroup();
+        fecStash.assign(data, data + length);
+        fecStashLength = length;
+        return;
+    }
+    if (!fecActive) {
+        if (fecStarted && first == fecFirst) {
+            // late datagram of a group that is over
+            return;
+        }
+        fecStarted = true;
+        fecActive = true;
+        fecClosed = false;
+        fecFirst = first;
+        fecCount = 0;
+        fecNext = 0;
+        fecSeen = 0;
+        std::fill(fecSlotLength.begin(), fecSlotLength.end(), 0);
+    }
+
+    const char* body = data + FEC_HEADER_SIZE;
+    size_t bodyLength = length - FEC_HEADER_SIZE;
+    size_t needed = static_cast<size_t>((kind > 0) ? kind : index + 1);
+    if (needed > fecSlotLength.size()) {
+        fecSlots.resize(needed);
+        fecSlotLength.resize(needed, 0);
+    }
+
+    if (kind == 0) {
+        auto at = static_cast<size_t>(index);
+        if (fecClosed || at < fecNext || fecSlotLength[at] != 0) {
+            return;
+        }
+        fecSlots[at].assign(body, body + bodyLength);
+        fecSlotLength[at] = bodyLength;
+        fecSeen = std::max(fecSeen, at + 1);
+        return;
+    }
+
+    // parity datagram
+    if (fecClosed || length < FEC_PARITY_SIZE) {
+        return;
+    }
+    fecCount = static_cast<size_t>(kind);
+    size_t missing = 0;
+    size_t lostAt = 0;
+    for (size_t i = 0; i < fecCount; i++) {
+        if (fecSlotLength[i] == 0) {
+            missing++;
+            lostAt = i;
+        }
+    }
+    if (missing == 1) {
+        NetInt32 netLength;
+        memcpy(&netLength, body, 4);
+        auto rebuilt = static_cast<std::uint32_t>(netLength);
+        size_t parityLength = bodyLength - 4;
+        std::vector<char>& slot = fecSlots[lostAt];
+        slot.assign(body + 4, body + 4 + parityLength);
+        for (size_t i = 0; i < fecCount; i++) {
+            if (i != lostAt) {
+                xorBytes(slot.data(), fecSlots[i].data(), std::min(fecSlotLength[i], parityLength));
+                rebuilt ^= static_cast<std::uint32_t>(fecSlotLength[i]);
+            }
+        }
+        if (rebuilt > CRC_SIZE && rebuilt <= parityLength) {
+            fecSlotLength[lostAt] = rebuilt;
+            fecRecovered++;
+        } else {
+            fecLost++;
+        }
+    } else {
+        fecLost += missing;
+    }
+    fecClosed = true;
+}
+
+
+void DgramTwoWayStream::closeFecGroup()
+{
+    for (size_t i = 0; i < fecSeen; i++) {
+        if (fecSlotLength[i] == 0) {
+            fecLost++;
+        }
+    }
+    fecClosed = true;
+}
+
+
+void DgramTwoWayStream::reportFec()
+{
+    if (fecRecovered == fecReportedRecovered && fecLost == fecReportedLost) {
+        return;
+    }
+    double now = SystemClock::nowSystem();
+    if (now - fecReportTime > 1) {
+        YARP_INFO(Logger::get(),
+                  std::string("Forward error correction: ") + NetType::toString(static_cast<int>(fecRecovered - fecReportedRecovered)) + " datagram(s) rebuilt, " + NetType::toString(static_cast<int>(fecLost - fecReportedLost)) + " lost");
+        fecReportedRecovered = fecRecovered;
+        fecReportedLost = fecLost;
+        fecReportTime = now;
+    }
 }
 
 
@@ -949,6 +1439,11 @@ void DgramTwoWayStream::reset()
     readAvail = 0;
     writeAvail = CRC_SIZE;
     pct = 0;
+    if (writeBatchCount > 0) {
+        // drop the datagrams that were not sent yet
+        writeBatchCount = 0;
+        writeBuffer = ManagedBytes(Bytes(writeBatch.get(), writeBatch.length() / batchSize), false);
+    }
 }
 
 
@@ -13,8 +13,10 @@
 #include <yarp/os/ManagedBytes.h>
 #include <yarp/os/TwoWayStream.h>
 
+#include <cstdint>
 #include <cstdlib>
 #include <mutex>
+#include <vector>
 
 #ifdef YARP_HAS_ACE
 #    include <ace/SOCK_Dgram.h>
@@ -59,7 +61,29 @@ public:
             bufferAlerted(false),
             multiMode(false),
             errCount(0),
-            lastReportTime(0)
+            lastReportTime(0),
+            batchSize(1),
+            readBatchNext(0),
+            readBatchCount(0),
+            writeBatchCount(0),
+            fecGroup(0),
+            fecSeq(0),
+            fecIndex(0),
+            fecParityLength(0),
+            fecLengthXor(0),
+            fecStarted(false),
+            fecActive(false),
+            fecClosed(false),
+            fecFirst(0),
+            fecCount(0),
+            fecNext(0),
+            fecSeen(0),
+            fecStashLength(0),
+            fecRecovered(0),
+            fecLost(0),
+            fecReportedRecovered(0),
+            fecReportedLost(0),
+            fecReportTime(0)
     {
     }
 
@@ -151,6 +175,39 @@ public:
 
     void removeMonitor();
 
+    /**
+     * Protect the datagrams with forward error correction.
+     *
+     * After each group of datagrams an extra datagram is sent, holding
+     * the XOR of the group, so that the receiver can rebuild one lost
+     * datagram per group rather than dropping the whole message.
+     * Both sides of the connection must use the same setting.
+     * Must be called before the stream is opened.
+     *
+     * @param redundancy the size of the parity datagrams, as a
+     *                   percentage of the data (e.g. 20 for one parity
+     *                   datagram every 5 datagrams), 0 to disable.
+     */
+    void setRedundancy(int redundancy);
+
+    /**
+     * @return the number of lost datagrams that were rebuilt by
+     *         forward error correction
+     */
+    size_t getRecoveredDatagrams() const
+    {
+        return fecRecovered;
+    }
+
+    /**
+     * @return the number of lost datagrams that forward error correction
+     *         could not rebuild
+     */
+    size_t getLostDatagrams() const
+    {
+        return fecLost;
+    }
+
     virtual void onMonitorInput()
     {
     }
@@ -184,8 +241,54 @@ private:
     int errCount;
     double lastReportTime;
 
+    // Datagrams sent or received with a single system call
+    // (see YARP_DGRAM_BATCH).  When this is more than 1, readBuffer and
+    // writeBuffer refer to one of the slots of readBatch and writeBatch.
+    size_t batchSize;
+    yarp::os::ManagedBytes readBatch, writeBatch;
+    std::vector<size_t> readBatchLength, writeBatchLength;
+    size_t readBatchNext, readBatchCount, writeBatchCount;
+
+    // Forward error correction (see setRedundancy()).  fecGroup is the
+    // number of datagrams per parity datagram, 0 when disabled, or -1
+    // when the datagrams are framed but not protected (interruptions).
+    // The header of the datagrams is written in the space reserved
+    // before writeBuffer in fecWrite.
+    int fecGroup;
+    yarp::os::ManagedBytes fecWrite, fecParity, fecRead;
+    std::uint32_t fecSeq;
+    int fecIndex;
+    size_t fecParityLength;
+    std::uint32_t fecLengthXor;
+    // receiver side: the group being received
+    bool fecStarted, fecActive, fecClosed;
+    std::uint32_t fecFirst;
+    size_t fecCount, fecNext, fecSeen;
+    std::vector<std::vector<char>> fecSlots;
+    std::vector<size_t> fecSlotLength;
+    std::vector<char> fecStash;
+    size_t fecStashLength;
+    size_t fecRecovered, fecLost;
+    size_t fecReportedRecovered, fecReportedLost;
+    double fecReportTime;
+
     void allocate(int readSize = 0, int writeSize = 0);
 
+    void sendDatagram();
+    yarp::conf::ssize_t sendRaw(const char* data, size_t length);
+    yarp::conf::ssize_t receiveRaw(char* data, size_t length);
+
+    void queueDatagram();
+    void sendBatch();
+    yarp::conf::ssize_t receiveBatch();
+
+    void addParity(const char* data, size_t length);
+    void sendParity();
+    yarp::conf::ssize_t receiveFec();
+    void acceptFec(const char* data, size_t length);
+    void closeFecGroup();
+    void reportFec();
+
     void configureSystemBuffers();
 };
 
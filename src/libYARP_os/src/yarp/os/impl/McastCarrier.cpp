@@ -184,6 +184,7 @@ bool yarp::os::impl::McastCarrier::becomeMcast(ConnectionState& proto, bool send
 {
     stream = new DgramTwoWayStream();
     yAssert(stream != nullptr);
+    stream->setRedundancy(getRedundancy(proto));
     Contact remote = proto.getStreams().getRemoteAddress();
     local = proto.getStreams().getLocalAddress();
     //(yarp::NameConfig::getEnv("YARP_MCAST_TEST")!="");
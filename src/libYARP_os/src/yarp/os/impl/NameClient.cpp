@@ -11,10 +11,14 @@
 
 #include <yarp/os/Bottle.h>
 #include <yarp/os/Carriers.h>
+#include <yarp/os/ConnectionReader.h>
 #include <yarp/os/NameStore.h>
 #include <yarp/os/NetType.h>
 #include <yarp/os/Network.h>
 #include <yarp/os/Os.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/SystemClock.h>
+#include <yarp/os/impl/CommandConnection.h>
 #include <yarp/os/impl/FallbackNameClient.h>
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/NameConfig.h>
@@ -22,11 +26,74 @@
 #include <yarp/os/impl/TcpFace.h>
 
 #include <cstdio>
+#include <cstdlib>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
 
+namespace {
+
+// Port addresses found by the NameClients of the process.
+struct CachedName
+{
+    std::string server; ///< the name server that was asked
+    Contact address;
+    double expiry;
+};
+
+std::mutex nameCacheMutex;
+std::unordered_map<std::string, CachedName> nameCache;
+
+double getNameCacheTtl()
+{
+    std::string ttl = NetworkBase::getEnvironment("YARP_NAME_CACHE_TTL");
+    return ttl.empty() ? 0 : std::atof(ttl.c_str());
+}
+
+void rememberName(const std::string& name, const std::string& server, const Contact& address, double ttl)
+{
+    std::lock_guard<std::mutex> lock(nameCacheMutex);
+    nameCache[name] = CachedName{server, address, SystemClock::nowSystem() + ttl};
+}
+
+// A reply of the name server on a name_ser connection.  Its content is
+// on the first line, and it ends with a "*** end of message" line that
+// must be consumed before the next request is sent.
+class NameServerReply :
+        public PortReader
+{
+public:
+    explicit NameServerReply(Bottle& reply) :
+            reply(reply)
+    {
+    }
+
+    bool read(ConnectionReader& reader) override
+    {
+        reply.clear();
+        bool first = true;
+        while (!reader.isError()) {
+            std::string line = reader.expectText();
+            if (line.length() > 1 && (line[0] == '*' || line[0] == '[')) {
+                return true;
+            }
+            if (first) {
+                reply.fromString(line);
+                first = false;
+            }
+        }
+        return false;
+    }
+
+private:
+    Bottle& reply;
+};
+
+} // namespace
+
 
 /*
   Old class for splitting string based on spaces
@@ -159,9 +226,30 @@ Contact NameClient::queryName(const std::string& name)
         return c;
     }
 
+    double ttl = getNameCacheTtl();
+    std::string server;
+    if (ttl > 0) {
+        server = getCacheKey();
+        std::lock_guard<std::mutex> lock(nameCacheMutex);
+        auto it = nameCache.find(name);
+        if (it != nameCache.end() && it->second.server == server && it->second.expiry > SystemClock::nowSystem()) {
+            return it->second.address;
+        }
+    }
+
     std::string q("NAME_SERVER query ");
     q += name;
-    return probe(q);
+    Contact address = probe(q);
+    if (ttl > 0 && address.isValid()) {
+        rememberName(name, server, address, ttl);
+    }
+    return address;
+}
+
+void NameClient::forgetName(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(nameCacheMutex);
+    nameCache.erase(name);
 }
 
 Contact NameClient::registerName(const std::string& name)
@@ -215,12 +303,35 @@ Contact NameClient::registerName(const std::string& name, const Contact& suggest
             cmd.addString(suggest.getCarrier().c_str());
         }
     }
+    // The registration and the properties of the port are sent over
+    // the same connection to the name server.
+    setup();
+    std::unique_ptr<CommandConnection> connection;
+    if (NetworkBase::getQueryBypass() == nullptr && !isFakeMode()) {
+        ContactStyle style;
+        style.carrier = "name_ser";
+        connection.reset(new CommandConnection(getAddress(), style));
+    }
+    auto request = [&](Bottle& cmd, Bottle& reply) {
+        if (connection != nullptr) {
+            NameServerReply serverReply(reply);
+            return connection->write(cmd, serverReply);
+        }
+        return send(cmd, reply);
+    };
+
     Bottle reply;
-    send(cmd, reply);
+    request(cmd, reply);
 
     Contact address = extractAddress(reply);
+    forgetName(name);
     if (address.isValid()) {
         std::string reg = address.getRegName();
+        forgetName(reg);
+        double ttl = getNameCacheTtl();
+        if (ttl > 0) {
+            rememberName(reg, getCacheKey(), address, ttl);
+        }
 
 
         std::string cmdOffers = "set /port offers ";
@@ -232,31 +343,32 @@ Contact NameClient::registerName(const std::string& name, const Contact& suggest
 
         cmd.fromString(cmdOffers);
         cmd.get(1) = Value(reg);
-        send(cmd, reply);
+        request(cmd, reply);
 
         // accept the same set of carriers
         cmd.get(2) = Value("accepts");
-        send(cmd, reply);
+        request(cmd, reply);
 
         cmd.clear();
         cmd.addString("set");
         cmd.addString(reg.c_str());
         cmd.addString("ips");
         cmd.append(NameConfig::getIpsAsBottle());
-        send(cmd, reply);
+        request(cmd, reply);
 
         cmd.clear();
         cmd.addString("set");
         cmd.addString(reg.c_str());
         cmd.addString("process");
         cmd.addInt32(yarp::os::getpid());
-        send(cmd, reply);
+        request(cmd, reply);
     }
     return address;
 }
 
 Contact NameClient::unregisterName(const std::string& name)
 {
+    forgetName(name);
     std::string q("NAME_SERVER unregister ");
     q += name;
     return probe(q);
@@ -508,6 +620,11 @@ NameServer& NameClient::getServer()
     return *fakeServer;
 }
 
+std::string NameClient::getCacheKey()
+{
+    return isFakeMode() ? std::string("fake") : getAddress().toURI();
+}
+
 void NameClient::setup()
 {
     static std::mutex mutex;
@@ -62,11 +62,24 @@ public:
 
     /**
      * Look up the address of a named port.
+     *
+     * If the `YARP_NAME_CACHE_TTL` environment variable is set to a
+     * time in seconds, the addresses found are remembered that long by
+     * the process, so that connecting the same ports again does not
+     * involve the name server.
+     *
      * @param name the name of the port
      * @return the address associated with the port
      */
     Contact queryName(const std::string& name);
 
+    /**
+     * Forget the address remembered by queryName() for a port, e.g.
+     * because it could not be reached there.
+     * @param name the name of the port
+     */
+    static void forgetName(const std::string& name);
+
     /**
      * Register a port with a given name.
      * @param name the name of the port
@@ -213,6 +226,7 @@ private:
 
     NameServer& getServer();
     void setup();
+    std::string getCacheKey();
 };
 
 } // namespace impl
@@ -22,12 +22,18 @@
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/os/impl/ConnectionRecorder.h>
 #include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/NameClient.h>
 #include <yarp/os/impl/PlatformUnistd.h>
 #include <yarp/os/impl/PortCoreInputUnit.h>
 #include <yarp/os/impl/PortCoreOutputUnit.h>
+#include <yarp/os/impl/PortCoreReactor.h>
 #include <yarp/os/impl/StreamConnectionReader.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
 #include <vector>
 
 #ifdef YARP_HAS_ACE
@@ -56,6 +62,17 @@ using namespace yarp::os::impl;
 using namespace yarp::os;
 using namespace yarp;
 
+namespace {
+
+// Ports of this process that can be reached without serialization,
+// indexed by name.  A port that is handed a message is pinned (see
+// PortCore::m_localUsers) and is not closed before the copy is done.
+std::mutex localPortsMutex;
+std::condition_variable localPortsReleased;
+std::unordered_map<std::string, PortCore*> localPorts;
+
+} // namespace
+
 PortCore::PortCore() :
         m_stateSemaphore(1),
         m_packetMutex(),
@@ -86,6 +103,18 @@ PortCore::PortCore() :
         m_flags(PORTCORE_IS_INPUT | PORTCORE_IS_OUTPUT),
         m_verbosity(1),
         m_logNeeded(false),
+        m_encodings(0),
+        m_encodingHits(0),
+        m_encodingBytesSaved(0),
+        m_localDelivery(false),
+        m_localDelivered(0),
+        m_localUsers(0),
+        m_coalesceDelay(0),
+        m_coalesceSize(65536),
+        m_coalescedBatches(0),
+        m_coalescedMessages(0),
+        m_coalesceDelaySum(0),
+        m_coalesceDelayMax(0),
         m_timeout(-1),
         m_counter(1),
         m_prop(nullptr),
@@ -161,6 +190,23 @@ bool PortCore::listen(const Contact& address, bool shouldAnnounce)
     m_log.setPrefix(address.getRegName().c_str());
     m_stateSemaphore.post();
 
+    // Let the ports of this process find us, if they are allowed to
+    // skip serialization.
+    m_localDelivery = (NetworkBase::getEnvironment("YARP_PORTCORE_LOCAL_DELIVERY") == "1");
+    if (m_localDelivery && !getName().empty()) {
+        std::lock_guard<std::mutex> lock(localPortsMutex);
+        localPorts[getName()] = this;
+    }
+
+    // Small messages may be kept a little while on TCP outputs, to be
+    // sent with the next ones.
+    std::string coalesce = NetworkBase::getEnvironment("YARP_PORTCORE_COALESCE");
+    m_coalesceDelay = coalesce.empty() ? 0 : std::max(0.0, std::atof(coalesce.c_str()) / 1000.0);
+    std::string coalesceSize = NetworkBase::getEnvironment("YARP_PORTCORE_COALESCE_SIZE");
+    if (!coalesceSize.empty() && std::atol(coalesceSize.c_str()) > 0) {
+        m_coalesceSize = static_cast<size_t>(std::atol(coalesceSize.c_str()));
+    }
+
     // Now that we are on the network, we can let the name server know this.
     if (shouldAnnounce) {
         if (!(NetworkBase::getLocalMode() && NetworkBase::getQueryBypass() == nullptr)) {
@@ -425,6 +471,17 @@ void PortCore::closeMain()
     YARP_DEBUG(m_log, "now preparing to shut down port");
     m_stateSemaphore.post();
 
+    // Ports of this process should no longer hand messages to us, and
+    // those doing so right now must be done before we go on.
+    if (m_localDelivery) {
+        std::unique_lock<std::mutex> lock(localPortsMutex);
+        auto it = localPorts.find(getName());
+        if (it != localPorts.end() && it->second == this) {
+            localPorts.erase(it);
+        }
+        localPortsReleased.wait(lock, [this] { return m_localUsers == 0; });
+    }
+
     // Start disconnecting inputs.  We ask the other side of the
     // connection to do this, so it won't come as a surprise.
     // The details of how disconnection works vary by carrier.
@@ -1014,6 +1071,8 @@ bool PortCore::addOutput(const std::string& dest,
 
     // No connection, abort.
     if (op == nullptr) {
+        // The address might be outdated, look it up again next time.
+        NameClient::forgetName(parts.getRegName());
         bw.appendLine(std::string("Cannot connect to ") + dest);
         if (os != nullptr) {
             bw.write(*os);
@@ -1090,6 +1149,23 @@ void PortCore::removeInput(const std::string& src, void* id, OutputStream* os)
     cleanUnits();
 }
 
+namespace {
+void appendStats(BufferedConnectionWriter& bw, const PortCoreStats& stats)
+{
+    // One indented line for the counters and one for each histogram.
+    std::string lines = stats.toString();
+    size_t start = 0;
+    while (start <= lines.length()) {
+        size_t end = lines.find('\n', start);
+        if (end == std::string::npos) {
+            end = lines.length();
+        }
+        bw.appendLine("  " + lines.substr(start, end - start));
+        start = end + 1;
+    }
+}
+} // namespace
+
 void PortCore::describe(void* id, OutputStream* os)
 {
     YARP_UNUSED(id);
@@ -1111,6 +1187,7 @@ void PortCore::describe(void* id, OutputStream* os)
             Route route = unit->getRoute();
             std::string msg = "There is an output connection from " + route.getFromName() + " to " + route.getToName() + " using " + route.getCarrierName();
             bw.appendLine(msg);
+            appendStats(bw, unit->getStats());
             oct++;
         }
     }
@@ -1126,6 +1203,7 @@ void PortCore::describe(void* id, OutputStream* os)
             if (!route.getCarrierName().empty()) {
                 std::string msg = "There is an input connection from " + route.getFromName() + " to " + route.getToName() + " using " + route.getCarrierName();
                 bw.appendLine(msg);
+                appendStats(bw, unit->getStats());
                 ict++;
             }
         }
@@ -1134,6 +1212,17 @@ void PortCore::describe(void* id, OutputStream* os)
         bw.appendLine("There are no incoming connections");
     }
 
+    // Report messages not yet read.
+    int pending = 0;
+    int capacity = 0;
+    if (getReaderQueue(pending, capacity)) {
+        std::string msg = "There are " + std::to_string(pending) + " messages waiting to be read";
+        if (capacity > 0) {
+            msg += " (at most " + std::to_string(capacity) + " are kept)";
+        }
+        bw.appendLine(msg);
+    }
+
     m_stateSemaphore.post();
 
     // Send description across network, or print it.
@@ -1331,11 +1420,12 @@ bool PortCore::sendHelper(const PortWriter& writer,
     int logCount = 0;
     std::string envelopeString = m_envelope;
 
-    // Pass a message to all output units for sending on.  We could
-    // be doing more here to cache the serialization of the message
-    // and reuse it across output connections.  However, one key
-    // optimization is present: external blocks written by
-    // yarp::os::ConnectionWriter::appendExternalBlock are never
+    // Pass a message to all output units for sending on.  The packet
+    // keeps a cache of the serialized message, one per wire encoding
+    // (binary, text, bare), so that connections using the same
+    // encoding share a single serialization of the message (see
+    // PortCorePacket::getEncoding).  Moreover, external blocks written
+    // by yarp::os::ConnectionWriter::appendExternalBlock are never
     // copied.  So for example the core image array in a yarp::sig::Image
     // is untouched by the port communications code.
 
@@ -1362,15 +1452,26 @@ bool PortCore::sendHelper(const PortWriter& writer,
     YMSG(("------- send in\n"));
     // Prepare a "packet" for tracking a single message which
     // may travel by multiple outputs.
-    m_packetMutex.lock();
+    // The packet pool and the packet usage counts are lock-free, so
+    // there is no need to hold m_packetMutex here.
     PortCorePacket* packet = m_packets.getFreePacket();
     yAssert(packet != nullptr);
     packet->setContent(&writer, false, callback);
-    m_packetMutex.unlock();
 
-    // Scan connections, placing message everyhere we can.
-    for (auto unit : m_units) {
-        if ((unit != nullptr) && unit->isOutput() && !unit->isFinished()) {
+    // When no reply is expected, readers living in this process may
+    // take a copy of the message.  Whether a connection is served this
+    // way does not depend on the message, so that all the messages of
+    // the connection go through the same queue, in order.
+    bool local = m_localDelivery && reader == nullptr && mode == PORTCORE_SEND_NORMAL;
+
+    // Scan connections, placing message everyhere we can.  The
+    // connections with a higher priority (see setTypeOfService) are
+    // served first.
+    for (int priority = PortCoreUnit::highPriority; priority >= PortCoreUnit::lowPriority; priority--) {
+        for (auto unit : m_units) {
+            if ((unit == nullptr) || !unit->isOutput() || unit->isFinished() || unit->getSendPriority() != priority) {
+                continue;
+            }
             bool log = (!unit->getMode().empty());
             if (log) {
                 // Some connections are for logging only.
@@ -1380,11 +1481,12 @@ bool PortCore::sendHelper(const PortWriter& writer,
             if (!ok) {
                 continue;
             }
+            if (local && sendLocal(unit, writer, envelopeString)) {
+                continue;
+            }
             bool waiter = m_waitAfterSend || (mode == PORTCORE_SEND_LOG);
             YMSG(("------- -- inc\n"));
-            m_packetMutex.lock();
             packet->inc(); // One more connection carrying message.
-            m_packetMutex.unlock();
             YMSG(("------- -- presend\n"));
             bool gotReplyOne = false;
             // Send the message off on this connection.
@@ -1400,10 +1502,8 @@ bool PortCore::sendHelper(const PortWriter& writer,
             YMSG(("------- -- send\n"));
             if (out != nullptr) {
                 // We got back a report of a message already sent.
-                m_packetMutex.lock();
-                ((PortCorePacket*)out)->dec(); // Message on one fewer connections.
-                m_packets.checkPacket((PortCorePacket*)out);
-                m_packetMutex.unlock();
+                // Message on one fewer connections.
+                m_packets.releasePacket((PortCorePacket*)out);
             }
             if (waiter) {
                 if (unit->isFinished()) {
@@ -1414,15 +1514,11 @@ bool PortCore::sendHelper(const PortWriter& writer,
         }
     }
     YMSG(("------- pack check\n"));
-    m_packetMutex.lock();
 
     // We no longer concern ourselves with the message.
     // It may or may not be traveling on some connections.
     // But that is not our problem anymore.
-    packet->dec();
-
-    m_packets.checkPacket(packet);
-    m_packetMutex.unlock();
+    m_packets.releasePacket(packet);
     YMSG(("------- packed\n"));
     YMSG(("------- send out\n"));
     if (mode == PORTCORE_SEND_LOG) {
@@ -1485,12 +1581,9 @@ int PortCore::getOutputCount()
 void PortCore::notifyCompletion(void* tracker)
 {
     YMSG(("starting notifyCompletion\n"));
-    m_packetMutex.lock();
     if (tracker != nullptr) {
-        ((PortCorePacket*)tracker)->dec();
-        m_packets.checkPacket((PortCorePacket*)tracker);
+        m_packets.releasePacket((PortCorePacket*)tracker);
     }
-    m_packetMutex.unlock();
     YMSG(("stopping notifyCompletion\n"));
 }
 
@@ -1590,6 +1683,7 @@ enum class PortCoreCommand : yarp::conf::vocab32_t
     Set = yarp::os::createVocab('s', 'e', 't'),
     Get = yarp::os::createVocab('g', 'e', 't'),
     Prop = yarp::os::createVocab('p', 'r', 'o', 'p'),
+    Stat = yarp::os::createVocab('s', 't', 'a', 't'),
     RosPublisherUpdate = yarp::os::createVocab('r', 'p', 'u', 'p'),
     RosRequestTopic = yarp::os::createVocab('r', 't', 'o', 'p'),
     RosGetPid = yarp::os::createVocab('p', 'i', 'd'),
@@ -1639,6 +1733,7 @@ PortCoreCommand parseCommand(const yarp::os::Value& v)
     case PortCoreCommand::Set:
     case PortCoreCommand::Get:
     case PortCoreCommand::Prop:
+    case PortCoreCommand::Stat:
     case PortCoreCommand::RosPublisherUpdate:
     case PortCoreCommand::RosRequestTopic:
     case PortCoreCommand::RosGetPid:
@@ -1741,6 +1836,8 @@ bool PortCore::adminBlock(ConnectionReader& reader,
         result.addString("[atch] [in]  $prop      # attach a portmonitor plug-in to the port's input");
         result.addString("[dtch] [out]            # detach portmonitor plug-in from the port's output");
         result.addString("[dtch] [in]             # detach portmonitor plug-in from the port's input");
+        result.addString("[stat]                  # get traffic statistics of all connections");
+        result.addString("[stat] $portname        # get traffic statistics of a connection to/from a port");
         //result.addString("[atch] $portname $prop  # attach a portmonitor plug-in to the connection to/from $portname");
         //result.addString("[dtch] $portname        # detach any portmonitor plug-in from the connection to/from $portname");
         return result;
@@ -2110,6 +2207,54 @@ bool PortCore::adminBlock(ConnectionReader& reader,
                         port_prop.put("is_output", is_output);
                         port_prop.put("is_rpc", is_rpc);
                         port_prop.put("type", getType().getName());
+
+                        PortCoreReactor::Stats rstats = PortCoreReactor::get().getStats();
+                        Bottle& reactor = result.addList();
+                        reactor.addString("reactor");
+                        Property& reactor_prop = reactor.addDict();
+                        reactor_prop.put("enabled", rstats.enabled);
+                        reactor_prop.put("io_threads", static_cast<int>(rstats.ioThreads));
+                        reactor_prop.put("workers", static_cast<int>(rstats.workers));
+                        reactor_prop.put("process_threads", ThreadImpl::getCount());
+                        reactor_prop.put("watched", static_cast<int>(rstats.watched));
+                        reactor_prop.put("read_wakeups", static_cast<int>(rstats.readWakeups));
+                        reactor_prop.put("tasks", static_cast<int>(rstats.tasks));
+                        reactor_prop.put("latency_mean", rstats.meanWakeupLatency);
+                        reactor_prop.put("latency_max", rstats.maxWakeupLatency);
+
+                        PortCorePackets::Stats pstats = m_packets.getStats();
+                        Bottle& packets = result.addList();
+                        packets.addString("packets");
+                        Property& packets_prop = packets.addDict();
+                        packets_prop.put("capacity", static_cast<int>(pstats.capacity));
+                        packets_prop.put("active", static_cast<int>(pstats.active));
+                        packets_prop.put("high_water", static_cast<int>(pstats.highWater));
+                        packets_prop.put("acquired", static_cast<int>(pstats.acquired));
+                        packets_prop.put("exhausted", static_cast<int>(pstats.exhausted));
+                        packets_prop.put("overflow", static_cast<int>(pstats.overflow));
+
+                        Bottle& encoding = result.addList();
+                        encoding.addString("encoding_cache");
+                        Property& encoding_prop = encoding.addDict();
+                        encoding_prop.put("encoded", static_cast<int>(m_encodings.load()));
+                        encoding_prop.put("hits", static_cast<int>(m_encodingHits.load()));
+                        encoding_prop.put("bytes_saved", static_cast<double>(m_encodingBytesSaved.load()));
+
+                        Bottle& local = result.addList();
+                        local.addString("local_delivery");
+                        Property& local_prop = local.addDict();
+                        local_prop.put("enabled", m_localDelivery ? 1 : 0);
+                        local_prop.put("delivered", static_cast<int>(m_localDelivered.load()));
+
+                        std::lock_guard<std::mutex> coalesceLock(m_coalesceMutex);
+                        Bottle& coalescing = result.addList();
+                        coalescing.addString("coalescing");
+                        Property& coalescing_prop = coalescing.addDict();
+                        coalescing_prop.put("enabled", (m_coalesceDelay > 0) ? 1 : 0);
+                        coalescing_prop.put("batches", static_cast<int>(m_coalescedBatches));
+                        coalescing_prop.put("messages", static_cast<int>(m_coalescedMessages));
+                        coalescing_prop.put("delay_mean", (m_coalescedBatches > 0) ? m_coalesceDelaySum / m_coalescedBatches : 0.0);
+                        coalescing_prop.put("delay_max", m_coalesceDelayMax);
                     } else {
                         for (auto unit : m_units) {
                             if ((unit != nullptr) && !unit->isFinished()) {
@@ -2290,6 +2435,49 @@ bool PortCore::adminBlock(ConnectionReader& reader,
         return result;
     };
 
+    auto handleAdminStatCmd = [this](const std::string& target) {
+        // Report the traffic on the connections, and the messages
+        // waiting to be read.
+        Bottle result;
+        if (target.empty()) {
+            int pending = 0;
+            int capacity = 0;
+            if (getReaderQueue(pending, capacity)) {
+                Bottle& queue = result.addList();
+                queue.addString("queue");
+                Bottle& bpending = queue.addList();
+                bpending.addString("pending");
+                bpending.addInt32(pending);
+                Bottle& bcapacity = queue.addList();
+                bcapacity.addString("capacity");
+                bcapacity.addInt32(capacity);
+            }
+        }
+        m_stateSemaphore.wait();
+        for (auto unit : m_units) {
+            if ((unit != nullptr) && !unit->isFinished() && (unit->isOutput() || unit->isInput())) {
+                Route route = unit->getRoute();
+                std::string peer = (unit->isOutput()) ? route.getToName() : route.getFromName();
+                if (route.getCarrierName().empty() || peer == "admin" || (!target.empty() && peer != target)) {
+                    continue;
+                }
+                Bottle& connection = result.addList();
+                connection.addString(unit->isOutput() ? "out" : "in");
+                connection.addString(peer);
+                Bottle& bcarrier = connection.addList();
+                bcarrier.addString("carrier");
+                bcarrier.addString(route.getCarrierName());
+                unit->getStats().describe(connection);
+            }
+        }
+        m_stateSemaphore.post();
+        if (!target.empty() && result.size() == 0) {
+            result.addVocab(Vocab::encode("fail"));
+            result.addString("cannot find any connection to/from " + target);
+        }
+        return result;
+    };
+
     // NOTE: YARP partially supports the ROS Slave API https://wiki.ros.org/ROS/Slave_API
 
     auto handleAdminRosPublisherUpdateCmd = [this](const std::string& topic, Bottle* pubs) {
@@ -2532,6 +2720,9 @@ bool PortCore::adminBlock(ConnectionReader& reader,
             break;
         }
     } break;
+    case PortCoreCommand::Stat:
+        result = handleAdminStatCmd(cmd.get(1).asString());
+        break;
     case PortCoreCommand::RosPublisherUpdate: {
         YARP_SPRINTF1(m_log, debug, "publisherUpdate! --> %s", cmd.toString().c_str());
         // std::string caller_id = cmd.get(1).asString(); // Currently unused
@@ -2578,6 +2769,19 @@ bool PortCore::setTypeOfService(PortCoreUnit* unit, int tos)
         return false;
     }
 
+    // The type of service also decides how the messages are scheduled
+    // on the connections of this port: the classes from CS4 up (e.g. the
+    // HIGH and CRIT priority levels) are served first, and the CS1 class
+    // (e.g. the LOW level) only gets the latest message.
+    int dscp = tos >> 2;
+    if (dscp >= QosStyle::DSCP_CS4) {
+        unit->setSendPriority(PortCoreUnit::highPriority);
+    } else if (dscp >= QosStyle::DSCP_CS1 && dscp < QosStyle::DSCP_CS2) {
+        unit->setSendPriority(PortCoreUnit::lowPriority);
+    } else {
+        unit->setSendPriority(PortCoreUnit::normalPriority);
+    }
+
     if (unit->isOutput()) {
         auto* outUnit = dynamic_cast<PortCoreOutputUnit*>(unit);
         if (outUnit != nullptr) {
@@ -2763,6 +2967,92 @@ void PortCore::reportUnit(PortCoreUnit* unit, bool active)
     }
 }
 
+void PortCore::reportEncoding(bool shared, size_t bytes)
+{
+    if (shared) {
+        m_encodingHits.fetch_add(1, std::memory_order_relaxed);
+        m_encodingBytesSaved.fetch_add(bytes, std::memory_order_relaxed);
+    } else {
+        m_encodings.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PortCore::reportCoalescing(size_t messages, double delay)
+{
+    std::lock_guard<std::mutex> lock(m_coalesceMutex);
+    m_coalescedBatches++;
+    m_coalescedMessages += messages;
+    m_coalesceDelaySum += delay;
+    if (delay > m_coalesceDelayMax) {
+        m_coalesceDelayMax = delay;
+    }
+}
+
+bool PortCore::acceptLocal(const PortWriter& writer,
+                           const std::string& envelope)
+{
+    YARP_UNUSED(writer);
+    YARP_UNUSED(envelope);
+    return false;
+}
+
+bool PortCore::getReaderQueue(int& pending, int& capacity)
+{
+    pending = 0;
+    capacity = 0;
+    return false;
+}
+
+bool PortCore::sendLocal(PortCoreUnit* unit,
+                         const PortWriter& writer,
+                         const std::string& envelope)
+{
+    // Port monitors and carrier modifiers need to see the message
+    // going through the connection.
+    if (m_modifier.outputModifier != nullptr) {
+        return false;
+    }
+    Route route = unit->getRoute();
+    if (route.getCarrierName().find('+') != std::string::npos) {
+        return false;
+    }
+
+    // The target is pinned, so that it is not closed while it copies
+    // the object.  The copy itself is done without holding the lock of
+    // the registry, other ports of the process can go on sending.
+    PortCore* target = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(localPortsMutex);
+        auto it = localPorts.find(route.getToName());
+        if (it != localPorts.end() && it->second->m_modifier.inputModifier == nullptr) {
+            target = it->second;
+            target->m_localUsers++;
+        }
+    }
+    if (target == nullptr) {
+        return false;
+    }
+
+    // The reader copies the object before we return, the writer is
+    // free to reuse it afterwards.
+    bool accepted = target->acceptLocal(writer, envelope);
+
+    {
+        std::lock_guard<std::mutex> lock(localPortsMutex);
+        target->m_localUsers--;
+        if (target->m_localUsers == 0) {
+            localPortsReleased.notify_all();
+        }
+    }
+    if (!accepted) {
+        return false;
+    }
+
+    m_localDelivered.fetch_add(1, std::memory_order_relaxed);
+    unit->getStats().recordMessage(0);
+    return true;
+}
+
 bool PortCore::setProcessSchedulingParam(int priority, int policy)
 {
 #if defined(__linux__)
@@ -18,6 +18,7 @@
 #include <yarp/os/PortReaderCreator.h>
 #include <yarp/os/PortReport.h>
 #include <yarp/os/PortWriter.h>
+#include <yarp/os/PortWriterBufferBase.h>
 #include <yarp/os/Property.h>
 #include <yarp/os/Semaphore.h>
 #include <yarp/os/Type.h>
@@ -32,6 +33,8 @@
 #undef YARP_INCLUDING_DEPRECATED_HEADER_ON_PURPOSE
 #endif
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <vector>
 
@@ -289,6 +292,70 @@ public:
      */
     void reportUnit(PortCoreUnit* unit, bool active);
 
+    /**
+     * Called by an output connection handler each time it gets the
+     * serialized content of a message from the packet encoding cache.
+     * @param shared true if the content had already been serialized for
+     * another connection, false if it was serialized for this one
+     * @param bytes the size of the serialized content
+     */
+    void reportEncoding(bool shared, size_t bytes);
+
+    /**
+     * Check whether small messages are coalesced on TCP outputs.  This
+     * is the case when YARP_PORTCORE_COALESCE is set to the longest
+     * time in milliseconds a message may be kept waiting for others.
+     * @return the longest time in seconds a message may be kept, or 0
+     * if each message is sent right away (the default)
+     */
+    double getCoalescingDelay() const
+    {
+        return m_coalesceDelay;
+    }
+
+    /**
+     * @return the number of bytes after which coalesced messages are
+     * sent without waiting (YARP_PORTCORE_COALESCE_SIZE)
+     */
+    size_t getCoalescingSize() const
+    {
+        return m_coalesceSize;
+    }
+
+    /**
+     * Called by an output connection handler each time it sends
+     * several messages at once.
+     * @param messages the number of messages sent
+     * @param delay the time the first of them was kept waiting, in
+     * seconds
+     */
+    void reportCoalescing(size_t messages, double delay);
+
+    /**
+     * Take a copy of a message written by a port of the same process,
+     * without going through the connection.  This is used when
+     * YARP_PORTCORE_LOCAL_DELIVERY is set.  By default, messages are
+     * never taken this way.
+     * @param writer the object written, not used once this returns
+     * @param envelope the envelope of the message
+     * @return true if the message was taken (or dropped, if the reader
+     * has no room for it and does not wait for room), false if it
+     * should be sent over the connection as usual
+     */
+    virtual bool acceptLocal(const yarp::os::PortWriter& writer,
+                             const std::string& envelope);
+
+    /**
+     * Check how many messages are waiting to be read by the user of the
+     * port.  By default, there is no queue.
+     * @param pending set to the number of messages waiting
+     * @param capacity set to the maximum number of messages kept, 0 if
+     * there is no limit
+     * @return true if the port has a reader that keeps messages in a
+     * queue (e.g. a BufferedPort)
+     */
+    virtual bool getReaderQueue(int& pending, int& capacity);
+
     /**
      * Configure the port to meet certain restrictions in behavior.
      */
@@ -518,7 +585,7 @@ private:
     // main internal PortCore state and operations
     std::vector<PortCoreUnit *> m_units;  ///< list of connections
     yarp::os::Semaphore m_stateSemaphore;       ///< control access to essential port state
-    std::mutex m_packetMutex;      ///< control access to message cache
+    std::mutex m_packetMutex;      ///< control access to connection counts
     yarp::os::Semaphore m_connectionChangeSemaphore; ///< signal changes in connections
     Logger m_log;  ///< message logger
     Face *m_face;  ///< network server
@@ -549,6 +616,19 @@ private:
     int m_verbosity;  ///< threshold on what warnings or debug messages are shown
     bool m_logNeeded; ///< port needs to monitor message content
     PortCorePackets m_packets; ///< a pool for tracking messages currently being sent
+    std::atomic<std::uint64_t> m_encodings;          ///< messages serialized into the packet encoding cache
+    std::atomic<std::uint64_t> m_encodingHits;       ///< serializations shared from the packet encoding cache
+    std::atomic<std::uint64_t> m_encodingBytesSaved; ///< bytes not serialized again thanks to the cache
+    bool m_localDelivery; ///< hand messages to readers of the same process without serializing them
+    std::atomic<std::uint64_t> m_localDelivered; ///< messages handed over without serialization
+    int m_localUsers; ///< ports of this process handing a message to us, guarded by the registry of local ports
+    double m_coalesceDelay;  ///< longest time a message is kept to be sent with others (0 = never)
+    size_t m_coalesceSize;   ///< bytes after which kept messages are sent without waiting
+    std::mutex m_coalesceMutex; ///< control access to the coalescing statistics
+    std::uint64_t m_coalescedBatches;  ///< writes carrying several messages
+    std::uint64_t m_coalescedMessages; ///< messages sent in those writes
+    double m_coalesceDelaySum; ///< total time the first message of a batch was kept
+    double m_coalesceDelayMax; ///< longest time the first message of a batch was kept
     std::string m_envelope;///< user-defined wrapping data
     float m_timeout;  ///< a timeout to apply to all network operations
     int m_counter;    ///< port-unique ids for connections
@@ -571,7 +651,13 @@ YARP_WARNING_POP
     // port data modifier
     yarp::os::impl::PortDataModifier m_modifier;
 
-    // set IP packet TOS
+    // hand a message to the reader at the other end of a connection,
+    // if it lives in this process
+    bool sendLocal(PortCoreUnit* unit,
+                   const yarp::os::PortWriter& writer,
+                   const std::string& envelope);
+
+    // set IP packet TOS, and the priority of the connection
     bool setTypeOfService(PortCoreUnit* unit, int tos);
 
     // get IP packet TOS
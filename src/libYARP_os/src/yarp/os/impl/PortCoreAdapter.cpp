@@ -10,12 +10,14 @@
 #include <yarp/os/impl/PortCoreAdapter.h>
 
 #include <yarp/os/PortReader.h>
+#include <yarp/os/PortReaderBufferBase.h>
 #include <yarp/os/Time.h>
 
 yarp::os::impl::PortCoreAdapter::PortCoreAdapter(Port& owner) :
         stateMutex(),
         readDelegate(nullptr),
         permanentReadDelegate(nullptr),
+        readBuffer(nullptr),
         adminReadDelegate(nullptr),
         writeDelegate(nullptr),
         readResult(false),
@@ -93,6 +95,11 @@ void yarp::os::impl::PortCoreAdapter::finishReading()
         consume.post();
         stateMutex.unlock();
     }
+    // A buffer may keep the connections waiting for room.  Once the
+    // port is closed, the buffer may be gone.
+    if (active && readBuffer != nullptr) {
+        readBuffer->interrupt();
+    }
 }
 
 void yarp::os::impl::PortCoreAdapter::finishWriting()
@@ -197,6 +204,32 @@ bool yarp::os::impl::PortCoreAdapter::read(ConnectionReader& reader)
     return result;
 }
 
+bool yarp::os::impl::PortCoreAdapter::acceptLocal(const PortWriter& writer,
+                                                  const std::string& envelope)
+{
+    // Only buffered readers (BufferedPort, PortReaderBuffer) have
+    // objects of their own to copy messages into.
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (closed) {
+        return false;
+    }
+    if (readBuffer == nullptr) {
+        return false;
+    }
+    return readBuffer->acceptLocalBase(writer, envelope);
+}
+
+bool yarp::os::impl::PortCoreAdapter::getReaderQueue(int& pending, int& capacity)
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (closed || readBuffer == nullptr) {
+        return false;
+    }
+    pending = readBuffer->check();
+    capacity = static_cast<int>((readBuffer->getCapacity() > 0) ? readBuffer->getCapacity() : readBuffer->getMaxBuffer());
+    return true;
+}
+
 bool yarp::os::impl::PortCoreAdapter::read(PortReader& reader, bool willReply)
 {
     // called by user
@@ -263,6 +296,7 @@ void yarp::os::impl::PortCoreAdapter::configReader(PortReader& reader)
     readBackground = true;
     readDelegate = &reader;
     permanentReadDelegate = &reader;
+    readBuffer = dynamic_cast<PortReaderBufferBase*>(&reader);
     checkType(reader);
     consume.post(); // just do this once
     stateMutex.unlock();
@@ -24,6 +24,7 @@
 
 namespace yarp {
 namespace os {
+class PortReaderBufferBase;
 namespace impl {
 
 class PortCoreAdapter :
@@ -33,6 +34,7 @@ private:
     std::mutex stateMutex;
     PortReader* readDelegate;
     PortReader* permanentReadDelegate;
+    PortReaderBufferBase* readBuffer; ///< permanentReadDelegate, if it is a buffer
     PortReader* adminReadDelegate;
     PortWriter* writeDelegate;
     //PortReaderCreator *readCreatorDelegate;
@@ -81,6 +83,9 @@ YARP_WARNING_POP
     void resumeFull();
     bool read(ConnectionReader& reader) override;
     bool read(PortReader& reader, bool willReply = false);
+    bool acceptLocal(const PortWriter& writer, const std::string& envelope) override;
+
+    bool getReaderQueue(int& pending, int& capacity) override;
     bool reply(PortWriter& writer, bool drop, bool interrupted);
     void configReader(PortReader& reader);
     void configAdminReader(PortReader& reader);
@@ -17,6 +17,8 @@
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PlatformSignal.h>
 #include <yarp/os/impl/PortCommand.h>
+#include <yarp/os/impl/PortCoreReactor.h>
+#include <yarp/os/impl/SocketTwoWayStream.h>
 
 #include <cstdio>
 
@@ -40,7 +42,12 @@ PortCoreInputUnit::PortCoreInputUnit(PortCore& owner,
         running(false),
         name(owner.getName()),
         localReader(nullptr),
-        reversed(reversed)
+        reversed(reversed),
+        wasNoticed(false),
+        posted(false),
+        reactorId(0),
+        reactorSetupDone(false),
+        reactorThreaded(false)
 {
     yAssert(ip != nullptr);
 
@@ -76,6 +83,12 @@ bool PortCoreInputUnit::start()
 
     phase.wait();
 
+    if (startReactor()) {
+        YARP_DEBUG(Logger::get(), std::string("new input connection to ") + getOwner().getName() + " handed to the reactor");
+        phase.post();
+        return true;
+    }
+
     bool result = PortCoreUnit::start();
     if (result) {
         YARP_DEBUG(Logger::get(), std::string("new input connection to ") + getOwner().getName() + " started ok");
@@ -93,19 +106,86 @@ bool PortCoreInputUnit::start()
 
 void PortCoreInputUnit::run()
 {
+    if (!reactorThreaded) {
+        running = true;
+        phase.post();
+    }
+
+    bool done = reactorThreaded ? false : !setup();
+    while (!done) {
+        done = !step();
+    }
+
+    teardown();
+}
+
+
+bool PortCoreInputUnit::startReactor()
+{
+    // Only connections initiated by a remote sender are multiplexed,
+    // reversed (pull) connections are never tcp.
+    if (reversed || ip == nullptr || !PortCoreReactor::isEnabled()) {
+        return false;
+    }
+    auto* socket = dynamic_cast<SocketTwoWayStream*>(&ip->getInputStream());
+    if (socket == nullptr) {
+        return false;
+    }
     running = true;
-    phase.post();
+    reactorId = PortCoreReactor::get().watch(socket->getHandle(), [this]() { return reactorStep(); });
+    if (reactorId == 0) {
+        running = false;
+        return false;
+    }
+    return true;
+}
 
-    Route route;
-    bool wasNoticed = false;
-    bool posted = false;
 
+bool PortCoreInputUnit::reactorStep()
+{
+    bool ok;
+    if (!reactorSetupDone) {
+        reactorSetupDone = true;
+        ok = setup();
+        if (ok && !isReactorCarrier()) {
+            // The carrier cannot be multiplexed (e.g. it reads ahead),
+            // continue as usual with a dedicated thread.
+            reactorThreaded = true;
+            if (PortCoreUnit::start()) {
+                return false;
+            }
+            reactorThreaded = false;
+            ok = false;
+        }
+    } else {
+        ok = step();
+    }
+
+    if (!ok) {
+        teardown();
+        return false;
+    }
+    return true;
+}
+
+
+bool PortCoreInputUnit::isReactorCarrier()
+{
+    if (ip == nullptr || dynamic_cast<SocketTwoWayStream*>(&ip->getInputStream()) == nullptr) {
+        return false;
+    }
+    std::string carrier = officialRoute.getCarrierName();
+    return carrier == "tcp" || carrier == "fast_tcp";
+}
+
+
+bool PortCoreInputUnit::setup()
+{
+    Route route;
     bool done = false;
 
     yAssert(ip != nullptr);
 
-    PortCommand cmd;
-
     bool ok = true;
     if (!reversed) {
         ip->open(getName());
@@ -182,228 +262,246 @@ void PortCoreInputUnit::run()
         done = true;
     }
 
-    void* id = (void*)this;
-
     if (ip != nullptr && !ip->getConnection().canEscape()) {
         InputStream* is = &ip->getInputStream();
         is->setReadEnvelopeCallback(envelopeReadCallback, this);
     }
 
-    while (!done) {
-        if (ip == nullptr) {
-            break;
-        }
-        ConnectionReader& br = ip->beginRead();
-
-        if (br.getReference() != nullptr) {
-            //printf("HAVE A REFERENCE\n");
-            if (localReader != nullptr) {
-                bool ok = localReader->read(br);
-                if (!br.isActive()) {
-                    break;
-                }
-                if (!ok) {
-                    continue;
-                }
-            } else {
-                PortCore& man = getOwner();
-                bool ok = man.readBlock(br, id, nullptr);
-                if (!br.isActive()) {
-                    break;
-                }
-                if (!ok) {
-                    continue;
-                }
-            }
-            //printf("DONE WITH A REFERENCE\n");
-            if (ip != nullptr) {
-                ip->endRead();
-            }
-            continue;
-        }
+    return !done;
+}
+
+
+bool PortCoreInputUnit::step()
+{
+    if (ip == nullptr) {
+        return false;
+    }
+
+    const Route& route = officialRoute;
+    void* id = (void*)this;
+    PortCommand cmd;
+    bool done = false;
+
+    ConnectionReader& br = ip->beginRead();
 
-        if (ip->getConnection().canEscape()) {
-            bool ok = cmd.read(br);
+    if (br.getReference() != nullptr) {
+        //printf("HAVE A REFERENCE\n");
+        getStats().recordMessage(0);
+        if (localReader != nullptr) {
+            bool ok = localReader->read(br);
             if (!br.isActive()) {
-                break;
+                return false;
             }
             if (!ok) {
-                continue;
+                return true;
             }
         } else {
-            cmd = PortCommand('d', "");
-            if (!ip->isOk()) {
-                break;
+            PortCore& man = getOwner();
+            bool ok = man.readBlock(br, id, nullptr);
+            if (!br.isActive()) {
+                return false;
+            }
+            if (!ok) {
+                return true;
             }
         }
+        //printf("DONE WITH A REFERENCE\n");
+        if (ip != nullptr) {
+            ip->endRead();
+        }
+        return true;
+    }
 
-        if (closing || isDoomed()) {
-            break;
+    if (ip->getConnection().canEscape()) {
+        bool ok = cmd.read(br);
+        if (!br.isActive()) {
+            return false;
+        }
+        if (!ok) {
+            return true;
         }
-        char key = cmd.getKey();
-        //printf("Port command is [%c:%d/%s]\n",
-        //         (key>=32)?key:'?', key, cmd.getText().c_str());
-
-        PortCore& man = getOwner();
-        OutputStream* os = nullptr;
-        if (br.isTextMode()) {
-            os = &(ip->getOutputStream());
+    } else {
+        cmd = PortCommand('d', "");
+        if (!ip->isOk()) {
+            return false;
         }
+    }
 
-        switch (key) {
-        case '/':
-            YARP_SPRINTF3(Logger::get(),
-                          debug,
-                          "Port command (%s): %s should add connection: %s",
-                          route.toString().c_str(),
-                          getOwner().getName().c_str(),
-                          cmd.getText().c_str());
-            man.addOutput(cmd.getText(), id, os);
-            break;
-        case '!':
-            YARP_SPRINTF3(Logger::get(),
-                          debug,
-                          "Port command (%s): %s should remove output: %s",
-                          route.toString().c_str(),
-                          getOwner().getName().c_str(),
-                          cmd.getText().c_str());
-            man.removeOutput(cmd.getText().substr(1, std::string::npos), id, os);
-            break;
-        case '~':
-            YARP_SPRINTF3(Logger::get(),
-                          debug,
-                          "Port command (%s): %s should remove input: %s",
-                          route.toString().c_str(),
-                          getOwner().getName().c_str(),
-                          cmd.getText().c_str());
-            man.removeInput(cmd.getText().substr(1, std::string::npos), id, os);
-            break;
-        case '*':
-            man.describe(id, os);
-            break;
-        case 'D':
-        case 'd': {
-            if (key == 'D') {
-                ip->suppressReply();
-            }
+    if (closing || isDoomed()) {
+        return false;
+    }
 
-            std::string env = cmd.getText();
-            if (env.length() > 2) {
-                //YARP_ERROR(Logger::get(),
-                //"***** received an envelope! [%s]", env.c_str());
-                std::string env2 = env.substr(2, env.length());
-                man.setEnvelope(env2);
-                ip->setEnvelope(env2);
+    char key = cmd.getKey();
+    //printf("Port command is [%c:%d/%s]\n",
+    //         (key>=32)?key:'?', key, cmd.getText().c_str());
+
+    PortCore& man = getOwner();
+    OutputStream* os = nullptr;
+    if (br.isTextMode()) {
+        os = &(ip->getOutputStream());
+    }
+
+    switch (key) {
+    case '/':
+        YARP_SPRINTF3(Logger::get(),
+                      debug,
+                      "Port command (%s): %s should add connection: %s",
+                      route.toString().c_str(),
+                      getOwner().getName().c_str(),
+                      cmd.getText().c_str());
+        man.addOutput(cmd.getText(), id, os);
+        break;
+    case '!':
+        YARP_SPRINTF3(Logger::get(),
+                      debug,
+                      "Port command (%s): %s should remove output: %s",
+                      route.toString().c_str(),
+                      getOwner().getName().c_str(),
+                      cmd.getText().c_str());
+        man.removeOutput(cmd.getText().substr(1, std::string::npos), id, os);
+        break;
+    case '~':
+        YARP_SPRINTF3(Logger::get(),
+                      debug,
+                      "Port command (%s): %s should remove input: %s",
+                      route.toString().c_str(),
+                      getOwner().getName().c_str(),
+                      cmd.getText().c_str());
+        man.removeInput(cmd.getText().substr(1, std::string::npos), id, os);
+        break;
+    case '*':
+        man.describe(id, os);
+        break;
+    case 'D':
+    case 'd': {
+        if (key == 'D') {
+            ip->suppressReply();
+        }
+        getStats().recordMessage(br.getSize());
+
+        std::string env = cmd.getText();
+        if (env.length() > 2) {
+            //YARP_ERROR(Logger::get(),
+            //"***** received an envelope! [%s]", env.c_str());
+            std::string env2 = env.substr(2, env.length());
+            man.setEnvelope(env2);
+            ip->setEnvelope(env2);
+        }
+        if (localReader != nullptr) {
+            localReader->read(br);
+            if (!br.isActive()) {
+                done = true;
+                break;
             }
-            if (localReader != nullptr) {
-                localReader->read(br);
-                if (!br.isActive()) {
-                    done = true;
-                    break;
-                }
-            } else {
-                if (ip->getReceiver().acceptIncomingData(br)) {
-                    ConnectionReader* cr = &(ip->getReceiver().modifyIncomingData(br));
-                    yarp::os::impl::PortDataModifier& modifier = getOwner().getPortModifier();
-                    modifier.inputMutex.lock();
-                    if (modifier.inputModifier != nullptr) {
-                        if (modifier.inputModifier->acceptIncomingData(*cr)) {
-                            cr = &(modifier.inputModifier->modifyIncomingData(*cr));
-                            modifier.inputMutex.unlock();
-                            man.readBlock(*cr, id, os);
-                        } else {
-                            modifier.inputMutex.unlock();
-                            skipIncomingData(*cr);
-                        }
-                    } else {
+        } else {
+            if (ip->getReceiver().acceptIncomingData(br)) {
+                ConnectionReader* cr = &(ip->getReceiver().modifyIncomingData(br));
+                yarp::os::impl::PortDataModifier& modifier = getOwner().getPortModifier();
+                modifier.inputMutex.lock();
+                if (modifier.inputModifier != nullptr) {
+                    if (modifier.inputModifier->acceptIncomingData(*cr)) {
+                        cr = &(modifier.inputModifier->modifyIncomingData(*cr));
                         modifier.inputMutex.unlock();
                         man.readBlock(*cr, id, os);
+                    } else {
+                        modifier.inputMutex.unlock();
+                        skipIncomingData(*cr);
                     }
                 } else {
-                    skipIncomingData(br);
-                }
-                if (!br.isActive()) {
-                    done = true;
-                    break;
+                    modifier.inputMutex.unlock();
+                    man.readBlock(*cr, id, os);
                 }
+            } else {
+                skipIncomingData(br);
             }
-        } break;
-        case 'a': {
-            man.adminBlock(br, id);
-        } break;
-        case 'r':
-            /*
-              In YARP implementation, OP=IP.
-              (This information is used rarely, and when used
-              is tagged with OP=IP keyword)
-              If it were not true, memory alloc would need to
-              reorganized here
-            */
-            {
-                OutputProtocol* op = &(ip->getOutput());
-                ip->endRead();
-                Route r = op->getRoute();
-                // reverse route
-                r.swapNames();
-                op->rename(r);
-
-                getOwner().addOutput(op);
-                ip = nullptr;
+            if (!br.isActive()) {
                 done = true;
+                break;
             }
-            break;
-        case 'q':
+        }
+    } break;
+    case 'a': {
+        man.adminBlock(br, id);
+    } break;
+    case 'r':
+        /*
+          In YARP implementation, OP=IP.
+          (This information is used rarely, and when used
+          is tagged with OP=IP keyword)
+          If it were not true, memory alloc would need to
+          reorganized here
+        */
+        {
+            OutputProtocol* op = &(ip->getOutput());
+            ip->endRead();
+            Route r = op->getRoute();
+            // reverse route
+            r.swapNames();
+            op->rename(r);
+
+            getOwner().addOutput(op);
+            ip = nullptr;
             done = true;
-            break;
+        }
+        break;
+    case 'q':
+        done = true;
+        break;
 #if !defined(NDEBUG)
-        case 'i':
-            printf("Interrupt requested\n");
-            //yarp::os::impl::kill(0, 2); // SIGINT
-            //yarp::os::impl::kill(Logger::get().getPid(), 2); // SIGINT
-            yarp::os::impl::kill(Logger::get().getPid(), 15); // SIGTERM
-            break;
+    case 'i':
+        printf("Interrupt requested\n");
+        //yarp::os::impl::kill(0, 2); // SIGINT
+        //yarp::os::impl::kill(Logger::get().getPid(), 2); // SIGINT
+        yarp::os::impl::kill(Logger::get().getPid(), 15); // SIGTERM
+        break;
 #endif
-        case '?':
-        case 'h':
-            if (os != nullptr) {
-                BufferedConnectionWriter bw(true);
-                bw.appendLine("This is a YARP port.  Here are the commands it responds to:");
-                bw.appendLine("*       Gives a description of this port");
-                bw.appendLine("d       Signals the beginning of input for the port's owner");
-                bw.appendLine(R"(do      The same as "d" except replies should be suppressed ("data-only"))");
-                bw.appendLine("q       Disconnects");
+    case '?':
+    case 'h':
+        if (os != nullptr) {
+            BufferedConnectionWriter bw(true);
+            bw.appendLine("This is a YARP port.  Here are the commands it responds to:");
+            bw.appendLine("*       Gives a description of this port");
+            bw.appendLine("d       Signals the beginning of input for the port's owner");
+            bw.appendLine(R"(do      The same as "d" except replies should be suppressed ("data-only"))");
+            bw.appendLine("q       Disconnects");
 #if !defined(NDEBUG)
-                bw.appendLine("i       Interrupt parent process (unix only)");
+            bw.appendLine("i       Interrupt parent process (unix only)");
 #endif
-                bw.appendLine("r       Reverse connection type to be a reader");
-                bw.appendLine("/port   Requests to send output to /port");
-                bw.appendLine("!/port  Requests to stop sending output to /port");
-                bw.appendLine("~/port  Requests to stop receiving input from /port");
-                bw.appendLine("a       Signals the beginning of an administrative message");
-                bw.appendLine("?       Gives this help");
-                bw.write(*os);
-            }
-            break;
-        default:
-            if (os != nullptr) {
-                BufferedConnectionWriter bw(true);
-                bw.appendLine("Port command not understood.");
-                bw.appendLine("Type d to send data to the port's owner.");
-                bw.appendLine("Type ? for help.");
-                bw.write(*os);
-            }
-            break;
-        }
-        if (ip != nullptr) {
-            ip->endRead();
+            bw.appendLine("r       Reverse connection type to be a reader");
+            bw.appendLine("/port   Requests to send output to /port");
+            bw.appendLine("!/port  Requests to stop sending output to /port");
+            bw.appendLine("~/port  Requests to stop receiving input from /port");
+            bw.appendLine("a       Signals the beginning of an administrative message");
+            bw.appendLine("?       Gives this help");
+            bw.write(*os);
         }
-        if (ip == nullptr) {
-            break;
-        }
-        if (closing || isDoomed() || (!ip->isOk())) {
-            break;
+        break;
+    default:
+        if (os != nullptr) {
+            BufferedConnectionWriter bw(true);
+            bw.appendLine("Port command not understood.");
+            bw.appendLine("Type d to send data to the port's owner.");
+            bw.appendLine("Type ? for help.");
+            bw.write(*os);
         }
+        break;
+    }
+    if (ip != nullptr) {
+        ip->endRead();
+    }
+    if (ip == nullptr) {
+        return false;
     }
+    if (closing || isDoomed() || (!ip->isOk())) {
+        return false;
+    }
+    return !done;
+}
+
+
+void PortCoreInputUnit::teardown()
+{
+    const Route& route = officialRoute;
 
     setDoomed();
 
@@ -521,6 +619,15 @@ void PortCoreInputUnit::closeMain()
 
     YARP_DEBUG(log, "PortCoreInputUnit closing");
 
+    if (reactorId != 0) {
+        YARP_DEBUG(log, "PortCoreInputUnit leaving the reactor");
+        PortCoreReactor::get().unwatch(reactorId, [this]() { interrupt(); });
+        reactorId = 0;
+        if (!finished && !reactorThreaded) {
+            teardown();
+        }
+    }
+
     if (running) {
         YARP_DEBUG(log, "PortCoreInputUnit joining");
         interrupt();
@@ -16,6 +16,8 @@
 #include <yarp/os/impl/PortCore.h>
 #include <yarp/os/impl/PortCoreUnit.h>
 
+#include <cstdint>
+
 namespace yarp {
 namespace os {
 namespace impl {
@@ -93,9 +95,48 @@ private:
     yarp::os::PortReader* localReader;
     Route officialRoute;
     bool reversed;
+    bool wasNoticed;
+    bool posted;
+    uint64_t reactorId;     ///< registration with the PortCoreReactor, if any
+    bool reactorSetupDone;  ///< the reactor already ran setup()
+    bool reactorThreaded;   ///< the reactor handed the connection to a thread
 
     void closeMain();
 
+    /**
+     * Open the connection and announce it.
+     * @return false if there is nothing more to read
+     */
+    bool setup();
+
+    /**
+     * Read and process a single message or port command.
+     * @return false if the connection should be shut down
+     */
+    bool step();
+
+    /**
+     * Close the connection and announce it.
+     */
+    void teardown();
+
+    /**
+     * Register the connection with the PortCoreReactor, if enabled.
+     * @return true if the connection does not need a thread
+     */
+    bool startReactor();
+
+    /**
+     * Called by the PortCoreReactor when the socket is readable.
+     * @return true if the socket should be watched again
+     */
+    bool reactorStep();
+
+    /**
+     * @return true if the carrier can be driven by the PortCoreReactor
+     */
+    bool isReactorCarrier();
+
     bool skipIncomingData(yarp::os::ConnectionReader& reader);
 
     static void envelopeReadCallback(void* data, const Bytes& envelope);
@@ -13,10 +13,13 @@
 #include <yarp/os/PortInfo.h>
 #include <yarp/os/PortReport.h>
 #include <yarp/os/Portable.h>
+#include <yarp/os/SystemClock.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PortCommand.h>
+#include <yarp/os/impl/PortCoreReactor.h>
+#include <yarp/os/impl/Protocol.h>
 
 
 #define YMSG(x) printf x;
@@ -34,15 +37,44 @@ PortCoreOutputUnit::PortCoreOutputUnit(PortCore& owner, int index, OutputProtoco
         running(false),
         threaded(false),
         sending(false),
+        reactorMode(false),
         phase(1),
         activate(0),
+        reactorIdle(1),
         trackerMutex(),
         cachedWriter(nullptr),
         cachedReader(nullptr),
         cachedCallback(nullptr),
-        cachedTracker(nullptr)
+        cachedTracker(nullptr),
+        cachedPacket(nullptr),
+        coalescing(nullptr),
+        coalesceStart(-1),
+        latest(&copies[0]),
+        cachedCopy(nullptr),
+        latestPending(false),
+        sendingLatest(false)
 {
     yAssert(op != nullptr);
+
+    // The modifiers are passed to the messages written, in the same
+    // form as the readers get them (see Protocol::getSenderSpecifier).
+    std::string carrier = op->getRoute().getCarrierName();
+    size_t start = carrier.find('+');
+    if (start != std::string::npos) {
+        modifiersKey = carrier.substr(start + 1);
+        std::string spec = "(";
+        for (char ch : modifiersKey) {
+            if (ch == '+') {
+                spec += ") (";
+            } else if (ch == '.') {
+                spec += " ";
+            } else {
+                spec += ch;
+            }
+        }
+        spec += ")";
+        modifiers.fromString(spec);
+    }
 }
 
 PortCoreOutputUnit::~PortCoreOutputUnit()
@@ -63,6 +95,18 @@ bool PortCoreOutputUnit::start()
         return true;
     }
 
+    // Kept messages are sent on a timer by our own thread, so the
+    // PortCoreReactor is not used for them.
+    if (!startCoalescing() && isReactorCarrier()) {
+        // Background writes are queued on the PortCoreReactor rather
+        // than on a thread of our own.  They run on its workers, which
+        // wait for the acknowledgement, never on its I/O threads.
+        reactorMode = true;
+        running = true;
+        phase.post();
+        return true;
+    }
+
     bool result = PortCoreUnit::start();
     if (result) {
         phase.wait();
@@ -91,24 +135,21 @@ void PortCoreOutputUnit::run()
         Logger log(r.toString().c_str(), Logger::get());
         while (!closing) {
             YARP_DEBUG(log, "PortCoreOutputUnit waiting");
-            activate.wait();
+            double start = coalesceStart;
+            if (start >= 0) {
+                // Send the kept messages once the oldest has waited enough.
+                double remaining = start + getOwner().getCoalescingDelay() - SystemClock::nowSystem();
+                if (remaining <= 0 || !activate.waitWithTimeout(remaining)) {
+                    std::lock_guard<std::mutex> lock(writeMutex);
+                    flushCoalesced();
+                    continue;
+                }
+            } else {
+                activate.wait();
+            }
             YARP_DEBUG(log, "PortCoreOutputUnit woken");
             if (!closing) {
-                if (sending) {
-                    YARP_DEBUG(log, "write something in background");
-                    sendHelper();
-                    YARP_DEBUG(log, "wrote something in background");
-                    trackerMutex.lock();
-                    if (cachedTracker != nullptr) {
-                        void* t = cachedTracker;
-                        cachedTracker = nullptr;
-                        sending = false;
-                        getOwner().notifyCompletion(t);
-                    } else {
-                        sending = false;
-                    }
-                    trackerMutex.unlock();
-                }
+                sendInBackground();
             }
             YARP_DEBUG(log, "wrote something in background");
         }
@@ -119,6 +160,183 @@ void PortCoreOutputUnit::run()
 }
 
 
+void PortCoreOutputUnit::sendInBackground()
+{
+    trackerMutex.lock();
+    bool more = sendingLatest;
+    trackerMutex.unlock();
+    if (sending && !more) {
+        YARP_DEBUG(Logger::get(), "write something in background");
+        sendHelper();
+        YARP_DEBUG(Logger::get(), "wrote something in background");
+        trackerMutex.lock();
+        more = finishSending();
+        if (cachedTracker != nullptr) {
+            void* t = cachedTracker;
+            cachedTracker = nullptr;
+            getOwner().notifyCompletion(t);
+        }
+        trackerMutex.unlock();
+    }
+    if (more) {
+        sendLatest();
+    }
+}
+
+
+bool PortCoreOutputUnit::finishSending()
+{
+    sendingLatest = latestPending && !closing;
+    sending = sendingLatest;
+    return sendingLatest;
+}
+
+
+bool PortCoreOutputUnit::keepLatest(const yarp::os::PortWriter& writer,
+                                    yarp::os::PortReader* reader,
+                                    void* tracker,
+                                    const std::string& envelopeString,
+                                    bool waitAfter)
+{
+    if (getSendPriority() != lowPriority || waitAfter || reader != nullptr || tracker == nullptr) {
+        return false;
+    }
+    if (op->getConnection().isLocal() || op->getSender().modifiesOutgoingData()) {
+        return false;
+    }
+    auto* packet = static_cast<PortCorePacket*>(tracker);
+    if (packet->getContent() != &writer) {
+        return false;
+    }
+    bool shared = false;
+    BufferedConnectionWriter* encoding = packet->getEncoding(op->getConnection().isTextMode(),
+                                                             op->getConnection().isBareMode(),
+                                                             modifiersKey,
+                                                             modifiers,
+                                                             shared);
+    if (encoding == nullptr) {
+        return false;
+    }
+    getOwner().reportEncoding(shared, encoding->dataSize());
+
+    trackerMutex.lock();
+    if (latestPending) {
+        // replaced before it was sent
+        getStats().recordDrop();
+    }
+    latest->restart();
+    for (size_t i = 0; i < encoding->length(); i++) {
+        latest->appendBlockCopy(Bytes(const_cast<char*>(encoding->data(i)), encoding->length(i)));
+    }
+    latestEnvelope = envelopeString;
+    latestPending = true;
+    bool idle = !sending;
+    if (idle) {
+        sending = true;
+        sendingLatest = true;
+    }
+    trackerMutex.unlock();
+
+    if (idle) {
+        // Nothing is being sent, so there is no tracker held either.
+        startBackground(nullptr);
+    }
+    return true;
+}
+
+
+void PortCoreOutputUnit::sendLatest()
+{
+    std::unique_lock<std::mutex> lock(trackerMutex);
+    while (latestPending && !closing) {
+        cachedCopy = latest;
+        latest = (latest == &copies[0]) ? &copies[1] : &copies[0];
+        latestPending = false;
+        cachedWriter = nullptr;
+        cachedReader = nullptr;
+        cachedCallback = nullptr;
+        cachedPacket = nullptr;
+        cachedEnvelope = latestEnvelope;
+        lock.unlock();
+        sendHelper();
+        lock.lock();
+        cachedCopy = nullptr;
+    }
+    latestPending = false;
+    sendingLatest = false;
+    sending = false;
+}
+
+
+void* PortCoreOutputUnit::startBackground(void* tracker)
+{
+    if (reactorMode) {
+        reactorIdle.wait();
+    }
+    trackerMutex.lock();
+    void* nextTracker = tracker;
+    tracker = cachedTracker;
+    cachedTracker = nextTracker;
+    if (!reactorMode) {
+        activate.post();
+    }
+    trackerMutex.unlock();
+    if (reactorMode) {
+        bool queued = PortCoreReactor::get().post([this]() {
+            if (!closing) {
+                sendInBackground();
+            }
+            reactorIdle.post();
+        });
+        if (!queued) {
+            sendInBackground();
+            reactorIdle.post();
+        }
+    }
+    return tracker;
+}
+
+
+bool PortCoreOutputUnit::isReactorCarrier()
+{
+    if (op == nullptr || !PortCoreReactor::isEnabled()) {
+        return false;
+    }
+    std::string carrier = op->getRoute().getCarrierName();
+    return carrier == "tcp" || carrier == "fast_tcp";
+}
+
+
+bool PortCoreOutputUnit::startCoalescing()
+{
+    if (op == nullptr || getOwner().getCoalescingDelay() <= 0) {
+        return false;
+    }
+    std::string carrier = op->getRoute().getCarrierName();
+    if (carrier != "tcp" && carrier != "fast_tcp") {
+        return false;
+    }
+    auto* protocol = dynamic_cast<Protocol*>(op);
+    if (protocol == nullptr || !protocol->setCoalescing(getOwner().getCoalescingSize())) {
+        return false;
+    }
+    coalescing = protocol;
+    return true;
+}
+
+
+void PortCoreOutputUnit::flushCoalesced()
+{
+    int messages = coalescing->getCoalescedMessages();
+    if (messages == 0) {
+        return;
+    }
+    coalescing->flushCoalesced();
+    getOwner().reportCoalescing(messages, SystemClock::nowSystem() - coalesceStart);
+    coalesceStart = -1;
+}
+
+
 void PortCoreOutputUnit::runSingleThreaded()
 {
     if (op != nullptr) {
@@ -211,6 +429,7 @@ void PortCoreOutputUnit::closeBasic()
                 is.read(dummy.bytes());
             }
         }
+        coalescing = nullptr;
         op->close();
         delete op;
         op = nullptr;
@@ -226,6 +445,26 @@ void PortCoreOutputUnit::closeMain()
     YARP_DEBUG(Logger::get(), "PortCoreOutputUnit closing");
 
     if (running) {
+        // Send what this connection still keeps before it is interrupted.
+        // The latest message of a low priority connection is sent here
+        // if no background write is going to take it (a write in
+        // progress is interrupted, with what it would send next).
+        trackerMutex.lock();
+        bool idle = !sending;
+        if (idle && latestPending) {
+            sending = true;
+            sendingLatest = true;
+        }
+        trackerMutex.unlock();
+        if (idle && sendingLatest) {
+            sendLatest();
+        }
+        if (coalescing != nullptr) {
+            // Waits for a write in progress, which may keep more messages.
+            std::lock_guard<std::mutex> lock(writeMutex);
+            flushCoalesced();
+        }
+
         // give a kick (unfortunately unavoidable)
 
         if (op != nullptr) {
@@ -233,9 +472,15 @@ void PortCoreOutputUnit::closeMain()
         }
 
         closing = true;
-        phase.post();
-        activate.post();
-        join();
+        if (reactorMode) {
+            // wait for any write queued on the reactor
+            reactorIdle.wait();
+            reactorIdle.post();
+        } else {
+            phase.post();
+            activate.post();
+            join();
+        }
     }
 
     YARP_DEBUG(Logger::get(), "PortCoreOutputUnit internal join");
@@ -266,6 +511,7 @@ bool PortCoreOutputUnit::sendHelper()
         bool done = false;
         BufferedConnectionWriter buf(op->getConnection().isTextMode(),
                                      op->getConnection().isBareMode());
+        buf.setConnectionModifiers(&modifiers);
         if (cachedReader != nullptr) {
             buf.setReplyHandler(*cachedReader);
         }
@@ -291,8 +537,8 @@ bool PortCoreOutputUnit::sendHelper()
             }
             buf.setReference(p);
         } else {
-            yAssert(cachedWriter != nullptr);
-            bool ok = cachedWriter->write(buf);
+            yAssert(cachedWriter != nullptr || cachedCopy != nullptr);
+            bool ok = writeContent(buf);
             if (!ok) {
                 done = true;
             }
@@ -325,7 +571,25 @@ bool PortCoreOutputUnit::sendHelper()
 
         if (!done) {
             if (op->getConnection().isActive()) {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                if (coalescing != nullptr) {
+                    // Replies and big messages do not wait, and neither
+                    // do the messages kept before them.
+                    if (buf.getReplyHandler() != nullptr || coalescing->getCoalesced() + buf.dataSize() > getOwner().getCoalescingSize()) {
+                        flushCoalesced();
+                    }
+                }
+                double writeStart = SystemClock::nowSystem();
                 replied = op->write(buf);
+                getStats().recordSendTime(SystemClock::nowSystem() - writeStart);
+                getStats().recordMessage(buf.dataSize());
+                if (coalescing != nullptr) {
+                    if (coalescing->getCoalescedMessages() == 0) {
+                        coalesceStart = -1;
+                    } else if (coalesceStart < 0) {
+                        coalesceStart = SystemClock::nowSystem();
+                    }
+                }
                 if (replied && op->getSender().modifiesReply() && cachedReader != nullptr) {
                     cachedReader = &op->getSender().modifyReply(*cachedReader);
                 }
@@ -350,6 +614,47 @@ bool PortCoreOutputUnit::sendHelper()
     return replied;
 }
 
+bool PortCoreOutputUnit::writeContent(BufferedConnectionWriter& buf)
+{
+    if (cachedCopy != nullptr) {
+        // A copy of our own, that stays until the write is done.
+        for (size_t i = 0; i < cachedCopy->length(); i++) {
+            buf.appendExternalBlock(cachedCopy->data(i), cachedCopy->length(i));
+        }
+        return true;
+    }
+
+    // The cached serialization can be used only if the message was
+    // not replaced by a port monitor for this connection.
+    if (cachedPacket == nullptr || cachedPacket->getContent() != cachedWriter) {
+        return cachedWriter->write(buf);
+    }
+
+    bool shared = false;
+    BufferedConnectionWriter* encoding = cachedPacket->getEncoding(buf.isTextMode(),
+                                                                   buf.isBareMode(),
+                                                                   modifiersKey,
+                                                                   modifiers,
+                                                                   shared);
+    if (encoding == nullptr) {
+        return false;
+    }
+    getOwner().reportEncoding(shared, encoding->dataSize());
+
+    // The encoding belongs to the packet, which is not recycled until
+    // this connection is done with it, so its blocks are not copied.
+    for (size_t i = 0; i < encoding->length(); i++) {
+        buf.appendExternalBlock(encoding->data(i), encoding->length(i));
+    }
+    if (buf.getReplyHandler() == nullptr && encoding->getReplyHandler() != nullptr) {
+        buf.setReplyHandler(*encoding->getReplyHandler());
+    }
+    if (encoding->dropRequested()) {
+        buf.requestDrop();
+    }
+    return true;
+}
+
 void* PortCoreOutputUnit::send(const yarp::os::PortWriter& writer,
                                yarp::os::PortReader* reader,
                                const yarp::os::PortWriter* callback,
@@ -380,7 +685,12 @@ void* PortCoreOutputUnit::send(const yarp::os::PortWriter& writer,
     if ((!waitBefore) && waitAfter) {
         YARP_ERROR(Logger::get(), "chosen port wait combination not yet implemented");
     }
+    if (keepLatest(writer, reader, tracker, envelopeString, waitAfter)) {
+        // The message is not needed anymore.
+        return tracker;
+    }
     if (!sending) {
+        cachedPacket = static_cast<PortCorePacket*>(tracker);
         cachedWriter = &writer;
         cachedReader = reader;
         cachedCallback = callback;
@@ -389,18 +699,24 @@ void* PortCoreOutputUnit::send(const yarp::os::PortWriter& writer,
         sending = true;
         if (waitAfter) {
             replied = sendHelper();
-            sending = false;
-        } else {
+            if (coalescing != nullptr) {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                flushCoalesced();
+            }
             trackerMutex.lock();
-            void* nextTracker = tracker;
-            tracker = cachedTracker;
-            cachedTracker = nextTracker;
-            activate.post();
+            bool more = finishSending();
             trackerMutex.unlock();
+            if (more) {
+                // a latest message came in the meantime
+                startBackground(nullptr);
+            }
+        } else {
+            tracker = startBackground(tracker);
         }
     } else {
         YARP_DEBUG(Logger::get(),
                    "skipping connection tagged as sending something");
+        getStats().recordDrop();
     }
 
     if (waitAfter) {
@@ -428,7 +744,8 @@ void* PortCoreOutputUnit::takeTracker()
 
 bool PortCoreOutputUnit::isBusy()
 {
-    return sending;
+    // A copy of the latest message does not hold the message back.
+    return (sending && !sendingLatest) || coalesceStart >= 0;
 }
 
 void PortCoreOutputUnit::setCarrierParams(const yarp::os::Property& params)
@@ -10,17 +10,21 @@
 #ifndef YARP_OS_IMPL_PORTCOREOUTPUTUNIT_H
 #define YARP_OS_IMPL_PORTCOREOUTPUTUNIT_H
 
+#include <yarp/os/Bottle.h>
 #include <yarp/os/OutputProtocol.h>
 #include <yarp/os/Semaphore.h>
 #include <yarp/os/impl/PortCore.h>
 #include <yarp/os/impl/PortCoreUnit.h>
 
+#include <atomic>
 #include <mutex>
 
 namespace yarp {
 namespace os {
 namespace impl {
 
+class Protocol;
+
 /**
  * Manager for a single output from a port.  Associated
  * with a PortCore object.
@@ -113,21 +117,100 @@ private:
     bool running;       ///< is a thread running
     bool threaded;      ///< do we need a thread for background writing
     bool sending;       ///< are we sending something right now
+    bool reactorMode;   ///< are background writes run by the PortCoreReactor
     yarp::os::Semaphore phase;        ///< let main thread kick sending thread
     yarp::os::Semaphore activate;     ///< signal when we have a new tracker
+    yarp::os::Semaphore reactorIdle;  ///< no write queued on the reactor
     std::mutex trackerMutex; ///< protect the tracker during outside access
     const yarp::os::PortWriter* cachedWriter;   ///< the message the send
     yarp::os::PortReader *cachedReader;   ///< where to put a reply
     const yarp::os::PortWriter* cachedCallback; ///< where to sent commencement and
                                           ///< completion events
     void *cachedTracker;        ///< memory tracker for current message
+    PortCorePacket* cachedPacket; ///< packet tracking the current message, if any
     std::string cachedEnvelope;      ///< some text to pass along with the message
+    Protocol* coalescing;       ///< the protocol keeping small messages, if any
+    std::atomic<double> coalesceStart; ///< when the oldest kept message was written (-1 = none)
+    std::mutex writeMutex;      ///< serialize writes and flushes of kept messages
+    BufferedConnectionWriter copies[2]; ///< the latest message and the one being sent, on a low priority connection
+    BufferedConnectionWriter* latest;   ///< copy of the latest message
+    BufferedConnectionWriter* cachedCopy; ///< copy being sent, if any
+    std::string latestEnvelope; ///< envelope of the latest message
+    bool latestPending;         ///< the latest message is waiting to be sent
+    bool sendingLatest;         ///< sending copies of the latest messages
+    std::string modifiersKey;   ///< the modifiers in the carrier name, e.g. "codec.jpeg+quality.80"
+    yarp::os::Bottle modifiers; ///< the same modifiers, e.g. "(codec jpeg) (quality 80)"
 
     /**
      * The core logic for sending a message.
      */
     bool sendHelper();
 
+    /**
+     * Serialize the cached message into a buffer, sharing the
+     * serialization with other connections using the same encoding
+     * whenever the message is not modified on this connection.
+     * @param buf the buffer for this connection
+     * @return true if the message was written correctly
+     */
+    bool writeContent(BufferedConnectionWriter& buf);
+
+    /**
+     * Send the cached message, then release its tracker.
+     */
+    void sendInBackground();
+
+    /**
+     * On a low priority connection, keep a copy of a message to send it
+     * in background, so that the message can be reused as soon as the
+     * other connections are done with it.  If the previous message is
+     * still waiting to be sent, it is replaced.
+     * @return true if the message was taken care of
+     */
+    bool keepLatest(const yarp::os::PortWriter& writer,
+                    yarp::os::PortReader* reader,
+                    void* tracker,
+                    const std::string& envelopeString,
+                    bool waitAfter);
+
+    /**
+     * Send the copies of the latest messages, until there is none left.
+     */
+    void sendLatest();
+
+    /**
+     * Called with trackerMutex locked when a message has been sent.
+     * @return true if the copy of a latest message is still to be sent
+     */
+    bool finishSending();
+
+    /**
+     * Wake up the thread, or the PortCoreReactor, to send the cached
+     * message.
+     * @param tracker the tracker of the message, kept until it is sent
+     * @return the tracker of the previous message
+     */
+    void* startBackground(void* tracker);
+
+    /**
+     * @return true if background writes can be run by the PortCoreReactor
+     */
+    bool isReactorCarrier();
+
+    /**
+     * Let the protocol keep small messages, to send several of them at
+     * once, if the port asks for it (YARP_PORTCORE_COALESCE) and the
+     * carrier allows it.
+     * @return true if messages are coalesced on this connection
+     */
+    bool startCoalescing();
+
+    /**
+     * Send the messages kept by the protocol.  Called with writeMutex
+     * locked.
+     */
+    void flushCoalesced();
+
     /**
      * Try to close the connection, but not very hard.
      */
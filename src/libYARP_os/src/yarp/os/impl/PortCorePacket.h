@@ -12,6 +12,12 @@
 
 #include <yarp/os/NetType.h>
 #include <yarp/os/PortWriter.h>
+#include <yarp/os/impl/BufferedConnectionWriter.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace yarp {
 namespace os {
@@ -24,27 +30,43 @@ namespace impl {
 class PortCorePacket
 {
 public:
-    PortCorePacket* prev_;                ///< this packet will be in a list of active packets
-    PortCorePacket* next_;                ///< this packet will be in a list of active packets
     const yarp::os::PortWriter* content;  ///< the object being sent
     const yarp::os::PortWriter* callback; ///< where to send event notifications
-    int ct;                               ///< number of uses of the messagae
+    std::atomic<int> ct;                  ///< number of uses of the messagae
     bool owned;                           ///< should we memory-manage the content object
     bool ownedCallback;                   ///< should we memory-manage the callback object
     bool completed;                       ///< has a notification of completion been sent
+    bool pooled;                          ///< was this packet preallocated by PortCorePackets
+
+    /**
+     * The content serialized for one kind of connection.
+     */
+    struct Encoding
+    {
+        BufferedConnectionWriter* writer {nullptr}; ///< the serialized content, kept for reuse
+        bool ready {false};                         ///< has the content been serialized
+        bool ok {false};                            ///< did the content write itself correctly
+        bool textMode {false};                      ///< the connection is in text mode
+        bool bareMode {false};                      ///< the connection is in bare mode
+        std::string modifiers;                      ///< the modifiers of the connection, if any
+    };
+
+    static constexpr size_t encodingCount = 4; ///< binary, text, bare binary, bare text
+    std::mutex encodingMutex;                  ///< control access to the encodings
+    Encoding encodings[encodingCount];         ///< the content serialized once per encoding
+    std::vector<Encoding> modifiedEncodings;   ///< the encodings for connections with modifiers
 
     /**
      * Constructor.
      */
     PortCorePacket() :
-            prev_(nullptr),
-            next_(nullptr),
             content(nullptr),
             callback(nullptr),
             ct(0),
             owned(false),
             ownedCallback(false),
-            completed(false)
+            completed(false),
+            pooled(false)
     {
         reset();
     }
@@ -56,6 +78,12 @@ public:
     {
         complete();
         reset();
+        for (auto& encoding : encodings) {
+            delete encoding.writer;
+        }
+        for (auto& encoding : modifiedEncodings) {
+            delete encoding.writer;
+        }
     }
 
     /**
@@ -63,7 +91,7 @@ public:
      */
     int getCount()
     {
-        return ct;
+        return ct.load();
     }
 
     /**
@@ -71,15 +99,17 @@ public:
      */
     void inc()
     {
-        ct++;
+        ct.fetch_add(1);
     }
 
     /**
      * Decrement the usage count for this messagae.
+     *
+     * @return the number of users left
      */
-    void dec()
+    int dec()
     {
-        ct--;
+        return ct.fetch_sub(1) - 1;
     }
 
     /**
@@ -113,7 +143,7 @@ public:
     {
         content = writable;
         this->callback = callback;
-        ct = 1;
+        ct.store(1);
         this->owned = owned;
         this->ownedCallback = ownedCallback;
         completed = false;
@@ -132,10 +162,84 @@ public:
         }
         content = nullptr;
         callback = nullptr;
-        ct = 0;
+        ct.store(0);
         owned = false;
         ownedCallback = false;
         completed = false;
+        for (auto& encoding : encodings) {
+            encoding.ready = false;
+        }
+        for (auto& encoding : modifiedEncodings) {
+            encoding.ready = false;
+        }
+    }
+
+    /**
+     * Get the content serialized for a connection with the given modes.
+     * The content is serialized on the first request, and then shared
+     * read-only by all the connections using the same modes, so that a
+     * message sent on many connections is serialized once per encoding
+     * rather than once per connection.
+     *
+     * The connections with modifiers (e.g. `tcp+codec.jpeg`) get
+     * encodings of their own, since the content can serialize itself
+     * differently for them, and share them with the connections with
+     * the same modifiers.
+     *
+     * @param textMode the connection is in text mode
+     * @param bareMode the connection is in bare mode
+     * @param modifiersKey the modifiers as written in the carrier name,
+     * empty if there are none
+     * @param modifiers the modifiers, passed to the content through
+     * ConnectionWriter::getConnectionModifiers()
+     * @param[out] shared set to true if the content was already serialized
+     * @return the serialized content, or nullptr if the content failed
+     * to write itself
+     */
+    BufferedConnectionWriter* getEncoding(bool textMode,
+                                          bool bareMode,
+                                          const std::string& modifiersKey,
+                                          const yarp::os::Searchable& modifiers,
+                                          bool& shared)
+    {
+        std::lock_guard<std::mutex> lock(encodingMutex);
+        Encoding* encoding = nullptr;
+        if (modifiersKey.empty()) {
+            encoding = &encodings[(textMode ? 1 : 0) + (bareMode ? 2 : 0)];
+        } else {
+            for (auto& candidate : modifiedEncodings) {
+                if (candidate.textMode == textMode && candidate.bareMode == bareMode && candidate.modifiers == modifiersKey) {
+                    encoding = &candidate;
+                    break;
+                }
+            }
+            if (encoding == nullptr) {
+                modifiedEncodings.emplace_back();
+                encoding = &modifiedEncodings.back();
+                encoding->textMode = textMode;
+                encoding->bareMode = bareMode;
+                encoding->modifiers = modifiersKey;
+            }
+        }
+        shared = encoding->ready;
+        if (!encoding->ready) {
+            if (encoding->writer != nullptr && encoding->writer->dropRequested()) {
+                // There is no way to clear the request, start afresh.
+                delete encoding->writer;
+                encoding->writer = nullptr;
+            }
+            if (encoding->writer == nullptr) {
+                encoding->writer = new BufferedConnectionWriter(textMode, bareMode);
+            } else {
+                encoding->writer->restart();
+            }
+            encoding->writer->setConnectionModifiers(&modifiers);
+            encoding->ok = (content != nullptr) && content->write(*encoding->writer);
+            encoding->writer->setConnectionModifiers(nullptr);
+            encoding->writer->stopWrite();
+            encoding->ready = true;
+        }
+        return encoding->ok ? encoding->writer : nullptr;
     }
 
     /**
@@ -12,43 +12,83 @@
 
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PortCorePacket.h>
-#ifdef YARP_HAS_ACE
-#    include <ace/String_Base.h>
-#    include <ace/config.h>
-// In one the ACE headers there is a definition of "main" for WIN32
-#    ifdef main
-#        undef main
-#    endif
-#endif
+
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
-#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace yarp {
 namespace os {
 namespace impl {
 
 /**
+ * A pool of PortCorePacket objects, tracking messages currently being
+ * sent.
  *
- * A collection of messages being transmitted over connections.
- * This tracks uses of the messages for memory management purposes.
- * We call messages "packets" for no particular reason.
- *
+ * A fixed number of packets is preallocated, and free packets are kept
+ * in a bounded lock-free ring, so that getting and releasing a packet
+ * never allocates nor takes a lock.  If all the preallocated packets
+ * are in use, extra packets are allocated (and kept for reuse) under a
+ * mutex, and the event is counted as an exhaustion of the pool.
  */
 class PortCorePackets
 {
-private:
-    std::list<PortCorePacket*> inactive; // unused packets we may reuse
-    std::list<PortCorePacket*> active;   // a list of packets being sent
 public:
-    virtual ~PortCorePackets()
+    /**
+     * Statistics about the use of the pool.
+     */
+    struct Stats
     {
-        while (!inactive.empty()) {
-            delete inactive.back();
-            inactive.pop_back();
+        size_t capacity {0};     ///< number of preallocated packets
+        size_t active {0};       ///< packets currently being sent
+        size_t highWater {0};    ///< maximum number of packets in use at the same time
+        uint64_t acquired {0};   ///< total number of packets handed out
+        uint64_t exhausted {0};  ///< times the preallocated packets were not enough
+        size_t overflow {0};     ///< extra packets allocated beyond the capacity
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param capacity number of packets to preallocate
+     */
+    explicit PortCorePackets(size_t capacity = 16) :
+            pool(new PortCorePacket[capacity > 0 ? capacity : 1]),
+            poolSize(capacity > 0 ? capacity : 1),
+            mask(0),
+            enqueuePos(0),
+            dequeuePos(0),
+            active(0),
+            highWater(0),
+            acquired(0),
+            exhausted(0)
+    {
+        size_t ringSize = 1;
+        while (ringSize < poolSize) {
+            ringSize <<= 1;
+        }
+        mask = ringSize - 1;
+        ring.reset(new Cell[ringSize]);
+        for (size_t i = 0; i < ringSize; i++) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+            ring[i].packet = nullptr;
         }
-        while (!active.empty()) {
-            delete active.back();
-            active.pop_back();
+        for (size_t i = 0; i < poolSize; i++) {
+            pool[i].pooled = true;
+            push(&pool[i]);
+        }
+    }
+
+    PortCorePackets(const PortCorePackets&) = delete;
+    PortCorePackets& operator=(const PortCorePackets&) = delete;
+
+    virtual ~PortCorePackets()
+    {
+        for (auto* packet : overflowPackets) {
+            delete packet;
         }
     }
 
@@ -57,7 +97,7 @@ public:
      */
     int getCount()
     {
-        return (int)active.size();
+        return static_cast<int>(active.load(std::memory_order_relaxed));
     }
 
     /**
@@ -69,23 +109,24 @@ public:
      */
     PortCorePacket* getFreePacket()
     {
-        if (inactive.empty()) {
-            PortCorePacket* obj = nullptr;
-            obj = new PortCorePacket();
-            yAssert(obj != nullptr);
-            inactive.push_back(obj);
-        }
-        PortCorePacket* next = inactive.front();
+        PortCorePacket* next = pop();
         if (next == nullptr) {
-            fprintf(stderr, "*** YARP consistency check failed.\n");
-            fprintf(stderr, "*** There has been a low-level failure in \"PortCorePackets\".\n");
-            fprintf(stderr, "*** This typically occurs when ports are accessed in a non-threadsafe way.\n");
-            fprintf(stderr, "*** For help: https://github.com/robotology/yarp/issues/new\n");
-            yAssert(1 == 0);
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            exhausted++;
+            if (!overflowFree.empty()) {
+                next = overflowFree.back();
+                overflowFree.pop_back();
+            } else {
+                next = new PortCorePacket();
+                yAssert(next != nullptr);
+                overflowPackets.push_back(next);
+            }
+        }
+        acquired.fetch_add(1, std::memory_order_relaxed);
+        size_t now = active.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t high = highWater.load(std::memory_order_relaxed);
+        while (now > high && !highWater.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
         }
-        yAssert(next != nullptr);
-        inactive.remove(next);
-        active.push_back(next);
         return next;
     }
 
@@ -102,8 +143,13 @@ public:
                 packet->reset();
             }
             packet->completed = true;
-            active.remove(packet);
-            inactive.push_back(packet);
+            active.fetch_sub(1, std::memory_order_relaxed);
+            if (packet->pooled) {
+                push(packet);
+            } else {
+                std::lock_guard<std::mutex> lock(overflowMutex);
+                overflowFree.push_back(packet);
+            }
         }
     }
 
@@ -141,8 +187,115 @@ public:
         }
         return false;
     }
-};
 
+    /**
+     * Drop one use of a packet, and move it to the inactive state if
+     * this was the last one.  Unlike a dec() followed by checkPacket(),
+     * this is safe to call concurrently from several threads without
+     * an external lock: only the thread dropping the last use
+     * completes and frees the packet.
+     * @param packet the packet to work on
+     * @return true if the packet was made inactive
+     */
+    bool releasePacket(PortCorePacket* packet)
+    {
+        if (packet != nullptr) {
+            if (packet->dec() <= 0) {
+                packet->complete();
+                freePacket(packet);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @return statistics about the use of the pool.
+     */
+    Stats getStats()
+    {
+        Stats stats;
+        stats.capacity = poolSize;
+        stats.active = active.load(std::memory_order_relaxed);
+        stats.highWater = highWater.load(std::memory_order_relaxed);
+        stats.acquired = acquired.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        stats.exhausted = exhausted;
+        stats.overflow = overflowPackets.size();
+        return stats;
+    }
+
+private:
+    // A cell of the bounded multi-producer multi-consumer ring (see
+    // D. Vyukov, "Bounded MPMC queue").  The sequence number tells
+    // whether the cell is ready to be written or read at a given
+    // position.
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        PortCorePacket* packet;
+    };
+
+    void push(PortCorePacket* packet)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = ring[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.packet = packet;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else {
+                // The ring holds at most poolSize packets, and it
+                // has at least as many cells, so it is never full.
+                yAssert(diff > 0);
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    PortCorePacket* pop()
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = ring[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    PortCorePacket* packet = cell.packet;
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return packet;
+                }
+            } else if (diff < 0) {
+                // empty
+                return nullptr;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::unique_ptr<PortCorePacket[]> pool; ///< preallocated packets
+    size_t poolSize;                        ///< number of preallocated packets
+    std::unique_ptr<Cell[]> ring;           ///< free preallocated packets
+    size_t mask;                            ///< ring size - 1
+    std::atomic<size_t> enqueuePos;
+    std::atomic<size_t> dequeuePos;
+
+    std::atomic<size_t> active;
+    std::atomic<size_t> highWater;
+    std::atomic<uint64_t> acquired;
+
+    std::mutex overflowMutex;                      ///< protects the fields below
+    std::vector<PortCorePacket*> overflowPackets;  ///< packets allocated beyond the capacity
+    std::vector<PortCorePacket*> overflowFree;     ///< free packets allocated beyond the capacity
+    uint64_t exhausted;
+};
 
 } // namespace impl
 } // namespace os
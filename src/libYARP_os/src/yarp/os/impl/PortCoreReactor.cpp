@@ -0,0 +1,492 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/os/impl/PortCoreReactor.h>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/SystemClock.h>
+#include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/ThreadImpl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#if defined(__linux__)
+#    include <sys/epoll.h>
+#    include <sys/eventfd.h>
+#    include <unistd.h>
+#    include <cerrno>
+#    define YARP_PORTCORE_REACTOR_AVAILABLE
+#endif
+
+using yarp::os::impl::PortCoreReactor;
+using yarp::os::impl::PortCoreReactorThread;
+using yarp::os::impl::Logger;
+using yarp::os::SystemClock;
+
+namespace {
+// epoll user data reserved for the wakeup event used by post()
+constexpr uint64_t wakeupId = 0;
+constexpr int maxEvents = 16;
+constexpr size_t maxThreads = 64;
+// time an extra worker waits for a task before it exits
+constexpr double defaultIdleTimeout = 10.0;
+} // namespace
+
+class yarp::os::impl::PortCoreReactorThread :
+        public yarp::os::impl::ThreadImpl
+{
+public:
+    PortCoreReactorThread(PortCoreReactor& owner, bool worker) :
+            owner(owner),
+            worker(worker)
+    {
+    }
+
+    void run() override
+    {
+        if (worker) {
+            owner.runWorker(this);
+        } else {
+            owner.runIoThread();
+        }
+    }
+
+private:
+    PortCoreReactor& owner;
+    bool worker;
+};
+
+
+PortCoreReactor::PortCoreReactor() :
+        m_epollFd(-1),
+        m_wakeFd(-1),
+        m_closing(false),
+        m_nextId(1),
+        m_idleWorkers(0),
+        m_startingWorkers(0),
+        m_idleTimeout(defaultIdleTimeout),
+        m_readWakeups(0),
+        m_taskCount(0),
+        m_latencySum(0.0),
+        m_latencyMax(0.0)
+{
+    std::string env = yarp::os::NetworkBase::getEnvironment("YARP_PORTCORE_REACTOR");
+    if (!env.empty()) {
+        int threads = std::atoi(env.c_str());
+        if (threads > 0) {
+            open(static_cast<size_t>(threads));
+        }
+    }
+}
+
+PortCoreReactor::~PortCoreReactor()
+{
+    close();
+}
+
+PortCoreReactor& PortCoreReactor::get()
+{
+    // Never destroyed: at exit the I/O threads may still be blocked in
+    // a handler, and joining them during static destruction would hang.
+    static auto* reactor = new PortCoreReactor;
+    return *reactor;
+}
+
+bool PortCoreReactor::isEnabled()
+{
+    return !get().m_threads.empty();
+}
+
+bool PortCoreReactor::open(size_t threads)
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    if (threads > maxThreads) {
+        threads = maxThreads;
+    }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        YARP_ERROR(Logger::get(), "PortCoreReactor: cannot create epoll instance, using one thread per connection");
+        return false;
+    }
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        ::close(m_epollFd);
+        m_epollFd = -1;
+        YARP_ERROR(Logger::get(), "PortCoreReactor: cannot create eventfd, using one thread per connection");
+        return false;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = wakeupId;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+
+    for (size_t i = 0; i < threads; i++) {
+        auto* thread = new PortCoreReactorThread(*this, false);
+        if (!thread->start()) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+    YARP_SPRINTF1(Logger::get(), debug, "PortCoreReactor: started with %d I/O threads", static_cast<int>(m_threads.size()));
+    return !m_threads.empty();
+#else
+    YARP_UNUSED(threads);
+    YARP_WARNING(Logger::get(), "PortCoreReactor: YARP_PORTCORE_REACTOR is not supported on this platform, using one thread per connection");
+    return false;
+#endif
+}
+
+void PortCoreReactor::close()
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    if (m_threads.empty()) {
+        return;
+    }
+    m_mutex.lock();
+    m_closing = true;
+    m_mutex.unlock();
+    m_work.notify_all();
+    uint64_t one = 1;
+    if (::write(m_wakeFd, &one, sizeof(one)) < 0) {
+        YARP_DEBUG(Logger::get(), "PortCoreReactor: cannot wake up I/O threads");
+    }
+    for (auto* thread : m_threads) {
+        thread->join();
+        delete thread;
+    }
+    // No worker is started once m_closing is set, and the workers run
+    // the tasks already queued before they exit.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::vector<PortCoreReactorThread*> workers;
+    workers.swap(m_workers);
+    lock.unlock();
+    for (auto* thread : workers) {
+        thread->join();
+        delete thread;
+    }
+    lock.lock();
+    joinRetiredWorkers(lock);
+    // (the workers compare their number with the number of I/O threads)
+    m_threads.clear();
+    m_closing = false;
+    lock.unlock();
+    ::close(m_wakeFd);
+    ::close(m_epollFd);
+    m_wakeFd = -1;
+    m_epollFd = -1;
+#endif
+}
+
+bool PortCoreReactor::restart(size_t threads)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_watches.empty()) {
+            return false;
+        }
+    }
+    close();
+    if (threads == 0) {
+        return true;
+    }
+    return open(threads);
+}
+
+void PortCoreReactor::setIdleTimeout(double seconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idleTimeout = seconds;
+}
+
+uint64_t PortCoreReactor::watch(int fd, ReadHandler handler)
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    if (m_threads.empty() || fd < 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t id = m_nextId++;
+    m_watches[id] = Watch{fd, std::move(handler), false, false};
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.u64 = id;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        m_watches.erase(id);
+        return 0;
+    }
+    return id;
+#else
+    YARP_UNUSED(fd);
+    YARP_UNUSED(handler);
+    return 0;
+#endif
+}
+
+void PortCoreReactor::unwatch(uint64_t id, const Task& interruptHandler)
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_watches.find(id);
+    if (it == m_watches.end()) {
+        return;
+    }
+    if (!it->second.busy) {
+        // The socket is armed, and its owner did not close it yet.
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        m_watches.erase(it);
+        return;
+    }
+    it->second.removed = true;
+    if (interruptHandler) {
+        lock.unlock();
+        interruptHandler();
+        lock.lock();
+    }
+    m_idle.wait(lock, [&]() { return m_watches.find(id) == m_watches.end(); });
+#else
+    YARP_UNUSED(id);
+    YARP_UNUSED(interruptHandler);
+#endif
+}
+
+bool PortCoreReactor::post(Task task)
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    if (m_threads.empty()) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_closing) {
+        return false;
+    }
+    queue(lock, QueuedTask{std::move(task), SystemClock::nowSystem(), false});
+    return true;
+#else
+    YARP_UNUSED(task);
+    return false;
+#endif
+}
+
+void PortCoreReactor::rearm(int fd, uint64_t id)
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.u64 = id;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &ev);
+#else
+    YARP_UNUSED(fd);
+    YARP_UNUSED(id);
+#endif
+}
+
+void PortCoreReactor::queue(std::unique_lock<std::mutex>& lock, QueuedTask task)
+{
+    m_tasks.push_back(std::move(task));
+    if (m_tasks.size() <= m_idleWorkers + m_startingWorkers) {
+        m_work.notify_one();
+        return;
+    }
+
+    // Every worker is busy, and may stay so for long (e.g. waiting for
+    // a reply that another task will read): add one.
+    joinRetiredWorkers(lock);
+    m_startingWorkers++;
+    lock.unlock();
+    auto* thread = new PortCoreReactorThread(*this, true);
+    bool started = thread->start();
+    lock.lock();
+    if (started) {
+        m_workers.push_back(thread);
+    } else {
+        m_startingWorkers--;
+        YARP_ERROR(Logger::get(), "PortCoreReactor: cannot start a worker, the task waits for a busy one");
+        lock.unlock();
+        delete thread;
+        lock.lock();
+    }
+}
+
+void PortCoreReactor::joinRetiredWorkers(std::unique_lock<std::mutex>& lock)
+{
+    if (m_retiredWorkers.empty()) {
+        return;
+    }
+    std::vector<PortCoreReactorThread*> retired;
+    retired.swap(m_retiredWorkers);
+    lock.unlock();
+    // They are done, or about to return from runWorker().
+    for (auto* thread : retired) {
+        thread->join();
+        delete thread;
+    }
+    lock.lock();
+}
+
+void PortCoreReactor::runHandler(uint64_t id)
+{
+    // Entries are not erased while busy, so the handler can be called
+    // without holding the lock.
+    ReadHandler* handler = nullptr;
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_watches.find(id);
+        if (it == m_watches.end()) {
+            return;
+        }
+        if (it->second.removed) {
+            // unwatch() came first, the handler is not needed anymore
+            m_watches.erase(it);
+            m_idle.notify_all();
+            return;
+        }
+        handler = &it->second.handler;
+        fd = it->second.fd;
+    }
+
+    bool again = (*handler)();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_watches.find(id);
+    if (it != m_watches.end()) {
+        if (it->second.removed || !again) {
+            // The handler closed the socket, or is about to,
+            // so it will leave the epoll set by itself.
+            m_watches.erase(it);
+            m_idle.notify_all();
+        } else {
+            it->second.busy = false;
+            rearm(fd, id);
+        }
+    }
+}
+
+void PortCoreReactor::recordLatency(double latency)
+{
+    if (latency < 0) {
+        latency = 0;
+    }
+    m_latencySum += latency;
+    if (latency > m_latencyMax) {
+        m_latencyMax = latency;
+    }
+}
+
+PortCoreReactor::Stats PortCoreReactor::getStats()
+{
+    Stats stats;
+    stats.enabled = !m_threads.empty();
+    stats.ioThreads = m_threads.size();
+    m_mutex.lock();
+    stats.workers = m_workers.size();
+    stats.watched = m_watches.size();
+    m_mutex.unlock();
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    stats.readWakeups = m_readWakeups;
+    stats.tasks = m_taskCount;
+    uint64_t total = m_readWakeups + m_taskCount;
+    stats.meanWakeupLatency = (total > 0) ? m_latencySum / static_cast<double>(total) : 0.0;
+    stats.maxWakeupLatency = m_latencyMax;
+    return stats;
+}
+
+void PortCoreReactor::runIoThread()
+{
+#ifdef YARP_PORTCORE_REACTOR_AVAILABLE
+    struct epoll_event events[maxEvents];
+    while (true) {
+        int n = epoll_wait(m_epollFd, events, maxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            YARP_ERROR(Logger::get(), "PortCoreReactor: epoll_wait failed, I/O thread exiting");
+            return;
+        }
+        double readyTime = SystemClock::nowSystem();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == wakeupId) {
+                uint64_t count;
+                if (::read(m_wakeFd, &count, sizeof(count)) < 0) {
+                    // Another thread already consumed the wakeup.
+                }
+                continue;
+            }
+
+            auto it = m_watches.find(id);
+            if (it == m_watches.end() || it->second.removed || m_closing) {
+                continue;
+            }
+            // The socket is not rearmed until the handler is done.
+            it->second.busy = true;
+            queue(lock, QueuedTask{[this, id]() { runHandler(id); }, readyTime, true});
+        }
+
+        if (m_closing) {
+            // Make sure the other threads wake up as well.
+            uint64_t one = 1;
+            if (::write(m_wakeFd, &one, sizeof(one)) < 0) {
+                YARP_DEBUG(Logger::get(), "PortCoreReactor: cannot wake up I/O threads");
+            }
+            return;
+        }
+    }
+#endif
+}
+
+void PortCoreReactor::runWorker(PortCoreReactorThread* self)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_startingWorkers--;
+    while (true) {
+        m_idleWorkers++;
+        bool woken = m_work.wait_for(lock,
+                                     std::chrono::duration<double>(m_idleTimeout),
+                                     [this]() { return m_closing || !m_tasks.empty(); });
+        m_idleWorkers--;
+        if (m_tasks.empty()) {
+            if (m_closing) {
+                return;
+            }
+            if (!woken && m_workers.size() > m_threads.size()) {
+                // Not needed for a while: leave, to be joined by the next
+                // worker started, or by close().
+                auto it = std::find(m_workers.begin(), m_workers.end(), self);
+                if (it != m_workers.end()) {
+                    m_workers.erase(it);
+                    m_retiredWorkers.push_back(self);
+                    return;
+                }
+            }
+            continue;
+        }
+        QueuedTask task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> statsLock(m_statsMutex);
+            if (task.read) {
+                m_readWakeups++;
+            } else {
+                m_taskCount++;
+            }
+            recordLatency(SystemClock::nowSystem() - task.postTime);
+        }
+        task.task();
+
+        lock.lock();
+    }
+}
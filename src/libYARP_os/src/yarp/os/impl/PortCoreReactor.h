@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_OS_IMPL_PORTCOREREACTOR_H
+#define YARP_OS_IMPL_PORTCOREREACTOR_H
+
+#include <yarp/os/api.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace yarp {
+namespace os {
+namespace impl {
+
+class PortCoreReactorThread;
+
+/**
+ * A process-wide pool of I/O threads that multiplexes the connections
+ * of all the ports of the process.
+ *
+ * By default every PortCoreInputUnit owns a thread.  When the reactor
+ * is enabled, TCP input connections instead register their socket with
+ * the reactor.  A small number of I/O threads wait for the sockets to
+ * become readable, and hand the unit to a worker thread whenever a
+ * message starts to arrive.
+ *
+ * The reactor is opt-in, and it is enabled by setting the
+ * `YARP_PORTCORE_REACTOR` environment variable to the number of I/O
+ * threads to use (e.g. `YARP_PORTCORE_REACTOR=2`).  It is available on
+ * Linux only (it is based on epoll), on other platforms the variable is
+ * ignored and every connection keeps its own thread.
+ *
+ * The background writes of the TCP output connections are queued on
+ * the reactor too (see post()).
+ *
+ * The I/O threads never run the handlers or the writes themselves: a
+ * handler reads the whole message, and runs the callbacks of the port
+ * (onRead(), RPC replies, waiting for room in a BufferedPort), and a
+ * write waits for the acknowledgement of the reader.  Both may block
+ * for a long time, or wait for a message on another connection of the
+ * same process.  They run on a pool of workers, that grows by one
+ * thread whenever a task is due and all the workers are busy, so that
+ * a blocked task never holds back the others.  A worker that has been
+ * idle for a while (see setIdleTimeout()) exits, down to one worker
+ * per I/O thread, i.e. the process has about as many workers as tasks
+ * running at the same time, rather than one thread per connection.
+ */
+class YARP_os_impl_API PortCoreReactor
+{
+public:
+    /**
+     * Handler for readable sockets.  Returns true if the socket should
+     * be watched again, false to drop the registration.
+     */
+    typedef std::function<bool()> ReadHandler;
+
+    /**
+     * Generic task to be executed by one of the workers.
+     */
+    typedef std::function<void()> Task;
+
+    /**
+     * Statistics collected by the reactor, to compare it against the
+     * thread-per-connection mode.
+     */
+    struct Stats
+    {
+        bool enabled {false};           ///< whether the reactor is in use
+        size_t ioThreads {0};           ///< number of I/O threads
+        size_t workers {0};             ///< number of workers running the handlers
+        size_t watched {0};             ///< sockets currently registered
+        uint64_t readWakeups {0};       ///< handlers run for readable sockets
+        uint64_t tasks {0};             ///< tasks run
+        double meanWakeupLatency {0.0}; ///< mean time from readiness/post to dispatch [s]
+        double maxWakeupLatency {0.0};  ///< max time from readiness/post to dispatch [s]
+    };
+
+    /**
+     * @return the process-wide reactor, created on first use.
+     */
+    static PortCoreReactor& get();
+
+    /**
+     * @return true if the reactor was enabled and successfully started.
+     */
+    static bool isEnabled();
+
+    /**
+     * Watch a socket, and call the handler on a worker when it becomes
+     * readable.  The handler is never called concurrently with
+     * itself.
+     *
+     * @param fd the socket descriptor
+     * @param handler the handler
+     * @return an id for the registration, or 0 on failure
+     */
+    uint64_t watch(int fd, ReadHandler handler);
+
+    /**
+     * Stop watching a socket.  If its handler is running on another
+     * thread, call interruptHandler (typically to close the socket and
+     * unblock the handler) and wait for the handler to complete.
+     * Must not be called from the handler itself (the handler should
+     * return false instead).
+     *
+     * The socket must still be open when this is called.
+     *
+     * @param id the id returned by watch()
+     * @param interruptHandler called only if the handler is running
+     */
+    void unwatch(uint64_t id, const Task& interruptHandler = nullptr);
+
+    /**
+     * Queue a task to be executed by one of the workers.
+     *
+     * @return true if the task was queued
+     */
+    bool post(Task task);
+
+    /**
+     * @return the statistics collected so far.
+     */
+    Stats getStats();
+
+    /**
+     * Stop the reactor, and start it again with another number of I/O
+     * threads, instead of the number read from `YARP_PORTCORE_REACTOR`
+     * when it was created.  This is meant for tests, and fails if a
+     * socket is watched.
+     *
+     * @param threads the number of I/O threads, 0 to disable the reactor
+     * @return true if the reactor was restarted as requested
+     */
+    bool restart(size_t threads);
+
+    /**
+     * Set how long a worker waits for a task before it exits, if there
+     * are more workers than I/O threads.
+     *
+     * @param seconds the idle time, in seconds
+     */
+    void setIdleTimeout(double seconds);
+
+    /**
+     * Internal: body of the I/O threads.
+     */
+    void runIoThread();
+
+    /**
+     * Internal: body of the workers.
+     */
+    void runWorker(PortCoreReactorThread* self);
+
+private:
+    PortCoreReactor();
+    ~PortCoreReactor();
+    PortCoreReactor(const PortCoreReactor&) = delete;
+    PortCoreReactor& operator=(const PortCoreReactor&) = delete;
+
+    struct Watch
+    {
+        int fd;
+        ReadHandler handler;
+        bool busy;
+        bool removed;
+    };
+
+    struct QueuedTask
+    {
+        Task task;
+        double postTime;
+        bool read; ///< a handler for a readable socket
+    };
+
+    bool open(size_t threads);
+    void close();
+    void rearm(int fd, uint64_t id);
+    void runHandler(uint64_t id);
+    void queue(std::unique_lock<std::mutex>& lock, QueuedTask task);
+    void joinRetiredWorkers(std::unique_lock<std::mutex>& lock);
+    void recordLatency(double latency);
+
+    int m_epollFd;
+    int m_wakeFd;
+    bool m_closing;
+    uint64_t m_nextId;
+    std::vector<PortCoreReactorThread*> m_threads;
+    std::vector<PortCoreReactorThread*> m_workers;
+    std::vector<PortCoreReactorThread*> m_retiredWorkers; ///< workers that exited, not joined yet
+    size_t m_idleWorkers;     ///< workers waiting for a task
+    size_t m_startingWorkers; ///< workers started, not waiting yet
+    double m_idleTimeout;     ///< time an extra worker waits for a task [s]
+    std::map<uint64_t, Watch> m_watches;
+    std::deque<QueuedTask> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_idle;
+    std::condition_variable m_work;
+
+    std::mutex m_statsMutex;
+    uint64_t m_readWakeups;
+    uint64_t m_taskCount;
+    double m_latencySum;
+    double m_latencyMax;
+};
+
+} // namespace impl
+} // namespace os
+} // namespace yarp
+
+#endif // YARP_OS_IMPL_PORTCOREREACTOR_H
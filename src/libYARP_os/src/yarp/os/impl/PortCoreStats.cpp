@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/os/impl/PortCoreStats.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/SystemClock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using yarp::os::Bottle;
+using yarp::os::SystemClock;
+using yarp::os::impl::PortCoreHistogram;
+using yarp::os::impl::PortCoreStats;
+
+namespace {
+
+void addPair(Bottle& result, const char* key, double value)
+{
+    Bottle& pair = result.addList();
+    pair.addString(key);
+    pair.addFloat64(value);
+}
+
+void addPair(Bottle& result, const char* key, std::uint64_t value)
+{
+    Bottle& pair = result.addList();
+    pair.addString(key);
+    pair.addInt64(static_cast<std::int64_t>(value));
+}
+
+void storeMax(std::atomic<std::uint64_t>& max, std::uint64_t value)
+{
+    std::uint64_t prev = max.load(std::memory_order_relaxed);
+    while (value > prev && !max.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+
+PortCoreHistogram::PortCoreHistogram() :
+        count(0),
+        sum(0),
+        max(0)
+{
+    for (auto& bucket : counts) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int PortCoreHistogram::bucketOf(std::uint64_t micros)
+{
+    const std::uint64_t sub = 1 << subBits;
+    if (micros < sub) {
+        return static_cast<int>(micros);
+    }
+    micros = std::min(micros, (static_cast<std::uint64_t>(1) << maxBits) - 1);
+    int exponent = subBits;
+    while ((micros >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+    int shift = exponent - subBits;
+    return static_cast<int>(((shift + 1) << subBits) + ((micros >> shift) - sub));
+}
+
+double PortCoreHistogram::valueOf(int bucket)
+{
+    const int sub = 1 << subBits;
+    if (bucket < sub) {
+        return bucket;
+    }
+    int shift = (bucket >> subBits) - 1;
+    double lower = static_cast<double>(static_cast<std::uint64_t>(sub + (bucket & (sub - 1))) << shift);
+    double width = static_cast<double>(static_cast<std::uint64_t>(1) << shift);
+    return lower + (width - 1) / 2;
+}
+
+void PortCoreHistogram::record(double seconds)
+{
+    std::uint64_t micros = (seconds > 0) ? static_cast<std::uint64_t>(std::llround(seconds * 1e6)) : 0;
+    counts[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(micros, std::memory_order_relaxed);
+    storeMax(max, micros);
+}
+
+std::uint64_t PortCoreHistogram::getCount() const
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+double PortCoreHistogram::getPercentile(double fraction) const
+{
+    // The buckets may be updated while they are read, so the total is
+    // taken from the buckets themselves.
+    std::uint64_t snapshot[buckets];
+    std::uint64_t total = 0;
+    for (int i = 0; i < buckets; i++) {
+        snapshot[i] = counts[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto target = static_cast<std::uint64_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) * total));
+    target = std::max<std::uint64_t>(target, 1);
+    std::uint64_t seen = 0;
+    for (int i = 0; i < buckets; i++) {
+        seen += snapshot[i];
+        if (seen >= target) {
+            return std::min(valueOf(i), getMax());
+        }
+    }
+    return getMax();
+}
+
+double PortCoreHistogram::getMean() const
+{
+    std::uint64_t n = getCount();
+    return (n > 0) ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+double PortCoreHistogram::getMax() const
+{
+    return static_cast<double>(max.load(std::memory_order_relaxed));
+}
+
+void PortCoreHistogram::describe(Bottle& result) const
+{
+    addPair(result, "count", getCount());
+    addPair(result, "mean", getMean());
+    addPair(result, "p50", getPercentile(0.5));
+    addPair(result, "p90", getPercentile(0.9));
+    addPair(result, "p99", getPercentile(0.99));
+    addPair(result, "p999", getPercentile(0.999));
+    addPair(result, "max", getMax());
+}
+
+std::string PortCoreHistogram::toString() const
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "p50 %.0f us p99 %.0f us max %.0f us", getPercentile(0.5), getPercentile(0.99), getMax());
+    return buf;
+}
+
+
+PortCoreStats::PortCoreStats() :
+        messages(0),
+        bytes(0),
+        drops(0),
+        last(-1)
+{
+}
+
+void PortCoreStats::recordMessage(size_t bytes)
+{
+    double now = SystemClock::nowSystem();
+    messages.fetch_add(1, std::memory_order_relaxed);
+    this->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    double prev = last.exchange(now, std::memory_order_relaxed);
+    if (prev >= 0) {
+        interval.record(now - prev);
+    }
+}
+
+void PortCoreStats::recordDrop()
+{
+    drops.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PortCoreStats::recordSendTime(double seconds)
+{
+    sendTime.record(seconds);
+}
+
+std::uint64_t PortCoreStats::getMessages() const
+{
+    return messages.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PortCoreStats::getBytes() const
+{
+    return bytes.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PortCoreStats::getDrops() const
+{
+    return drops.load(std::memory_order_relaxed);
+}
+
+const PortCoreHistogram& PortCoreStats::getSendTime() const
+{
+    return sendTime;
+}
+
+const PortCoreHistogram& PortCoreStats::getInterval() const
+{
+    return interval;
+}
+
+void PortCoreStats::describe(Bottle& result) const
+{
+    addPair(result, "messages", getMessages());
+    addPair(result, "bytes", getBytes());
+    addPair(result, "drops", getDrops());
+    if (sendTime.getCount() > 0) {
+        Bottle& send = result.addList();
+        send.addString("send_us");
+        sendTime.describe(send);
+    }
+    if (interval.getCount() > 0) {
+        Bottle& gap = result.addList();
+        gap.addString("interval_us");
+        interval.describe(gap);
+    }
+}
+
+std::string PortCoreStats::toString() const
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "messages %llu bytes %llu drops %llu",
+             static_cast<unsigned long long>(getMessages()),
+             static_cast<unsigned long long>(getBytes()),
+             static_cast<unsigned long long>(getDrops()));
+    std::string result = buf;
+    if (interval.getCount() > 0) {
+        result += "\ninterval " + interval.toString();
+    }
+    if (sendTime.getCount() > 0) {
+        result += "\nsend time " + sendTime.toString();
+    }
+    return result;
+}
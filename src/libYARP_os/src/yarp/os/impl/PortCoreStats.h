@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_OS_IMPL_PORTCORESTATS_H
+#define YARP_OS_IMPL_PORTCORESTATS_H
+
+#include <yarp/os/api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace yarp {
+namespace os {
+
+class Bottle;
+
+namespace impl {
+
+/**
+ * A histogram of durations, in microseconds, with a bounded relative
+ * error (HDR histogram).
+ *
+ * Values below 16 microseconds have a bucket each, the others are put
+ * in one of 16 buckets for each power of two, so that a percentile is
+ * known within about 3%.  Values above 2^36 microseconds (about 19
+ * hours) are counted as that.
+ *
+ * The buckets are atomic counters: recording a value never locks, and
+ * the histogram can be read while values are being recorded.
+ */
+class YARP_os_impl_API PortCoreHistogram
+{
+public:
+    PortCoreHistogram();
+
+    /**
+     * Record a duration.
+     * @param seconds the duration, in seconds
+     */
+    void record(double seconds);
+
+    /**
+     * @return the number of durations recorded
+     */
+    std::uint64_t getCount() const;
+
+    /**
+     * @param fraction the fraction of the durations (e.g. 0.99)
+     * @return the duration that this fraction of the durations does
+     * not exceed, in microseconds, or 0 if nothing was recorded
+     */
+    double getPercentile(double fraction) const;
+
+    /**
+     * @return the mean duration, in microseconds
+     */
+    double getMean() const;
+
+    /**
+     * @return the longest duration, in microseconds
+     */
+    double getMax() const;
+
+    /**
+     * Add the count, the mean and the main percentiles of the
+     * histogram to a bottle, as (key value) pairs.
+     */
+    void describe(yarp::os::Bottle& result) const;
+
+    /**
+     * @return a short human-readable summary of the histogram
+     */
+    std::string toString() const;
+
+private:
+    static constexpr int subBits = 4;
+    static constexpr int maxBits = 36;
+    static constexpr int buckets = (maxBits - subBits + 1) << subBits;
+
+    static int bucketOf(std::uint64_t micros);
+    static double valueOf(int bucket);
+
+    std::atomic<std::uint64_t> counts[buckets];
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max;
+};
+
+
+/**
+ * Statistics about the traffic on a connection, updated without locks
+ * by the PortCoreUnit that handles it, and reported through the
+ * administrative interface of the port (`[stat]`) and `yarp ping`.
+ */
+class YARP_os_impl_API PortCoreStats
+{
+public:
+    PortCoreStats();
+
+    /**
+     * Called each time a message is sent or received.
+     * @param bytes the bytes written or read for the message, 0 if it
+     * was not serialized
+     */
+    void recordMessage(size_t bytes);
+
+    /**
+     * Called each time a message could not be sent on the connection
+     * because the previous one was still being sent.
+     */
+    void recordDrop();
+
+    /**
+     * Called each time a message has been written on the connection.
+     * @param seconds the time taken to write it
+     */
+    void recordSendTime(double seconds);
+
+    std::uint64_t getMessages() const;
+
+    std::uint64_t getBytes() const;
+
+    std::uint64_t getDrops() const;
+
+    const PortCoreHistogram& getSendTime() const;
+
+    const PortCoreHistogram& getInterval() const;
+
+    /**
+     * Add the statistics to a bottle, as (key value) pairs, with the
+     * histograms that are not empty as nested lists.
+     */
+    void describe(yarp::os::Bottle& result) const;
+
+    /**
+     * @return a short human-readable summary of the statistics, on
+     * one line for the counters and one for each histogram
+     */
+    std::string toString() const;
+
+private:
+    std::atomic<std::uint64_t> messages;
+    std::atomic<std::uint64_t> bytes;
+    std::atomic<std::uint64_t> drops;
+    std::atomic<double> last;    ///< when the last message was seen
+    PortCoreHistogram sendTime;  ///< time taken to write each message
+    PortCoreHistogram interval;  ///< time between successive messages
+};
+
+} // namespace impl
+} // namespace os
+} // namespace yarp
+
+#endif // YARP_OS_IMPL_PORTCORESTATS_H
@@ -12,8 +12,10 @@
 
 #include <yarp/os/Name.h>
 #include <yarp/os/impl/PortCore.h>
+#include <yarp/os/impl/PortCoreStats.h>
 #include <yarp/os/impl/ThreadImpl.h>
 
+#include <atomic>
 #include <string>
 
 namespace yarp {
@@ -40,7 +42,8 @@ public:
             doomed(false),
             hasMode(false),
             pupped(false),
-            index(index)
+            index(index),
+            sendPriority(normalPriority)
     {
     }
 
@@ -271,6 +274,41 @@ public:
         YARP_UNUSED(params);
     }
 
+    /**
+     * The priorities of the messages sent on a connection.  The
+     * connections with a high priority are given a message first, the
+     * ones with a low priority only get the latest message, without
+     * holding back the others.
+     */
+    static constexpr int lowPriority = -1;
+    static constexpr int normalPriority = 0;
+    static constexpr int highPriority = 1;
+
+    /**
+     * Set the priority of the messages sent on this connection.
+     * @param priority lowPriority, normalPriority or highPriority
+     */
+    void setSendPriority(int priority)
+    {
+        sendPriority = priority;
+    }
+
+    /**
+     * @return the priority of the messages sent on this connection
+     */
+    int getSendPriority() const
+    {
+        return sendPriority;
+    }
+
+    /**
+     * @return the statistics about the traffic on this connection
+     */
+    PortCoreStats& getStats()
+    {
+        return stats;
+    }
+
 
 protected:
     /**
@@ -289,6 +327,8 @@ private:
     bool pupped;           ///< whether the connection was made by `publisherUpdate`
     int index;             ///< an ID assigned to the connection
     std::string pupString; ///< the target of the connection if created by `publisherUpdate`
+    PortCoreStats stats;   ///< traffic on the connection
+    std::atomic<int> sendPriority; ///< the priority of the messages sent
 };
 
 } // namespace impl
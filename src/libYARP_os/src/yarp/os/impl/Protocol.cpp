@@ -17,6 +17,7 @@
 #include <yarp/os/ShiftStream.h>
 #include <yarp/os/TwoWayStream.h>
 #include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/SocketTwoWayStream.h>
 #include <yarp/os/impl/StreamConnectionReader.h>
 
 #include <cstdio>
@@ -44,7 +45,9 @@ Protocol::Protocol(TwoWayStream* stream) :
         ref(nullptr),
         envelope(""),
         port(nullptr),
-        pendingReply(false)
+        pendingReply(false),
+        coalescing(nullptr),
+        coalescedMessages(0)
 {
     // We start off with the streams used to contact the port that
     // owns this connection.
@@ -121,6 +124,7 @@ TwoWayStream& Protocol::getStreams()
 
 void Protocol::takeStreams(TwoWayStream* streams)
 {
+    setCoalescing(0);
     shift.takeStream(streams);
     if (streams != nullptr) {
         active = true;
@@ -130,6 +134,7 @@ void Protocol::takeStreams(TwoWayStream* streams)
 
 TwoWayStream* Protocol::giveStreams()
 {
+    setCoalescing(0);
     return shift.giveStream();
 }
 
@@ -306,6 +311,17 @@ bool Protocol::write(SizedWriter& writer)
     bool ok = delegate->write(*this, writer);
     getStreams().endPacket(); // Message ends.
     PortReader* reply = writer.getReplyHandler();
+    if (coalescing != nullptr) {
+        if (reply == nullptr && coalescing->getCoalesced() > 0) {
+            // Acknowledged later, by flushCoalesced().
+            coalescedMessages++;
+            this->writer = nullptr;
+            return false;
+        }
+        // The message went out (or must, to get a reply), and the
+        // acknowledgements of the ones before it come first.
+        flushCoalesced();
+    }
     if (reply != nullptr) {
         if (!delegate->supportReply()) {
             // We are expected to get a reply, but cannot.
@@ -522,6 +538,46 @@ bool Protocol::respondToHeader()
 }
 
 
+bool Protocol::setCoalescing(size_t limit)
+{
+    if (limit == 0) {
+        flushCoalesced();
+        if (coalescing != nullptr) {
+            coalescing->setCoalescing(0);
+            coalescing = nullptr;
+        }
+        return true;
+    }
+    auto* stream = dynamic_cast<SocketTwoWayStream*>(&os());
+    if (stream == nullptr) {
+        return false;
+    }
+    stream->setCoalescing(limit);
+    coalescing = stream;
+    return true;
+}
+
+
+size_t Protocol::getCoalesced() const
+{
+    return (coalescing != nullptr) ? coalescing->getCoalesced() : 0;
+}
+
+
+bool Protocol::flushCoalesced()
+{
+    if (coalescing == nullptr) {
+        return true;
+    }
+    coalescing->flushCoalesced();
+    while (coalescedMessages > 0) {
+        coalescedMessages--;
+        expectAck();
+    }
+    return isOk();
+}
+
+
 bool Protocol::expectAck()
 {
     yAssert(delegate != nullptr);
@@ -534,6 +590,7 @@ bool Protocol::expectAck()
 
 void Protocol::closeHelper()
 {
+    setCoalescing(0);
     active = false;
     if (pendingAck) {
         sendAck();
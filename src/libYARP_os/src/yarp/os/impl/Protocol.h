@@ -23,6 +23,8 @@ namespace yarp {
 namespace os {
 namespace impl {
 
+class SocketTwoWayStream;
+
 /**
  * Connection choreographer.  Handles one side of a single YARP connection.
  * The Protocol object for a connection holds its streams (which may
@@ -97,6 +99,38 @@ public:
         pendingReply = true;
     }
 
+    /**
+     * Keep small messages in memory, to send several of them with a
+     * single write when flushCoalesced() is called.  Acknowledgements
+     * are collected then.  Messages expecting a reply are sent right
+     * away, along with the pending ones.
+     * @param limit messages at least this big are not kept; 0 sends
+     * the pending messages and turns coalescing off
+     * @return false if the streams of the connection cannot coalesce
+     * messages (only TCP sockets can)
+     */
+    bool setCoalescing(size_t limit);
+
+    /**
+     * @return the number of bytes written but not sent yet
+     */
+    size_t getCoalesced() const;
+
+    /**
+     * @return the number of messages written but not sent yet
+     */
+    int getCoalescedMessages() const
+    {
+        return coalescedMessages;
+    }
+
+    /**
+     * Send the messages kept by setCoalescing(), and wait for their
+     * acknowledgements (if the carrier makes them).
+     * @return true if the connection is still fine
+     */
+    bool flushCoalesced();
+
 private:
     /**
      * Scan for a receiver modifier in the carrier options, and
@@ -205,6 +239,8 @@ private:
     NullConnection nullConnection; ///< dummy connection
     yarp::os::Contactable* port;   ///< port associated with this connection
     bool pendingReply;             ///< will we be making a reply
+    SocketTwoWayStream* coalescing; ///< stream keeping small messages, if any
+    int coalescedMessages;         ///< messages kept but not sent yet
 };
 
 } // namespace impl
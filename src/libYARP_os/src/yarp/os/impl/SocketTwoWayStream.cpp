@@ -26,9 +26,110 @@
 #    include <netinet/tcp.h>
 #endif
 
+#include <yarp/os/Network.h>
+
+#include <cstdlib>
+
+#if defined(__linux__)
+#    include <linux/errqueue.h>
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <cerrno>
+#    if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#        define YARP_TCP_ZEROCOPY_AVAILABLE
+#    endif
+#endif
+
 using namespace yarp::os;
 using namespace yarp::os::impl;
 
+#ifdef YARP_TCP_ZEROCOPY_AVAILABLE
+namespace {
+
+// Wait until the kernel reports that it does not need the buffers of
+// the first `calls` zero-copy sends anymore.
+bool waitZeroCopyCompletion(int fd, uint32_t calls, int timeoutMs)
+{
+    uint32_t done = 0;
+    while (done < calls) {
+        struct pollfd pfd = {fd, 0, 0};
+        int ready = ::poll(&pfd, 1, timeoutMs);
+        if (ready == 0) {
+            return false;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        char control[128];
+        struct msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if (errno == EAGAIN && ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0) {
+                continue;
+            }
+            return false;
+        }
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+            if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                auto* err = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+                if (err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                    // Notifications cover a range of send calls.
+                    done += err->ee_data - err->ee_info + 1;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Send the blocks with MSG_ZEROCOPY.
+// Returns 1 on success, 0 if nothing was sent and a normal send should
+// be used instead, -1 on failure.
+int sendZeroCopy(int fd, struct iovec* iov, int count, int timeoutMs)
+{
+    uint32_t calls = 0;
+    while (count > 0) {
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t result = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS && calls == 0) {
+                // Out of memory for pinning the pages.
+                return 0;
+            }
+            return -1;
+        }
+        calls++;
+        auto sent = static_cast<size_t>(result);
+        while (count > 0 && sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return waitZeroCopyCompletion(fd, calls, timeoutMs) ? 1 : -1;
+}
+
+} // namespace
+#endif
+
 int SocketTwoWayStream::open(const Contact& address)
 {
     if (address.getPort() == -1) {
@@ -67,6 +168,7 @@ int SocketTwoWayStream::open(const Contact& address)
 #endif
     if (result >= 0) {
         happy = true;
+        enableZeroCopy();
     } else {
         YARP_SPRINTF2(Logger::get(),
                       debug,
@@ -83,6 +185,7 @@ int SocketTwoWayStream::open(yarp::os::impl::TcpAcceptor& acceptor)
     int result = acceptor.accept(stream);
     if (result >= 0) {
         happy = true;
+        enableZeroCopy();
     }
     updateAddresses();
     return result;
@@ -152,3 +255,119 @@ int SocketTwoWayStream::getTypeOfService()
     stream.get_option(IPPROTO_IP, IP_TOS, (int*)&tos, &optlen);
     return tos;
 }
+
+void SocketTwoWayStream::enableZeroCopy()
+{
+    zeroCopyThreshold = 0;
+    std::string env = NetworkBase::getEnvironment("YARP_TCP_ZEROCOPY");
+    long threshold = env.empty() ? 0 : std::atol(env.c_str());
+    if (threshold <= 0) {
+        return;
+    }
+#ifdef YARP_TCP_ZEROCOPY_AVAILABLE
+    int one = 1;
+    if (stream.set_option(SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+        zeroCopyThreshold = static_cast<size_t>(threshold);
+        return;
+    }
+#endif
+    YARP_DEBUG(Logger::get(), "MSG_ZEROCOPY is not supported, using normal writes");
+}
+
+void SocketTwoWayStream::setCoalescing(size_t limit)
+{
+    if (limit == 0) {
+        flushCoalesced();
+    }
+    coalesceLimit = limit;
+}
+
+void SocketTwoWayStream::flushCoalesced()
+{
+    if (coalesced.empty()) {
+        return;
+    }
+    if (isOk()) {
+        yarp::conf::ssize_t result;
+        if (haveWriteTimeout) {
+            result = stream.send_n(coalesced.data(), coalesced.size(), &writeTimeout);
+        } else {
+            result = stream.send_n(coalesced.data(), coalesced.size());
+        }
+        if (result < 0) {
+            happy = false;
+            YARP_DEBUG(Logger::get(), "bad socket write");
+        }
+    }
+    coalesced.clear();
+}
+
+void SocketTwoWayStream::write(const Bytes* blocks, size_t count)
+{
+    if (!isOk()) {
+        return;
+    }
+    if (coalesceLimit > 0) {
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += blocks[i].length();
+        }
+        if (total < coalesceLimit) {
+            for (size_t i = 0; i < count; i++) {
+                coalesced.insert(coalesced.end(), blocks[i].get(), blocks[i].get() + blocks[i].length());
+            }
+            return;
+        }
+        // Too big to be worth a copy, but it must not overtake what
+        // is pending.
+        flushCoalesced();
+    }
+    constexpr size_t maxChunk = 64;
+    iovec iov[maxChunk];
+    size_t next = 0;
+    while (next < count) {
+        int n = 0;
+        size_t total = 0;
+        while (n < static_cast<int>(maxChunk) && next < count) {
+            if (blocks[next].length() > 0) {
+                iov[n].iov_base = const_cast<char*>(blocks[next].get());
+                iov[n].iov_len = blocks[next].length();
+                total += blocks[next].length();
+                n++;
+            }
+            next++;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+#ifdef YARP_TCP_ZEROCOPY_AVAILABLE
+        if (zeroCopyThreshold > 0 && total >= zeroCopyThreshold) {
+            int timeoutMs = haveWriteTimeout ? static_cast<int>(toDouble(writeTimeout) * 1000) : -1;
+            int result = sendZeroCopy(stream.get_handle(), iov, n, timeoutMs);
+            if (result < 0) {
+                happy = false;
+                YARP_DEBUG(Logger::get(), "bad socket write");
+                return;
+            }
+            if (result > 0) {
+                continue;
+            }
+        }
+#else
+        YARP_UNUSED(total);
+#endif
+
+        yarp::conf::ssize_t result;
+        if (haveWriteTimeout) {
+            result = stream.sendv_n(iov, n, &writeTimeout);
+        } else {
+            result = stream.sendv_n(iov, n);
+        }
+        if (result < 0) {
+            happy = false;
+            YARP_DEBUG(Logger::get(), "bad socket write");
+            return;
+        }
+    }
+}
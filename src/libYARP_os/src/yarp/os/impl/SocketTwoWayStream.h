@@ -19,6 +19,8 @@
 #include <yarp/os/impl/TcpAcceptor.h>
 #include <yarp/os/impl/TcpStream.h>
 
+#include <vector>
+
 #ifdef YARP_HAS_ACE // For TCP_CORK definition
 #    include <ace/os_include/netinet/os_tcp.h>
 // In one the ACE headers there is a definition of "main" for WIN32
@@ -45,7 +47,9 @@ public:
     SocketTwoWayStream() :
             haveWriteTimeout(false),
             haveReadTimeout(false),
-            happy(false)
+            happy(false),
+            zeroCopyThreshold(0),
+            coalesceLimit(0)
     {
     }
 
@@ -147,6 +151,10 @@ public:
         if (!isOk()) {
             return;
         }
+        if (coalesceLimit > 0) {
+            write(&b, 1);
+            return;
+        }
         yarp::conf::ssize_t result;
         if (haveWriteTimeout) {
             result = stream.send_n(b.get(), b.length(), &writeTimeout);
@@ -159,8 +167,50 @@ public:
         }
     }
 
+    /**
+     * Write several blocks of data at once.  The blocks are gathered by
+     * the kernel (writev/sendmsg) rather than being copied into a single
+     * buffer or sent with one system call each.
+     *
+     * If the `YARP_TCP_ZEROCOPY` environment variable is set to a size in
+     * bytes, messages at least that big are sent with `MSG_ZEROCOPY`
+     * where supported (Linux >= 4.14).  The call returns only when the
+     * kernel does not need the blocks anymore, so they can be reused
+     * right away, as with a normal write.
+     *
+     * @param blocks the blocks to write
+     * @param count the number of blocks
+     */
+    void write(const Bytes* blocks, size_t count);
+
+    /**
+     * Keep small writes in memory, to send several of them at once
+     * with flushCoalesced().  Writes of at least `limit` bytes are sent
+     * directly when nothing is pending.
+     * @param limit the size of the writes to keep, 0 to send every
+     * write right away (the default); pending data is sent then
+     */
+    void setCoalescing(size_t limit);
+
+    /**
+     * @return the number of bytes written but not sent yet
+     */
+    size_t getCoalesced() const
+    {
+        return coalesced.size();
+    }
+
+    /**
+     * Send the data kept by setCoalescing() with a single write.
+     */
+    void flushCoalesced();
+
     void flush() override
     {
+        if (coalesceLimit > 0) {
+            // Sent by flushCoalesced()
+            return;
+        }
 #ifdef TCP_CORK
         int status = 0;
         int sizeInt = sizeof(int);
@@ -187,6 +237,9 @@ public:
 
     void beginPacket() override
     {
+        if (coalesceLimit > 0) {
+            return;
+        }
 #ifdef TCP_CORK
         // Set CORK
         int one = 1;
@@ -196,6 +249,9 @@ public:
 
     void endPacket() override
     {
+        if (coalesceLimit > 0) {
+            return;
+        }
 #ifdef TCP_CORK
         // Remove CORK
         int zero = 0;
@@ -228,6 +284,19 @@ public:
     bool setTypeOfService(int tos) override;
     int getTypeOfService() override;
 
+    /**
+     * @return the socket descriptor, e.g. to watch it with epoll, or -1
+     * on platforms where the descriptor is not an int.
+     */
+    int getHandle()
+    {
+#if defined(_WIN32)
+        return -1;
+#else
+        return stream.get_handle();
+#endif
+    }
+
 private:
     yarp::os::impl::TcpStream stream;
     bool haveWriteTimeout;
@@ -236,7 +305,11 @@ private:
     YARP_timeval readTimeout;
     Contact localAddress, remoteAddress;
     bool happy;
+    size_t zeroCopyThreshold; ///< messages at least this big are sent with MSG_ZEROCOPY (0 = never)
+    size_t coalesceLimit;     ///< writes smaller than this are kept in coalesced (0 = never)
+    std::vector<char> coalesced; ///< data written but not sent yet
     void updateAddresses();
+    void enableZeroCopy();
 };
 
 } // namespace impl
@@ -513,9 +513,12 @@ void StoreString::fromString(const std::string& src)
 
 void StoreString::fromStringNested(const std::string& src)
 {
-    // unquoting code: very inefficient, but portable
-    x = "";
-    size_t len = src.length();
+    unquote(src.c_str(), src.length(), x);
+}
+
+void StoreString::unquote(const char* src, size_t len, std::string& result)
+{
+    result.clear();
     if (len > 0) {
         bool skip = false;
         bool back = false;
@@ -531,22 +534,22 @@ void StoreString::fromStringNested(const std::string& src)
                     if (!back) {
                         back = true;
                     } else {
-                        x += '\\';
+                        result += '\\';
                         back = false;
                     }
                 } else {
                     if (back) {
                         if (ch == 'n') {
-                            x += '\n';
+                            result += '\n';
                         } else if (ch == 'r') {
-                            x += '\r';
+                            result += '\r';
                         } else if (ch == '0') {
-                            x += '\0';
+                            result += '\0';
                         } else {
-                            x += ch;
+                            result += ch;
                         }
                     } else {
-                        x += ch;
+                        result += ch;
                     }
                     back = false;
                 }
@@ -675,7 +678,7 @@ bool StoreList::writeRaw(ConnectionWriter& writer) const
 
 std::int32_t StoreList::subCode() const
 {
-    return subCoder(*(content.implementation));
+    return content.implementation->subCode();
 }
 
 
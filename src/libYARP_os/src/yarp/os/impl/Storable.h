@@ -927,6 +927,12 @@ public:
         this->x = x;
     }
 
+    // Bytes allocated for the content
+    size_t capacity() const
+    {
+        return x.capacity();
+    }
+
     Storable* createStorable() const override
     {
         return new StoreString();
@@ -942,6 +948,9 @@ public:
     std::string toStringNested() const override;
     void fromStringNested(const std::string& src) override;
 
+    // Remove the quotes and the escapes of the text form of a string
+    static void unquote(const char* src, size_t len, std::string& result);
+
     static const std::int32_t code;
     std::int32_t getCode() const override
     {
@@ -984,6 +993,12 @@ public:
         this->x = x;
     }
 
+    // Bytes allocated for the content
+    size_t capacity() const
+    {
+        return x.capacity();
+    }
+
     Storable* createStorable() const override
     {
         return new StoreBlob();
@@ -10,7 +10,10 @@
 #include <yarp/os/impl/TcpCarrier.h>
 
 #include <yarp/os/ConnectionState.h>
+#include <yarp/os/NetType.h>
+#include <yarp/os/SizedWriter.h>
 #include <yarp/os/TwoWayStream.h>
+#include <yarp/os/impl/SocketTwoWayStream.h>
 
 #include <string>
 
@@ -83,3 +86,42 @@ bool yarp::os::impl::TcpCarrier::expectReplyToHeader(ConnectionState& proto)
     readYarpInt(proto); // ignore result
     return proto.checkStreams();
 }
+
+bool yarp::os::impl::TcpCarrier::write(ConnectionState& proto, SizedWriter& writer)
+{
+    // Text-mode subclasses (e.g. TextCarrier) send their own kind of index.
+    auto* stream = dynamic_cast<SocketTwoWayStream*>(&proto.os());
+    if (stream == nullptr || isTextMode()) {
+        return AbstractCarrier::write(proto, writer);
+    }
+
+    // Same index as AbstractCarrier::defaultSendIndex(), built in memory
+    // so that it travels in the same write as the message.
+    size_t len = writer.length();
+    index.resize(8 + 10 + (len + 1) * sizeof(NetInt32));
+    Bytes header(index.data(), 8);
+    createYarpNumber(10, header);
+    char* lens = index.data() + 8;
+    lens[0] = (char)len;
+    lens[1] = (char)1;
+    for (size_t i = 2; i < 10; i++) {
+        lens[i] = (char)-1;
+    }
+    char* cursor = lens + 10;
+    for (size_t i = 0; i <= len; i++) {
+        Bytes number(cursor, sizeof(NetInt32));
+        NetType::netInt((i < len) ? (int)writer.length(i) : 0, number);
+        cursor += sizeof(NetInt32);
+    }
+
+    blocks.clear();
+    blocks.emplace_back(index.data(), index.size());
+    for (size_t i = 0; i < len; i++) {
+        blocks.emplace_back(const_cast<char*>(writer.data(i)), writer.length(i));
+    }
+    stream->write(blocks.data(), blocks.size());
+    // The blocks are sent, as SizedWriter::write() does.
+    writer.stopWrite();
+    stream->flush();
+    return stream->isOk();
+}
@@ -11,6 +11,9 @@
 #define YARP_OS_IMPL_TCPCARRIER_H
 
 #include <yarp/os/AbstractCarrier.h>
+#include <yarp/os/Bytes.h>
+
+#include <vector>
 
 namespace yarp {
 namespace os {
@@ -39,8 +42,16 @@ public:
     bool respondToHeader(yarp::os::ConnectionState& proto) override;
     bool expectReplyToHeader(yarp::os::ConnectionState& proto) override;
 
+    /**
+     * Write the index and all the blocks of a message with a single
+     * gathered socket write, when the connection is a plain socket.
+     */
+    bool write(yarp::os::ConnectionState& proto, yarp::os::SizedWriter& writer) override;
+
 private:
     bool requireAckFlag;
+    std::vector<char> index;               ///< buffer for the message index
+    std::vector<yarp::os::Bytes> blocks;   ///< index and message blocks to write
 };
 
 } // namespace impl
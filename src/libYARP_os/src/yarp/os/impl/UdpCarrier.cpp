@@ -11,6 +11,9 @@
 
 #include <yarp/os/ConnectionState.h>
 #include <yarp/os/Log.h>
+#include <yarp/os/Name.h>
+#include <yarp/os/NetType.h>
+#include <yarp/os/Route.h>
 
 #include <string>
 
@@ -68,6 +71,7 @@ bool yarp::os::impl::UdpCarrier::respondToHeader(ConnectionState& proto)
     auto* stream = new DgramTwoWayStream();
     yAssert(stream != nullptr);
 
+    stream->setRedundancy(getRedundancy(proto));
     Contact remote = proto.getStreams().getRemoteAddress();
     bool ok = stream->open(remote);
     if (!ok) {
@@ -98,6 +102,7 @@ bool yarp::os::impl::UdpCarrier::expectReplyToHeader(ConnectionState& proto)
     auto* stream = new DgramTwoWayStream();
     yAssert(stream != nullptr);
 
+    stream->setRedundancy(getRedundancy(proto));
     proto.takeStreams(nullptr); // free up port from tcp
     bool ok = stream->open(Contact(myName, myPort), Contact(altName, altPort));
     if (!ok) {
@@ -107,3 +112,9 @@ bool yarp::os::impl::UdpCarrier::expectReplyToHeader(ConnectionState& proto)
     proto.takeStreams(stream);
     return true;
 }
+
+int yarp::os::impl::UdpCarrier::getRedundancy(ConnectionState& proto)
+{
+    Name n(proto.getRoute().getCarrierName() + "://test");
+    return NetType::toInt(n.getCarrierModifier("fec"));
+}
@@ -39,6 +39,13 @@ public:
     bool isConnectionless() const override;
     bool respondToHeader(ConnectionState& proto) override;
     bool expectReplyToHeader(ConnectionState& proto) override;
+
+protected:
+    /**
+     * @return the redundancy requested with the "fec" carrier modifier
+     *         (e.g. 20 for udp+fec.20), or 0 if there is none.
+     */
+    static int getRedundancy(ConnectionState& proto);
 };
 
 } // namespace impl
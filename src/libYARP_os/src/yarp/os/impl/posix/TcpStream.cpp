@@ -13,7 +13,9 @@
 
 // General files
 #include <sys/socket.h>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
 
 #include <yarp/os/impl/TcpStream.h>
 
@@ -38,6 +40,47 @@ int TcpStream::open() {
     return 0;
 }
 
+ssize_t TcpStream::sendv_n (const iovec iov[], int n) {
+    // sendmsg() may send only part of the data, so work on a copy of the
+    // blocks that can be advanced, a chunk at a time.
+    constexpr int maxChunk = 64;
+    iovec chunk[maxChunk];
+    ssize_t total = 0;
+    int next = 0;
+    while (next < n) {
+        int count = 0;
+        while (count < maxChunk && next < n) {
+            chunk[count++] = iov[next++];
+        }
+        iovec* pending = chunk;
+        while (count > 0) {
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = pending;
+            msg.msg_iovlen = count;
+            ssize_t result = ::sendmsg(sd, &msg, 0);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            total += result;
+            auto sent = static_cast<size_t>(result);
+            while (count > 0 && sent >= pending->iov_len) {
+                sent -= pending->iov_len;
+                pending++;
+                count--;
+            }
+            if (count > 0) {
+                pending->iov_base = static_cast<char*>(pending->iov_base) + sent;
+                pending->iov_len -= sent;
+            }
+        }
+    }
+    return total;
+}
+
 int TcpStream::get_local_addr (sockaddr & sa) {
 
     int len = sizeof(sa);
@@ -10,9 +10,12 @@
 #ifndef YARP_OS_IMPL_POSIX_TCPSTREAM_H
 #define YARP_OS_IMPL_POSIX_TCPSTREAM_H
 
+#include <yarp/os/api.h>
+
 // General files
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -30,7 +33,7 @@ namespace posix {
  * **************************************************************************************/
 
 
-class TcpStream
+class YARP_os_impl_API TcpStream
 {
 public:
     /**
@@ -76,6 +79,30 @@ public:
         return ::send(sd, buf, n, 0);
     }
 
+    /**
+     * Send all the given blocks, with as few sendmsg() calls as possible.
+     *
+     * @return the number of bytes sent, or -1 on failure
+     */
+    ssize_t sendv_n (const iovec iov[], int n);
+
+    /**
+     * Same as sendv_n(iov, n), with a send timeout for this call only:
+     * the previous timeout of the socket is restored.
+     */
+    inline ssize_t sendv_n (const iovec iov[], int n, struct timeval *tv)
+    {
+        struct timeval previous {0, 0};
+        socklen_t len = sizeof(previous);
+        bool restore = (getsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, (char *)&previous, &len) == 0);
+        setsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, (char *)tv, sizeof (*tv));
+        ssize_t result = sendv_n(iov, n);
+        if (restore) {
+            setsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, (char *)&previous, sizeof (previous));
+        }
+        return result;
+    }
+
     // No idea what this should do...
     void flush() { }
 
@@ -56,6 +56,8 @@ int yarp::serversql::Server::run(int argc, char** argv)
         printf("  --portdb ports.db        Store port information in named database.\n");
         printf("                           Must not be on an NFS file system.\n");
         printf("                           Set to :memory: to store in memory (faster).\n");
+        printf("  --portdb-backend memory  Keep port information in hash tables instead of sqlite\n");
+        printf("                           (faster), the --portdb file then logs the changes.\n");
         printf("  --subdb subs.db          Store subscription information in named database.\n");
         printf("                           Must not be on an NFS file system.\n");
         printf("                           Set to :memory: to store in memory (faster).\n");
@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/serversql/impl/MemoryTripleSource.h>
+
+#include <yarp/os/Bottle.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#else
+#include <io.h>
+#define fsync(fd) _commit(fd)
+#define fileno(f) _fileno(f)
+#endif
+
+using yarp::os::Bottle;
+using namespace yarp::serversql::impl;
+
+
+namespace {
+
+// The log is rewritten as a snapshot once it has this many more lines
+// than there are triples.
+constexpr size_t logSlack = 1024;
+
+// The first line of the file, to tell it from other files
+// (e.g. a database of the sqlite backend).
+constexpr const char* fileHeader = "yarp_portdb_memory 1";
+
+int getRid(TripleContext *context)
+{
+    return (context != nullptr) ? context->rid : -1;
+}
+
+std::string keyField(bool has, const std::string& str)
+{
+    return has ? (std::to_string(str.length()) + ":" + str) : std::string("~");
+}
+
+std::string nameKey(int rid, const Triple& t)
+{
+    return std::to_string(rid) + "|" + keyField(t.hasNs, t.ns) + keyField(t.hasName, t.name);
+}
+
+std::string valueKey(int rid, const Triple& t)
+{
+    return nameKey(rid, t) + keyField(t.hasValue, t.value);
+}
+
+// A field of a pattern matches anything if it is "*", only missing
+// fields if it is missing, and equal fields otherwise.
+bool isExact(bool has, const std::string& pattern)
+{
+    return !has || pattern != "*";
+}
+
+bool matches(bool hasPattern, const std::string& pattern, bool has, const std::string& str)
+{
+    if (!hasPattern) {
+        return !has;
+    }
+    return pattern == "*" || (has && str == pattern);
+}
+
+// Missing fields first, like NULLs in the index of the sqlite table.
+bool lessField(bool has1, const std::string& str1, bool has2, const std::string& str2)
+{
+    if (has1 != has2) {
+        return !has1;
+    }
+    return str1 < str2;
+}
+
+} // namespace
+
+
+MemoryTripleSource::MemoryTripleSource() :
+        nextId(1),
+        file(nullptr),
+        cautious(false),
+        inTransaction(false),
+        logged(0)
+{
+}
+
+MemoryTripleSource::~MemoryTripleSource()
+{
+    close();
+}
+
+bool MemoryTripleSource::open(const std::string& filename, bool cautious)
+{
+    close();
+    this->filename = filename;
+    this->cautious = cautious;
+    if (!load()) {
+        fprintf(stderr, "Failed to read %s, or it is not a database of the memory backend\n", filename.c_str());
+        return false;
+    }
+    if (!writeSnapshot()) {
+        fprintf(stderr, "Failed to write %s\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+void MemoryTripleSource::close()
+{
+    if (file != nullptr) {
+        flushLog();
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+std::vector<int> MemoryTripleSource::match(const Triple& t, int rid) const
+{
+    std::vector<int> ids;
+    const std::unordered_set<int> *candidates = nullptr;
+    if (isExact(t.hasNs, t.ns) && isExact(t.hasName, t.name)) {
+        if (isExact(t.hasValue, t.value)) {
+            auto it = byValue.find(valueKey(rid, t));
+            candidates = (it != byValue.end()) ? &it->second : nullptr;
+        } else {
+            auto it = byName.find(nameKey(rid, t));
+            candidates = (it != byName.end()) ? &it->second : nullptr;
+        }
+    } else {
+        auto it = byRid.find(rid);
+        candidates = (it != byRid.end()) ? &it->second : nullptr;
+    }
+    if (candidates == nullptr) {
+        return ids;
+    }
+    for (int id : *candidates) {
+        const Triple& row = rows.at(id).triple;
+        if (matches(t.hasNs, t.ns, row.hasNs, row.ns) &&
+            matches(t.hasName, t.name, row.hasName, row.name) &&
+            matches(t.hasValue, t.value, row.hasValue, row.value)) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+int MemoryTripleSource::find(Triple& t, TripleContext *context)
+{
+    std::vector<int> ids = match(t, getRid(context));
+    if (ids.empty()) {
+        return -1;
+    }
+    if (ids.size() > 1) {
+        fprintf(stderr,"*** WARNING: multiple matches ignored\n");
+    }
+    return *std::min_element(ids.begin(), ids.end());
+}
+
+void MemoryTripleSource::prune(TripleContext *context)
+{
+    YARP_UNUSED(context);
+    std::vector<int> orphans;
+    for (const auto& row : rows) {
+        if (row.second.rid != -1 && rows.find(row.second.rid) == rows.end()) {
+            orphans.push_back(row.first);
+        }
+    }
+    for (int id : orphans) {
+        erase(id);
+    }
+}
+
+std::list<Triple> MemoryTripleSource::query(Triple& ti, TripleContext *context)
+{
+    std::vector<int> ids = match(ti, getRid(context));
+    std::sort(ids.begin(), ids.end(), [this](int id1, int id2) {
+        const Triple& t1 = rows.at(id1).triple;
+        const Triple& t2 = rows.at(id2).triple;
+        if (t1.hasName != t2.hasName || t1.name != t2.name) {
+            return lessField(t1.hasName, t1.name, t2.hasName, t2.name);
+        }
+        if (t1.hasValue != t2.hasValue || t1.value != t2.value) {
+            return lessField(t1.hasValue, t1.value, t2.hasValue, t2.value);
+        }
+        return id1 < id2;
+    });
+    std::list<Triple> q;
+    for (int id : ids) {
+        q.push_back(rows.at(id).triple);
+    }
+    return q;
+}
+
+void MemoryTripleSource::remove_query(Triple& ti, TripleContext *context)
+{
+    for (int id : match(ti, getRid(context))) {
+        erase(id);
+    }
+}
+
+void MemoryTripleSource::insert(Triple& t, TripleContext *context)
+{
+    add(nextId, getRid(context), t);
+}
+
+void MemoryTripleSource::update(Triple& t, TripleContext *context)
+{
+    if (t.hasName || t.hasNs) {
+        Triple t2(t);
+        t2.value = "*";
+        std::vector<int> ids = match(t2, getRid(context));
+        for (int id : ids) {
+            setValue(id, t);
+        }
+        if (ids.empty()) {
+            insert(t, context);
+        }
+    } else if (rows.find(getRid(context)) != rows.end()) {
+        setValue(getRid(context), t);
+    }
+}
+
+void MemoryTripleSource::begin(TripleContext *context)
+{
+    YARP_UNUSED(context);
+    inTransaction = true;
+}
+
+void MemoryTripleSource::end(TripleContext *context)
+{
+    YARP_UNUSED(context);
+    inTransaction = false;
+    flushLog();
+}
+
+void MemoryTripleSource::add(int id, int rid, const Triple& t)
+{
+    Row row;
+    row.rid = rid;
+    if (t.hasNs) {
+        row.triple.hasNs = true;
+        row.triple.ns = t.ns;
+    }
+    if (t.hasName) {
+        row.triple.hasName = true;
+        row.triple.name = t.name;
+    }
+    if (t.hasValue) {
+        row.triple.hasValue = true;
+        row.triple.value = t.value;
+    }
+    nextId = std::max(nextId, id + 1);
+    index(id, row);
+    logRow(id, rows.emplace(id, row).first->second);
+}
+
+void MemoryTripleSource::erase(int id)
+{
+    auto it = rows.find(id);
+    if (it == rows.end()) {
+        return;
+    }
+    unindex(id, it->second);
+    rows.erase(it);
+    log("del " + std::to_string(id));
+}
+
+void MemoryTripleSource::setValue(int id, const Triple& t)
+{
+    Row& row = rows.at(id);
+    unindex(id, row);
+    row.triple.hasValue = t.hasValue;
+    row.triple.value = t.hasValue ? t.value : std::string();
+    index(id, row);
+    logRow(id, row);
+}
+
+void MemoryTripleSource::index(int id, const Row& row)
+{
+    byValue[valueKey(row.rid, row.triple)].insert(id);
+    byName[nameKey(row.rid, row.triple)].insert(id);
+    byRid[row.rid].insert(id);
+}
+
+void MemoryTripleSource::unindex(int id, const Row& row)
+{
+    auto removeFrom = [id](auto& map, const auto& key) {
+        auto it = map.find(key);
+        if (it != map.end()) {
+            it->second.erase(id);
+            if (it->second.empty()) {
+                map.erase(it);
+            }
+        }
+    };
+    removeFrom(byValue, valueKey(row.rid, row.triple));
+    removeFrom(byName, nameKey(row.rid, row.triple));
+    removeFrom(byRid, row.rid);
+}
+
+void MemoryTripleSource::log(const std::string& line)
+{
+    if (file == nullptr) {
+        return;
+    }
+    pending += line;
+    pending += '\n';
+    logged++;
+    if (verbose) {
+        printf("Log: %s\n", line.c_str());
+    }
+    if (!inTransaction) {
+        flushLog();
+    }
+}
+
+std::string MemoryTripleSource::rowLine(int id, const Row& row)
+{
+    const Triple& t = row.triple;
+    Bottle b;
+    b.addString("set");
+    b.addInt32(id);
+    b.addInt32(row.rid);
+    b.addInt32((t.hasNs ? 1 : 0) | (t.hasName ? 2 : 0) | (t.hasValue ? 4 : 0));
+    b.addString(t.ns);
+    b.addString(t.name);
+    b.addString(t.value);
+    return b.toString();
+}
+
+void MemoryTripleSource::logRow(int id, const Row& row)
+{
+    if (file != nullptr) {
+        log(rowLine(id, row));
+    }
+}
+
+void MemoryTripleSource::flushLog()
+{
+    if (file == nullptr || pending.empty()) {
+        return;
+    }
+    if (fwrite(pending.c_str(), 1, pending.length(), file) != pending.length()) {
+        fprintf(stderr, "Failed to write to %s\n", filename.c_str());
+    }
+    pending.clear();
+    fflush(file);
+    if (cautious) {
+        fsync(fileno(file));
+    }
+    if (logged > rows.size() * 2 + logSlack) {
+        writeSnapshot();
+    }
+}
+
+bool MemoryTripleSource::load()
+{
+    FILE *in = fopen(filename.c_str(), "r");
+    if (in == nullptr) {
+        // nothing stored yet
+        return true;
+    }
+    std::string line;
+    int ch = 0;
+    bool first = true;
+    while ((ch = fgetc(in)) != EOF) {
+        if (ch != '\n' && !(first && line.length() > strlen(fileHeader))) {
+            line += static_cast<char>(ch);
+            continue;
+        }
+        if (first) {
+            if (line != fileHeader) {
+                // not written by this class, do not touch it
+                fclose(in);
+                return false;
+            }
+            first = false;
+            line.clear();
+            continue;
+        }
+        Bottle b(line);
+        line.clear();
+        std::string op = b.get(0).asString();
+        int id = b.get(1).asInt32();
+        if (op == "del" && b.size() == 2) {
+            erase(id);
+        } else if (op == "set" && b.size() == 7) {
+            int flags = b.get(3).asInt32();
+            Triple t;
+            t.hasNs = (flags & 1) != 0;
+            t.ns = b.get(4).asString();
+            t.hasName = (flags & 2) != 0;
+            t.name = b.get(5).asString();
+            t.hasValue = (flags & 4) != 0;
+            t.value = b.get(6).asString();
+            erase(id);
+            add(id, b.get(2).asInt32(), t);
+        }
+        // anything else is a line that was being written when the
+        // server was stopped, the changes it had are lost.
+    }
+    fclose(in);
+    // an empty file has nothing stored yet, anything else needs a header
+    return !first || line.empty();
+}
+
+bool MemoryTripleSource::writeSnapshot()
+{
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+    std::string tmpname = filename + ".tmp";
+    FILE *out = fopen(tmpname.c_str(), "w");
+    if (out == nullptr) {
+        return false;
+    }
+    std::vector<int> ids;
+    ids.reserve(rows.size());
+    for (const auto& row : rows) {
+        ids.push_back(row.first);
+    }
+    std::sort(ids.begin(), ids.end());
+    std::string snapshot = fileHeader;
+    snapshot += '\n';
+    for (int id : ids) {
+        snapshot += rowLine(id, rows.at(id));
+        snapshot += '\n';
+    }
+    bool ok = fwrite(snapshot.c_str(), 1, snapshot.length(), out) == snapshot.length();
+    ok = (fflush(out) == 0) && ok;
+    fsync(fileno(out));
+    fclose(out);
+    if (!ok) {
+        return false;
+    }
+#if defined(_WIN32)
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        return false;
+    }
+    file = fopen(filename.c_str(), "a");
+    logged = rows.size();
+    return file != nullptr;
+}
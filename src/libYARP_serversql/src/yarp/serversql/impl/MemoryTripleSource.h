@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SERVERSQL_IMPL_MEMORYTRIPLESOURCE_H
+#define YARP_SERVERSQL_IMPL_MEMORYTRIPLESOURCE_H
+
+#include <yarp/serversql/impl/Triple.h>
+#include <yarp/serversql/impl/TripleSource.h>
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace yarp {
+namespace serversql {
+namespace impl {
+
+/**
+ *
+ * A collection of triples kept in memory, with the same behavior as
+ * the tags table of a SqliteTripleSource.
+ *
+ * The triples are indexed by hash tables on (rid,ns,name,value), on
+ * (rid,ns,name) and on rid, so that each of the lookups done by the
+ * name server only looks at the matching triples.
+ *
+ * If a file is given to open(), the changes are appended to it as a
+ * log, written out at the end of each transaction.  The file is read
+ * back when opening, and it is rewritten as a snapshot of the triples
+ * when the log gets too long.  The file starts with a header line;
+ * open() fails, leaving the file alone, if an existing file does not
+ * (e.g. a database of the sqlite backend).
+ *
+ * Like SqliteTripleSource, it does not lock: its users must serialize
+ * the accesses.
+ *
+ */
+class MemoryTripleSource : public TripleSource {
+public:
+    MemoryTripleSource();
+
+    ~MemoryTripleSource() override;
+
+    /**
+     * Start keeping the triples in a file.
+     *
+     * @param filename the file, created if it does not exist
+     * @param cautious if true, the file is synced to disk at the end of
+     *                 each transaction
+     * @return true if the file could be read and opened
+     */
+    bool open(const std::string& filename, bool cautious);
+
+    void close();
+
+    int find(Triple& t, TripleContext *context) override;
+
+    void prune(TripleContext *context) override;
+
+    std::list<Triple> query(Triple& ti, TripleContext *context) override;
+
+    void remove_query(Triple& ti, TripleContext *context) override;
+
+    void insert(Triple& t, TripleContext *context) override;
+
+    void update(Triple& t, TripleContext *context) override;
+
+    void begin(TripleContext *context) override;
+
+    void end(TripleContext *context) override;
+
+private:
+    struct Row {
+        int rid;
+        Triple triple;
+    };
+
+    std::vector<int> match(const Triple& t, int rid) const;
+    void add(int id, int rid, const Triple& t);
+    void erase(int id);
+    void setValue(int id, const Triple& t);
+    void index(int id, const Row& row);
+    void unindex(int id, const Row& row);
+
+    static std::string rowLine(int id, const Row& row);
+    void log(const std::string& line);
+    void logRow(int id, const Row& row);
+    void flushLog();
+    bool load();
+    bool writeSnapshot();
+
+    std::unordered_map<int, Row> rows;
+    std::unordered_map<std::string, std::unordered_set<int>> byValue;
+    std::unordered_map<std::string, std::unordered_set<int>> byName;
+    std::unordered_map<int, std::unordered_set<int>> byRid;
+    int nextId;
+
+    std::string filename;
+    FILE *file;
+    bool cautious;
+    bool inTransaction;
+    std::string pending;
+    size_t logged;
+};
+
+} // namespace impl
+} // namespace serversql
+} // namespace yarp
+
+
+#endif // YARP_SERVERSQL_IMPL_MEMORYTRIPLESOURCE_H
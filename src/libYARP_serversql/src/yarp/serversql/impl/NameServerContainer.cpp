@@ -92,12 +92,15 @@ bool NameServerContainer::open(Searchable& options)
 
     std::string ip = options.check("ip",Value("...")).asString();
     int sock = options.check("socket",Value(Network::getDefaultPortRange())).asInt32();
+    std::string backend = options.check("portdb-backend",
+                                        Value("sqlite")).asString();
     bool cautious = options.check("cautious");
     bool verbose = options.check("verbose");
 
     if (!silent) {
-        printf("Using port database: %s\n",
-               dbFilename.c_str());
+        printf("Using port database: %s (%s)\n",
+               dbFilename.c_str(),
+               backend.c_str());
         printf("Using subscription database: %s\n",
                subdbFilename.c_str());
         if (dbFilename!=":memory:" || subdbFilename!=":memory:") {
@@ -114,7 +117,7 @@ bool NameServerContainer::open(Searchable& options)
         reset = true;
     }
 
-    TripleSource *pmem = db.open(dbFilename.c_str(),cautious,reset);
+    TripleSource *pmem = db.open(dbFilename.c_str(),cautious,reset,backend);
     if (pmem == nullptr) {
         fprintf(stderr,"Aborting, ports database failed to open.\n");
         return false;
@@ -12,18 +12,15 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
 
 #include <sqlite3.h>
 
 #include <yarp/serversql/impl/Triple.h>
 #include <yarp/serversql/impl/TripleSource.h>
 
-#ifdef _MSC_VER
-#define safe_printf sprintf_s
-#else
-#define safe_printf snprintf
-#endif
-
 
 namespace yarp {
 namespace serversql {
@@ -35,48 +32,147 @@ namespace impl {
  * minimum functions needed by the name server to use a Sqlite
  * database.
  *
+ * The statements are prepared once for each form of query, with the
+ * values bound as parameters, and kept for reuse.
+ *
  */
 class SqliteTripleSource : public TripleSource {
 private:
     sqlite3 *db;
+    std::map<std::string, sqlite3_stmt*> statements;
+
+    /**
+     * The values bound to the parameters of a statement, in order.
+     * A parameter is either a rid, or a text that may be NULL.
+     */
+    struct Parameter {
+        int rid;
+        const char *text;
+    };
+    using Binding = std::vector<Parameter>;
+
+    /**
+     * A cached statement, with its values bound.  It is reset when done.
+     */
+    class Statement {
+    public:
+        Statement(sqlite3_stmt *statement) : statement(statement) {
+        }
+
+        Statement(Statement&& other) noexcept : statement(other.statement) {
+            other.statement = nullptr;
+        }
+
+        Statement(const Statement&) = delete;
+        Statement& operator=(const Statement&) = delete;
+        Statement& operator=(Statement&&) = delete;
+
+        ~Statement() {
+            if (statement != nullptr) {
+                sqlite3_reset(statement);
+                sqlite3_clear_bindings(statement);
+            }
+        }
+
+        bool ok() const {
+            return statement != nullptr;
+        }
+
+        int step() {
+            return sqlite3_step(statement);
+        }
+
+        sqlite3_stmt *get() const {
+            return statement;
+        }
+
+    private:
+        sqlite3_stmt *statement;
+    };
+
+    Statement prepare(const std::string& query, const Binding& binding) {
+        if (verbose) {
+            printf("Query: %s\n", query.c_str());
+        }
+        sqlite3_stmt *statement = nullptr;
+        auto it = statements.find(query);
+        if (it != statements.end()) {
+            statement = it->second;
+        } else {
+            int result = sqlite3_prepare_v2(db, query.c_str(), -1, &statement, nullptr);
+            if (result!=SQLITE_OK) {
+                printf("Error in query\n");
+                sqlite3_finalize(statement);
+                return Statement(nullptr);
+            }
+            statements[query] = statement;
+        }
+        int index = 1;
+        for (const Parameter& parameter : binding) {
+            if (parameter.rid!=-1) {
+                sqlite3_bind_int(statement, index++, parameter.rid);
+            } else if (parameter.text != nullptr) {
+                sqlite3_bind_text(statement, index++, parameter.text, -1, SQLITE_TRANSIENT);
+            } else {
+                sqlite3_bind_null(statement, index++);
+            }
+        }
+        return Statement(statement);
+    }
+
+    bool run(const std::string& query, const Binding& binding) {
+        Statement statement = prepare(query, binding);
+        if (!statement.ok()) {
+            return false;
+        }
+        int result = statement.step();
+        if (result!=SQLITE_DONE) {
+            fprintf(stderr,"Error: %s\n", sqlite3_errmsg(db));
+            fprintf(stderr,"(Query was): %s\n", query.c_str());
+            return false;
+        }
+        return true;
+    }
+
 public:
     SqliteTripleSource(sqlite3 *db) : db(db) {
     }
 
-    std::string condition(Triple& t, TripleContext *context) {
+    ~SqliteTripleSource() override {
+        for (auto& statement : statements) {
+            sqlite3_finalize(statement.second);
+        }
+    }
+
+    std::string condition(Triple& t, TripleContext *context, Binding& binding) {
         int rid = (context != nullptr) ? context->rid : -1;
         std::string cond = "";
         if (rid==-1) {
             cond = "rid IS NULL";
         } else {
-            cond = "rid = " + expressContext(context);
+            cond = "rid = ?";
+            binding.push_back({rid, nullptr});
         }
         if (t.hasNs) {
             if (t.ns!="*") {
-                char *query = nullptr;
-                query = sqlite3_mprintf(" AND ns = %Q",t.getNs());
-                cond = cond + query;
-                sqlite3_free(query);
+                cond += " AND ns = ?";
+                binding.push_back({-1, t.getNs()});
             }
         } else {
             cond += " AND ns IS NULL";
         }
         if (t.hasName) {
             if (t.name!="*") {
-                char *query = nullptr;
-                query = sqlite3_mprintf(" AND name = %Q",t.getName());
-                cond = cond + query;
-                sqlite3_free(query);
+                cond += " AND name = ?";
+                binding.push_back({-1, t.getName()});
             }
         } else {
             cond += " AND name IS NULL";
         }
         if (t.hasValue) {
             if (t.value!="*") {
-                char *query = nullptr;
-                query = sqlite3_mprintf(" AND value = %Q",t.getValue());
-                cond = cond + query;
-                sqlite3_free(query);
+                cond += " AND value = ?";
+                binding.push_back({-1, t.getValue()});
             }
         } else {
             cond += " AND value IS NULL";
@@ -86,75 +182,41 @@ public:
 
     int find(Triple& t, TripleContext *context) override {
         int out = -1;
-        sqlite3_stmt *statement = nullptr;
-        char *query = nullptr;
-        query = sqlite3_mprintf("SELECT id FROM tags WHERE %s",
-                                condition(t,context).c_str());
-        if (verbose) {
-            printf("Query: %s\n", query);
-        }
-        int result = sqlite3_prepare_v2(db, query, -1, &statement, nullptr);
-        if (result!=SQLITE_OK) {
-            printf("Error in query\n");
-        }
-        while (result == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW) {
+        Binding binding;
+        Statement statement = prepare("SELECT id FROM tags WHERE " + condition(t,context,binding),
+                                      binding);
+        while (statement.ok() && statement.step() == SQLITE_ROW) {
             if (out!=-1) {
                 fprintf(stderr,"*** WARNING: multiple matches ignored\n");
             }
-            out = sqlite3_column_int(statement,0);
+            out = sqlite3_column_int(statement.get(),0);
             //printf("Match %d\n", out);
         }
         //if (out==-1) {
         //printf("No match for %s\n", t.toString().c_str());
         //}
-        sqlite3_finalize(statement);
-        sqlite3_free(query);
         return out;
     }
 
     void remove_query(Triple& ti, TripleContext *context) override {
-        char *query = nullptr;
-        query = sqlite3_mprintf("DELETE FROM tags WHERE %s",condition(ti,context).c_str());
-        if (verbose) {
-            printf("Query: %s\n", query);
-        }
-        int result = sqlite3_exec(db, query, nullptr, nullptr, nullptr);
-        if (result!=SQLITE_OK) {
-            printf("Error in query\n");
-        }
-        sqlite3_free(query);
+        Binding binding;
+        run("DELETE FROM tags WHERE " + condition(ti,context,binding), binding);
     }
 
     void prune(TripleContext *context) override {
-        char *query = nullptr;
-        query = sqlite3_mprintf("DELETE FROM tags WHERE rid IS NOT NULL AND rid  NOT IN (SELECT id FROM tags)");
-        if (verbose) {
-            printf("Query: %s\n", query);
-        }
-        int result = sqlite3_exec(db, query, nullptr, nullptr, nullptr);
-        if (result!=SQLITE_OK) {
-            printf("Error in query\n");
-        }
-        sqlite3_free(query);
+        run("DELETE FROM tags WHERE rid IS NOT NULL AND rid  NOT IN (SELECT id FROM tags)", Binding());
     }
 
     std::list<Triple> query(Triple& ti, TripleContext *context) override {
         std::list<Triple> q;
-        sqlite3_stmt *statement = nullptr;
-        char *query = nullptr;
-        query = sqlite3_mprintf("SELECT id, ns, name, value FROM tags WHERE %s",condition(ti,context).c_str());
-        if (verbose) {
-            printf("Query: %s\n", query);
-        }
-        int result = sqlite3_prepare_v2(db, query, -1, &statement, nullptr);
-        if (result!=SQLITE_OK) {
-            printf("Error in query\n");
-        }
-        while (result == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW) {
-            //int id = sqlite3_column_int(statement,0);
-            char *ns = (char *)sqlite3_column_text(statement,1);
-            char *name = (char *)sqlite3_column_text(statement,2);
-            char *value = (char *)sqlite3_column_text(statement,3);
+        Binding binding;
+        Statement statement = prepare("SELECT id, ns, name, value FROM tags WHERE " + condition(ti,context,binding),
+                                      binding);
+        while (statement.ok() && statement.step() == SQLITE_ROW) {
+            //int id = sqlite3_column_int(statement.get(),0);
+            char *ns = (char *)sqlite3_column_text(statement.get(),1);
+            char *name = (char *)sqlite3_column_text(statement.get(),2);
+            char *value = (char *)sqlite3_column_text(statement.get(),3);
             Triple t;
             if (ns != nullptr) {
                 t.ns = ns;
@@ -170,91 +232,63 @@ public:
             }
             q.push_back(t);
         }
-        sqlite3_finalize(statement);
-        sqlite3_free(query);
         return q;
     }
 
-    std::string expressContext(TripleContext *context) {
-        int rid = (context != nullptr)?context->rid:-1;
-        char buf[100] = "NULL";
-        if (rid!=-1) {
-            safe_printf(buf,100,"%d",rid);
-        }
-        return buf;
-    }
-
     void insert(Triple& t, TripleContext *context) override {
-        char *msg = nullptr;
-        char *query = sqlite3_mprintf("INSERT INTO tags (rid,ns,name,value) VALUES(%s,%Q,%Q,%Q)",
-                                      expressContext(context).c_str(),
-                                      t.getNs(),t.getName(),t.getValue());
-        if (verbose) {
-            printf("Query: %s\n", query);
+        int rid = (context != nullptr) ? context->rid : -1;
+        Binding binding;
+        if (rid!=-1) {
+            binding.push_back({rid, nullptr});
         }
-        int result = sqlite3_exec(db, query, nullptr, nullptr, &msg);
-        if (result!=SQLITE_OK) {
-            if (msg != nullptr) {
-                fprintf(stderr,"Error: %s\n", msg);
-                fprintf(stderr,"(Query was): %s\n", query);
-                fprintf(stderr,"(Location): %s:%d\n", __FILE__, __LINE__);
-                if (verbose) {
-                    std::exit(1);
-                }
-                sqlite3_free(msg);
+        binding.push_back({-1, t.getNs()});
+        binding.push_back({-1, t.getName()});
+        binding.push_back({-1, t.getValue()});
+        bool ok = run((rid==-1) ?
+                          "INSERT INTO tags (rid,ns,name,value) VALUES(NULL,?,?,?)" :
+                          "INSERT INTO tags (rid,ns,name,value) VALUES(?,?,?,?)",
+                      binding);
+        if (!ok) {
+            fprintf(stderr,"(Location): %s:%d\n", __FILE__, __LINE__);
+            if (verbose) {
+                std::exit(1);
             }
         }
-        sqlite3_free(query);
     }
 
     void update(Triple& t, TripleContext *context) override {
-        char *msg = nullptr;
-        char *query = nullptr;
+        Binding binding;
+        binding.push_back({-1, t.getValue()});
+        std::string query;
         if (t.hasName||t.hasNs) {
             Triple t2(t);
             t2.value = "*";
-            query = sqlite3_mprintf("UPDATE tags SET value = %Q WHERE %s",
-                                    t.getValue(),
-                                    condition(t2,context).c_str());
+            query = "UPDATE tags SET value = ? WHERE " + condition(t2,context,binding);
         } else {
-            query = sqlite3_mprintf("UPDATE tags SET value = %Q WHERE id = %Q",
-                                    t.getValue(),
-                                    expressContext(context).c_str());
-        }
-        if (verbose) {
-            printf("Query: %s\n", query);
-        }
-        int result = sqlite3_exec(db, query, nullptr, nullptr, &msg);
-        if (result!=SQLITE_OK) {
-            if (msg != nullptr) {
-                fprintf(stderr,"Error: %s\n", msg);
-                sqlite3_free(msg);
+            int rid = (context != nullptr) ? context->rid : -1;
+            if (rid!=-1) {
+                binding.push_back({rid, nullptr});
+                query = "UPDATE tags SET value = ? WHERE id = ?";
+            } else {
+                query = "UPDATE tags SET value = ? WHERE id IS NULL";
             }
         }
+        run(query, binding);
         int ct = sqlite3_changes(db);
         if (ct==0 && (t.hasName||t.hasNs)) {
             insert(t,context);
         }
-        sqlite3_free(query);
     }
 
 
     void begin(TripleContext *context) override {
-        int result = sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
-        if (verbose) {
-            printf("Query: BEGIN TRANSACTION;\n");
-        }
-        if (result!=SQLITE_OK) {
+        if (!run("BEGIN TRANSACTION;", Binding())) {
             printf("Error in BEGIN query\n");
         }
     }
 
     void end(TripleContext *context) override {
-        int result = sqlite3_exec(db, "END TRANSACTION;", nullptr, nullptr, nullptr);
-        if (verbose) {
-            printf("Query: END TRANSACTION;\n");
-        }
-        if (result!=SQLITE_OK) {
+        if (!run("END TRANSACTION;", Binding())) {
             printf("Error in END query\n");
         }
     }
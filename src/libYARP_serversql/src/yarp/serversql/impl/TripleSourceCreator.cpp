@@ -10,6 +10,7 @@
 #include <yarp/serversql/impl/TripleSourceCreator.h>
 
 #include <yarp/conf/compiler.h>
+#include <yarp/serversql/impl/MemoryTripleSource.h>
 #include <yarp/serversql/impl/SqliteTripleSource.h>
 
 #if !defined(_WIN32)
@@ -46,9 +47,11 @@ static bool sql_enact(sqlite3 *db, const char *cmd) {
 
 TripleSource *TripleSourceCreator::open(const char *filename,
                                         bool cautious,
-                                        bool fresh) {
+                                        bool fresh,
+                                        const std::string& backend) {
     sqlite3 *db = nullptr;
-    if (fresh) {
+    bool inMemory = (string(filename) == ":memory:");
+    if (fresh && !inMemory) {
         int result = access(filename,F_OK);
         if (result==0) {
             fprintf(stderr,"Database needs to be recreated.\n");
@@ -57,6 +60,22 @@ TripleSource *TripleSourceCreator::open(const char *filename,
         }
 
     }
+
+    if (backend == "memory") {
+        auto* mem = new MemoryTripleSource();
+        if (!inMemory && !mem->open(filename, cautious)) {
+            fprintf(stderr,"Failed to open database %s\n", filename);
+            delete mem;
+            return nullptr;
+        }
+        accessor = mem;
+        return accessor;
+    }
+    if (backend != "sqlite") {
+        fprintf(stderr,"Unknown database backend %s\n", backend.c_str());
+        return nullptr;
+    }
+
     int result = sqlite3_open_v2(filename,
                                  &db,
                                  SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE|SQLITE_OPEN_NOMUTEX,
@@ -13,6 +13,8 @@
 #include <yarp/serversql/impl/TripleSource.h>
 #include <yarp/conf/compiler.h>
 
+#include <string>
+
 
 namespace yarp {
 namespace serversql {
@@ -31,14 +33,26 @@ public:
     }
 
     virtual ~TripleSourceCreator() {
-        if (implementation != nullptr) {
+        if (implementation != nullptr || accessor != nullptr) {
             close();
         }
     }
 
+    /**
+     * Open a triple store.
+     *
+     * @param filename the database file, or ":memory:" to keep
+     *                 everything in memory
+     * @param cautious if true, changes are synced to disk
+     * @param fresh if true, fail if the database file already exists
+     * @param backend "sqlite" for a sqlite database, or "memory" for a
+     *                MemoryTripleSource, that keeps its changes in the
+     *                database file if one is given
+     */
     TripleSource *open(const char *filename,
                        bool cautious = false,
-                       bool fresh = false);
+                       bool fresh = false,
+                       const std::string& backend = "sqlite");
 
     bool close();
 
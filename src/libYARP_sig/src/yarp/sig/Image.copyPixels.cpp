@@ -10,6 +10,7 @@
 #include <yarp/os/Log.h>
 #include <yarp/sig/Image.h>
 #include <yarp/sig/impl/IplImage.h>
+#include <yarp/sig/impl/PixelConversion.h>
 
 #include <cstring>
 #include <cstdio>
@@ -1234,6 +1235,13 @@ void Image::copyPixels(const unsigned char *src, size_t id1,
         return;
     }
 
+    // The common conversions have row kernels, the others are done
+    // one pixel at a time.
+    if (impl::convertPixels(src, static_cast<int>(id1), dest, static_cast<int>(id2),
+                            w, h, quantum1, quantum2, topIsLow1!=topIsLow2)) {
+        return;
+    }
+
 
     switch(HASH(id1,id2)) {
         // Macros rely on len, x1, x2 variable names
@@ -24,10 +24,16 @@
 #include <yarp/sig/ImageNetworkHeader.h>
 #include <yarp/sig/impl/IplImage.h>
 #include <yarp/sig/impl/DeBayer.h>
+#include <yarp/sig/impl/ImageBufferPool.h>
+#include <yarp/sig/impl/ImageCodec.h>
+#include <yarp/sig/impl/ImageResampling.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
 
 
 using namespace yarp::sig;
@@ -66,6 +72,98 @@ inline bool readFromConnection(Image &dest, ImageNetworkHeader &header, Connecti
     return (!connection.isError() && ok);
 }
 
+/**
+* The rows of a view are not contiguous: each row is appended as an external
+* block, padded as the rows of an image with the default quantum, so that the
+* receiver reads a plain image.
+*/
+inline bool writeView(const Image& src, ImageNetworkHeader& header, ConnectionWriter& connection)
+{
+    static const char padding[YARP_IMAGE_ALIGN] = {};
+    size_t rowBytes = src.width() * src.getPixelSize();
+    size_t pad = yarp::sig::PAD_BYTES(rowBytes, YARP_IMAGE_ALIGN);
+    header.quantum = YARP_IMAGE_ALIGN;
+    header.imgSize = (rowBytes + pad) * src.height();
+    header.paramBlobLen = header.imgSize;
+
+    connection.appendBlock((char*)&header, sizeof(header));
+    const unsigned char* mem = src.getRawImage();
+    for (size_t r = 0; r < src.height(); r++) {
+        connection.appendExternalBlock((const char*)mem + r * src.getRowSize(), rowBytes);
+        if (pad != 0) {
+            connection.appendExternalBlock(padding, pad);
+        }
+    }
+
+    connection.convertTextMode();
+    return !connection.isError();
+}
+
+
+/**
+* A compressed image has the codec as sixth parameter, followed by the blob
+* of the compressed pixels (see ImageNetworkHeader).
+*/
+inline bool writeCompressed(ImageNetworkHeader& header, std::int32_t codec, const std::vector<unsigned char>& payload, ConnectionWriter& connection)
+{
+    header.paramListLen = 6;
+    // the header up to the height
+    connection.appendBlock((char*)&header, sizeof(header) - 2 * sizeof(NetInt32));
+    connection.appendInt32(codec);
+    connection.appendInt32(BOTTLE_TAG_BLOB);
+    connection.appendInt32(static_cast<std::int32_t>(payload.size()));
+    connection.appendBlock((const char*)payload.data(), payload.size());
+    return !connection.isError();
+}
+
+/**
+* The header of a compressed image was read up to its codec, in place of the
+* blob tag, and the blob tag, in place of the blob length.
+*/
+inline bool readCompressed(Image& dest, ImageNetworkHeader& header, ConnectionReader& connection)
+{
+    std::int32_t codec = header.paramBlobTag;
+    header.paramBlobTag = header.paramBlobLen;
+    header.paramBlobLen = connection.expectInt32();
+    if (connection.isError() || header.paramBlobLen < 0) {
+        return false;
+    }
+
+    // A compressed image is never larger than the raw image, which bounds
+    // the memory a peer can make us allocate.
+    if (header.width < 0 || header.height < 0 || header.depth <= 0 ||
+        (size_t)header.paramBlobLen > (size_t)header.width * (size_t)header.height * (size_t)header.depth) {
+        return false;
+    }
+
+    // The payload is taken from the pool of image buffers, so that it is
+    // reused by the next images without staying pinned to this thread.
+    struct Payload
+    {
+        size_t capacity {0};
+        unsigned char* data {nullptr};
+        ~Payload() { yarp::sig::impl::releaseImageBuffer(data, capacity); }
+    } buffer;
+    const size_t length = header.paramBlobLen;
+    buffer.data = static_cast<unsigned char*>(yarp::sig::impl::acquireImageBuffer(length, buffer.capacity));
+    if (!connection.expectBlock((char*)buffer.data, length) || connection.isError()) {
+        return false;
+    }
+    const unsigned char* payload = buffer.data;
+
+    if (dest.getPixelCode() == header.id) {
+        dest.resize(header.width, header.height);
+        return yarp::sig::impl::decodeImage(codec, payload, length, dest);
+    }
+    FlexImage flex;
+    flex.setPixelCode(header.id);
+    flex.resize(header.width, header.height);
+    if (!yarp::sig::impl::decodeImage(codec, payload, length, flex)) {
+        return false;
+    }
+    dest.copy(flex);
+    return true;
+}
 
 
 class ImageStorage {
@@ -77,6 +175,11 @@ public:
     size_t quantum;
     bool topIsLow;
 
+    // the image is a view of a region of another image (see
+    // Image::setView), whose rows are not contiguous
+    bool is_view;
+    std::shared_ptr<const Image> viewParent;
+
 protected:
     Image& owner;
 
@@ -84,12 +187,22 @@ protected:
 
     int is_owner;
 
+    // the capacities of the image data (when owned) and of the row
+    // pointers, taken from the pool of image buffers
+    size_t dataCapacity;
+    size_t rowsCapacity;
+
+    // the header of the last image, kept to be reused by the next one
+    IplImage* spareHeader;
+
     // ipl allocation is done in two steps.
     // _alloc allocates the actual ipl pointer.
     // _alloc_data allocates the image array and data.
     // memory is allocated in a single chunk. Row ptrs are then
     // made to point appropriately. This is compatible with IPL and
     // SOMEONE says it's more efficient on NT.
+    // Both are taken from the process-wide pool of image buffers, and
+    // given back to it when the image is resized or destroyed.
     void _alloc ();
     void _alloc_extern (const void *buf);
     void _alloc_data ();
@@ -123,10 +236,17 @@ public:
         topIsLow = true;
         extern_type_id = 0;
         extern_type_quantum = -1;
+        dataCapacity = 0;
+        rowsCapacity = 0;
+        spareHeader = nullptr;
+        is_view = false;
     }
 
     ~ImageStorage() {
         _free_complete();
+        if (spareHeader != nullptr) {
+            iplDeallocate (spareHeader, IPL_IMAGE_HEADER);
+        }
     }
 
     void resize(size_t x, size_t y, int pixel_type,
@@ -164,12 +284,13 @@ void ImageStorage::_alloc () {
 
     _free(); // was iplDeallocateImage(pImage); but that won't work with refs
 
-    if ((type_id == VOCAB_PIXEL_MONO_FLOAT) ||
-        (type_id == VOCAB_PIXEL_RGB_FLOAT)  ||
-        (type_id == VOCAB_PIXEL_HSV_FLOAT))
-        iplAllocateImageFP(pImage, 0, 0);
+    // as iplAllocateImage, with a buffer from the pool
+    yAssert(pImage->imageSize == pImage->widthStep * pImage->height);
+    pImage->imageData = (char*)yarp::sig::impl::acquireImageBuffer(pImage->imageSize, dataCapacity);
+    if (pImage->origin == IPL_ORIGIN_TL)
+        pImage->imageDataOrigin = pImage->imageData + pImage->imageSize - pImage->widthStep;
     else
-        iplAllocateImage (pImage, 0, 0);
+        pImage->imageDataOrigin = pImage->imageData;
 
     iplSetBorderMode (pImage, IPL_BORDER_CONSTANT, IPL_SIDE_ALL, 0);
 }
@@ -180,9 +301,7 @@ void ImageStorage::_alloc_extern (const void *buf)
     yAssert(pImage != nullptr);
     yAssert(Data==nullptr);
 
-    if (pImage != nullptr)
-        if (pImage->imageData != nullptr)
-            iplDeallocateImage (pImage);
+    _free();
 
     //iplAllocateImage (pImage, 0, 0);
     pImage->imageData = (char*)buf;
@@ -199,7 +318,7 @@ void ImageStorage::_alloc_data ()
 
     yAssert(Data==nullptr);
 
-    char **ptr = new char *[pImage->height];
+    auto** ptr = (char**)yarp::sig::impl::acquireImageBuffer(pImage->height * sizeof(char*), rowsCapacity);
 
     Data = ptr;
 
@@ -230,17 +349,17 @@ void ImageStorage::_free ()
             {
                 if (is_owner)
                     {
-                        iplDeallocateImage (pImage);
+                        yarp::sig::impl::releaseImageBuffer(pImage->imageData, dataCapacity);
                         if (Data!=nullptr)
                             {
-                                delete[] Data;
+                                yarp::sig::impl::releaseImageBuffer(Data, rowsCapacity);
                             }
                     }
                 else
                     {
                         if (Data!=nullptr)
                             {
-                                delete[] Data;
+                                yarp::sig::impl::releaseImageBuffer(Data, rowsCapacity);
                             }
                     }
 
@@ -261,6 +380,8 @@ void ImageStorage::_free_complete()
     _free();
     _free_data();
     _free_ipl_header();
+    is_view = false;
+    viewParent.reset();
 }
 
 
@@ -268,7 +389,14 @@ void ImageStorage::_free_ipl_header()
 {
     if (pImage!=nullptr)
         {
-            iplDeallocate (pImage, IPL_IMAGE_HEADER);
+            if (spareHeader == nullptr)
+                {
+                    spareHeader = pImage;
+                }
+            else
+                {
+                    iplDeallocate (pImage, IPL_IMAGE_HEADER);
+                }
         }
     pImage = nullptr;
 }
@@ -335,8 +463,8 @@ bool ImageStorage::_set_ipl_header(size_t x, size_t y, int pixel_type, size_t qu
                                    bool topIsLow)
 {
     if (pImage != nullptr) {
-        iplDeallocateImage(pImage);
-        pImage = nullptr;
+        _free();
+        _free_ipl_header();
     }
 
     if (pixel_type == VOCAB_PIXEL_INVALID) {
@@ -356,7 +484,12 @@ bool ImageStorage::_set_ipl_header(size_t x, size_t y, int pixel_type, size_t qu
     }
     int origin = topIsLow ? IPL_ORIGIN_TL : IPL_ORIGIN_BL;
 
-    pImage = iplCreateImageHeader(param.nChannels, 0, param.depth, const_cast<char*>(param.colorModel), const_cast<char*>(param.channelSeq), IPL_DATA_ORDER_PIXEL, origin, quantum, x, y, nullptr, nullptr, nullptr, nullptr);
+    if (spareHeader != nullptr) {
+        pImage = iplInitImageHeader(spareHeader, param.nChannels, 0, param.depth, const_cast<char*>(param.colorModel), const_cast<char*>(param.channelSeq), IPL_DATA_ORDER_PIXEL, origin, quantum, x, y, nullptr, nullptr, nullptr, nullptr);
+        spareHeader = nullptr;
+    } else {
+        pImage = iplCreateImageHeader(param.nChannels, 0, param.depth, const_cast<char*>(param.colorModel), const_cast<char*>(param.channelSeq), IPL_DATA_ORDER_PIXEL, origin, quantum, x, y, nullptr, nullptr, nullptr, nullptr);
+    }
 
     type_id = pixel_type;
     this->quantum = quantum;
@@ -455,6 +588,13 @@ int Image::getPixelCode() const {
 
 void Image::zero() {
     if (getRawImage()!=nullptr) {
+        if (isView()) {
+            // the rows are shared with the rest of the parent image
+            for (size_t r=0; r<height(); r++) {
+                memset(getRow(r),0,width()*getPixelSize());
+            }
+            return;
+        }
         memset(getRawImage(),0,getRawImageSize());
     }
 }
@@ -687,6 +827,11 @@ bool Image::read(yarp::os::ConnectionReader& connection) {
         }
     }
 
+    // the image was compressed for this connection
+    if (header.paramListLen == 6) {
+        return readCompressed(*this, header, connection);
+    }
+
     // handle easy case, received and current image are compatible, no conversion needed
     if (getPixelCode() == header.id && q == (size_t) header.quantum && imgPixelSize == (size_t) header.depth)
     {
@@ -777,6 +922,28 @@ bool Image::write(yarp::os::ConnectionWriter& connection) const {
     header.paramBlobLen = getRawImageSize();
     */
 
+    // the connections asking for a codec (e.g. tcp+codec.jpeg+quality.80)
+    // get the image compressed, if the codec can encode it and the
+    // compressed image is smaller
+    if (!connection.isTextMode() && header.width != 0 && header.height != 0) {
+        const Searchable& modifiers = connection.getConnectionModifiers();
+        if (modifiers.check("codec")) {
+            std::int32_t codec = yarp::sig::impl::chooseImageCodec(modifiers.find("codec").asString(), *this);
+            if (codec != ImageNetworkHeader::codecRaw) {
+                // reused by the next images written by this thread
+                static thread_local std::vector<unsigned char> payload;
+                int quality = modifiers.check("quality", Value(90)).asInt32();
+                if (yarp::sig::impl::encodeImage(*this, codec, quality, payload) && payload.size() < (size_t)header.imgSize) {
+                    return writeCompressed(header, codec, payload, connection);
+                }
+            }
+        }
+    }
+
+    if (isView()) {
+        return writeView(*this, header, connection);
+    }
+
     connection.appendBlock((char*)&header,sizeof(header));
     unsigned char *mem = getRawImage();
     if (header.width!=0&&header.height!=0) {
@@ -833,7 +1000,8 @@ bool Image::copy(const Image& alt)
         int myCode = getPixelCode();
         if (myCode==0) {
             setPixelCode(alt.getPixelCode());
-            setQuantum(alt.getQuantum());
+            // the quantum of a view is the row size of its parent
+            setQuantum(alt.isView() ? 0 : alt.getQuantum());
         }
         resize(alt.width(),alt.height());
         int q1 = alt.getQuantum();
@@ -848,7 +1016,8 @@ bool Image::copy(const Image& alt)
         yAssert(height()==alt.height());
         if (getPixelCode()==alt.getPixelCode()) {
             if (getQuantum()==alt.getQuantum()) {
-                yAssert(getRawImageSize()==alt.getRawImageSize());
+                // a view ends with its last pixel, not with a whole row
+                yAssert(getRawImageSize()==alt.getRawImageSize() || alt.isView());
                 yAssert(q1==q2);
             }
         }
@@ -856,7 +1025,7 @@ bool Image::copy(const Image& alt)
         copyPixels(alt.getRawImage(),alt.getPixelCode(),
                    getRawImage(),getPixelCode(),
                    width(),height(),
-                   getRawImageSize(),q1,q2,o1,o2);
+                   std::min(getRawImageSize(),alt.getRawImageSize()),q1,q2,o1,o2);
     }
     return true;
 }
@@ -876,15 +1045,63 @@ void Image::setExternal(const void *data, size_t imgWidth, size_t imgHeight) {
 }
 
 
+bool Image::setView(const Image& parent, size_t x, size_t y, size_t w, size_t h) {
+    if (&parent==this || w==0 || h==0 || x+w>parent.width() || y+h>parent.height()) {
+        return false;
+    }
+    // ImageOf has a fixed pixel type, FlexImage takes the one of the parent
+    setPixelCode(parent.getPixelCode());
+    if (getPixelCode()!=parent.getPixelCode()) {
+        setPixelCode(getPixelCode());
+        return false;
+    }
+
+    // The lowest row in memory is the last one if the origin is at the
+    // bottom.  A quantum of the row size of the parent gives rows of
+    // that size.
+    const unsigned char* first = parent.getPixelAddress(x, parent.topIsLowIndex() ? y : y+h-1);
+    size_t rowSize = parent.getRowSize();
+    setQuantum(rowSize);
+    setTopIsLowIndex(parent.topIsLowIndex());
+    auto* impl = (ImageStorage*)implementation;
+    impl->_alloc_complete_extern(first, w, h, getPixelCode(), rowSize, topIsLow);
+    // the last row ends with the last pixel of the region, that may be
+    // the last pixel of the parent
+    impl->pImage->imageSize = (h-1)*rowSize + w*getPixelSize();
+    impl->is_view = true;
+    synchronize();
+    return true;
+}
+
+
+bool Image::setView(std::shared_ptr<const Image> parent, size_t x, size_t y, size_t w, size_t h) {
+    if (!parent || !setView(*parent, x, y, w, h)) {
+        return false;
+    }
+    ((ImageStorage*)implementation)->viewParent = std::move(parent);
+    return true;
+}
+
+
+bool Image::isView() const {
+    return ((const ImageStorage*)implementation)->is_view;
+}
+
+
 bool Image::copy(const Image& alt, size_t w, size_t h) {
+    return copy(alt, w, h, Resampling::Nearest);
+}
+
+
+bool Image::copy(const Image& alt, size_t w, size_t h, Resampling filter) {
     if (getPixelCode()==0) {
         setPixelCode(alt.getPixelCode());
-        setQuantum(alt.getQuantum());
+        setQuantum(alt.isView() ? 0 : alt.getQuantum());
     }
     if (&alt==this) {
         FlexImage img;
         img.copy(alt);
-        return copy(img,w,h);
+        return copy(img,w,h,filter);
     }
 
     if (getPixelCode()!=alt.getPixelCode()) {
@@ -892,30 +1109,13 @@ bool Image::copy(const Image& alt, size_t w, size_t h) {
         img.setPixelCode(getPixelCode());
         img.setQuantum(getQuantum());
         img.copy(alt);
-        return copy(img,w,h);
+        return copy(img,w,h,filter);
     }
 
     resize(w,h);
-    size_t d = getPixelSize();
-
-    size_t nw = w;
-    size_t nh = h;
-    w = alt.width();
-    h = alt.height();
-
-    float di = ((float)h)/nh;
-    float dj = ((float)w)/nw;
-
-    for (size_t i=0; i<nh; i++)
-        {
-            auto i0 = (size_t)(di*i);
-            for (size_t j=0; j<nw; j++)
-                {
-                    auto j0 = (size_t)(dj*j);
-                    memcpy(getPixelAddress(j,i),
-                           alt.getPixelAddress(j0,i0),
-                           d);
-                }
-        }
+    if (filter != Resampling::Nearest && yarp::sig::impl::resampleFiltered(alt, *this, filter)) {
+        return true;
+    }
+    yarp::sig::impl::resampleNearest(alt, *this);
     return true;
 }
@@ -17,6 +17,7 @@
 #include <yarp/os/Vocab.h>
 #include <yarp/sig/api.h>
 #include <map>
+#include <memory>
 
 namespace yarp {
     /**
@@ -145,6 +146,29 @@ public:
      */
     bool copy(const Image& alt, size_t w, size_t h);
 
+    /**
+     * The filters used to scale an image.
+     */
+    enum class Resampling
+    {
+        Nearest,  ///< the nearest pixel, fast but aliased
+        Bilinear, ///< the 4 nearest pixels, weighted by their distance
+        Area      ///< the average of the pixels covered, best to shrink an image
+    };
+
+    /**
+     * Scaled copy, with a choice of filter.
+     * The mono, color, signed, integer and floating point pixel types
+     * can be filtered, the others (e.g. hsv and bayer images) are
+     * scaled with Resampling::Nearest.  Large images are scaled by
+     * several threads.
+     * @param alt the image to copy
+     * @param w target width for image
+     * @param h target height for image
+     * @param filter the filter used to compute each pixel
+     */
+    bool copy(const Image& alt, size_t w, size_t h, Resampling filter);
+
 
     /**
      * Gets width of image in pixels.
@@ -270,6 +294,40 @@ public:
      */
     void setExternal(const void *data, size_t imgWidth, size_t imgHeight);
 
+    /**
+     * Make this image a view of a region of another image, sharing its
+     * pixels instead of copying them (e.g. to split a stereo image).
+     * The rows of the view are those of the parent image, so its
+     * padding quantum is the row size of the parent.  The view is sent
+     * by write() without copying its pixels, and received as a plain
+     * image.  As with setExternal(), the parent must not be resized or
+     * destroyed while the view is used, and resizing the view turns it
+     * into an image of its own.
+     * @param parent the image whose pixels are shared, with the same
+     * pixel type (a FlexImage takes the pixel type of the parent)
+     * @param x the left column of the region
+     * @param y the top row of the region
+     * @param w the width of the region
+     * @param h the height of the region
+     * @return false if the region is empty or not inside the parent,
+     * or if the pixel types differ
+     */
+    bool setView(const Image& parent, size_t x, size_t y, size_t w, size_t h);
+
+    /**
+     * Make this image a view of a region of an image shared with
+     * std::shared_ptr, see setView(const Image&, size_t, size_t, size_t, size_t).
+     * The view keeps a reference to the parent, so that its pixels
+     * stay valid when the other references are released.  The reference
+     * is released when the view is resized, set up again or destroyed.
+     */
+    bool setView(std::shared_ptr<const Image> parent, size_t x, size_t y, size_t w, size_t h);
+
+    /**
+     * @return true if the image is a view of another image, see setView()
+     */
+    bool isView() const;
+
     /**
     * Access to the internal image buffer.
     * @return pointer to the internal image buffer.
@@ -17,6 +17,8 @@
 
 #include <yarp/sig/Image.h>
 
+#include <cstdint>
+
 namespace yarp {
     namespace sig {
         class ImageNetworkHeader;
@@ -27,6 +29,14 @@ namespace yarp {
  *
  * Byte order in image header for network transmission.
  *
+ * An image is sent as `(mat <id> (depth imgSize quantum width height) <pixels>)`.
+ * A compressed image has a sixth parameter, its codec, and the blob holds
+ * the compressed pixels: `(mat <id> (depth imgSize quantum width height codec) <payload>)`.
+ * The header is then followed by the codec, the blob tag and the blob length,
+ * which are not part of this structure.  The images are compressed only on
+ * the connections asking for a codec (e.g. `tcp+codec.jpeg`), so that the
+ * other readers keep receiving the images they know.
+ *
  */
 YARP_BEGIN_PACK
 class yarp::sig::ImageNetworkHeader
@@ -49,6 +59,21 @@ public:
     yarp::os::NetInt32 paramBlobTag;
     yarp::os::NetInt32 paramBlobLen;
 
+    /**
+     * The codecs of the compressed images.
+     */
+    enum Codec : std::int32_t
+    {
+        /// The pixels are not compressed.
+        codecRaw = 0,
+        /// JPEG, lossy, for MONO, RGB and BGR images.
+        codecJpeg = yarp::os::createVocab('j','p','e','g'),
+        /// QOI-style lossless codec, for images of 3 or 4 channels of 8 bits.
+        codecQoi = yarp::os::createVocab('q','o','i'),
+        /// Lossless codec for depth images (MONO, MONO16, MONO_FLOAT and INT).
+        codecDepth = yarp::os::createVocab('d','e','p','t')
+    };
+
     ImageNetworkHeader() : listTag(0), listLen(0), paramNameTag(0),
                            paramName(0), paramIdTag(0), id(0),
                            paramListTag(0), paramListLen(0), depth(0),
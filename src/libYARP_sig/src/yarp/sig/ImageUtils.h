@@ -27,6 +27,7 @@ namespace utils
  * @param outImgL[out] left half of inImg.
  * @param outImgR[out] right half of inImg.
  * @note The input image must have same height, double width of the output images and same pixel type.
+ * @note The pixels are copied, Image::setView() splits an image without copying them.
  * @return true on success, false otherwise.
  */
 bool YARP_sig_API vertSplit(const yarp::sig::Image& inImg, yarp::sig::Image& outImgL, yarp::sig::Image& outImgR);
@@ -37,6 +38,7 @@ bool YARP_sig_API vertSplit(const yarp::sig::Image& inImg, yarp::sig::Image& out
  * @param outImgUp[out] top half of inImg.
  * @param outImgDown[out] bottom half of inImg.
  * @note The input image must have same height, double width of the output images and same pixel type.
+ * @note The pixels are copied, Image::setView() splits an image without copying them.
  * @return true on success, false otherwise.
  */
 bool YARP_sig_API horzSplit(const yarp::sig::Image& inImg, yarp::sig::Image& outImgUp, yarp::sig::Image& outImgDown);
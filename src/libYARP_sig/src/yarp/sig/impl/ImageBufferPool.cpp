@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/sig/impl/ImageBufferPool.h>
+
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/*
+  The buffers given back are kept in a free list for each size class,
+  and the most recently given back buffer of a class is the first one
+  reused.  A class covers a quarter of a power of two, so at most 25%
+  of a buffer is wasted, and images whose sizes change a little (e.g.
+  the row padding) share their buffers.  An image resized to the same
+  class takes back the buffer it has just released, so that streaming
+  images of a few sizes allocates nothing once each size was seen.
+*/
+
+using namespace yarp::sig::impl;
+
+namespace {
+
+constexpr size_t minClassBits = 6; // the smallest class is 64 bytes
+constexpr size_t subBits = 2;      // 4 classes for each power of two
+constexpr size_t classes = 1 + ((sizeof(size_t) * 8 - minClassBits) << subBits);
+
+size_t classOf(size_t size)
+{
+    if (size <= (size_t{1} << minClassBits)) {
+        return 0;
+    }
+    size_t s = size - 1;
+    size_t bits = minClassBits;
+    while ((s >> (bits + 1)) != 0) {
+        bits++;
+    }
+    size_t sub = (s - (size_t{1} << bits)) >> (bits - subBits);
+    return 1 + ((bits - minClassBits) << subBits) + sub;
+}
+
+size_t capacityOf(size_t sizeClass)
+{
+    if (sizeClass == 0) {
+        return size_t{1} << minClassBits;
+    }
+    size_t bits = minClassBits + ((sizeClass - 1) >> subBits);
+    size_t sub = (sizeClass - 1) & ((size_t{1} << subBits) - 1);
+    return (size_t{1} << bits) + ((sub + 1) << (bits - subBits));
+}
+
+// The pointer returned by operator new is stored just before the
+// aligned buffer.
+void* allocateAligned(size_t capacity)
+{
+    void* raw = ::operator new(capacity + imageBufferAlignment);
+    auto aligned = (reinterpret_cast<std::uintptr_t>(raw) + imageBufferAlignment) & ~(imageBufferAlignment - 1);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void freeAligned(void* buffer)
+{
+    ::operator delete(reinterpret_cast<void**>(buffer)[-1]);
+}
+
+class ImageBufferPool
+{
+public:
+    void* acquire(size_t size, size_t& capacity)
+    {
+        size_t sizeClass = classOf(size);
+        capacity = capacityOf(sizeClass);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<void*>& list = free[sizeClass];
+            if (!list.empty()) {
+                void* buffer = list.back();
+                list.pop_back();
+                stats.hits++;
+                stats.pooledBuffers--;
+                stats.pooledBytes -= capacity;
+                return buffer;
+            }
+            stats.misses++;
+        }
+        return allocateAligned(capacity);
+    }
+
+    void release(void* buffer, size_t capacity)
+    {
+        if (buffer == nullptr) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stats.pooledBytes + capacity <= limit) {
+                free[classOf(capacity)].push_back(buffer);
+                stats.recycled++;
+                stats.pooledBuffers++;
+                stats.pooledBytes += capacity;
+                return;
+            }
+            stats.discarded++;
+        }
+        freeAligned(buffer);
+    }
+
+    ImageBufferPoolStats getStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.hits = 0;
+        stats.misses = 0;
+        stats.recycled = 0;
+        stats.discarded = 0;
+    }
+
+    void setLimit(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        limit = bytes;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::vector<void*>& list : free) {
+            for (void* buffer : list) {
+                freeAligned(buffer);
+            }
+            list.clear();
+        }
+        stats.pooledBuffers = 0;
+        stats.pooledBytes = 0;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<void*> free[classes];
+    size_t limit {size_t{128} << 20};
+    ImageBufferPoolStats stats;
+};
+
+// Never destroyed, since images can be destroyed by static destructors
+// of other translation units.
+ImageBufferPool& pool()
+{
+    static auto* instance = new ImageBufferPool;
+    return *instance;
+}
+
+} // namespace
+
+
+void* yarp::sig::impl::acquireImageBuffer(size_t size, size_t& capacity)
+{
+    return pool().acquire(size, capacity);
+}
+
+void yarp::sig::impl::releaseImageBuffer(void* buffer, size_t capacity)
+{
+    pool().release(buffer, capacity);
+}
+
+ImageBufferPoolStats yarp::sig::impl::getImageBufferPoolStats()
+{
+    return pool().getStats();
+}
+
+void yarp::sig::impl::resetImageBufferPoolStats()
+{
+    pool().resetStats();
+}
+
+void yarp::sig::impl::setImageBufferPoolLimit(size_t bytes)
+{
+    pool().setLimit(bytes);
+}
+
+void yarp::sig::impl::clearImageBufferPool()
+{
+    pool().clear();
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SIG_IMPL_IMAGEBUFFERPOOL_H
+#define YARP_SIG_IMPL_IMAGEBUFFERPOOL_H
+
+#include <yarp/sig/api.h>
+
+#include <cstddef>
+
+namespace yarp {
+namespace sig {
+namespace impl {
+
+/**
+ * The alignment, in bytes, of the buffers of the pool.
+ */
+constexpr size_t imageBufferAlignment = 64;
+
+/**
+ * Statistics about the pool of image buffers.
+ */
+struct ImageBufferPoolStats
+{
+    size_t hits {0};          ///< buffers taken from the pool
+    size_t misses {0};        ///< buffers allocated because the pool had none of their size
+    size_t recycled {0};      ///< buffers given back to the pool
+    size_t discarded {0};     ///< buffers freed because the pool was full
+    size_t pooledBuffers {0}; ///< buffers currently in the pool
+    size_t pooledBytes {0};   ///< bytes currently in the pool
+};
+
+/**
+ * Get a buffer from the process-wide pool of image buffers, allocating
+ * it if the pool has none of this size.
+ *
+ * The sizes are rounded up to classes (4 for each power of two), so that
+ * a buffer can be reused by images of slightly different sizes.
+ * @param size the bytes needed
+ * @param[out] capacity the size of the buffer, to be passed to
+ * releaseImageBuffer()
+ * @return a buffer aligned to imageBufferAlignment bytes
+ */
+void* acquireImageBuffer(size_t size, size_t& capacity);
+
+/**
+ * Give a buffer back to the pool, or free it if the pool is full.
+ * @param buffer a buffer returned by acquireImageBuffer(), or nullptr
+ * @param capacity the capacity returned with the buffer
+ */
+void releaseImageBuffer(void* buffer, size_t capacity);
+
+/**
+ * @return the statistics of the pool
+ */
+YARP_sig_API ImageBufferPoolStats getImageBufferPoolStats();
+
+/**
+ * Reset the hits, misses, recycled and discarded counters.
+ */
+YARP_sig_API void resetImageBufferPoolStats();
+
+/**
+ * Set the maximum number of bytes kept in the pool (128 MiB by default).
+ * The buffers given back when the pool is full are freed.
+ * @param bytes the limit, 0 to disable the pool
+ */
+YARP_sig_API void setImageBufferPoolLimit(size_t bytes);
+
+/**
+ * Free all the buffers in the pool.
+ */
+YARP_sig_API void clearImageBufferPool();
+
+} // namespace impl
+} // namespace sig
+} // namespace yarp
+
+#endif // YARP_SIG_IMPL_IMAGEBUFFERPOOL_H
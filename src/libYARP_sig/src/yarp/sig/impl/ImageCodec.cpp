@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/sig/impl/ImageCodec.h>
+
+#include <yarp/sig/ImageNetworkHeader.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#if YARP_HAS_JPEG_C
+#include "jpeglib.h"
+#include "jerror.h"
+#endif
+
+/*
+  The codecs compress the rows in memory order, as the raw images are
+  sent, without their padding.
+
+  The QOI-style codec is the "Quite OK Image" format without its file
+  header and end marker: each pixel is a run of the previous pixel, a
+  reference to a recently seen pixel, a small difference from the
+  previous pixel, or the pixel itself.
+
+  The depth codec predicts each pixel from its left neighbour (the
+  first pixel of a row from the pixel above), and writes the residuals,
+  zigzag encoded, as varints.  The runs of zero residuals, frequent in
+  the flat and invalid areas of the depth images, are written as a
+  single varint.  The floats are handled as their bits.
+*/
+
+using yarp::sig::Image;
+using yarp::sig::ImageNetworkHeader;
+
+namespace {
+
+const unsigned char* rowOf(const Image& image, size_t r)
+{
+    return image.getRawImage() + r * image.getRowSize();
+}
+
+unsigned char* rowOf(Image& image, size_t r)
+{
+    return image.getRawImage() + r * image.getRowSize();
+}
+
+bool canEncode(std::int32_t codec, int code)
+{
+    switch (codec) {
+    case ImageNetworkHeader::codecQoi:
+        return code == VOCAB_PIXEL_RGB || code == VOCAB_PIXEL_BGR || code == VOCAB_PIXEL_HSV ||
+               code == VOCAB_PIXEL_RGBA || code == VOCAB_PIXEL_BGRA;
+    case ImageNetworkHeader::codecDepth:
+        return code == VOCAB_PIXEL_MONO || code == VOCAB_PIXEL_MONO16 ||
+               code == VOCAB_PIXEL_MONO_FLOAT || code == VOCAB_PIXEL_INT;
+#if YARP_HAS_JPEG_C
+    case ImageNetworkHeader::codecJpeg:
+#    ifdef JCS_EXTENSIONS
+        return code == VOCAB_PIXEL_MONO || code == VOCAB_PIXEL_RGB || code == VOCAB_PIXEL_BGR;
+#    else
+        return code == VOCAB_PIXEL_MONO || code == VOCAB_PIXEL_RGB;
+#    endif
+#endif
+    default:
+        return false;
+    }
+}
+
+
+// QOI-style codec
+
+constexpr unsigned char qoiOpIndex = 0x00;
+constexpr unsigned char qoiOpDiff = 0x40;
+constexpr unsigned char qoiOpLuma = 0x80;
+constexpr unsigned char qoiOpRun = 0xc0;
+constexpr unsigned char qoiOpRgb = 0xfe;
+constexpr unsigned char qoiOpRgba = 0xff;
+constexpr unsigned char qoiMask = 0xc0;
+constexpr size_t qoiMaxRun = 62;
+
+size_t qoiHash(const unsigned char* px)
+{
+    return (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+}
+
+template <size_t C>
+void encodeQoi(const Image& src, std::vector<unsigned char>& out)
+{
+    const size_t w = src.width();
+    const size_t h = src.height();
+    out.clear();
+    out.reserve(w * h * (C + 1));
+
+    unsigned char index[64][4] = {};
+    unsigned char prev[4] = {0, 0, 0, 255};
+    unsigned char px[4] = {0, 0, 0, 255};
+    size_t run = 0;
+    for (size_t y = 0; y < h; y++) {
+        const unsigned char* p = rowOf(src, y);
+        for (size_t x = 0; x < w; x++, p += C) {
+            memcpy(px, p, C);
+            if (memcmp(px, prev, 4) == 0) {
+                run++;
+                if (run == qoiMaxRun) {
+                    out.push_back(qoiOpRun | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out.push_back(qoiOpRun | (run - 1));
+                run = 0;
+            }
+            size_t hash = qoiHash(px);
+            if (memcmp(index[hash], px, 4) == 0) {
+                out.push_back(qoiOpIndex | hash);
+            } else {
+                memcpy(index[hash], px, 4);
+                if (px[3] == prev[3]) {
+                    auto vr = static_cast<signed char>(px[0] - prev[0]);
+                    auto vg = static_cast<signed char>(px[1] - prev[1]);
+                    auto vb = static_cast<signed char>(px[2] - prev[2]);
+                    auto vgr = static_cast<signed char>(vr - vg);
+                    auto vgb = static_cast<signed char>(vb - vg);
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        out.push_back(qoiOpDiff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                        out.push_back(qoiOpLuma | (vg + 32));
+                        out.push_back((vgr + 8) << 4 | (vgb + 8));
+                    } else {
+                        out.push_back(qoiOpRgb);
+                        out.insert(out.end(), px, px + 3);
+                    }
+                } else {
+                    out.push_back(qoiOpRgba);
+                    out.insert(out.end(), px, px + 4);
+                }
+            }
+            memcpy(prev, px, 4);
+        }
+    }
+    if (run > 0) {
+        out.push_back(qoiOpRun | (run - 1));
+    }
+}
+
+template <size_t C>
+bool decodeQoi(const unsigned char* data, size_t length, Image& dest)
+{
+    const size_t w = dest.width();
+    const size_t h = dest.height();
+    unsigned char index[64][4] = {};
+    unsigned char px[4] = {0, 0, 0, 255};
+    size_t run = 0;
+    size_t pos = 0;
+    for (size_t y = 0; y < h; y++) {
+        unsigned char* p = rowOf(dest, y);
+        for (size_t x = 0; x < w; x++, p += C) {
+            if (run > 0) {
+                run--;
+            } else {
+                if (pos >= length) {
+                    return false;
+                }
+                unsigned char b1 = data[pos++];
+                if (b1 == qoiOpRgb) {
+                    if (length - pos < 3) {
+                        return false;
+                    }
+                    memcpy(px, data + pos, 3);
+                    pos += 3;
+                } else if (b1 == qoiOpRgba) {
+                    if (length - pos < 4) {
+                        return false;
+                    }
+                    memcpy(px, data + pos, 4);
+                    pos += 4;
+                } else if ((b1 & qoiMask) == qoiOpIndex) {
+                    memcpy(px, index[b1], 4);
+                } else if ((b1 & qoiMask) == qoiOpDiff) {
+                    px[0] += ((b1 >> 4) & 0x03) - 2;
+                    px[1] += ((b1 >> 2) & 0x03) - 2;
+                    px[2] += (b1 & 0x03) - 2;
+                } else if ((b1 & qoiMask) == qoiOpLuma) {
+                    if (pos >= length) {
+                        return false;
+                    }
+                    unsigned char b2 = data[pos++];
+                    int vg = (b1 & 0x3f) - 32;
+                    px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+                    px[1] += vg;
+                    px[2] += vg - 8 + (b2 & 0x0f);
+                } else {
+                    run = b1 & 0x3f;
+                }
+                memcpy(index[qoiHash(px)], px, 4);
+            }
+            memcpy(p, px, C);
+        }
+    }
+    return pos == length && run == 0;
+}
+
+
+// Depth codec
+
+void putVarint(std::vector<unsigned char>& out, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+bool getVarint(const unsigned char* data, size_t length, size_t& pos, std::uint64_t& v)
+{
+    v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= length) {
+            return false;
+        }
+        unsigned char b = data[pos++];
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class U>
+U loadPixel(const unsigned char* p)
+{
+    U v;
+    memcpy(&v, p, sizeof(U));
+    return v;
+}
+
+template <class U>
+void encodeDepth(const Image& src, std::vector<unsigned char>& out)
+{
+    using S = typename std::make_signed<U>::type;
+    const size_t w = src.width();
+    const size_t h = src.height();
+    out.clear();
+    out.reserve(w * h * (sizeof(U) + 1));
+
+    std::uint64_t run = 0;
+    for (size_t y = 0; y < h; y++) {
+        const unsigned char* row = rowOf(src, y);
+        U pred = (y > 0) ? loadPixel<U>(rowOf(src, y - 1)) : 0;
+        for (size_t x = 0; x < w; x++) {
+            U v = loadPixel<U>(row + x * sizeof(U));
+            auto residual = static_cast<std::int64_t>(static_cast<S>(static_cast<U>(v - pred)));
+            pred = v;
+            auto zigzag = (static_cast<std::uint64_t>(residual) << 1) ^ static_cast<std::uint64_t>(residual >> 63);
+            if (zigzag == 0) {
+                run++;
+                continue;
+            }
+            if (run > 0) {
+                putVarint(out, ((run - 1) << 1) | 1);
+                run = 0;
+            }
+            putVarint(out, zigzag << 1);
+        }
+    }
+    if (run > 0) {
+        putVarint(out, ((run - 1) << 1) | 1);
+    }
+}
+
+template <class U>
+bool decodeDepth(const unsigned char* data, size_t length, Image& dest)
+{
+    const size_t w = dest.width();
+    const size_t h = dest.height();
+    std::uint64_t run = 0;
+    size_t pos = 0;
+    for (size_t y = 0; y < h; y++) {
+        unsigned char* row = rowOf(dest, y);
+        U pred = (y > 0) ? loadPixel<U>(rowOf(dest, y - 1)) : 0;
+        for (size_t x = 0; x < w; x++) {
+            U residual = 0;
+            if (run > 0) {
+                run--;
+            } else {
+                std::uint64_t token;
+                if (!getVarint(data, length, pos, token)) {
+                    return false;
+                }
+                if ((token & 1) != 0) {
+                    // this pixel is the first of the run
+                    run = token >> 1;
+                } else {
+                    std::uint64_t zigzag = token >> 1;
+                    residual = static_cast<U>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+                }
+            }
+            pred = static_cast<U>(pred + residual);
+            memcpy(row + x * sizeof(U), &pred, sizeof(U));
+        }
+    }
+    return pos == length && run == 0;
+}
+
+
+#if YARP_HAS_JPEG_C
+
+// The errors of libjpeg jump back to the function that called it,
+// instead of exiting.
+struct JpegError
+{
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr cinfo)
+{
+    std::longjmp(reinterpret_cast<JpegError*>(cinfo->err)->jump, 1);
+}
+
+void jpegOutputMessage(j_common_ptr /*cinfo*/)
+{
+}
+
+// Destination writing into a vector, grown as needed.
+struct JpegDestination
+{
+    jpeg_destination_mgr pub;
+    std::vector<unsigned char>* out;
+};
+
+void jpegInitDestination(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<JpegDestination*>(cinfo->dest);
+    dest->out->resize(std::max<size_t>(dest->out->capacity(), 4096));
+    dest->pub.next_output_byte = dest->out->data();
+    dest->pub.free_in_buffer = dest->out->size();
+}
+
+boolean jpegEmptyOutputBuffer(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<JpegDestination*>(cinfo->dest);
+    size_t used = dest->out->size();
+    dest->out->resize(used * 2);
+    dest->pub.next_output_byte = dest->out->data() + used;
+    dest->pub.free_in_buffer = dest->out->size() - used;
+    return TRUE;
+}
+
+void jpegTermDestination(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<JpegDestination*>(cinfo->dest);
+    dest->out->resize(dest->out->size() - dest->pub.free_in_buffer);
+}
+
+// Source reading from memory.
+void jpegInitSource(j_decompress_ptr /*cinfo*/)
+{
+}
+
+boolean jpegFillInputBuffer(j_decompress_ptr cinfo)
+{
+    // The data is truncated: end it, as the libjpeg sources do, with a
+    // warning.
+    static const JOCTET eoi[2] = {0xFF, JPEG_EOI};
+    WARNMS(cinfo, JWRN_JPEG_EOF);
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+}
+
+void jpegSkipInputData(j_decompress_ptr cinfo, long count)
+{
+    if (count > 0) {
+        size_t skipped = std::min(static_cast<size_t>(count), cinfo->src->bytes_in_buffer);
+        cinfo->src->next_input_byte += skipped;
+        cinfo->src->bytes_in_buffer -= skipped;
+    }
+}
+
+void jpegTermSource(j_decompress_ptr /*cinfo*/)
+{
+}
+
+bool jpegColorSpace(int code, J_COLOR_SPACE& space, int& components)
+{
+    switch (code) {
+    case VOCAB_PIXEL_MONO:
+        space = JCS_GRAYSCALE;
+        components = 1;
+        return true;
+    case VOCAB_PIXEL_RGB:
+        space = JCS_RGB;
+        components = 3;
+        return true;
+#    ifdef JCS_EXTENSIONS
+    case VOCAB_PIXEL_BGR:
+        space = JCS_EXT_BGR;
+        components = 3;
+        return true;
+#    endif
+    default:
+        return false;
+    }
+}
+
+// No object with a destructor can live between setjmp and the calls
+// that may jump back to it.
+bool encodeJpeg(const Image& src, int quality, std::vector<unsigned char>& out)
+{
+    J_COLOR_SPACE space;
+    int components;
+    if (!jpegColorSpace(src.getPixelCode(), space, components)) {
+        return false;
+    }
+
+    jpeg_compress_struct cinfo;
+    JpegError err;
+    JpegDestination dest;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpegErrorExit;
+    err.pub.output_message = jpegOutputMessage;
+    if (setjmp(err.jump) != 0) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    dest.pub.init_destination = jpegInitDestination;
+    dest.pub.empty_output_buffer = jpegEmptyOutputBuffer;
+    dest.pub.term_destination = jpegTermDestination;
+    dest.out = &out;
+    cinfo.dest = &dest.pub;
+
+    cinfo.image_width = static_cast<JDIMENSION>(src.width());
+    cinfo.image_height = static_cast<JDIMENSION>(src.height());
+    cinfo.input_components = components;
+    cinfo.in_color_space = space;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, std::min(std::max(quality, 1), 100), TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        auto row = const_cast<JSAMPROW>(rowOf(src, cinfo.next_scanline));
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+bool decodeJpeg(const unsigned char* data, size_t length, Image& dest)
+{
+    J_COLOR_SPACE space;
+    int components;
+    if (!jpegColorSpace(dest.getPixelCode(), space, components)) {
+        return false;
+    }
+
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    jpeg_source_mgr src;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpegErrorExit;
+    err.pub.output_message = jpegOutputMessage;
+    if (setjmp(err.jump) != 0) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    src.init_source = jpegInitSource;
+    src.fill_input_buffer = jpegFillInputBuffer;
+    src.skip_input_data = jpegSkipInputData;
+    src.resync_to_restart = jpeg_resync_to_restart;
+    src.term_source = jpegTermSource;
+    src.next_input_byte = data;
+    src.bytes_in_buffer = length;
+    cinfo.src = &src;
+
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = space;
+    jpeg_start_decompress(&cinfo);
+    if (cinfo.output_width != dest.width() || cinfo.output_height != dest.height() ||
+        cinfo.output_components != components) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = rowOf(dest, cinfo.output_scanline);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    bool ok = (err.pub.num_warnings == 0);
+    jpeg_destroy_decompress(&cinfo);
+    return ok;
+}
+
+#endif // YARP_HAS_JPEG_C
+
+} // namespace
+
+
+std::int32_t yarp::sig::impl::chooseImageCodec(const std::string& name, const Image& image)
+{
+    const int code = image.getPixelCode();
+    std::int32_t codec = ImageNetworkHeader::codecRaw;
+    if (name == "lossless") {
+        codec = canEncode(ImageNetworkHeader::codecQoi, code) ? ImageNetworkHeader::codecQoi : ImageNetworkHeader::codecDepth;
+    } else if (name == "qoi") {
+        codec = ImageNetworkHeader::codecQoi;
+    } else if (name == "depth") {
+        codec = ImageNetworkHeader::codecDepth;
+    } else if (name == "jpeg" || name == "jpg") {
+        codec = ImageNetworkHeader::codecJpeg;
+    }
+    return canEncode(codec, code) ? codec : ImageNetworkHeader::codecRaw;
+}
+
+
+bool yarp::sig::impl::encodeImage(const Image& src, std::int32_t codec, int quality, std::vector<unsigned char>& out)
+{
+#if !YARP_HAS_JPEG_C
+    YARP_UNUSED(quality);
+#endif
+    if (!canEncode(codec, src.getPixelCode())) {
+        return false;
+    }
+    switch (codec) {
+    case ImageNetworkHeader::codecQoi:
+        if (src.getPixelSize() == 4) {
+            encodeQoi<4>(src, out);
+        } else {
+            encodeQoi<3>(src, out);
+        }
+        return true;
+    case ImageNetworkHeader::codecDepth:
+        switch (src.getPixelSize()) {
+        case 1: encodeDepth<std::uint8_t>(src, out); return true;
+        case 2: encodeDepth<std::uint16_t>(src, out); return true;
+        case 4: encodeDepth<std::uint32_t>(src, out); return true;
+        default: return false;
+        }
+#if YARP_HAS_JPEG_C
+    case ImageNetworkHeader::codecJpeg:
+        return encodeJpeg(src, quality, out);
+#endif
+    default:
+        return false;
+    }
+}
+
+
+bool yarp::sig::impl::decodeImage(std::int32_t codec, const unsigned char* data, size_t length, Image& dest)
+{
+    if (!canEncode(codec, dest.getPixelCode())) {
+        return false;
+    }
+    switch (codec) {
+    case ImageNetworkHeader::codecQoi:
+        if (dest.getPixelSize() == 4) {
+            return decodeQoi<4>(data, length, dest);
+        }
+        return decodeQoi<3>(data, length, dest);
+    case ImageNetworkHeader::codecDepth:
+        switch (dest.getPixelSize()) {
+        case 1: return decodeDepth<std::uint8_t>(data, length, dest);
+        case 2: return decodeDepth<std::uint16_t>(data, length, dest);
+        case 4: return decodeDepth<std::uint32_t>(data, length, dest);
+        default: return false;
+        }
+#if YARP_HAS_JPEG_C
+    case ImageNetworkHeader::codecJpeg:
+        return decodeJpeg(data, length, dest);
+#endif
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SIG_IMPL_IMAGECODEC_H
+#define YARP_SIG_IMPL_IMAGECODEC_H
+
+#include <yarp/sig/Image.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace yarp {
+namespace sig {
+namespace impl {
+
+/**
+ * Choose the codec used to send an image on a connection.
+ * @param name the codec asked by the connection: "jpeg", "qoi", "depth",
+ * or "lossless" for the lossless codec of the pixel type of the image
+ * @param image the image to send
+ * @return the codec (see ImageNetworkHeader), or
+ * ImageNetworkHeader::codecRaw if the codec is unknown or cannot encode
+ * the pixel type of the image
+ */
+std::int32_t chooseImageCodec(const std::string& name, const Image& image);
+
+/**
+ * Compress an image.
+ * @param src the image to compress
+ * @param codec a codec returned by chooseImageCodec() for this image
+ * @param quality the quality of the lossy codecs, from 1 to 100
+ * @param[out] out the compressed image
+ * @return true on success
+ */
+bool encodeImage(const Image& src, std::int32_t codec, int quality, std::vector<unsigned char>& out);
+
+/**
+ * Decompress an image.
+ * @param codec the codec of the compressed image
+ * @param data the compressed image
+ * @param length the bytes of the compressed image
+ * @param dest the image, already resized, with the pixel type of the
+ * compressed image
+ * @return false if the codec is unknown or the data is corrupted
+ */
+bool decodeImage(std::int32_t codec, const unsigned char* data, size_t length, Image& dest);
+
+} // namespace impl
+} // namespace sig
+} // namespace yarp
+
+#endif // YARP_SIG_IMPL_IMAGECODEC_H
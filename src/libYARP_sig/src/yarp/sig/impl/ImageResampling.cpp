@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/sig/impl/ImageResampling.h>
+
+#include <yarp/conf/numeric.h>
+#include <yarp/sig/impl/PixelConversion.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__)
+#    define YARP_RESAMPLING_SSE2_AVAILABLE
+#    include <emmintrin.h>
+#endif
+
+/*
+  The filtered scaling is separable: each source row is filtered
+  horizontally into a row of floats, and the rows of floats are
+  combined vertically into each destination row.  The taps (source
+  pixels and weights) of the destination columns and rows are computed
+  once per image.  The rows of floats are kept while the next
+  destination rows use them, and the vertical pass and the conversion
+  back to 8 bit pixels use SSE2 when available.
+*/
+
+using yarp::sig::Image;
+
+namespace {
+
+// The source pixels and weights of each destination pixel along an axis,
+// with the same number of taps for all the pixels.
+struct Taps
+{
+    size_t count {0};
+    std::vector<size_t> index;
+    std::vector<float> weight;
+};
+
+Taps makeTaps(size_t srcLen, size_t destLen, Image::Resampling filter)
+{
+    Taps taps;
+    const double scale = static_cast<double>(srcLen) / destLen;
+    if (filter == Image::Resampling::Bilinear) {
+        taps.count = 2;
+    } else {
+        // the most source pixels a destination pixel can overlap
+        taps.count = static_cast<size_t>(std::ceil(scale)) + 1;
+    }
+    taps.index.resize(destLen * taps.count);
+    taps.weight.resize(destLen * taps.count);
+    for (size_t o = 0; o < destLen; o++) {
+        size_t* index = &taps.index[o * taps.count];
+        float* weight = &taps.weight[o * taps.count];
+        if (filter == Image::Resampling::Bilinear) {
+            // pixel centers are at half integers
+            double s = std::max((o + 0.5) * scale - 0.5, 0.0);
+            auto s0 = static_cast<size_t>(s);
+            double f = s - s0;
+            if (s0 >= srcLen - 1) {
+                s0 = srcLen - 1;
+                f = 0;
+            }
+            index[0] = s0;
+            index[1] = std::min(s0 + 1, srcLen - 1);
+            weight[0] = static_cast<float>(1 - f);
+            weight[1] = static_cast<float>(f);
+        } else {
+            double start = o * scale;
+            double end = start + scale;
+            auto s0 = static_cast<size_t>(start);
+            for (size_t k = 0; k < taps.count; k++) {
+                size_t s = s0 + k;
+                double overlap = std::min(end, s + 1.0) - std::max(start, static_cast<double>(s));
+                index[k] = std::min(s, srcLen - 1);
+                weight[k] = (s < srcLen && overlap > 0) ? static_cast<float>(overlap / scale) : 0.0F;
+            }
+        }
+    }
+    return taps;
+}
+
+
+// Horizontal pass, over a source row of C channels of type T.
+template <class T, size_t C>
+void filterRow(const unsigned char* srcRow, float* out, const Taps& taps, size_t destWidth)
+{
+    const T* src = reinterpret_cast<const T*>(srcRow);
+    const size_t* index = taps.index.data();
+    const float* weight = taps.weight.data();
+    for (size_t o = 0; o < destWidth; o++) {
+        float v[C] = {};
+        for (size_t k = 0; k < taps.count; k++) {
+            const T* p = src + index[k] * C;
+            for (size_t c = 0; c < C; c++) {
+                v[c] += weight[k] * static_cast<float>(p[c]);
+            }
+        }
+        for (size_t c = 0; c < C; c++) {
+            out[c] = v[c];
+        }
+        index += taps.count;
+        weight += taps.count;
+        out += C;
+    }
+}
+
+// Vertical pass, acc += w * row.
+void accumulate(float* acc, const float* row, float w, size_t n)
+{
+    size_t i = 0;
+#ifdef YARP_RESAMPLING_SSE2_AVAILABLE
+    const __m128 vw = _mm_set1_ps(w);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(row + i), vw));
+        _mm_storeu_ps(acc + i, x);
+    }
+#endif
+    for (; i < n; i++) {
+        acc[i] += w * row[i];
+    }
+}
+
+// Conversion back to the channel type, rounding to nearest and
+// saturating the integer types.
+template <class T>
+void storeRow(const float* acc, unsigned char* destRow, size_t n)
+{
+    T* dest = reinterpret_cast<T*>(destRow);
+    if (std::numeric_limits<T>::is_integer) {
+        const auto lo = static_cast<float>(std::numeric_limits<T>::lowest());
+        const auto hi = static_cast<float>(std::numeric_limits<T>::max());
+        for (size_t i = 0; i < n; i++) {
+            // the bounds of the 32 bit integers are not floats
+            long long v = std::llrint(std::min(std::max(acc[i], lo), hi));
+            dest[i] = static_cast<T>(std::min<long long>(std::max<long long>(v, std::numeric_limits<T>::lowest()),
+                                                         std::numeric_limits<T>::max()));
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            dest[i] = static_cast<T>(acc[i]);
+        }
+    }
+}
+
+#ifdef YARP_RESAMPLING_SSE2_AVAILABLE
+template <>
+void storeRow<unsigned char>(const float* acc, unsigned char* dest, size_t n)
+{
+    size_t i = 0;
+    // cvtps rounds to nearest even, like lrint, and the packs saturate.
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(acc + i));
+        __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 4));
+        __m128i c = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 8));
+        __m128i d = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 12));
+        __m128i x = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), x);
+    }
+    for (; i < n; i++) {
+        dest[i] = static_cast<unsigned char>(std::lrint(std::min(std::max(acc[i], 0.0F), 255.0F)));
+    }
+}
+#endif
+
+// The rows of floats of the source rows, filtered horizontally.  The
+// destination rows use increasing source rows, so the oldest row is the
+// one replaced.
+class RowCache
+{
+public:
+    RowCache(size_t size, size_t length) :
+            ids(size, std::numeric_limits<size_t>::max()),
+            rows(size, std::vector<float>(length)),
+            next(0)
+    {
+    }
+
+    template <class Filter>
+    const float* get(size_t id, Filter filter)
+    {
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (ids[i] == id) {
+                return rows[i].data();
+            }
+        }
+        size_t slot = next;
+        next = (next + 1) % ids.size();
+        ids[slot] = id;
+        filter(id, rows[slot].data());
+        return rows[slot].data();
+    }
+
+private:
+    std::vector<size_t> ids;
+    std::vector<std::vector<float>> rows;
+    size_t next;
+};
+
+template <class T, size_t C>
+void resample(const Image& src, Image& dest, Image::Resampling filter)
+{
+    const size_t destWidth = dest.width();
+    const size_t destHeight = dest.height();
+    const size_t length = destWidth * C;
+    const Taps columns = makeTaps(src.width(), destWidth, filter);
+    const Taps rows = makeTaps(src.height(), destHeight, filter);
+
+    yarp::sig::impl::forEachRowBand(destWidth, destHeight, [&](size_t first, size_t last) {
+        RowCache cache(rows.count + 1, length);
+        std::vector<float> acc(length);
+        auto filterSourceRow = [&](size_t y, float* out) {
+            filterRow<T, C>(src.getRow(y), out, columns, destWidth);
+        };
+        for (size_t y = first; y < last; y++) {
+            std::fill(acc.begin(), acc.end(), 0.0F);
+            for (size_t k = 0; k < rows.count; k++) {
+                float w = rows.weight[y * rows.count + k];
+                if (w != 0) {
+                    accumulate(acc.data(), cache.get(rows.index[y * rows.count + k], filterSourceRow), w, length);
+                }
+            }
+            storeRow<T>(acc.data(), dest.getRow(y), length);
+        }
+    });
+}
+
+template <size_t D>
+void copyNearestRow(const unsigned char* src, unsigned char* dest, const std::vector<size_t>& offsets)
+{
+    for (size_t offset : offsets) {
+        memcpy(dest, src + offset, D);
+        dest += D;
+    }
+}
+
+} // namespace
+
+
+void yarp::sig::impl::resampleNearest(const Image& src, Image& dest)
+{
+    const size_t nw = dest.width();
+    const size_t nh = dest.height();
+    const size_t w = src.width();
+    const size_t h = src.height();
+    if (nw == 0 || nh == 0 || w == 0 || h == 0) {
+        return;
+    }
+    const size_t d = dest.getPixelSize();
+
+    // The same source pixels as the original per pixel loop.
+    float di = ((float)h)/nh;
+    float dj = ((float)w)/nw;
+    std::vector<size_t> offsets(nw);
+    for (size_t j = 0; j < nw; j++) {
+        offsets[j] = ((size_t)(dj*j)) * d;
+    }
+
+    forEachRowBand(nw, nh, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            const unsigned char* srcRow = src.getRow((size_t)(di*i));
+            unsigned char* destRow = dest.getRow(i);
+            switch (d) {
+            case 1: copyNearestRow<1>(srcRow, destRow, offsets); break;
+            case 2: copyNearestRow<2>(srcRow, destRow, offsets); break;
+            case 3: copyNearestRow<3>(srcRow, destRow, offsets); break;
+            case 4: copyNearestRow<4>(srcRow, destRow, offsets); break;
+            case 12: copyNearestRow<12>(srcRow, destRow, offsets); break;
+            default:
+                for (size_t j = 0; j < nw; j++) {
+                    memcpy(destRow + j * d, srcRow + offsets[j], d);
+                }
+                break;
+            }
+        }
+    });
+}
+
+
+bool yarp::sig::impl::resampleFiltered(const Image& src, Image& dest, Image::Resampling filter)
+{
+    if (dest.width() == 0 || dest.height() == 0 || src.width() == 0 || src.height() == 0) {
+        return true;
+    }
+    switch (dest.getPixelCode()) {
+    case VOCAB_PIXEL_MONO:
+        resample<unsigned char, 1>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_RGB:
+    case VOCAB_PIXEL_BGR:
+        resample<unsigned char, 3>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_RGBA:
+    case VOCAB_PIXEL_BGRA:
+        resample<unsigned char, 4>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_MONO_SIGNED:
+        resample<signed char, 1>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_RGB_SIGNED:
+        resample<signed char, 3>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_MONO_FLOAT:
+        resample<float, 1>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_RGB_FLOAT:
+        resample<float, 3>(src, dest, filter);
+        return true;
+#ifdef YARP_LITTLE_ENDIAN
+    // The network integers are plain integers on this host.
+    case VOCAB_PIXEL_MONO16:
+        resample<std::uint16_t, 1>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_INT:
+        resample<std::int32_t, 1>(src, dest, filter);
+        return true;
+    case VOCAB_PIXEL_RGB_INT:
+        resample<std::int32_t, 3>(src, dest, filter);
+        return true;
+#endif
+    default:
+        // e.g. the hue would not be interpolated correctly, and the
+        // bayer patterns would be mixed up
+        return false;
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SIG_IMPL_IMAGERESAMPLING_H
+#define YARP_SIG_IMPL_IMAGERESAMPLING_H
+
+#include <yarp/sig/Image.h>
+
+namespace yarp {
+namespace sig {
+namespace impl {
+
+/**
+ * Scale an image, picking the nearest pixel of the source image.
+ * @param src the image to scale
+ * @param dest the scaled image, already resized, with the same pixel type
+ */
+void resampleNearest(const Image& src, Image& dest);
+
+/**
+ * Scale an image with a filter.
+ * @param src the image to scale
+ * @param dest the scaled image, already resized, with the same pixel type
+ * @param filter the filter used to compute each pixel
+ * @return false if the pixel type cannot be filtered
+ */
+bool resampleFiltered(const Image& src, Image& dest, Image::Resampling filter);
+
+} // namespace impl
+} // namespace sig
+} // namespace yarp
+
+#endif // YARP_SIG_IMPL_IMAGERESAMPLING_H
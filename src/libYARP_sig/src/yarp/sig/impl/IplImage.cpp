@@ -784,6 +784,28 @@ IPLAPIIMPL(IplImage*, iplCreateImageHeader,
             int   origin,     int     align,
             int   width,      int   height, IplROI* roi, IplImage* maskROI,
             void* imageId,    IplTileInfo* tileInfo))
+{
+    IplImage *r = nullptr;
+    r = new IplImage;
+    yAssert(r != nullptr);
+
+    if (iplInitImageHeader (r, nChannels, alphaChannel, depth, colorModel, channelSeq,
+                            dataOrder, origin, align, width, height, roi, maskROI,
+                            imageId, tileInfo) == nullptr)
+        {
+            delete r;
+            return nullptr;
+        }
+    return r;
+}
+
+IPLAPIIMPL(IplImage*, iplInitImageHeader,
+           (IplImage* r,
+            int   nChannels,  int     alphaChannel, int     depth,
+            char* colorModel, char*   channelSeq,   int     dataOrder,
+            int   origin,     int     align,
+            int   width,      int   height, IplROI* roi, IplImage* maskROI,
+            void* imageId,    IplTileInfo* tileInfo))
 {
     switch (depth)
         {
@@ -800,8 +822,6 @@ IPLAPIIMPL(IplImage*, iplCreateImageHeader,
             break;
         }
 
-    IplImage *r = nullptr;
-    r = new IplImage;
     yAssert(r != nullptr);
 
     r->nSize = sizeof(IplImage);
@@ -239,6 +239,16 @@ IPLAPIIMPL(IplImage*, iplCreateImageHeader,
             int   width,      int   height, IplROI* roi, IplImage* maskROI,
             void* imageId,    IplTileInfo* tileInfo));
 
+// not IPL: sets up an existing header as iplCreateImageHeader would,
+// so that it can be reused.  Returns nullptr if the depth is not supported.
+IPLAPIIMPL(IplImage*, iplInitImageHeader,
+           (IplImage* image,
+            int   nChannels,  int     alphaChannel, int     depth,
+            char* colorModel, char*   channelSeq,   int     dataOrder,
+            int   origin,     int     align,
+            int   width,      int   height, IplROI* roi, IplImage* maskROI,
+            void* imageId,    IplTileInfo* tileInfo));
+
 IPLAPIIMPL(IplImage*, iplCloneImage, ( const IplImage* img ) );
 
 IPLAPIIMPL(void, iplCopy, (IplImage* srcImage, IplImage* dstImage));
@@ -0,0 +1,472 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/sig/impl/PixelConversion.h>
+
+#include <yarp/sig/Image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+  The conversions between the 8 bit pixel types only move bytes around,
+  fill the alpha channel, or average the color channels into a mono
+  pixel.  Each conversion is described by the source of each byte of a
+  destination pixel, from which the row kernels are built:
+
+  - the portable kernels loop over the pixels of a row;
+  - the SSSE3 kernels shuffle blocks of 16 bytes (pshufb).  A block
+    holds a few whole pixels (e.g. 5 rgb pixels), the extra bytes that
+    are written are overwritten by the next block, and the last pixels
+    of the row are left to the portable kernel.  The mono pixels are
+    computed with the same integer division as CopyPixel;
+  - the AVX2 kernels do the same on two blocks at once.
+
+  The results are the same as converting one pixel at a time.  Large
+  images are split into bands of rows, converted by the calling thread
+  and by a pool of threads started the first time they are needed.
+*/
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#    define YARP_PIXEL_SIMD_AVAILABLE
+#    include <immintrin.h>
+#endif
+
+using yarp::sig::impl::PixelConversionKernels;
+
+namespace {
+
+constexpr unsigned char alpha = 0xff;
+constexpr unsigned char zero = 0x80; // a shuffle index that gives 0
+
+// The images smaller than this are converted by a single thread.
+constexpr size_t minParallelPixels = 1 << 16;
+constexpr size_t minRowsPerThread = 16;
+constexpr size_t maxThreads = 8;
+
+struct Layout
+{
+    int code;
+    size_t size;
+    int r, g, b, a; // position of each channel, -1 if missing
+};
+
+const Layout layouts[] = {
+    {VOCAB_PIXEL_MONO, 1, 0, 0, 0, -1},
+    {VOCAB_PIXEL_RGB, 3, 0, 1, 2, -1},
+    {VOCAB_PIXEL_BGR, 3, 2, 1, 0, -1},
+    {VOCAB_PIXEL_RGBA, 4, 0, 1, 2, 3},
+    {VOCAB_PIXEL_BGRA, 4, 2, 1, 0, 3},
+};
+
+const Layout* findLayout(int code)
+{
+    for (const auto& layout : layouts) {
+        if (layout.code == code) {
+            return &layout;
+        }
+    }
+    return nullptr;
+}
+
+struct Conversion
+{
+    size_t srcSize;
+    size_t destSize;
+    bool identity;           // same pixel type, the rows are copied
+    bool reduce;             // color to mono, (r + g + b) / 3
+    int map[4];              // source of each destination byte, -1 for alpha
+    size_t pixels;           // pixels in a block of 16 bytes
+    unsigned char mask[16];  // shuffle of a block
+    unsigned char fill[16];  // bytes or-ed after the shuffle
+};
+
+bool makeConversion(int id1, int id2, Conversion& c)
+{
+    const Layout* from = findLayout(id1);
+    const Layout* to = findLayout(id2);
+    if (from == nullptr || to == nullptr) {
+        return false;
+    }
+    c.srcSize = from->size;
+    c.destSize = to->size;
+    c.identity = (id1 == id2);
+    c.reduce = (to->size == 1 && from->size > 1);
+    for (int& m : c.map) {
+        m = -1;
+    }
+    if (c.reduce) {
+        // The sum does not depend on the order of the channels.
+        c.map[0] = 0;
+        c.map[1] = 1;
+        c.map[2] = 2;
+        c.pixels = 4;
+    } else {
+        if (to->size > 1) {
+            c.map[to->r] = from->r;
+            c.map[to->g] = from->g;
+            c.map[to->b] = from->b;
+        } else {
+            c.map[0] = 0;
+        }
+        if (to->a >= 0) {
+            c.map[to->a] = from->a;
+        }
+        c.pixels = 16 / std::max(c.srcSize, c.destSize);
+    }
+    for (size_t i = 0; i < 16; i++) {
+        c.mask[i] = zero;
+        c.fill[i] = 0;
+    }
+    if (c.reduce) {
+        // Each pixel gives the words (r + g) and b, see maddubs.
+        for (size_t p = 0; p < 4; p++) {
+            for (size_t k = 0; k < 3; k++) {
+                c.mask[p * 4 + k] = static_cast<unsigned char>(p * c.srcSize + k);
+            }
+        }
+    } else {
+        for (size_t p = 0; p < c.pixels; p++) {
+            for (size_t k = 0; k < c.destSize; k++) {
+                if (c.map[k] >= 0) {
+                    c.mask[p * c.destSize + k] = static_cast<unsigned char>(p * c.srcSize + c.map[k]);
+                } else {
+                    c.fill[p * c.destSize + k] = alpha;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+// Portable kernels, from pixel j to the end of the row.
+void convertRowScalar(const Conversion& c, const unsigned char* src, unsigned char* dest, size_t j, size_t w)
+{
+    src += j * c.srcSize;
+    dest += j * c.destSize;
+    if (c.reduce) {
+        for (; j < w; j++) {
+            *dest = static_cast<unsigned char>((src[0] + src[1] + src[2]) / 3);
+            src += c.srcSize;
+            dest++;
+        }
+        return;
+    }
+    for (; j < w; j++) {
+        for (size_t k = 0; k < c.destSize; k++) {
+            dest[k] = (c.map[k] >= 0) ? src[c.map[k]] : alpha;
+        }
+        src += c.srcSize;
+        dest += c.destSize;
+    }
+}
+
+
+#ifdef YARP_PIXEL_SIMD_AVAILABLE
+
+// Each of these kernels starts from pixel j, and returns the first
+// pixel left to the next kernel.
+
+__attribute__((target("ssse3")))
+size_t shuffleRowSsse3(const Conversion& c, const unsigned char* src, unsigned char* dest, size_t j, size_t w)
+{
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.mask));
+    const __m128i fill = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.fill));
+    // A block reads and writes 16 bytes, all within the row.
+    for (; (j * c.srcSize + 16 <= w * c.srcSize) && (j * c.destSize + 16 <= w * c.destSize); j += c.pixels) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * c.srcSize));
+        x = _mm_or_si128(_mm_shuffle_epi8(x, mask), fill);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + j * c.destSize), x);
+    }
+    return j;
+}
+
+__attribute__((target("ssse3")))
+size_t reduceRowSsse3(const Conversion& c, const unsigned char* src, unsigned char* dest, size_t j, size_t w)
+{
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.mask));
+    const __m128i ones = _mm_set1_epi8(1);
+    // x / 3 == (x * 43691) >> 17 for x <= 765
+    const __m128i third = _mm_set1_epi16(static_cast<short>(43691));
+    for (; ((j + 4) * c.srcSize + 16 <= w * c.srcSize) && (j + 8 <= w); j += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * c.srcSize));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (j + 4) * c.srcSize));
+        a = _mm_maddubs_epi16(_mm_shuffle_epi8(a, mask), ones);
+        b = _mm_maddubs_epi16(_mm_shuffle_epi8(b, mask), ones);
+        __m128i sum = _mm_hadd_epi16(a, b);
+        sum = _mm_srli_epi16(_mm_mulhi_epu16(sum, third), 1);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + j), _mm_packus_epi16(sum, sum));
+    }
+    return j;
+}
+
+__attribute__((target("avx2")))
+size_t shuffleRowAvx2(const Conversion& c, const unsigned char* src, unsigned char* dest, size_t j, size_t w)
+{
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c.mask)));
+    const __m256i fill = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c.fill)));
+    const size_t p = c.pixels;
+    for (; ((j + p) * c.srcSize + 16 <= w * c.srcSize) && ((j + p) * c.destSize + 16 <= w * c.destSize); j += 2 * p) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * c.srcSize));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (j + p) * c.srcSize));
+        __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        x = _mm256_or_si256(_mm256_shuffle_epi8(x, mask), fill);
+        // The first block first, its extra bytes are overwritten by the second.
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + j * c.destSize), _mm256_castsi256_si128(x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + (j + p) * c.destSize), _mm256_extracti128_si256(x, 1));
+    }
+    return j;
+}
+
+__attribute__((target("avx2")))
+size_t reduceRowAvx2(const Conversion& c, const unsigned char* src, unsigned char* dest, size_t j, size_t w)
+{
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c.mask)));
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i third = _mm256_set1_epi16(static_cast<short>(43691));
+    const size_t s = c.srcSize;
+    for (; ((j + 12) * s + 16 <= w * s) && (j + 16 <= w); j += 16) {
+        // pixels 0-3 and 4-7 in a, 8-11 and 12-15 in b
+        __m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * s))),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (j + 4) * s)), 1);
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (j + 8) * s))),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (j + 12) * s)), 1);
+        a = _mm256_maddubs_epi16(_mm256_shuffle_epi8(a, mask), ones);
+        b = _mm256_maddubs_epi16(_mm256_shuffle_epi8(b, mask), ones);
+        // hadd gives pixels 0-3, 8-11 in the first lane and 4-7, 12-15
+        // in the second, they are put back in order.
+        __m256i sum = _mm256_permute4x64_epi64(_mm256_hadd_epi16(a, b), 0xd8);
+        sum = _mm256_srli_epi16(_mm256_mulhi_epu16(sum, third), 1);
+        __m128i out = _mm_packus_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + j), out);
+    }
+    return j;
+}
+
+const bool hasSsse3 = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}();
+
+const bool hasAvx2 = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("avx2");
+}();
+
+#endif // YARP_PIXEL_SIMD_AVAILABLE
+
+PixelConversionKernels bestKernels()
+{
+#ifdef YARP_PIXEL_SIMD_AVAILABLE
+    if (hasAvx2) {
+        return PixelConversionKernels::Avx2;
+    }
+    if (hasSsse3) {
+        return PixelConversionKernels::Ssse3;
+    }
+#endif
+    return PixelConversionKernels::Scalar;
+}
+
+std::atomic<PixelConversionKernels> selectedKernels(bestKernels());
+std::atomic<size_t> selectedThreads(0);
+
+void convertRow(const Conversion& c, PixelConversionKernels kernels, const unsigned char* src, unsigned char* dest, size_t w)
+{
+    if (c.identity) {
+        memcpy(dest, src, w * c.srcSize);
+        return;
+    }
+    size_t j = 0;
+#ifdef YARP_PIXEL_SIMD_AVAILABLE
+    if (kernels == PixelConversionKernels::Avx2) {
+        j = c.reduce ? reduceRowAvx2(c, src, dest, j, w) : shuffleRowAvx2(c, src, dest, j, w);
+    }
+    if (kernels == PixelConversionKernels::Avx2 || kernels == PixelConversionKernels::Ssse3) {
+        j = c.reduce ? reduceRowSsse3(c, src, dest, j, w) : shuffleRowSsse3(c, src, dest, j, w);
+    }
+#else
+    YARP_UNUSED(kernels);
+#endif
+    convertRowScalar(c, src, dest, j, w);
+}
+
+} // namespace
+
+
+bool yarp::sig::impl::isPixelConversionSupported(PixelConversionKernels kernels)
+{
+    switch (kernels) {
+    case PixelConversionKernels::Reference:
+    case PixelConversionKernels::Scalar:
+        return true;
+#ifdef YARP_PIXEL_SIMD_AVAILABLE
+    case PixelConversionKernels::Ssse3:
+        return hasSsse3;
+    case PixelConversionKernels::Avx2:
+        return hasAvx2;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool yarp::sig::impl::setPixelConversionKernels(PixelConversionKernels kernels)
+{
+    if (!isPixelConversionSupported(kernels)) {
+        return false;
+    }
+    selectedKernels = kernels;
+    return true;
+}
+
+PixelConversionKernels yarp::sig::impl::getPixelConversionKernels()
+{
+    return selectedKernels;
+}
+
+void yarp::sig::impl::setPixelConversionThreads(size_t threads)
+{
+    selectedThreads = threads;
+}
+
+bool yarp::sig::impl::convertPixels(const unsigned char* src, int id1,
+                                    unsigned char* dest, int id2,
+                                    size_t w, size_t h,
+                                    size_t quantum1, size_t quantum2,
+                                    bool flip)
+{
+    PixelConversionKernels kernels = selectedKernels;
+    Conversion c;
+    if (kernels == PixelConversionKernels::Reference || !makeConversion(id1, id2, c)) {
+        return false;
+    }
+    const size_t step1 = w * c.srcSize + PAD_BYTES(w * c.srcSize, quantum1);
+    const size_t step2 = w * c.destSize + PAD_BYTES(w * c.destSize, quantum2);
+
+    forEachRowBand(w, h, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            convertRow(c, kernels, src + i * step1, dest + (flip ? (h - 1 - i) : i) * step2, w);
+        }
+    });
+    return true;
+}
+
+namespace {
+
+// The bands of rows of one call to forEachRowBand.  Any thread takes
+// the next band until there is none left, so the calling thread never
+// waits for a busy pool to start: at worst, it does all the work.
+struct RowBandJob
+{
+    const std::function<void(size_t, size_t)>* process;
+    size_t h;
+    size_t band;
+    size_t bands;
+    std::atomic<size_t> next {0};
+    size_t done {0};
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    void work()
+    {
+        size_t count = 0;
+        for (size_t i = next++; i < bands; i = next++) {
+            size_t first = i * band;
+            (*process)(first, std::min(first + band, h));
+            count++;
+        }
+        if (count > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done += count;
+            if (done == bands) {
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+class RowBandPool
+{
+public:
+    // Never destroyed: the threads wait for jobs until the process ends.
+    static RowBandPool& get()
+    {
+        static auto* pool = new RowBandPool;
+        return *pool;
+    }
+
+    void post(const std::shared_ptr<RowBandJob>& job, size_t helpers)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (threads.size() < helpers) {
+            threads.emplace_back([this]() { run(); });
+        }
+        for (size_t i = 0; i < helpers; i++) {
+            jobs.push_back(job);
+        }
+        available.notify_all();
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            available.wait(lock, [this]() { return !jobs.empty(); });
+            std::shared_ptr<RowBandJob> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job->work();
+            job.reset();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<std::shared_ptr<RowBandJob>> jobs;
+    std::vector<std::thread> threads;
+};
+
+} // namespace
+
+void yarp::sig::impl::forEachRowBand(size_t w, size_t h, const std::function<void(size_t, size_t)>& process)
+{
+    size_t threads = selectedThreads;
+    if (threads == 0) {
+        threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), maxThreads);
+    }
+    threads = std::min(threads, maxThreads);
+    if (w * h < minParallelPixels) {
+        threads = 1;
+    }
+    threads = std::max<size_t>(std::min(threads, h / minRowsPerThread), 1);
+    if (threads == 1) {
+        process(0, h);
+        return;
+    }
+
+    auto job = std::make_shared<RowBandJob>();
+    job->process = &process;
+    job->h = h;
+    job->band = (h + threads - 1) / threads;
+    job->bands = (h + job->band - 1) / job->band;
+    RowBandPool::get().post(job, job->bands - 1);
+    job->work();
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job]() { return job->done == job->bands; });
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef YARP_SIG_IMPL_PIXELCONVERSION_H
+#define YARP_SIG_IMPL_PIXELCONVERSION_H
+
+#include <yarp/sig/api.h>
+
+#include <cstddef>
+#include <functional>
+
+namespace yarp {
+namespace sig {
+namespace impl {
+
+/**
+ * The kernels used to convert the rows of an image between the common
+ * 8 bit pixel types (mono, rgb, bgr, rgba and bgra).
+ */
+enum class PixelConversionKernels
+{
+    Reference, ///< no row kernels, convert one pixel at a time with CopyPixel
+    Scalar,    ///< portable row kernels
+    Ssse3,     ///< row kernels using SSSE3 instructions
+    Avx2       ///< row kernels using AVX2 instructions
+};
+
+/**
+ * @return true if the kernels can be used on this processor
+ */
+YARP_sig_API bool isPixelConversionSupported(PixelConversionKernels kernels);
+
+/**
+ * Choose the kernels used by Image::copy().  By default, the fastest
+ * kernels supported by the processor are used.
+ * @return false if the kernels cannot be used on this processor
+ */
+YARP_sig_API bool setPixelConversionKernels(PixelConversionKernels kernels);
+
+/**
+ * @return the kernels used by Image::copy()
+ */
+YARP_sig_API PixelConversionKernels getPixelConversionKernels();
+
+/**
+ * Set the maximum number of threads converting the rows of a large
+ * image.
+ * @param threads the number of threads, 0 for the number of cores
+ */
+YARP_sig_API void setPixelConversionThreads(size_t threads);
+
+/**
+ * Process the rows of an image, split into bands converted by several
+ * threads if the image is large enough (see setPixelConversionThreads).
+ * @param w the width of the image
+ * @param h the number of rows
+ * @param process called for each band, with its first and last (not
+ * included) rows
+ */
+void forEachRowBand(size_t w, size_t h, const std::function<void(size_t, size_t)>& process);
+
+/**
+ * Convert an image with the row kernels, if there is one for these
+ * pixel types.
+ * @param src the pixels of the source image
+ * @param id1 the pixel type of the source image
+ * @param dest the pixels of the destination image
+ * @param id2 the pixel type of the destination image
+ * @param w the width of the images
+ * @param h the height of the images
+ * @param quantum1 the row alignment of the source image
+ * @param quantum2 the row alignment of the destination image
+ * @param flip the rows are stored in opposite orders
+ * @return false if the image has to be converted one pixel at a time
+ */
+bool convertPixels(const unsigned char* src, int id1,
+                   unsigned char* dest, int id2,
+                   size_t w, size_t h,
+                   size_t quantum1, size_t quantum2,
+                   bool flip);
+
+} // namespace impl
+} // namespace sig
+} // namespace yarp
+
+#endif // YARP_SIG_IMPL_PIXELCONVERSION_H
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/os/all.h>
+#include <yarp/os/Network.h>
+#include <yarp/sig/all.h>
+
+#include <catch.hpp>
+#include <harness.h>
+
+using namespace yarp::os;
+using namespace yarp::sig;
+
+namespace {
+class Responder : public Thread
+{
+public:
+    Port& port;
+    Bottle received;
+
+    explicit Responder(Port& port) :
+            port(port)
+    {
+    }
+
+    void run() override
+    {
+        Bottle answer("done");
+        port.read(received, true);
+        port.reply(answer);
+    }
+};
+} // namespace
+
+TEST_CASE("carriers::shm2", "[carriers]")
+{
+    YARP_REQUIRE_PLUGIN("shm2", "carrier");
+
+    Network::setLocalMode(true);
+
+    SECTION("test bottle with reply")
+    {
+        Port in;
+        Port out;
+        REQUIRE(in.open("/shm2/in"));
+        REQUIRE(out.open("/shm2/out"));
+        REQUIRE(Network::connect(out.getName(), in.getName(), "shm2"));
+        CHECK(Network::isConnected(out.getName(), in.getName(), "shm2", true));
+
+        Bottle cmd("hello 1 2.5 [ok]");
+        Bottle reply;
+        Responder responder(in);
+        REQUIRE(responder.start());
+        REQUIRE(out.write(cmd, reply));
+        responder.stop();
+        CHECK(responder.received.toString() == cmd.toString());
+        CHECK(reply.toString() == "done");
+
+        out.close();
+        in.close();
+    }
+
+    SECTION("test large images")
+    {
+        BufferedPort<ImageOf<PixelRgb>> in;
+        BufferedPort<ImageOf<PixelRgb>> out;
+        REQUIRE(in.open("/shm2/img/in"));
+        REQUIRE(out.open("/shm2/img/out"));
+        REQUIRE(Network::connect(out.getName(), in.getName(), "shm2"));
+
+        // The first image fits the initial ring, the larger ones make it grow.
+        const size_t widths[] = {320, 1920, 1920};
+        const size_t heights[] = {240, 1080, 1080};
+        for (int k = 0; k < 3; k++) {
+            ImageOf<PixelRgb>& outImg = out.prepare();
+            outImg.resize(widths[k], heights[k]);
+            for (size_t y = 0; y < heights[k]; y++) {
+                for (size_t x = 0; x < widths[k]; x++) {
+                    PixelRgb& pix = outImg.pixel(x, y);
+                    pix.r = static_cast<unsigned char>(x + k);
+                    pix.g = static_cast<unsigned char>(y);
+                    pix.b = static_cast<unsigned char>(x ^ y);
+                }
+            }
+            out.writeStrict();
+
+            ImageOf<PixelRgb>* inImg = in.read();
+            REQUIRE(inImg != nullptr);
+            CHECK(inImg->width() == widths[k]);
+            CHECK(inImg->height() == heights[k]);
+            bool same = true;
+            for (size_t y = 0; y < heights[k] && same; y++) {
+                for (size_t x = 0; x < widths[k] && same; x++) {
+                    PixelRgb& pix = inImg->pixel(x, y);
+                    same = pix.r == static_cast<unsigned char>(x + k) &&
+                           pix.g == static_cast<unsigned char>(y) &&
+                           pix.b == static_cast<unsigned char>(x ^ y);
+                }
+            }
+            CHECK(same);
+        }
+
+        in.interrupt();
+        in.close();
+        out.interrupt();
+        out.close();
+    }
+
+    Network::setLocalMode(false);
+}
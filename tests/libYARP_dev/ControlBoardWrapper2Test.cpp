@@ -9,11 +9,16 @@
 
 #include <yarp/dev/PolyDriver.h>
 
+#include <yarp/os/BufferedPort.h>
 #include <yarp/os/Network.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
 #include <yarp/dev/FrameGrabberInterfaces.h>
 #include <yarp/dev/ControlBoardInterfaces.h>
 #include <yarp/dev/IMultipleWrapper.h>
+#include <yarp/sig/Vector.h>
 
+#include <algorithm>
 #include <string>
 
 #include <catch.hpp>
@@ -69,3 +74,82 @@ TEST_CASE("dev::ControlBoardWrapper2", "[yarp::dev]")
         CHECK(dd2.close()); // close dd2 reported successful
     }
 }
+
+
+TEST_CASE("dev::ControlBoardWrapper2FlowControl", "[yarp::dev]")
+{
+    YARP_REQUIRE_PLUGIN("fakeMotionControl", "device");
+    YARP_REQUIRE_PLUGIN("controlboardwrapper2", "device");
+
+    Network::setLocalMode(true);
+
+    SECTION("test a slow reader of the streaming state")
+    {
+        PolyDriver fmc;
+        Property p;
+        p.fromConfig("device fakeMotionControl\n"
+                     "[GENERAL]\n"
+                     "Joints 2\n"
+                     "\n"
+                     "AxisName \"axis1\" \"axis2\"\n");
+        REQUIRE(fmc.open(p)); // fakeMotionControl open reported successful
+
+        PolyDriver wrapper;
+        Property p2;
+        p2.fromConfig("device controlboardwrapper2\n"
+                      "name /flow\n"
+                      "period 5\n"
+                      "networks (net)\n"
+                      "joints 2\n"
+                      "net 0 1 0 1\n");
+        REQUIRE(wrapper.open(p2)); // controlboardwrapper2 open reported successful
+        IMultipleWrapper* iwrap = nullptr;
+        REQUIRE(wrapper.view(iwrap));
+        PolyDriverList pdList;
+        pdList.push(&fmc, "net");
+        REQUIRE(iwrap->attachAll(pdList)); // controlboardwrapper2 attached to fakeMotionControl
+
+        // A reader that takes a message every 50 ms, from a writer that
+        // sends one every 5 ms.
+        const size_t credits = 2;
+        BufferedPort<Vector> slow;
+        slow.setFlowControl(credits);
+        REQUIRE(slow.open("/flow/slow:i"));
+        REQUIRE(Network::connect("/flow/state:o", "/flow/slow:i", "tcp"));
+
+        size_t maxPending = 0;
+        int previous = -1;
+        bool ordered = true;
+        for (int i = 0; i < 20; i++) {
+            Time::delay(0.05);
+            maxPending = std::max(maxPending, static_cast<size_t>(slow.getPendingReads()));
+            Vector* v = slow.read();
+            REQUIRE(v != nullptr);
+            CHECK(v->size() == 2);
+            Stamp stamp;
+            slow.getEnvelope(stamp);
+            ordered = ordered && stamp.getCount() > previous;
+            previous = stamp.getCount();
+        }
+        CHECK(maxPending <= credits); // memory bounded
+        CHECK(ordered); // messages delivered in order
+        BufferOverflowStats stats = slow.getOverflowStats();
+        CHECK(stats.blocked > 0); // the writer was held back
+        CHECK(stats.droppedOldest + stats.droppedNewest == 0); // nothing dropped by the reader
+
+        // The writer dropped the messages it could not send.
+        Bottle cmd("stat /flow/slow:i");
+        Bottle reply;
+        REQUIRE(Network::write(Network::queryName("/flow/state:o"), cmd, reply, true));
+        Bottle* out = reply.get(0).asList();
+        REQUIRE(out != nullptr);
+        CHECK(out->find("drops").asInt64() > 0);
+        CHECK(out->find("messages").asInt64() < previous);
+
+        slow.close(); // must not wait for the reader
+        CHECK(wrapper.close());
+        CHECK(fmc.close());
+    }
+
+    Network::setLocalMode(false);
+}
@@ -12,17 +12,77 @@
 
 #include <yarp/os/DummyConnector.h>
 #include <yarp/os/Stamp.h>
+#include <yarp/os/StringInputStream.h>
 #include <yarp/os/Vocab.h>
 
+#include <yarp/os/impl/BottleImpl.h>
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/os/impl/StreamConnectionReader.h>
 
+#include <cstring>
+#include <random>
+#include <thread>
+
 #include <catch.hpp>
 #include <harness.h>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
 
+// Fill a bottle with random items, of all the kinds that have a text form
+static void fillRandomly(Bottle& b, std::mt19937& rng, int depth)
+{
+    const std::string chars = "ab Z09 ,.()[]{}\"\\\n\r\t-+e";
+    int len = rng() % 8;
+    for (int i = 0; i < len; i++) {
+        switch (rng() % 7) {
+        case 0:
+            b.addInt32(static_cast<std::int32_t>(rng()));
+            break;
+        case 1:
+            b.addFloat64(static_cast<std::int32_t>(rng()) / 1024.0);
+            break;
+        case 2: {
+            std::string str;
+            int strLen = rng() % 10;
+            for (int j = 0; j < strLen; j++) {
+                str += chars[rng() % chars.length()];
+            }
+            b.addString(str);
+        } break;
+        case 3:
+            b.addVocab(createVocab('a' + rng() % 26, 'a' + rng() % 26, '0' + rng() % 10));
+            break;
+        case 4: {
+            char blob[6];
+            for (auto& ch : blob) {
+                ch = static_cast<char>(rng() % 256);
+            }
+            b.add(Value(blob, rng() % sizeof(blob)));
+        } break;
+        case 5:
+            if (depth < 3) {
+                fillRandomly(b.addList(), rng, depth + 1);
+            }
+            break;
+        default:
+            b.addString("word");
+            break;
+        }
+    }
+}
+
+static void checkSameItems(const Bottle& a, const Bottle& b)
+{
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        CHECK(a.get(i).getCode() == b.get(i).getCode());
+        if (a.get(i).isList() && b.get(i).isList()) {
+            checkSameItems(*a.get(i).asList(), *b.get(i).asList());
+        }
+    }
+}
+
 TEST_CASE("OS::BottleTest", "[yarp::os]")
 {
     SECTION("testing string representation")
@@ -538,4 +598,336 @@ TEST_CASE("OS::BottleTest", "[yarp::os]")
 
 
     }
+
+    SECTION("test that clear() reuses the storage of the items")
+    {
+        Bottle b;
+        b.addInt32(1);
+        b.addString("a string too long to be stored inline by std::string");
+        b.addList().addFloat64(2.5);
+        const Value* item0 = &b.get(0);
+        const Value* item1 = &b.get(1);
+        const Value* item2 = &b.get(2);
+        const Value* nested = &b.get(2).asList()->get(0);
+
+        b.clear();
+        b.addInt32(3);
+        b.addString("another one");
+        b.addList().addFloat64(4.5);
+        CHECK(b.toString() == "3 \"another one\" (4.5)");
+        CHECK(&b.get(0) == item0);
+        CHECK(&b.get(1) == item1);
+        CHECK(&b.get(2) == item2);
+        CHECK(&b.get(2).asList()->get(0) == nested);
+
+        // Reading a message of the same shape reuses the items too
+        Bottle src("10 \"ten\" (10.5 [ten])");
+        Bottle dest;
+        dest.read(src);
+        const Value* read0 = &dest.get(0);
+        const Value* read2 = &dest.get(2).asList()->get(1);
+        src.clear();
+        src.fromString("20 \"twenty\" (20.5 [twen])");
+        dest.read(src);
+        CHECK(dest.toString() == src.toString());
+        CHECK(&dest.get(0) == read0);
+        CHECK(&dest.get(2).asList()->get(1) == read2);
+        CHECK(dest.get(2).asList()->get(1).isVocab());
+    }
+
+    SECTION("test that clear() keeps a bounded number of items")
+    {
+        BottleImpl impl;
+        for (int i = 0; i < 5000; i++) {
+            impl.addInt32(i);
+        }
+        impl.clear();
+        CHECK(impl.getSpareCount() > 0);
+        CHECK(impl.getSpareCount() <= 1024);
+
+        impl.addInt32(1);
+        size_t spares = impl.getSpareCount();
+        impl.clear();
+        CHECK(impl.getSpareCount() == spares + 1);
+
+        // Large strings are released rather than kept
+        for (int i = 0; i < 10; i++) {
+            impl.addString(std::string(100000, 'x'));
+        }
+        impl.addString("short");
+        impl.clear();
+        CHECK(impl.getSpareBytes() <= 64 * 1024);
+        CHECK(impl.getSpareCount() <= 1024);
+    }
+
+    SECTION("test that the state kept for reuse is not in every bottle")
+    {
+        // The spare items and the packed arrays are allocated on demand
+        CHECK(sizeof(BottleImpl) <= 16 * sizeof(void*));
+
+        BottleImpl impl;
+        impl.addInt32(1);
+        impl.addString("one");
+        CHECK(impl.getSpareCount() == 0);
+        CHECK(impl.getSpareBytes() == 0);
+        impl.clear();
+        CHECK(impl.getSpareCount() == 2);
+    }
+
+    SECTION("test lists of numbers sent as a single block")
+    {
+        std::vector<yarp::conf::float64_t> numbers{1.5, -2.25, 3.0, 1e-9};
+        std::vector<std::int32_t> integers{1, -2, 300000};
+
+        Bottle src;
+        src.addString("data");
+        src.addList(numbers);
+        src.addList(integers);
+        CHECK(src.get(1).asList()->getFloat64Data() != nullptr);
+
+        // Same encoding as a list filled item by item
+        Bottle ref;
+        ref.addString("data");
+        Bottle& refNumbers = ref.addList();
+        for (auto x : numbers) {
+            refNumbers.addFloat64(x);
+        }
+        Bottle& refIntegers = ref.addList();
+        for (auto x : integers) {
+            refIntegers.addInt32(x);
+        }
+        size_t srcSize = 0;
+        size_t refSize = 0;
+        const char* srcBytes = src.toBinary(&srcSize);
+        const char* refBytes = ref.toBinary(&refSize);
+        REQUIRE(srcSize == refSize);
+        CHECK(memcmp(srcBytes, refBytes, srcSize) == 0);
+        CHECK(refNumbers.getFloat64Data() != nullptr);
+        CHECK(ref.getFloat64Data() == nullptr);
+
+        Bottle dest;
+        dest.read(src);
+        Bottle* destNumbers = dest.get(1).asList();
+        Bottle* destIntegers = dest.get(2).asList();
+        REQUIRE(destNumbers->size() == numbers.size());
+        REQUIRE(destIntegers->size() == integers.size());
+        const yarp::conf::float64_t* view = destNumbers->getFloat64Data();
+        REQUIRE(view != nullptr);
+        for (size_t i = 0; i < numbers.size(); i++) {
+            CHECK(view[i] == numbers[i]);
+        }
+        CHECK(destNumbers->getInt32Data() == nullptr);
+        const std::int32_t* intView = destIntegers->getInt32Data();
+        REQUIRE(intView != nullptr);
+        for (size_t i = 0; i < integers.size(); i++) {
+            CHECK(intView[i] == integers[i]);
+        }
+
+        // The items are still available one by one
+        CHECK(destNumbers->get(1).asFloat64() == -2.25);
+        CHECK(destIntegers->get(2).asInt32() == 300000);
+        CHECK(dest.toString() == src.toString());
+        // and the views given before stay valid
+        CHECK(destNumbers->getFloat64Data() == view);
+        CHECK(view[1] == -2.25);
+        CHECK(destIntegers->getInt32Data() == intView);
+        CHECK(intView[2] == 300000);
+        // A change made through get() is seen by the next call
+        destNumbers->get(0) = Value(5.0);
+        CHECK(destNumbers->getFloat64Data() == view);
+        CHECK(destNumbers->getFloat64Data()[0] == 5.0);
+        destIntegers->get(1) = Value(7);
+        CHECK(destIntegers->getInt32Data()[1] == 7);
+        refNumbers.get(3) = Value(6.5);
+        CHECK(refNumbers.getFloat64Data()[3] == 6.5);
+        destNumbers->addString("end");
+        CHECK(destNumbers->size() == numbers.size() + 1);
+        CHECK(destNumbers->getFloat64Data() == nullptr);
+
+        // Adding more of the same kind keeps the list packed
+        Bottle& more = src.addList(numbers);
+        more.addFloat64(4.0);
+        CHECK(more.size() == numbers.size() + 1);
+        CHECK(more.getFloat64Data()[numbers.size()] == 4.0);
+        Bottle copy(more);
+        CHECK(copy.toString() == more.toString());
+        copy.copy(more, 1, 2);
+        CHECK(copy.toString() == "-2.25 3.0");
+    }
+
+    SECTION("test reading a packed list from several threads")
+    {
+        std::vector<yarp::conf::float64_t> numbers;
+        for (int i = 0; i < 1000; i++) {
+            numbers.push_back(i * 0.5);
+        }
+        for (int round = 0; round < 20; round++) {
+            Bottle src;
+            src.addList(numbers);
+            Bottle dest;
+            dest.read(src);
+            const Bottle& list = *dest.get(0).asList();
+            const yarp::conf::float64_t* view = list.getFloat64Data();
+            REQUIRE(view != nullptr);
+
+            std::vector<std::thread> readers;
+            std::vector<int> errors(4, 0);
+            for (size_t t = 0; t < errors.size(); t++) {
+                readers.emplace_back([&list, &numbers, &errors, view, t]() {
+                    for (size_t i = 0; i < numbers.size(); i++) {
+                        if (list.get(i).asFloat64() != numbers[i] || view[i] != numbers[i]) {
+                            errors[t]++;
+                        }
+                    }
+                    if (list.getFloat64Data() != view || list.toString().empty()) {
+                        errors[t]++;
+                    }
+                });
+            }
+            for (auto& reader : readers) {
+                reader.join();
+            }
+            for (int e : errors) {
+                CHECK(e == 0);
+            }
+        }
+    }
+
+    SECTION("test the text parser with random input")
+    {
+        std::mt19937 rng(42);
+
+        // Well formed text is parsed back to the same items
+        for (int i = 0; i < 2000; i++) {
+            Bottle src;
+            fillRandomly(src, rng, 0);
+            std::string txt = src.toString();
+            Bottle dest(txt);
+            INFO("text: " << txt);
+            CHECK(dest.toString() == txt);
+            checkSameItems(src, dest);
+        }
+
+        // Anything else is parsed without failing, the same way when
+        // read from a connection in text mode
+        const std::string alphabet = "()[]{}\"\\ ,\t\n0123456789.-+eExXabnulltrsf";
+        for (int i = 0; i < 5000; i++) {
+            std::string txt;
+            int len = rng() % 40;
+            for (int j = 0; j < len; j++) {
+                txt += alphabet[rng() % alphabet.length()];
+            }
+            Bottle b(txt);
+            CHECK(b.size() <= txt.length());
+            if (BottleImpl::isComplete(txt.c_str()) && txt.find('\n') == std::string::npos && !txt.empty() && txt.back() != '\\') {
+                StringInputStream sis;
+                sis.add(txt + "\n");
+                StreamConnectionReader reader;
+                Route route;
+                reader.reset(sis, nullptr, route, txt.length() + 1, true);
+                Bottle read;
+                read.read(reader);
+                INFO("text: " << txt);
+                CHECK(read.toString() == b.toString());
+            }
+        }
+    }
 }
+
+TEST_CASE("OS::BottleBenchmark", "[yarp::os][.][benchmark]")
+{
+    // Lines similar to the ones of yarp rpc sessions and of the logs of
+    // yarpdataplayer
+    const std::vector<std::string> lines{
+        "12345 1.5 -2.25e3 \"a quoted string, with \\\"escapes\\\"\" [vocb] plain_word",
+        "(joint_positions (0.125 -1.5 2.75 3.0 -0.5 0.0 12.5)) (timestamp 1587654321.123456)",
+        "set pos 3 45.0 (options (speed 10) (accel 2.5)) {1 2 3 255 0 12}",
+        "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0",
+        "\"/icub/head/state:o\" \"/icub/head/rpc:i\" true false 0x1f -0.001",
+    };
+    const int rounds = 2000;
+
+    size_t items = 0;
+    Bottle b;
+    BENCHMARK("fromString")
+    {
+        items = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& line : lines) {
+                b.fromString(line);
+                items += b.size();
+            }
+        }
+    }
+    CHECK(items == rounds * 52);
+
+    // The previous parser: the top level items are copied one by one
+    // into a std::string, then parsed on their own.
+    auto splitAndAdd = [](Bottle& bot, const std::string& line) {
+        bot.clear();
+        std::string arg;
+        bool quoted = false;
+        bool back = false;
+        int nested = 0;
+        for (char ch : line + " ") {
+            if (back) {
+                arg += ch;
+                back = false;
+                continue;
+            }
+            if (ch == '\"') {
+                quoted = !quoted;
+            }
+            if (!quoted) {
+                if (ch == '(' || ch == '{') {
+                    nested++;
+                }
+                if (ch == ')' || ch == '}') {
+                    nested--;
+                }
+            }
+            if (ch == '\\') {
+                back = true;
+                arg += ch;
+            } else if (!quoted && nested == 0 && (ch == ' ' || ch == ',')) {
+                if (!arg.empty()) {
+                    Value* v = Value::makeValue(arg);
+                    bot.add(*v);
+                    delete v;
+                }
+                arg.clear();
+            } else {
+                arg += ch;
+            }
+        }
+    };
+    BENCHMARK("per item copies, as the previous parser")
+    {
+        items = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& line : lines) {
+                splitAndAdd(b, line);
+                items += b.size();
+            }
+        }
+    }
+
+    BottleImpl impl;
+    BENCHMARK("text read through a ConnectionReader")
+    {
+        items = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& line : lines) {
+                StringInputStream sis;
+                sis.add(line + "\n");
+                StreamConnectionReader reader;
+                Route route;
+                reader.reset(sis, nullptr, route, line.length() + 1, true);
+                impl.read(reader);
+                items += impl.size();
+            }
+        }
+    }
+    CHECK(items == rounds * 52);
+}
+
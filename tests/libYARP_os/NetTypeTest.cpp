@@ -14,6 +14,8 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <random>
+#include <vector>
 
 #include <catch.hpp>
 #include <harness.h>
@@ -43,6 +45,45 @@ TEST_CASE("OS::NetTypeTest", "[yarp::os]")
         CHECK(ct1==ct2); // two identical sequences again
     }
 
+    SECTION("checking cyclic redundancy check matches the reference")
+    {
+        // bit at a time CRC-32
+        auto reference = [](const char* buf, size_t len) {
+            unsigned long c = 0xffffffffUL;
+            for (size_t i = 0; i < len; i++) {
+                c ^= static_cast<unsigned char>(buf[i]);
+                for (int k = 0; k < 8; k++) {
+                    c = ((c & 1) != 0) ? (0xedb88320UL ^ (c >> 1)) : (c >> 1);
+                }
+            }
+            return c ^ 0xffffffffUL;
+        };
+
+        char check[] = "123456789";
+        CHECK(NetType::getCrc(check, 9) == 0xcbf43926UL); // standard check value
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::vector<char> data(70000);
+        for (auto& c : data) {
+            c = static_cast<char>(byte(gen));
+        }
+        // all the lengths around the block sizes, plus datagram sized buffers
+        std::vector<size_t> lengths;
+        for (size_t len = 0; len < 300; len++) {
+            lengths.push_back(len);
+        }
+        lengths.push_back(1500);
+        lengths.push_back(65499);
+        lengths.push_back(data.size() - 1);
+        for (size_t len : lengths) {
+            for (size_t offset = 0; offset < 3; offset++) {
+                INFO("length " << len << " offset " << offset);
+                CHECK(NetType::getCrc(data.data() + offset, len) == reference(data.data() + offset, len));
+            }
+        }
+    }
+
     SECTION("checking integer representation")
     {
         union {
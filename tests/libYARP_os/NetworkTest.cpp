@@ -17,8 +17,12 @@
 #include <yarp/os/Bottle.h>
 #include <yarp/os/QosStyle.h>
 
+#include <yarp/os/impl/NameClient.h>
 #include <yarp/os/impl/TcpFace.h>
 
+#include <memory>
+#include <vector>
+
 #include <catch.hpp>
 #include <harness.h>
 
@@ -257,5 +261,90 @@ TEST_CASE("OS::NetworkTest", "[yarp::os]")
         p2.close();
     }
 
+    SECTION("checking the name lookup cache")
+    {
+        Network::setEnvironment("YARP_NAME_CACHE_TTL", "60");
+        Contact registered = Network::registerContact(Contact("/NetworkTest/cache", "tcp", "127.0.0.1", 10999));
+        REQUIRE(registered.isValid());
+        Contact found = Network::queryName("/NetworkTest/cache");
+        CHECK(found.getPort() == 10999); // lookup ok
+
+        // remove the name behind the back of the cache
+        NameClient::getNameClient().send("NAME_SERVER unregister /NetworkTest/cache", false);
+        found = Network::queryName("/NetworkTest/cache");
+        CHECK(found.getPort() == 10999); // lookup served by the cache
+
+        NameClient::forgetName("/NetworkTest/cache");
+        found = Network::queryName("/NetworkTest/cache");
+        CHECK_FALSE(found.isValid()); // cache invalidated
+
+        Port p1;
+        Port p2;
+        REQUIRE(p1.open("/NetworkTest/cache/p1"));
+        REQUIRE(p2.open("/NetworkTest/cache/p2"));
+        CHECK(Network::connect(p1.getName(), p2.getName())); // connect through the cache
+        CHECK(Network::isConnected(p1.getName(), p2.getName()));
+        p2.close();
+        CHECK_FALSE(Network::queryName("/NetworkTest/cache/p2").isValid()); // closed port forgotten
+        p1.close();
+        Network::unsetEnvironment("YARP_NAME_CACHE_TTL");
+    }
+
     Network::setLocalMode(false);
 }
+
+TEST_CASE("OS::NetworkBenchmark", "[yarp::os][.][benchmark]")
+{
+    // Uses the name server if there is one, to include the cost of the
+    // lookups in the measure.
+    bool local = !Network::checkNetwork(2);
+    if (local) {
+        Network::setLocalMode(true);
+    }
+
+    const size_t count = 50;
+    std::vector<std::unique_ptr<Port>> senders;
+    std::vector<std::unique_ptr<Port>> receivers;
+    for (size_t i = 0; i < count; i++) {
+        senders.emplace_back(new Port);
+        receivers.emplace_back(new Port);
+        REQUIRE(senders.back()->open("/NetworkBenchmark/out" + std::to_string(i)));
+        REQUIRE(receivers.back()->open("/NetworkBenchmark/in" + std::to_string(i)));
+    }
+
+    auto connectAll = [&]() {
+        size_t connected = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (Network::connect(senders[i]->getName(), receivers[i]->getName(), "tcp", true)) {
+                connected++;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            Network::disconnect(senders[i]->getName(), receivers[i]->getName(), true);
+        }
+        return connected;
+    };
+
+    size_t connected = 0;
+    BENCHMARK("connecting 50 ports, no name cache")
+    {
+        connected = connectAll();
+    }
+    CHECK(connected == count);
+
+    Network::setEnvironment("YARP_NAME_CACHE_TTL", "60");
+    BENCHMARK("connecting 50 ports, name cache")
+    {
+        connected = connectAll();
+    }
+    CHECK(connected == count);
+    Network::unsetEnvironment("YARP_NAME_CACHE_TTL");
+
+    for (size_t i = 0; i < count; i++) {
+        senders[i]->close();
+        receivers[i]->close();
+    }
+    if (local) {
+        Network::setLocalMode(false);
+    }
+}
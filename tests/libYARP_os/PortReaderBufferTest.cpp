@@ -13,6 +13,9 @@
 #include <yarp/os/Network.h>
 #include <yarp/os/Time.h>
 
+#include <thread>
+#include <vector>
+
 #include <catch.hpp>
 #include <harness.h>
 
@@ -174,5 +177,135 @@ TEST_CASE("OS::PortReaderBufferTest", "[yarp::os]")
         }
     }
 
+    SECTION("checking bounded buffer")
+    {
+        std::vector<Bottle> data(5);
+        for (size_t i = 0; i < data.size(); i++) {
+            data[i].addInt32(static_cast<std::int32_t>(i));
+        }
+
+        {
+            INFO("drop oldest");
+            PortReaderBuffer<Bottle> buffer;
+            buffer.setCapacity(3, BufferOverflowPolicy::DropOldest);
+            for (auto& b : data) {
+                buffer.acceptObject(&b, nullptr);
+            }
+            CHECK(buffer.getPendingReads() == 3); // bounded
+            CHECK(buffer.read()->get(0).asInt32() == 2); // oldest dropped
+            CHECK(buffer.read()->get(0).asInt32() == 3); // in order
+            CHECK(buffer.read()->get(0).asInt32() == 4); // in order
+            BufferOverflowStats stats = buffer.getOverflowStats();
+            CHECK(stats.received == 5);
+            CHECK(stats.droppedOldest == 2);
+            CHECK(stats.highWater == 3);
+        }
+
+        {
+            INFO("drop newest");
+            PortReaderBuffer<Bottle> buffer;
+            buffer.setCapacity(3, BufferOverflowPolicy::DropNewest);
+            for (auto& b : data) {
+                buffer.acceptObject(&b, nullptr);
+            }
+            CHECK(buffer.getPendingReads() == 3); // bounded
+            CHECK(buffer.read()->get(0).asInt32() == 0); // oldest kept
+            CHECK(buffer.read()->get(0).asInt32() == 1); // in order
+            CHECK(buffer.read()->get(0).asInt32() == 2); // in order
+            CHECK(buffer.getOverflowStats().droppedNewest == 2);
+        }
+
+        {
+            INFO("coalesce");
+            std::vector<Bottle> updates(4);
+            updates[0].fromString("a 1");
+            updates[1].fromString("b 1");
+            updates[2].fromString("a 2");
+            updates[3].fromString("c 1");
+            PortReaderBuffer<Bottle> buffer;
+            buffer.setCapacity(3, BufferOverflowPolicy::Coalesce);
+            buffer.setCoalescingKey([](const Bottle& b) { return b.get(0).asString(); });
+            for (auto& b : updates) {
+                buffer.acceptObject(&b, nullptr);
+            }
+            CHECK(buffer.getPendingReads() == 3); // one message for each key
+            CHECK(buffer.read()->toString() == "a 2"); // replaced in place
+            CHECK(buffer.read()->toString() == "b 1");
+            CHECK(buffer.read()->toString() == "c 1");
+            CHECK(buffer.getOverflowStats().coalesced == 1);
+        }
+
+        {
+            INFO("block");
+            PortReaderBuffer<Bottle> buffer;
+            buffer.setCapacity(2, BufferOverflowPolicy::Block);
+            std::thread sender([&]() {
+                for (auto& b : data) {
+                    buffer.acceptObject(&b, nullptr);
+                }
+            });
+            for (size_t i = 0; i < data.size(); i++) {
+                Bottle* bot = buffer.read();
+                REQUIRE(bot != nullptr);
+                CHECK(bot->get(0).asInt32() == static_cast<std::int32_t>(i)); // nothing dropped
+                CHECK(buffer.getPendingReads() <= 2); // bounded
+            }
+            sender.join();
+            BufferOverflowStats stats = buffer.getOverflowStats();
+            CHECK(stats.received == data.size());
+            CHECK(stats.droppedOldest + stats.droppedNewest == 0);
+            CHECK(stats.highWater <= 2);
+        }
+
+        {
+            INFO("blocked message counted once");
+            std::vector<Bottle> two(2);
+            PortReaderBuffer<Bottle> buffer;
+            buffer.setCapacity(1, BufferOverflowPolicy::Block);
+            std::thread sender([&]() {
+                for (auto& b : two) {
+                    buffer.acceptObject(&b, nullptr);
+                }
+            });
+            int rep = 0;
+            while (buffer.getOverflowStats().blocked == 0 && rep < 50) {
+                Time::delay(0.1);
+                rep++;
+            }
+            for (int i = 0; i < 5; i++) {
+                // wakes the sender up, there is still no room
+                buffer.setCapacity(1, BufferOverflowPolicy::Block);
+                Time::delay(0.02);
+            }
+            CHECK(buffer.getOverflowStats().blocked == 1);
+            REQUIRE(buffer.read() != nullptr);
+            REQUIRE(buffer.read() != nullptr);
+            sender.join();
+            CHECK(buffer.getOverflowStats().blocked == 1);
+        }
+
+        {
+            INFO("block released on close");
+            BufferedPort<Bottle> out;
+            BufferedPort<Bottle> in;
+            in.setCapacity(1, BufferOverflowPolicy::Block);
+            REQUIRE(out.open("/out"));
+            REQUIRE(in.open("/in"));
+            REQUIRE(Network::connect("/out", "/in"));
+            out.prepare().fromString("1 2 3");
+            out.write(true);
+            out.prepare().fromString("4 5 6");
+            out.write(true);
+            int rep = 0;
+            while (in.getOverflowStats().blocked == 0 && rep < 50) {
+                Time::delay(0.1);
+                rep++;
+            }
+            CHECK(in.getOverflowStats().blocked > 0); // sender waiting for room
+            in.close(); // must not wait for the reader
+            out.close();
+        }
+    }
+
     NetworkBase::setLocalMode(false);
 }
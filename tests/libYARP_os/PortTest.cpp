@@ -25,7 +25,9 @@
 #include <yarp/os/RpcClient.h>
 #include <yarp/os/RpcServer.h>
 #include <yarp/os/PortInfo.h>
+#include <yarp/os/QosStyle.h>
 #include <yarp/os/Log.h>
+#include <yarp/os/Stamp.h>
 
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/dev/Drivers.h>
@@ -34,6 +36,20 @@
 
 #include <yarp/companion/impl/Companion.h>
 
+#if !defined(YARP_HAS_ACE) && defined(__unix__)
+#    include <yarp/os/impl/TcpStream.h>
+#    include <sys/socket.h>
+#endif
+
+#if defined(__unix__)
+#    include <cstdio>
+#    include <unistd.h>
+#endif
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
 #include <catch.hpp>
 #include <harness.h>
 
@@ -1169,6 +1185,57 @@ TEST_CASE("OS::PortTest", "[yarp::os]")
         writer.finish();
     }
 
+#if defined(__unix__)
+    SECTION("check yarp bench")
+    {
+        auto& companion = yarp::companion::impl::Companion::getInstance();
+        // Run yarp bench with its standard output sent to a file
+        auto bench = [&companion](std::vector<const char*> args, std::string& output) {
+            FILE* tmp = std::tmpfile();
+            REQUIRE(tmp != nullptr);
+            fflush(stdout);
+            int saved = dup(fileno(stdout));
+            dup2(fileno(tmp), fileno(stdout));
+            int result = companion.cmdBench(static_cast<int>(args.size()), const_cast<char**>(args.data()));
+            fflush(stdout);
+            dup2(saved, fileno(stdout));
+            close(saved);
+            output.clear();
+            rewind(tmp);
+            int ch = 0;
+            while ((ch = fgetc(tmp)) != EOF) {
+                output += static_cast<char>(ch);
+            }
+            fclose(tmp);
+            return result;
+        };
+
+        std::string output;
+        CHECK(bench({"--payload", "nothing"}, output) != 0); // unknown payload
+        CHECK(bench({"--count", "0"}, output) != 0); // no messages
+
+        CHECK(bench({"--count", "20", "--warmup", "2"}, output) == 0);
+        Bottle report(output);
+        CHECK(report.find("carrier").asString() == "tcp");
+        CHECK(report.find("payload").asString() == "bottle");
+        CHECK(report.find("sent").asInt32() == 20);
+        CHECK(report.find("received").asInt32() == 20);
+        CHECK(report.find("drops").asInt32() == 0);
+        CHECK(report.find("bytes").asInt32() > 0);
+
+        CHECK(bench({"--count", "20", "--warmup", "2", "--json", "--name", "/bench"}, output) == 0);
+        INFO(output);
+        REQUIRE(output.length() > 2);
+        CHECK(output.front() == '{');
+        CHECK(output.substr(output.length() - 2) == "}\n");
+        CHECK(output.find("\"carrier\": \"tcp\"") != std::string::npos);
+        CHECK(output.find("\"output\": \"/bench/o\"") != std::string::npos);
+        CHECK(output.find("\"input\": \"/bench/i\"") != std::string::npos);
+        CHECK(output.find("\"sent\": 20,") != std::string::npos);
+        CHECK(output.find("\"received\": 20,") != std::string::npos);
+    }
+#endif
+
     SECTION("check behavior on missing slash")
     {
         Port p;
@@ -1547,5 +1614,445 @@ TEST_CASE("OS::PortTest", "[yarp::os]")
         p.close();
     }
 
+    SECTION("checking large image over tcp, with and without zero-copy writes")
+    {
+        for (const char* zerocopy : {"", "65536"}) {
+            INFO("YARP_TCP_ZEROCOPY=" << zerocopy);
+            NetworkBase::setEnvironment("YARP_TCP_ZEROCOPY", zerocopy);
+
+            BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> input;
+            Port output;
+            input.setStrict();
+            REQUIRE(input.open("/in"));
+            REQUIRE(output.open("/out"));
+            REQUIRE(NetworkBase::connect("/out", "/in", "tcp"));
+
+            yarp::sig::ImageOf<yarp::sig::PixelRgb> img;
+            img.resize(640, 480);
+            for (size_t y = 0; y < img.height(); y++) {
+                for (size_t x = 0; x < img.width(); x++) {
+                    img(x, y) = yarp::sig::PixelRgb(x % 256, y % 256, (x + y) % 256);
+                }
+            }
+            CHECK(output.write(img));
+            yarp::sig::ImageOf<yarp::sig::PixelRgb>* result = input.read();
+            REQUIRE(result != nullptr);
+            CHECK(result->width() == img.width());
+            CHECK(result->height() == img.height());
+            CHECK(result->getRawImageSize() == img.getRawImageSize());
+            CHECK(memcmp(result->getRawImage(), img.getRawImage(), img.getRawImageSize()) == 0);
+
+            output.close();
+            input.close();
+        }
+        NetworkBase::unsetEnvironment("YARP_TCP_ZEROCOPY");
+    }
+
+#if !defined(YARP_HAS_ACE) && defined(__unix__)
+    SECTION("checking that gathered writes with a timeout keep the socket timeout")
+    {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        struct timeval original {7, 0};
+        REQUIRE(setsockopt(fds[0], SOL_SOCKET, SO_SNDTIMEO, &original, sizeof(original)) == 0);
+
+        yarp::os::impl::TcpStream stream;
+        stream.set_handle(fds[0]);
+        char data[] = "hello";
+        iovec iov[2] {{data, 2}, {data + 2, 3}};
+        struct timeval timeout {1, 0};
+        CHECK(stream.sendv_n(iov, 2, &timeout) == 5);
+
+        struct timeval after {0, 0};
+        socklen_t len = sizeof(after);
+        REQUIRE(getsockopt(fds[0], SOL_SOCKET, SO_SNDTIMEO, &after, &len) == 0);
+        CHECK(after.tv_sec == 7);
+        char received[5];
+        CHECK(::recv(fds[1], received, sizeof(received), 0) == 5);
+        CHECK(memcmp(received, data, 5) == 0);
+        stream.close();
+        ::close(fds[1]);
+    }
+#endif
+
+    SECTION("checking large bottle over udp, with batched datagrams or error correction")
+    {
+        NetworkBase::setEnvironment("YARP_DGRAM_SIZE", "8192");
+        const std::vector<std::pair<const char*, const char*>> configs {
+            {"", "udp"},
+            {"4", "udp"},
+            {"", "udp+fec.20"}
+        };
+        for (const auto& config : configs) {
+            const char* batch = config.first;
+            const char* carrier = config.second;
+            INFO("YARP_DGRAM_BATCH=" << batch << " carrier " << carrier);
+            NetworkBase::setEnvironment("YARP_DGRAM_BATCH", batch);
+
+            Bottle bot1;
+            std::vector<yarp::conf::float64_t> values(20000);
+            for (size_t i = 0; i < values.size(); i++) {
+                values[i] = i * 0.5;
+            }
+            bot1.addList(values);
+
+            BufferedPort<Bottle> input;
+            Port output;
+            REQUIRE(input.open("/in"));
+            REQUIRE(output.open("/out"));
+            REQUIRE(NetworkBase::connect("/out", "/in", carrier));
+
+            // udp may drop messages, send until one gets through
+            Bottle* result = nullptr;
+            for (int i = 0; i < 50 && result == nullptr; i++) {
+                CHECK(output.write(bot1));
+                Time::delay(0.1);
+                result = input.read(false);
+            }
+            REQUIRE(result != nullptr);
+            CHECK(result->toString() == bot1.toString());
+
+            output.close();
+            input.close();
+        }
+        NetworkBase::unsetEnvironment("YARP_DGRAM_BATCH");
+        NetworkBase::unsetEnvironment("YARP_DGRAM_SIZE");
+    }
+
+    SECTION("checking coalesced writes over tcp")
+    {
+        NetworkBase::setEnvironment("YARP_PORTCORE_COALESCE", "20");
+
+        for (const char* carrier : {"tcp", "fast_tcp"}) {
+            INFO("carrier " << carrier);
+            BufferedPort<Bottle> output;
+            BufferedPort<Bottle> input;
+            input.setStrict();
+            REQUIRE(output.open("/out"));
+            REQUIRE(input.open("/in"));
+            REQUIRE(NetworkBase::connect("/out", "/in", carrier));
+
+            const int count = 100;
+            for (int i = 0; i < count; i++) {
+                Bottle& b = output.prepare();
+                b.clear();
+                b.addInt32(i);
+                b.addString("joint state");
+                output.writeStrict();
+            }
+            // Every message is delivered on its own, in order.
+            for (int i = 0; i < count; i++) {
+                Bottle* b = input.read();
+                REQUIRE(b != nullptr);
+                CHECK(b->get(0).asInt32() == i);
+                CHECK(b->size() == 2);
+            }
+            CHECK(input.getPendingReads() == 0);
+
+            // The last batch is reported once it is acknowledged.
+            Property* stats = nullptr;
+            Bottle reply;
+            for (int i = 0; i < 50; i++) {
+                Bottle cmd("prop get /out");
+                reply.clear();
+                REQUIRE(NetworkBase::write(output.where(), cmd, reply, true));
+                stats = reply.find("coalescing").asDict();
+                REQUIRE(stats != nullptr);
+                if (stats->find("messages").asInt32() == count) {
+                    break;
+                }
+                Time::delay(0.05);
+            }
+            CHECK(stats->find("enabled").asInt32() == 1);
+            CHECK(stats->find("messages").asInt32() == count);
+            CHECK(stats->find("batches").asInt32() >= 1);
+            CHECK(stats->find("batches").asInt32() < count);
+            CHECK(stats->find("delay_max").asFloat64() < 1.0);
+
+            // Messages still waiting for their batch are sent on close.
+            for (int i = 0; i < 3; i++) {
+                Bottle& b = output.prepare();
+                b.clear();
+                b.addInt32(count + i);
+                output.writeStrict();
+            }
+            output.close();
+            for (int i = 0; i < 3; i++) {
+                Bottle* b = nullptr;
+                for (int k = 0; k < 100 && b == nullptr; k++) {
+                    b = input.read(false);
+                    if (b == nullptr) {
+                        Time::delay(0.02);
+                    }
+                }
+                REQUIRE(b != nullptr);
+                CHECK(b->get(0).asInt32() == count + i);
+            }
+            input.close();
+        }
+
+        NetworkBase::unsetEnvironment("YARP_PORTCORE_COALESCE");
+    }
+
+    SECTION("checking in-process delivery without serialization")
+    {
+        NetworkBase::setEnvironment("YARP_PORTCORE_LOCAL_DELIVERY", "1");
+
+        BufferedPort<Bottle> output;
+        BufferedPort<Bottle> input;
+        Port plainInput;
+        input.setStrict();
+        REQUIRE(output.open("/out"));
+        REQUIRE(input.open("/in"));
+        REQUIRE(plainInput.open("/plain"));
+        REQUIRE(NetworkBase::connect("/out", "/in"));
+        REQUIRE(NetworkBase::connect("/out", "/plain"));
+
+        // The reader gets its own copy of the object written.
+        Bottle& first = output.prepare();
+        first.fromString("1 2 3");
+        output.write(true);
+        Bottle* got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got != &first);
+        CHECK(got->toString() == "1 2 3");
+
+        // A plain Port reader gets a serialized copy.
+        Bottle plain;
+        REQUIRE(plainInput.read(plain));
+        CHECK(plain.toString() == "1 2 3");
+
+        // The copy does not change with the object of the writer.
+        first.fromString("changed");
+        CHECK(got->toString() == "1 2 3");
+
+        // The reader may modify its copy.
+        got->addInt32(4);
+        Bottle& second = output.prepare();
+        second.fromString("4 5");
+        output.write(true);
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "4 5");
+        REQUIRE(plainInput.read(plain));
+        CHECK(plain.toString() == "4 5");
+
+        // Messages not read yet are kept when the writer closes.
+        Bottle& third = output.prepare();
+        third.fromString("6");
+        output.write(true);
+        REQUIRE(plainInput.read(plain));
+        CHECK(input.getPendingReads() == 1);
+        output.close();
+        got = input.read(false);
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "6");
+
+        // Objects of another type are copied through their serialized
+        // form, in order with the others.
+        Port mixed;
+        REQUIRE(mixed.open("/mixed"));
+        REQUIRE(NetworkBase::connect("/mixed", "/in"));
+        Bottle before("7");
+        Stamp stamp(42, 1.5);
+        Bottle after("8");
+        REQUIRE(mixed.write(before));
+        REQUIRE(mixed.write(stamp));
+        REQUIRE(mixed.write(after));
+        CHECK(input.getPendingReads() == 3);
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "7");
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->get(0).asInt32() == 42);
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "8");
+
+        // A full buffer drops the messages that arrive, they are not
+        // sent over the connection instead.
+        input.setCapacity(1, BufferOverflowPolicy::DropNewest);
+        REQUIRE(mixed.write(before));
+        REQUIRE(mixed.write(after));
+        CHECK(input.getPendingReads() == 1);
+        CHECK(input.getOverflowStats().droppedNewest == 1);
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "7");
+        CHECK(input.getPendingReads() == 0);
+        mixed.close();
+
+        // A reader that waits for room is served through the connection,
+        // which holds the writer back instead of dropping the message.
+        input.setCapacity(1, BufferOverflowPolicy::Block);
+        BufferedPort<Bottle> slow;
+        REQUIRE(slow.open("/slow"));
+        REQUIRE(NetworkBase::connect("/slow", "/in"));
+        slow.prepare().fromString("9");
+        slow.write();
+        slow.waitForWrite();
+        CHECK(input.getPendingReads() == 1);
+        slow.prepare().fromString("10");
+        slow.write();
+        Time::delay(0.2);
+        CHECK(input.getPendingReads() == 1);
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "9");
+        got = input.read();
+        REQUIRE(got != nullptr);
+        CHECK(got->toString() == "10");
+        CHECK(input.getOverflowStats().droppedNewest == 1);
+        slow.waitForWrite();
+        slow.close();
+
+        plainInput.close();
+        input.close();
+        NetworkBase::unsetEnvironment("YARP_PORTCORE_LOCAL_DELIVERY");
+    }
+
+    SECTION("checking connection statistics")
+    {
+        BufferedPort<Bottle> output;
+        BufferedPort<Bottle> input;
+        input.setStrict();
+        REQUIRE(output.open("/out"));
+        REQUIRE(input.open("/in"));
+        REQUIRE(NetworkBase::connect("/out", "/in"));
+
+        const int count = 50;
+        for (int i = 0; i < count; i++) {
+            Bottle& b = output.prepare();
+            b.clear();
+            b.addInt32(i);
+            output.writeStrict();
+        }
+        output.waitForWrite();
+        for (int i = 0; i < 100 && input.getPendingReads() < count; i++) {
+            Time::delay(0.01);
+        }
+
+        Bottle cmd("stat");
+        Bottle reply;
+        REQUIRE(NetworkBase::write(output.where(), cmd, reply, true));
+        // A BufferedPort has a reader queue, reported first.
+        CHECK(reply.find("queue").asList() != nullptr);
+        Bottle* out = reply.get(1).asList();
+        REQUIRE(out != nullptr);
+        CHECK(out->get(0).asString() == "out");
+        CHECK(out->get(1).asString() == "/in");
+        CHECK(out->find("carrier").asString() == "tcp");
+        CHECK(out->find("messages").asInt64() == count);
+        CHECK(out->find("bytes").asInt64() > count);
+        CHECK(out->find("drops").asInt64() == 0);
+        Bottle* send = out->find("send_us").asList();
+        REQUIRE(send != nullptr);
+        CHECK(send->find("count").asInt64() == count);
+        CHECK(send->find("p50").asFloat64() <= send->find("max").asFloat64());
+        CHECK(out->find("interval_us").asList() != nullptr);
+        std::int64_t sent = out->find("bytes").asInt64();
+
+        // The messages are still waiting to be read.
+        reply.clear();
+        REQUIRE(NetworkBase::write(input.where(), cmd, reply, true));
+        Bottle* queue = reply.find("queue").asList();
+        REQUIRE(queue != nullptr);
+        CHECK(queue->find("pending").asInt32() == count);
+        Bottle* in = reply.get(1).asList();
+        REQUIRE(in != nullptr);
+        CHECK(in->get(0).asString() == "in");
+        CHECK(in->get(1).asString() == "/out");
+        CHECK(in->find("messages").asInt64() == count);
+        // The headers of the messages are not counted on input.
+        CHECK(in->find("bytes").asInt64() >= count);
+        CHECK(in->find("bytes").asInt64() <= sent);
+
+        // A single connection can be asked for.
+        Bottle one("stat /out");
+        reply.clear();
+        REQUIRE(NetworkBase::write(input.where(), one, reply, true));
+        CHECK(reply.size() == 1);
+        CHECK(reply.get(0).asList()->get(1).asString() == "/out");
+        Bottle none("stat /nowhere");
+        reply.clear();
+        REQUIRE(NetworkBase::write(input.where(), none, reply, true));
+        CHECK(reply.get(0).asVocab() == yarp::os::createVocab('f', 'a', 'i', 'l'));
+
+        // Messages written while the previous one is being sent are
+        // dropped on that connection, and counted.
+        for (int i = 0; i < count; i++) {
+            Bottle& b = output.prepare();
+            b.clear();
+            b.addInt32(i);
+            output.write();
+        }
+        output.waitForWrite();
+        reply.clear();
+        REQUIRE(NetworkBase::write(output.where(), cmd, reply, true));
+        out = reply.get(1).asList();
+        REQUIRE(out != nullptr);
+        CHECK(out->find("messages").asInt64() + out->find("drops").asInt64() == 2 * count);
+
+        output.close();
+        input.close();
+    }
+
+    SECTION("checking low priority connections get the latest message")
+    {
+        BufferedPort<Bottle> output;
+        BufferedPort<Bottle> fast;
+        BufferedPort<Bottle> slow;
+        fast.setStrict();
+        // The slow reader holds back the acknowledgements.
+        slow.setFlowControl(1);
+        REQUIRE(output.open("/out"));
+        REQUIRE(fast.open("/fast"));
+        REQUIRE(slow.open("/slow"));
+        REQUIRE(NetworkBase::connect("/out", "/fast"));
+        REQUIRE(NetworkBase::connect("/out", "/slow"));
+        QosStyle low;
+        low.setPacketPriorityByLevel(QosStyle::PacketPriorityLow);
+        NetworkBase::setConnectionQos("/out", "/slow", low);
+
+        // Waiting for the writes waits only for the normal connection.
+        const int count = 50;
+        for (int i = 0; i < count; i++) {
+            Bottle& b = output.prepare();
+            b.clear();
+            b.addInt32(i);
+            output.writeStrict();
+        }
+        output.waitForWrite();
+        for (int i = 0; i < 100 && fast.getPendingReads() < count; i++) {
+            Time::delay(0.01);
+        }
+        CHECK(fast.getPendingReads() == count); // nothing lost on the normal connection
+
+        int last = -1;
+        int received = 0;
+        while (last < count - 1) {
+            Bottle* b = slow.read();
+            REQUIRE(b != nullptr);
+            CHECK(b->get(0).asInt32() > last); // in order
+            last = b->get(0).asInt32();
+            received++;
+        }
+        INFO("received " << received << " messages on the low priority connection");
+        CHECK(received < count); // the older messages were replaced
+
+        Bottle cmd("stat /slow");
+        Bottle reply;
+        REQUIRE(NetworkBase::write(output.where(), cmd, reply, true));
+        Bottle* out = reply.get(0).asList();
+        REQUIRE(out != nullptr);
+        CHECK(out->find("drops").asInt64() > 0);
+        CHECK(out->find("messages").asInt64() + out->find("drops").asInt64() == count);
+
+        output.close();
+        fast.close();
+        slow.close();
+    }
+
     NetworkBase::setLocalMode(false);
 }
@@ -16,6 +16,9 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cfloat>
+#include <map>
+#include <string>
+#include <vector>
 
 #include <catch.hpp>
 #include <harness.h>
@@ -614,4 +617,107 @@ check $x $y\n\
         CHECK(p.find("two").asFloat64() == 2.0);
         CHECK(p.find("string").asString() == "foo");
     }
+
+    SECTION("checking lookups with many keys")
+    {
+        Property p;
+        for (int i = 0; i < 1000; i++) {
+            p.put("key_number_" + std::to_string(i), i);
+        }
+        for (int i = 0; i < 1000; i++) {
+            std::string key = "key_number_" + std::to_string(i);
+            CHECK(p.check(key));
+            CHECK(p.check(key.c_str()));
+            CHECK(p.find(key.c_str()).asInt32() == i);
+        }
+        CHECK_FALSE(p.check("key_number_1000"));
+        CHECK(p.find("key_number_1000").isNull());
+        CHECK_FALSE(p.check(std::string("key_number_1\0", 13)));
+
+        for (int i = 0; i < 1000; i += 2) {
+            p.unput("key_number_" + std::to_string(i));
+        }
+        for (int i = 0; i < 1000; i++) {
+            CHECK(p.check("key_number_" + std::to_string(i)) == (i % 2 == 1));
+        }
+
+        Property copy;
+        copy = p;
+        CHECK(copy.find("key_number_999").asInt32() == 999);
+        CHECK_FALSE(copy.check("key_number_998"));
+
+        p.clear();
+        CHECK_FALSE(p.check("key_number_999"));
+        p.put("key_number_999", "again");
+        CHECK(p.find("key_number_999").asString() == "again");
+        CHECK(copy.find("key_number_999").asInt32() == 999);
+    }
+}
+
+TEST_CASE("OS::PropertyBenchmark", "[yarp::os][.][benchmark]")
+{
+    // A configuration similar to the ones of the parts of a robot, which
+    // are read at startup and then looked up key by key by the devices.
+    std::vector<std::string> keys;
+    std::string config;
+    for (int i = 0; i < 300; i++) {
+        keys.push_back("controlboard_parameter_" + std::to_string(i));
+        config += "(" + keys.back() + " " + std::to_string(i) + " 1.5 2.5 \"name\") ";
+    }
+    Property prop(config.c_str());
+
+    // The same lookups in a std::map, as done by Property before it used
+    // a hash index
+    std::map<std::string, Bottle> map;
+    for (const auto& key : keys) {
+        map[key] = prop.findGroup(key);
+    }
+
+    const int rounds = 100;
+    long long expected = 0;
+    for (int i = 0; i < 300; i++) {
+        expected += i;
+    }
+    expected *= rounds;
+
+    BENCHMARK("parsing")
+    {
+        Property p;
+        p.fromString(config);
+    }
+
+    long long sumMap = 0;
+    BENCHMARK("lookups in std::map")
+    {
+        sumMap = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& key : keys) {
+                sumMap += map.find(key)->second.get(1).asInt32();
+            }
+        }
+    }
+    CHECK(sumMap == expected);
+
+    long long sum = 0;
+    BENCHMARK("lookups in Property")
+    {
+        sum = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& key : keys) {
+                sum += prop.find(key).asInt32();
+            }
+        }
+    }
+    CHECK(sum == expected);
+
+    BENCHMARK("lookups in Property, const char* keys")
+    {
+        sum = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& key : keys) {
+                sum += prop.find(key.c_str()).asInt32();
+            }
+        }
+    }
+    CHECK(sum == expected);
 }
@@ -10,6 +10,7 @@
 #include <yarp/os/impl/DgramTwoWayStream.h>
 
 #include <cstdio>
+#include <cstring>
 #include <string>
 
 #include <catch.hpp>
@@ -251,4 +252,62 @@ TEST_CASE("OS::impl::DgramTwoWayStreamTest", "[yarp::os][yarp::os::impl]")
             }
         }
     }
+
+    SECTION("Test Dgram with forward error correction")
+    {
+        for (size_t i=0; i<msg.length(); i++) {
+            msg.get()[i] = i%128;
+        }
+
+        // one parity dgram every 2 dgrams
+        out.setRedundancy(50);
+        out.openMonitor(sz, sz);
+        for (int k=0; k<3; k++) {
+            out.beginPacket();
+            out.write(msg.bytes());
+            out.flush();
+            out.endPacket();
+        }
+        // 3 dgrams per message, plus 2 parity dgrams
+        CHECK(15 == out.size());
+
+        // drop nothing, then each dgram of the middle message, then two
+        // dgrams of the same group
+        for (int problem=-1; problem<6; problem++) {
+            INFO("problem " << problem);
+            DgramTest fin;
+            fin.setRedundancy(50);
+            fin.openMonitor(sz, sz);
+            fin.copyMonitor(out);
+            if (problem == 5) {
+                fin.corruptDrop(5);
+                fin.corruptDrop(5);
+            } else if (problem >= 0) {
+                fin.corruptDrop(5 + problem);
+            }
+
+            bool goodRead[3];
+            for (int k=0; k<3; k++) {
+                for (size_t i=0; i<recv.length(); i++) {
+                    recv.get()[i] = 0;
+                }
+                fin.beginPacket();
+                int len = fin.readFull(recv.bytes());
+                fin.endPacket();
+                goodRead[k] = ((size_t) len == recv.length()) && memcmp(recv.get(), msg.get(), recv.length()) == 0;
+            }
+            CHECK(goodRead[0]);
+            CHECK(goodRead[1] == (problem != 5));
+            if (problem == 5) {
+                CHECK(fin.getRecoveredDatagrams() == 0);
+                CHECK(fin.getLostDatagrams() == 2);
+            } else {
+                CHECK(goodRead[2]);
+                // dropping a parity dgram does not need any repair
+                bool parity = (problem == 2 || problem == 4);
+                CHECK(fin.getRecoveredDatagrams() == ((problem >= 0 && !parity) ? 1 : 0));
+                CHECK(fin.getLostDatagrams() == 0);
+            }
+        }
+    }
 }
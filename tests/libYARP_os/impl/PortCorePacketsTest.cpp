@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/os/impl/PortCorePackets.h>
+
+#include <yarp/os/Bottle.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include <harness.h>
+
+using namespace yarp::os;
+using namespace yarp::os::impl;
+
+namespace {
+class CompletionCounter : public PortWriter
+{
+public:
+    mutable std::atomic<int> completions {0};
+
+    bool write(ConnectionWriter& writer) const override
+    {
+        YARP_UNUSED(writer);
+        return true;
+    }
+
+    void onCompletion() const override
+    {
+        completions++;
+    }
+};
+} // namespace
+
+TEST_CASE("OS::impl::PortCorePacketsTest", "[yarp::os][yarp::os::impl]")
+{
+    SECTION("packets are recycled")
+    {
+        PortCorePackets packets(4);
+        CompletionCounter content;
+        PortCorePacket* packet = packets.getFreePacket();
+        REQUIRE(packet != nullptr);
+        packet->setContent(&content);
+        CHECK(packets.getCount() == 1);
+        packet->inc();
+        CHECK_FALSE(packets.releasePacket(packet));
+        CHECK(content.completions == 0);
+        CHECK(packets.releasePacket(packet));
+        CHECK(content.completions == 1);
+        CHECK(packets.getCount() == 0);
+
+        PortCorePackets::Stats stats = packets.getStats();
+        CHECK(stats.capacity == 4);
+        CHECK(stats.acquired == 1);
+        CHECK(stats.highWater == 1);
+        CHECK(stats.exhausted == 0);
+        CHECK(stats.overflow == 0);
+    }
+
+    SECTION("exhausting the pool")
+    {
+        PortCorePackets packets(2);
+        std::vector<PortCorePacket*> used;
+        for (int i = 0; i < 5; i++) {
+            used.push_back(packets.getFreePacket());
+        }
+        CHECK(std::set<PortCorePacket*>(used.begin(), used.end()).size() == 5);
+        CHECK(packets.getCount() == 5);
+        for (auto* packet : used) {
+            packets.freePacket(packet);
+        }
+        PortCorePackets::Stats stats = packets.getStats();
+        CHECK(stats.active == 0);
+        CHECK(stats.highWater == 5);
+        CHECK(stats.exhausted == 3);
+        CHECK(stats.overflow == 3);
+
+        // Extra packets are kept and reused.
+        for (int i = 0; i < 5; i++) {
+            used[i] = packets.getFreePacket();
+        }
+        stats = packets.getStats();
+        CHECK(stats.overflow == 3);
+        for (auto* packet : used) {
+            packets.freePacket(packet);
+        }
+    }
+
+    SECTION("concurrent release")
+    {
+        PortCorePackets packets(8);
+        CompletionCounter content;
+        const int rounds = 1000;
+        const int users = 4;
+        for (int r = 0; r < rounds; r++) {
+            PortCorePacket* packet = packets.getFreePacket();
+            packet->setContent(&content);
+            for (int u = 0; u < users; u++) {
+                packet->inc();
+            }
+            std::vector<std::thread> threads;
+            for (int u = 0; u < users; u++) {
+                threads.emplace_back([&]() { packets.releasePacket(packet); });
+            }
+            packets.releasePacket(packet);
+            for (auto& t : threads) {
+                t.join();
+            }
+        }
+        CHECK(content.completions == rounds);
+        CHECK(packets.getCount() == 0);
+        CHECK(packets.getStats().exhausted == 0);
+    }
+}
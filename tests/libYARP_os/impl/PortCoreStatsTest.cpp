@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <yarp/os/impl/PortCoreStats.h>
+
+#include <yarp/os/Bottle.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include <harness.h>
+
+using namespace yarp::os;
+using namespace yarp::os::impl;
+
+TEST_CASE("OS::impl::PortCoreStatsTest", "[yarp::os][yarp::os::impl]")
+{
+    SECTION("percentiles are within the precision of the histogram")
+    {
+        PortCoreHistogram histogram;
+        CHECK(histogram.getPercentile(0.5) == 0);
+
+        std::mt19937 gen(42);
+        std::lognormal_distribution<double> duration(5.0, 2.0);
+        std::vector<double> micros;
+        for (int i = 0; i < 20000; i++) {
+            double us = std::floor(duration(gen));
+            micros.push_back(us);
+            histogram.record(us * 1e-6);
+        }
+        std::sort(micros.begin(), micros.end());
+        CHECK(histogram.getCount() == micros.size());
+        CHECK(histogram.getMax() == micros.back());
+        for (double fraction : {0.01, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+            INFO("fraction " << fraction);
+            auto index = static_cast<size_t>(std::ceil(fraction * micros.size())) - 1;
+            double exact = micros[index];
+            CHECK(std::abs(histogram.getPercentile(fraction) - exact) <= std::max(0.5, exact / 32));
+        }
+    }
+
+    SECTION("small and huge durations")
+    {
+        PortCoreHistogram histogram;
+        for (int us = 0; us < 16; us++) {
+            histogram.record(us * 1e-6);
+        }
+        CHECK(histogram.getPercentile(0.5) == 7);
+        CHECK(histogram.getPercentile(1.0) == 15);
+        histogram.record(-1);
+        histogram.record(1e9);
+        CHECK(histogram.getCount() == 18);
+        CHECK(histogram.getPercentile(0.01) == 0);
+        CHECK(histogram.getPercentile(1.0) > 6e10);
+    }
+
+    SECTION("statistics are recorded from several threads")
+    {
+        PortCoreStats stats;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&stats]() {
+                for (int i = 0; i < 1000; i++) {
+                    stats.recordMessage(10);
+                    stats.recordSendTime(1e-5);
+                    if (i % 10 == 0) {
+                        stats.recordDrop();
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(stats.getMessages() == 4000);
+        CHECK(stats.getBytes() == 40000);
+        CHECK(stats.getDrops() == 400);
+        CHECK(stats.getSendTime().getCount() == 4000);
+        CHECK(stats.getSendTime().getPercentile(0.99) == 10);
+        CHECK(stats.getInterval().getCount() == 3999);
+
+        Bottle b;
+        stats.describe(b);
+        CHECK(b.find("messages").asInt64() == 4000);
+        CHECK(b.find("drops").asInt64() == 400);
+        REQUIRE(b.find("send_us").asList() != nullptr);
+        CHECK(b.find("send_us").asList()->find("count").asInt64() == 4000);
+    }
+}
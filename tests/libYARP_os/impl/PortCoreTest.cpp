@@ -8,11 +8,15 @@
  */
 
 #include <yarp/os/impl/PortCore.h>
+#include <yarp/os/impl/PortCoreReactor.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/Carriers.h>
 #include <yarp/os/PortReader.h>
 #include <yarp/os/impl/BottleImpl.h>
 #include <yarp/os/Network.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Semaphore.h>
 
 #include <catch.hpp>
 #include <harness.h>
@@ -162,6 +166,57 @@ public:
         sender.close();
         receiver.close();
     }
+
+
+    void testFanOut() {
+        expectation = "";
+        receives = 0;
+
+        Contact write = NetworkBase::registerContact(Contact("/write", "tcp", "127.0.0.1", safePort()));
+        Contact read = NetworkBase::registerContact(Contact("/read", "tcp", "127.0.0.1", safePort()+1));
+        Contact read2 = NetworkBase::registerContact(Contact("/read2", "tcp", "127.0.0.1", safePort()+2));
+
+        PortCore sender;
+        PortCore receiver;
+        PortCore receiver2;
+        receiver.setReadHandler(*this);
+        receiver2.setReadHandler(*this);
+        sender.listen(write);
+        receiver.listen(read);
+        receiver2.listen(read2);
+        sender.start();
+        receiver.start();
+        receiver2.start();
+        NetworkBase::connect("/write", "/read");
+        NetworkBase::connect("/write", "/read2");
+        Time::delay(0.3);
+
+        Bottle bot;
+        bot.addInt32(0);
+        bot.addString("Hello world");
+        expectation = bot.toString();
+        sender.send(bot);
+        for (int i=0; i<1000; i++) {
+            if (receives==2) break;
+            Time::delay(0.3);
+        }
+        CHECK(receives == 2); // "received on both connections"
+
+        // Both connections use the binary encoding, so the message is
+        // serialized once and then shared.
+        Bottle cmd("prop get /write");
+        Bottle reply;
+        CHECK(NetworkBase::write(write, cmd, reply, true));
+        Property* cache = reply.find("encoding_cache").asDict();
+        REQUIRE(cache != nullptr);
+        CHECK(cache->find("encoded").asInt32() == 1);
+        CHECK(cache->find("hits").asInt32() == 1);
+        CHECK(cache->find("bytes_saved").asFloat64() > 0);
+
+        sender.close();
+        receiver.close();
+        receiver2.close();
+    }
 };
 
 TEST_CASE("OS::impl::PortCoreTest", "[yarp::os][yarp::os::impl]")
@@ -184,5 +239,198 @@ TEST_CASE("OS::impl::PortCoreTest", "[yarp::os][yarp::os::impl]")
         thePortCoreTest.testBackground();
     }
 
+    SECTION("serialize once for many connections check")
+    {
+        thePortCoreTest.testFanOut();
+    }
+
+    Network::setLocalMode(false);
+}
+
+namespace {
+
+// Reads a message, then waits until it is allowed to go on.
+class StallingReader : public PortReader {
+public:
+    Semaphore entered {0};
+    Semaphore gate {0};
+
+    bool read(ConnectionReader& reader) override {
+        Bottle bot;
+        if (!bot.read(reader)) {
+            return false;
+        }
+        entered.post();
+        gate.wait();
+        return true;
+    }
+};
+
+class CountingReader : public PortReader {
+public:
+    Semaphore received {0};
+
+    bool read(ConnectionReader& reader) override {
+        Bottle bot;
+        if (!bot.read(reader)) {
+            return false;
+        }
+        received.post();
+        return true;
+    }
+};
+
+// Replies with the message, after a tag.
+class EchoReader : public PortReader {
+public:
+    bool read(ConnectionReader& reader) override {
+        Bottle cmd;
+        if (!cmd.read(reader)) {
+            return false;
+        }
+        Bottle reply;
+        reply.addString("inner");
+        reply.append(cmd);
+        ConnectionWriter* writer = reader.getWriter();
+        if (writer != nullptr) {
+            reply.write(*writer);
+        }
+        return true;
+    }
+};
+
+// Replies with the reply of another port of the same process.
+class ForwardReader : public PortReader {
+public:
+    Port client;
+
+    bool read(ConnectionReader& reader) override {
+        Bottle cmd;
+        if (!cmd.read(reader)) {
+            return false;
+        }
+        Bottle reply;
+        client.write(cmd, reply);
+        ConnectionWriter* writer = reader.getWriter();
+        if (writer != nullptr) {
+            reply.write(*writer);
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+TEST_CASE("OS::impl::PortCoreReactorTest", "[yarp::os][yarp::os::impl]")
+{
+    // The reactor may have been created already, by the ports of other
+    // tests, with or without YARP_PORTCORE_REACTOR: it is restarted as
+    // needed, and left as it was.  A single I/O thread must be enough,
+    // whatever the handlers do.
+    Network::setLocalMode(true);
+    PortCoreTest thePortCoreTest;
+
+#if defined(__linux__)
+    PortCoreReactor& reactor = PortCoreReactor::get();
+    const size_t previousThreads = reactor.getStats().ioThreads;
+    REQUIRE(reactor.restart(1));
+    reactor.setIdleTimeout(2.0);
+    {
+        PortCoreReactor::Stats before = reactor.getStats();
+        REQUIRE(before.enabled);
+        CHECK(before.ioThreads == 1);
+
+        SECTION("simple bottle transmission check with reactor")
+        {
+            thePortCoreTest.testBottle();
+            PortCoreReactor::Stats after = PortCoreReactor::get().getStats();
+            CHECK(after.readWakeups > before.readWakeups);
+        }
+
+        SECTION("background transmission check with reactor")
+        {
+            thePortCoreTest.testBackground();
+            PortCoreReactor::Stats after = PortCoreReactor::get().getStats();
+            CHECK(after.readWakeups > before.readWakeups);
+            CHECK(after.tasks > before.tasks); // the writes were queued on the reactor
+        }
+
+        SECTION("blocked handler with reactor")
+        {
+            StallingReader stalling;
+            Port slowIn;
+            slowIn.setReader(stalling);
+            BufferedPort<Bottle> slowOut;
+            REQUIRE(slowIn.open("/slow/in"));
+            REQUIRE(slowOut.open("/slow/out"));
+            REQUIRE(NetworkBase::connect("/slow/out", "/slow/in"));
+
+            CountingReader counting;
+            Port fastIn;
+            fastIn.setReader(counting);
+            BufferedPort<Bottle> fastOut;
+            REQUIRE(fastIn.open("/fast/in"));
+            REQUIRE(fastOut.open("/fast/out"));
+            REQUIRE(NetworkBase::connect("/fast/out", "/fast/in"));
+
+            slowOut.prepare().fromString("1");
+            slowOut.write();
+            REQUIRE(stalling.entered.waitWithTimeout(10));
+
+            // The other connection is served while the handler is blocked.
+            fastOut.prepare().fromString("2");
+            fastOut.write();
+            CHECK(counting.received.waitWithTimeout(10));
+
+            stalling.gate.post();
+            fastOut.close();
+            fastIn.close();
+            slowOut.close();
+            slowIn.close();
+        }
+
+        SECTION("nested rpc with reactor")
+        {
+            EchoReader echo;
+            Port inner;
+            inner.setReader(echo);
+            REQUIRE(inner.open("/inner"));
+
+            ForwardReader forward;
+            Port outer;
+            outer.setReader(forward);
+            REQUIRE(outer.open("/outer"));
+            REQUIRE(forward.client.open("/outer/client"));
+            forward.client.setTimeout(10);
+            REQUIRE(NetworkBase::connect("/outer/client", "/inner"));
+
+            Port client;
+            REQUIRE(client.open("/client"));
+            client.setTimeout(10);
+            REQUIRE(NetworkBase::connect("/client", "/outer"));
+
+            // The reply of /inner is read while the handler of /outer
+            // waits for it.
+            Bottle cmd("hello");
+            Bottle reply;
+            REQUIRE(client.write(cmd, reply));
+            CHECK(reply.toString() == "inner hello");
+            CHECK(PortCoreReactor::get().getStats().workers >= 2);
+
+            client.close();
+            forward.client.close();
+            outer.close();
+            inner.close();
+
+            // The extra workers exit once they are not needed.
+            for (int i = 0; i < 100 && PortCoreReactor::get().getStats().workers > 1; i++) {
+                Time::delay(0.1);
+            }
+            CHECK(PortCoreReactor::get().getStats().workers == 1);
+        }
+    }
+    CHECK(reactor.restart(previousThreads));
+#endif
+
     Network::setLocalMode(false);
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2006-2020 Istituto Italiano di Tecnologia (IIT)
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms of the
+ * BSD-3-Clause license. See the accompanying LICENSE file for details.
+ */
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Contact.h>
+#include <yarp/os/NameStore.h>
+#include <yarp/os/Property.h>
+#include <yarp/serversql/yarpserversql.h>
+
+#include <YarpBuildLocation.h>
+
+#include <catch.hpp>
+#include <harness.h>
+
+using namespace yarp::os;
+
+namespace {
+
+NameStore* createStore(const std::string& backend, const std::string& portdb = ":memory:")
+{
+    Property opts;
+    opts.put("portdb", portdb);
+    opts.put("subdb", ":memory:");
+    opts.put("portdb-backend", backend);
+    opts.put("local", 1);
+    return yarpserver_create(opts);
+}
+
+std::string request(NameStore& store, const std::string& text)
+{
+    Bottle cmd(text);
+    Bottle reply;
+    store.process(cmd, reply, Contact());
+    return reply.toString();
+}
+
+// The requests sent by the ports when they are registered.
+void fill(NameStore& store)
+{
+    for (const char *port : {"/b", "/a", "/c"}) {
+        request(store, std::string("register ") + port + " tcp 127.0.0.1 ...");
+        request(store, std::string("set ") + port + " ips 10.0.0.1 127.0.0.1");
+        request(store, std::string("set ") + port + " process 42");
+    }
+    request(store, "set /b process 43");
+}
+
+std::string dump(NameStore& store)
+{
+    std::string result = request(store, "list");
+    for (const char *port : {"/a", "/b", "/c"}) {
+        result += "\n" + request(store, std::string("query ") + port);
+        result += "\n" + request(store, std::string("get ") + port + " ips");
+        result += "\n" + request(store, std::string("get ") + port + " process");
+    }
+    return result;
+}
+
+} // namespace
+
+
+TEST_CASE("serversql::TripleSourceTest", "[yarp::serversql]")
+{
+    SECTION("check the port databases agree")
+    {
+        std::unique_ptr<NameStore> sqlite(createStore("sqlite"));
+        std::unique_ptr<NameStore> memory(createStore("memory"));
+        REQUIRE(sqlite != nullptr);
+        REQUIRE(memory != nullptr);
+        fill(*sqlite);
+        fill(*memory);
+        CHECK(sqlite->query("/b").getPort() > 0); // port registered
+        CHECK(dump(*sqlite).find("property process \"=\" 43") != std::string::npos); // property set
+        CHECK(dump(*memory) == dump(*sqlite)); // same replies
+
+        request(*sqlite, "unregister /b");
+        request(*memory, "unregister /b");
+        CHECK_FALSE(memory->query("/b").isValid()); // port unregistered
+        CHECK(dump(*memory) == dump(*sqlite)); // same replies
+
+        request(*sqlite, "register /b tcp 127.0.0.1 ...");
+        request(*memory, "register /b tcp 127.0.0.1 ...");
+        CHECK(dump(*memory) == dump(*sqlite)); // same port number given again
+    }
+
+    SECTION("check the memory database is kept in its file")
+    {
+        std::string filename = std::string(CMAKE_BINARY_DIR) + "/TripleSourceTest.db";
+        std::remove(filename.c_str());
+        std::string before;
+        {
+            std::unique_ptr<NameStore> store(createStore("memory", filename));
+            REQUIRE(store != nullptr);
+            fill(*store);
+            request(*store, "register /d tcp 127.0.0.1 ...");
+            request(*store, "unregister /d");
+            before = dump(*store);
+        }
+        // a change that was being written when the server stopped
+        FILE *f = fopen(filename.c_str(), "a");
+        REQUIRE(f != nullptr);
+        fputs("set 999 -1 6 \"\" \"port\"", f);
+        fclose(f);
+
+        std::unique_ptr<NameStore> store(createStore("memory", filename));
+        REQUIRE(store != nullptr);
+        CHECK(dump(*store) == before); // same content
+        CHECK(before.find("property ips \"=\" \"10.0.0.1\" \"127.0.0.1\"") != std::string::npos); // properties kept
+        CHECK_FALSE(store->query("/d").isValid()); // removed port still removed
+        store.reset();
+        std::remove(filename.c_str());
+    }
+
+    SECTION("check the memory database does not open other files")
+    {
+        std::string filename = std::string(CMAKE_BINARY_DIR) + "/TripleSourceTest.sqlite";
+        std::remove(filename.c_str());
+        {
+            std::unique_ptr<NameStore> store(createStore("sqlite", filename));
+            REQUIRE(store != nullptr);
+            fill(*store);
+        }
+        auto contents = [&filename]() {
+            std::string result;
+            FILE *f = fopen(filename.c_str(), "rb");
+            if (f != nullptr) {
+                int ch = 0;
+                while ((ch = fgetc(f)) != EOF) {
+                    result += static_cast<char>(ch);
+                }
+                fclose(f);
+            }
+            return result;
+        };
+        std::string before = contents();
+        REQUIRE_FALSE(before.empty());
+
+        std::unique_ptr<NameStore> memory(createStore("memory", filename));
+        CHECK(memory == nullptr); // not a database of the memory backend
+        CHECK(contents() == before); // left alone
+
+        std::unique_ptr<NameStore> sqlite(createStore("sqlite", filename));
+        REQUIRE(sqlite != nullptr);
+        CHECK(sqlite->query("/b").getPort() > 0); // still usable
+        sqlite.reset();
+        std::remove(filename.c_str());
+    }
+}
@@ -7,18 +7,33 @@
  * BSD-3-Clause license. See the accompanying LICENSE file for details.
  */
 
+#include <yarp/os/DummyConnector.h>
 #include <yarp/os/NetType.h>
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/sig/Image.h>
 #include <yarp/sig/ImageDraw.h>
 #include <yarp/sig/ImageUtils.h>
+#include <yarp/sig/ImageNetworkHeader.h>
+#include <yarp/sig/impl/ImageBufferPool.h>
+#include <yarp/sig/impl/PixelConversion.h>
 #include <yarp/os/Network.h>
 #include <yarp/os/PortReaderBuffer.h>
+#include <yarp/os/BufferedPort.h>
 #include <yarp/os/Port.h>
 #include <yarp/os/Bottle.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/Log.h>
 #include <yarp/os/PeriodicThread.h>
+#include <yarp/os/Vocab.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
 
 #include <catch.hpp>
 #include <harness.h>
@@ -28,6 +43,35 @@ using namespace yarp::sig;
 using namespace yarp::sig::draw;
 using namespace yarp::os;
 
+using yarp::sig::impl::PixelConversionKernels;
+
+namespace {
+
+void fillPattern(Image& img)
+{
+    unsigned int x = 12345;
+    for (size_t i = 0; i < img.getRawImageSize(); i++) {
+        x = x * 1103515245 + 12345;
+        img.getRawImage()[i] = static_cast<unsigned char>(x >> 16);
+    }
+}
+
+// The padding of the rows is not compared.
+bool samePixels(const Image& img1, const Image& img2)
+{
+    if (img1.width() != img2.width() || img1.height() != img2.height()) {
+        return false;
+    }
+    for (size_t y = 0; y < img1.height(); y++) {
+        if (memcmp(img1.getPixelAddress(0, y), img2.getPixelAddress(0, y), img1.width() * img1.getPixelSize()) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 class readWriteTest : public yarp::os::PeriodicThread
 {
     yarp::os::Port p;
@@ -743,5 +787,570 @@ TEST_CASE("sig::ImageTest", "[yarp::sig]")
         CHECK(ok); // Checking data consistency bottom split
     }
 
+    SECTION("check pixel conversion kernels")
+    {
+        const int codes[] = {VOCAB_PIXEL_MONO, VOCAB_PIXEL_RGB, VOCAB_PIXEL_BGR, VOCAB_PIXEL_RGBA, VOCAB_PIXEL_BGRA};
+        const PixelConversionKernels kernels[] = {PixelConversionKernels::Scalar,
+                                                  PixelConversionKernels::Ssse3,
+                                                  PixelConversionKernels::Avx2};
+        // Widths that leave a few pixels at the end of the rows, and an
+        // image converted by several threads.
+        const size_t sizes[][2] = {{1, 1}, {5, 3}, {37, 7}, {331, 5}, {640, 480}};
+        PixelConversionKernels best = yarp::sig::impl::getPixelConversionKernels();
+        yarp::sig::impl::setPixelConversionThreads(4);
+        int mismatches = 0;
+        for (int code1 : codes) {
+            for (int code2 : codes) {
+                for (const auto& size : sizes) {
+                    for (size_t quantum : {1, 8}) {
+                        FlexImage src;
+                        src.setPixelCode(code1);
+                        src.setQuantum(quantum);
+                        src.resize(size[0], size[1]);
+                        fillPattern(src);
+
+                        // The existing conversion, one pixel at a time.
+                        FlexImage expected;
+                        expected.setPixelCode(code2);
+                        expected.setQuantum(9 - quantum);
+                        expected.setTopIsLowIndex(quantum == 1);
+                        REQUIRE(yarp::sig::impl::setPixelConversionKernels(PixelConversionKernels::Reference));
+                        expected.copy(src);
+
+                        for (PixelConversionKernels k : kernels) {
+                            if (!yarp::sig::impl::setPixelConversionKernels(k)) {
+                                continue; // not supported by this processor
+                            }
+                            FlexImage out;
+                            out.setPixelCode(code2);
+                            out.setQuantum(9 - quantum);
+                            out.setTopIsLowIndex(quantum == 1);
+                            out.copy(src);
+                            if (!samePixels(out, expected)) {
+                                mismatches++;
+                                UNSCOPED_INFO("mismatch " << Vocab::decode(code1) << " to " << Vocab::decode(code2)
+                                              << " " << size[0] << "x" << size[1] << " kernels " << static_cast<int>(k));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        yarp::sig::impl::setPixelConversionKernels(best);
+        yarp::sig::impl::setPixelConversionThreads(0);
+        CHECK(mismatches == 0); // same pixels as CopyPixel
+    }
+
+    SECTION("check resampling filters")
+    {
+        const Image::Resampling filters[] = {Image::Resampling::Nearest,
+                                             Image::Resampling::Bilinear,
+                                             Image::Resampling::Area};
+
+        // A uniform image stays uniform, whatever the scale.
+        for (Image::Resampling filter : filters) {
+            ImageOf<PixelRgb> rgb;
+            rgb.resize(37, 23);
+            rgb.zero();
+            for (size_t y = 0; y < rgb.height(); y++) {
+                for (size_t x = 0; x < rgb.width(); x++) {
+                    rgb(x, y) = PixelRgb(10, 200, 255);
+                }
+            }
+            ImageOf<PixelMono16> mono16;
+            mono16.resize(37, 23);
+            mono16.zero();
+            ImageOf<PixelFloat> fl;
+            fl.resize(37, 23);
+            ImageOf<PixelInt> in;
+            in.resize(37, 23);
+            for (size_t y = 0; y < rgb.height(); y++) {
+                for (size_t x = 0; x < rgb.width(); x++) {
+                    mono16(x, y) = 60000;
+                    fl(x, y) = 0.25F;
+                    in(x, y) = -1000;
+                }
+            }
+            for (const auto& size : {std::make_pair(11, 7), std::make_pair(80, 50)}) {
+                ImageOf<PixelRgb> rgb2;
+                ImageOf<PixelMono16> mono162;
+                ImageOf<PixelFloat> fl2;
+                ImageOf<PixelInt> in2;
+                rgb2.copy(rgb, size.first, size.second, filter);
+                mono162.copy(mono16, size.first, size.second, filter);
+                fl2.copy(fl, size.first, size.second, filter);
+                in2.copy(in, size.first, size.second, filter);
+                REQUIRE(rgb2.width() == static_cast<size_t>(size.first));
+                REQUIRE(rgb2.height() == static_cast<size_t>(size.second));
+                bool uniform = true;
+                for (size_t y = 0; y < rgb2.height(); y++) {
+                    for (size_t x = 0; x < rgb2.width(); x++) {
+                        uniform = uniform && rgb2(x, y).r == 10 && rgb2(x, y).g == 200 && rgb2(x, y).b == 255;
+                        uniform = uniform && mono162(x, y) == 60000;
+                        uniform = uniform && std::fabs(fl2(x, y) - 0.25F) < 1e-6;
+                        uniform = uniform && in2(x, y) == -1000;
+                    }
+                }
+                CHECK(uniform); // uniform after scaling
+            }
+        }
+
+        // The area filter averages the source pixels.
+        ImageOf<PixelMono> mono;
+        mono.resize(64, 32);
+        fillPattern(mono);
+        ImageOf<PixelMono> half;
+        half.copy(mono, 32, 16, Image::Resampling::Area);
+        bool averaged = true;
+        for (size_t y = 0; y < half.height(); y++) {
+            for (size_t x = 0; x < half.width(); x++) {
+                int sum = mono(2 * x, 2 * y) + mono(2 * x + 1, 2 * y) + mono(2 * x, 2 * y + 1) + mono(2 * x + 1, 2 * y + 1);
+                averaged = averaged && std::abs(half(x, y) * 4 - sum) <= 2;
+            }
+        }
+        CHECK(averaged); // 2x2 averages
+
+        // The bilinear filter interpolates between the pixel centers.
+        ImageOf<PixelMono> ramp;
+        ramp.resize(2, 1);
+        ramp(0, 0) = 0;
+        ramp(1, 0) = 255;
+        ImageOf<PixelMono> wide;
+        wide.copy(ramp, 4, 1, Image::Resampling::Bilinear);
+        CHECK(wide(0, 0) == 0);
+        CHECK(wide(1, 0) == 64);
+        CHECK(wide(2, 0) == 191);
+        CHECK(wide(3, 0) == 255);
+
+        // The same pixels, whatever the number of threads.
+        ImageOf<PixelRgb> big;
+        big.resize(640, 480);
+        fillPattern(big);
+        for (Image::Resampling filter : filters) {
+            ImageOf<PixelRgb> one;
+            ImageOf<PixelRgb> four;
+            yarp::sig::impl::setPixelConversionThreads(1);
+            one.copy(big, 400, 300, filter);
+            yarp::sig::impl::setPixelConversionThreads(4);
+            four.copy(big, 400, 300, filter);
+            CHECK(samePixels(one, four)); // same pixels with threads
+        }
+        yarp::sig::impl::setPixelConversionThreads(0);
+    }
+
+    SECTION("check image buffer pool")
+    {
+        // The buffers are aligned, whatever the row padding.
+        bool aligned = true;
+        for (size_t quantum : {1, 8}) {
+            for (size_t w : {1, 7, 333, 640}) {
+                FlexImage img;
+                img.setPixelCode(VOCAB_PIXEL_RGB);
+                img.setQuantum(quantum);
+                img.resize(w, 5);
+                aligned = aligned && reinterpret_cast<uintptr_t>(img.getRawImage()) % yarp::sig::impl::imageBufferAlignment == 0;
+            }
+        }
+        CHECK(aligned); // 64 byte aligned
+
+        // The buffers of a destroyed image are reused.
+        yarp::sig::impl::resetImageBufferPoolStats();
+        {
+            ImageOf<PixelRgb> img;
+            img.resize(123, 45);
+        }
+        yarp::sig::impl::ImageBufferPoolStats stats = yarp::sig::impl::getImageBufferPoolStats();
+        CHECK(stats.recycled >= 2); // pixels and row pointers given back
+        CHECK(stats.pooledBytes > 0);
+        yarp::sig::impl::resetImageBufferPoolStats();
+        {
+            ImageOf<PixelRgb> img;
+            img.resize(123, 45);
+        }
+        stats = yarp::sig::impl::getImageBufferPoolStats();
+        CHECK(stats.hits == 2);
+        CHECK(stats.misses == 0);
+
+        // Reading images of alternating sizes allocates nothing once each
+        // size was seen.
+        ImageOf<PixelRgb> small;
+        small.resize(320, 240);
+        fillPattern(small);
+        ImageOf<PixelRgb> large;
+        large.resize(640, 480);
+        fillPattern(large);
+        ImageOf<PixelRgb> received;
+        for (int i = 0; i < 2; i++) {
+            Portable::copyPortable(small, received);
+            Portable::copyPortable(large, received);
+        }
+        yarp::sig::impl::resetImageBufferPoolStats();
+        bool same = true;
+        for (int i = 0; i < 10; i++) {
+            Portable::copyPortable(small, received);
+            same = same && samePixels(small, received);
+            Portable::copyPortable(large, received);
+            same = same && samePixels(large, received);
+        }
+        stats = yarp::sig::impl::getImageBufferPoolStats();
+        CHECK(same);
+        CHECK(stats.hits > 0);
+        CHECK(stats.misses == 0); // no allocation
+
+        // A full pool frees the buffers given back.
+        yarp::sig::impl::clearImageBufferPool();
+        yarp::sig::impl::setImageBufferPoolLimit(0);
+        yarp::sig::impl::resetImageBufferPoolStats();
+        {
+            ImageOf<PixelRgb> img;
+            img.resize(123, 45);
+        }
+        stats = yarp::sig::impl::getImageBufferPoolStats();
+        CHECK(stats.recycled == 0);
+        CHECK(stats.discarded == 2);
+        CHECK(stats.pooledBytes == 0);
+        yarp::sig::impl::setImageBufferPoolLimit(size_t{128} << 20);
+    }
+
+    SECTION("check image views")
+    {
+        auto samePixel = [](const PixelRgb& a, const PixelRgb& b) {
+            return a.r == b.r && a.g == b.g && a.b == b.b;
+        };
+        ImageOf<PixelRgb> parent;
+        parent.resize(65, 48);
+        fillPattern(parent);
+
+        // The view shares the pixels of the parent.
+        ImageOf<PixelRgb> view;
+        REQUIRE(view.setView(parent, 10, 5, 21, 30));
+        CHECK(view.isView());
+        CHECK(view.width() == 21);
+        CHECK(view.height() == 30);
+        CHECK(view.getRowSize() == parent.getRowSize());
+        CHECK(&view(0, 0) == &parent(10, 5));
+        CHECK(&view(20, 29) == &parent(30, 34));
+        parent(12, 6) = PixelRgb(1, 2, 3);
+        CHECK(samePixel(view(2, 1), PixelRgb(1, 2, 3)));
+
+        // Regions outside the parent and other pixel types are refused.
+        ImageOf<PixelRgb> outside;
+        CHECK_FALSE(outside.setView(parent, 60, 0, 6, 1));
+        CHECK_FALSE(outside.setView(parent, 0, 0, 0, 1));
+        ImageOf<PixelMono> mono;
+        CHECK_FALSE(mono.setView(parent, 0, 0, 1, 1));
+        CHECK(mono.getPixelCode() == VOCAB_PIXEL_MONO);
+
+        // A copy has the pixels of the region, with the default padding.
+        FlexImage flex;
+        flex.copy(view);
+        CHECK_FALSE(flex.isView());
+        CHECK(flex.getPixelCode() == VOCAB_PIXEL_RGB);
+        CHECK(flex.getRowSize() < parent.getRowSize());
+        CHECK(samePixels(flex, view));
+
+        // The view is sent as a plain image.
+        ImageOf<PixelRgb> received;
+        REQUIRE(Portable::copyPortable(view, received));
+        CHECK_FALSE(received.isView());
+        CHECK(samePixels(received, view));
+
+        // The right half of the parent, up to its last pixel.
+        ImageOf<PixelRgb> right;
+        REQUIRE(right.setView(parent, 33, 0, 32, 48));
+        CHECK(right.getRawImage() + right.getRawImageSize() == reinterpret_cast<unsigned char*>(&parent(64, 47) + 1));
+        REQUIRE(Portable::copyPortable(right, received));
+        CHECK(samePixels(received, right));
+
+        // A view of a view.
+        ImageOf<PixelRgb> inner;
+        REQUIRE(inner.setView(view, 1, 2, 3, 4));
+        CHECK(&inner(0, 0) == &parent(11, 7));
+
+        // Zeroing a view leaves the rest of the parent alone.
+        ImageOf<PixelRgb> before;
+        before.copy(parent);
+        view.zero();
+        bool untouched = true;
+        bool zeroed = true;
+        for (size_t y = 0; y < parent.height(); y++) {
+            for (size_t x = 0; x < parent.width(); x++) {
+                bool inside = x >= 10 && x < 31 && y >= 5 && y < 35;
+                if (inside) {
+                    zeroed = zeroed && samePixel(parent(x, y), PixelRgb(0, 0, 0));
+                } else {
+                    untouched = untouched && samePixel(parent(x, y), before(x, y));
+                }
+            }
+        }
+        CHECK(zeroed);
+        CHECK(untouched);
+
+        // A parent with the origin at the bottom.
+        FlexImage bottom;
+        bottom.setPixelCode(VOCAB_PIXEL_MONO);
+        bottom.setTopIsLowIndex(false);
+        bottom.resize(16, 8);
+        fillPattern(bottom);
+        FlexImage bottomView;
+        REQUIRE(bottomView.setView(bottom, 4, 2, 8, 3));
+        CHECK_FALSE(bottomView.topIsLowIndex());
+        CHECK(bottomView.getPixelAddress(0, 0) == bottom.getPixelAddress(4, 2));
+        CHECK(bottomView.getPixelAddress(7, 2) == bottom.getPixelAddress(11, 4));
+
+        // Resizing the view makes it an image of its own.
+        view.resize(5, 5);
+        CHECK_FALSE(view.isView());
+    }
+
+    SECTION("check image views of shared images")
+    {
+        auto parent = std::make_shared<ImageOf<PixelRgb>>();
+        parent->resize(64, 48);
+        fillPattern(*parent);
+        ImageOf<PixelRgb> expected;
+        expected.copy(*parent);
+        std::weak_ptr<ImageOf<PixelRgb>> weak = parent;
+
+        // The views keep the parent alive.
+        ImageOf<PixelRgb> left;
+        ImageOf<PixelRgb> right;
+        REQUIRE(left.setView(parent, 0, 0, 32, 48));
+        REQUIRE(right.setView(parent, 32, 0, 32, 48));
+        parent.reset();
+        CHECK_FALSE(weak.expired());
+
+        // Same pixels as the copying split.
+        ImageOf<PixelRgb> leftCopy;
+        ImageOf<PixelRgb> rightCopy;
+        REQUIRE(utils::vertSplit(expected, leftCopy, rightCopy));
+        CHECK(samePixels(left, leftCopy));
+        CHECK(samePixels(right, rightCopy));
+        ImageOf<PixelRgb> received;
+        REQUIRE(Portable::copyPortable(right, received));
+        CHECK(samePixels(received, rightCopy));
+
+        // A moved view still shares the parent.
+        ImageOf<PixelRgb> moved(std::move(left));
+        CHECK(moved.isView());
+        CHECK(samePixels(moved, leftCopy));
+
+        // The parent goes with the last view.
+        moved.resize(1, 1);
+        CHECK_FALSE(weak.expired());
+        {
+            ImageOf<PixelRgb> last(std::move(right));
+        }
+        CHECK(weak.expired());
+    }
+
+    SECTION("check compressed images")
+    {
+        // Smooth images, as the ones of a camera, with a flat area.
+        auto fillSmooth = [](Image& img) {
+            for (size_t y = 0; y < img.height(); y++) {
+                for (size_t x = 0; x < img.width(); x++) {
+                    unsigned char* p = img.getPixelAddress(x, y);
+                    for (size_t c = 0; c < img.getPixelSize(); c++) {
+                        p[c] = (x < 16) ? 0 : static_cast<unsigned char>(x + 2 * y + 40 * c);
+                    }
+                }
+            }
+        };
+        // Serialize an image for a connection with the given modifiers.
+        auto send = [](const Image& img, const std::string& modifiers, Image& received, size_t& size) {
+            Bottle b(modifiers);
+            BufferedConnectionWriter writer;
+            writer.setConnectionModifiers(&b);
+            bool ok = img.write(writer);
+            size = writer.dataSize();
+            return ok && writer.write(received);
+        };
+        size_t size = 0;
+
+        ImageOf<PixelRgb> rgb;
+        rgb.resize(97, 60);
+        fillSmooth(rgb);
+        const size_t rawSize = rgb.getRawImageSize();
+
+        INFO("lossless codecs are exact");
+        for (const char* codec : {"(codec qoi)", "(codec lossless)"}) {
+            ImageOf<PixelRgb> received;
+            REQUIRE(send(rgb, codec, received, size));
+            CHECK(size < rawSize / 2);
+            CHECK(samePixels(received, rgb));
+        }
+        ImageOf<PixelRgba> rgba;
+        rgba.resize(33, 20);
+        fillSmooth(rgba);
+        rgba.pixel(5, 5).a = 17;
+        {
+            FlexImage received;
+            REQUIRE(send(rgba, "(codec lossless)", received, size));
+            CHECK(received.getPixelCode() == VOCAB_PIXEL_RGBA);
+            CHECK(samePixels(received, rgba));
+        }
+
+        INFO("depth codec is exact");
+        ImageOf<PixelMono16> depth;
+        depth.resize(80, 61);
+        for (size_t y = 0; y < depth.height(); y++) {
+            for (size_t x = 0; x < depth.width(); x++) {
+                depth(x, y) = (x < 20) ? 0 : static_cast<PixelMono16>(1000 + 7 * x + 3 * y + (x * y) % 5);
+            }
+        }
+        depth(79, 60) = 65535;
+        {
+            ImageOf<PixelMono16> received;
+            REQUIRE(send(depth, "(codec depth)", received, size));
+            CHECK(size < depth.getRawImageSize() / 2);
+            CHECK(samePixels(received, depth));
+        }
+        ImageOf<PixelFloat> floats;
+        floats.resize(40, 30);
+        for (size_t y = 0; y < floats.height(); y++) {
+            for (size_t x = 0; x < floats.width(); x++) {
+                floats(x, y) = (y < 10) ? 0.0F : 0.5F + 0.001F * x - 0.25F * y;
+            }
+        }
+        {
+            ImageOf<PixelFloat> received;
+            REQUIRE(send(floats, "(codec lossless)", received, size));
+            CHECK(size < floats.getRawImageSize());
+            CHECK(samePixels(received, floats));
+        }
+
+        INFO("jpeg is close");
+        {
+            ImageOf<PixelRgb> received;
+            REQUIRE(send(rgb, "(codec jpeg) (quality 95)", received, size));
+            CHECK(size < rawSize / 2);
+            REQUIRE(received.width() == rgb.width());
+            REQUIRE(received.height() == rgb.height());
+            double error = 0;
+            for (size_t y = 0; y < rgb.height(); y++) {
+                for (size_t x = 0; x < rgb.width(); x++) {
+                    error += std::abs(received(x, y).r - rgb(x, y).r) + std::abs(received(x, y).b - rgb(x, y).b);
+                }
+            }
+            CHECK(error / (2 * rgb.width() * rgb.height()) < 4);
+
+            // The decoded image is converted to the pixel type of the reader.
+            ImageOf<PixelBgr> bgr;
+            REQUIRE(send(rgb, "(codec jpeg)", bgr, size));
+            CHECK(std::abs(bgr(50, 30).r - rgb(50, 30).r) < 8);
+            CHECK(std::abs(bgr(50, 30).b - rgb(50, 30).b) < 8);
+        }
+
+        INFO("images the codec cannot help are sent raw");
+        {
+            ImageOf<PixelRgb> noise;
+            noise.resize(32, 32);
+            fillPattern(noise);
+            ImageOf<PixelRgb> received;
+            REQUIRE(send(noise, "(codec qoi)", received, size));
+            CHECK(size > noise.getRawImageSize());
+            CHECK(samePixels(received, noise));
+            REQUIRE(send(depth, "(codec qoi)", received, size));
+            CHECK(size > depth.getRawImageSize());
+        }
+
+        INFO("corrupted payloads are refused");
+        {
+            Bottle b("(codec qoi)");
+            BufferedConnectionWriter writer;
+            writer.setConnectionModifiers(&b);
+            REQUIRE(rgb.write(writer));
+            std::string bytes = writer.toString();
+            // The header, the codec, the blob tag and length, then the
+            // payload, replaced by literal pixels that end too early.
+            const size_t headerSize = sizeof(ImageNetworkHeader) + sizeof(NetInt32);
+            REQUIRE(bytes.size() > headerSize);
+            std::fill(bytes.begin() + headerSize, bytes.end(), '\xfe');
+            DummyConnector con;
+            con.getWriter().appendBlock(bytes.data(), bytes.size());
+            ImageOf<PixelRgb> received;
+            CHECK_FALSE(received.read(con.getReader()));
+
+            // A payload larger than the raw image is refused before
+            // anything is allocated for it.
+            bytes = writer.toString();
+            NetInt32 huge = 0x7fffffff;
+            memcpy(&bytes[headerSize - sizeof(NetInt32)], &huge, sizeof(huge));
+            DummyConnector con2;
+            con2.getWriter().appendBlock(bytes.data(), bytes.size());
+            yarp::sig::impl::resetImageBufferPoolStats();
+            CHECK_FALSE(received.read(con2.getReader()));
+            CHECK(yarp::sig::impl::getImageBufferPoolStats().misses == 0);
+        }
+
+        INFO("each connection gets the form it asked for");
+        {
+            Port output;
+            BufferedPort<ImageOf<PixelRgb>> plain;
+            BufferedPort<ImageOf<PixelRgb>> compressed;
+            BufferedPort<Bottle> raw;
+            REQUIRE(output.open("/codec/out"));
+            REQUIRE(plain.open("/codec/plain"));
+            REQUIRE(compressed.open("/codec/compressed"));
+            REQUIRE(raw.open("/codec/raw"));
+            REQUIRE(output.addOutput(Contact("/codec/plain", "tcp")));
+            REQUIRE(output.addOutput(Contact("/codec/compressed", "tcp+codec.qoi")));
+            REQUIRE(output.addOutput(Contact("/codec/raw", "tcp+codec.qoi")));
+
+            output.write(rgb);
+            ImageOf<PixelRgb>* img1 = plain.read();
+            ImageOf<PixelRgb>* img2 = compressed.read();
+            Bottle* b = raw.read();
+            REQUIRE(img1 != nullptr);
+            REQUIRE(img2 != nullptr);
+            REQUIRE(b != nullptr);
+            CHECK(samePixels(*img1, rgb));
+            CHECK(samePixels(*img2, rgb));
+            // (mat rgb (depth imgSize quantum width height codec) <payload>)
+            REQUIRE(b->size() == 4);
+            REQUIRE(b->get(2).asList() != nullptr);
+            CHECK(b->get(2).asList()->size() == 6);
+            CHECK(b->get(2).asList()->get(5).asInt32() == ImageNetworkHeader::codecQoi);
+            CHECK(b->get(3).asBlobLength() < rawSize / 2);
+
+            output.close();
+            plain.close();
+            compressed.close();
+            raw.close();
+        }
+    }
+
     NetworkBase::setLocalMode(false);
 }
+
+
+TEST_CASE("sig::ImageCopyBenchmark", "[yarp::sig][.][benchmark]")
+{
+    const std::pair<int, int> conversions[] = {{VOCAB_PIXEL_BGR, VOCAB_PIXEL_RGB},
+                                               {VOCAB_PIXEL_RGBA, VOCAB_PIXEL_RGB},
+                                               {VOCAB_PIXEL_RGB, VOCAB_PIXEL_BGRA},
+                                               {VOCAB_PIXEL_MONO, VOCAB_PIXEL_RGB},
+                                               {VOCAB_PIXEL_RGB, VOCAB_PIXEL_MONO}};
+    PixelConversionKernels best = yarp::sig::impl::getPixelConversionKernels();
+    for (const auto& conversion : conversions) {
+        FlexImage src;
+        src.setPixelCode(conversion.first);
+        src.resize(1280, 720);
+        fillPattern(src);
+        FlexImage dest;
+        dest.setPixelCode(conversion.second);
+        std::string name = Vocab::decode(conversion.first) + " to " + Vocab::decode(conversion.second);
+
+        yarp::sig::impl::setPixelConversionKernels(PixelConversionKernels::Reference);
+        BENCHMARK("1280x720 " + name + ", one pixel at a time")
+        {
+            dest.copy(src);
+        }
+        yarp::sig::impl::setPixelConversionKernels(best);
+        BENCHMARK("1280x720 " + name + ", row kernels")
+        {
+            dest.copy(src);
+        }
+    }
+}